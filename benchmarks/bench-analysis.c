@@ -0,0 +1,889 @@
+/*
+ * bench-analysis.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#include "wf-gst.h"
+#include "wf-pcm-cache.h"
+#include "wf-readahead.h"
+#include "wf-spectra.h"
+#include "wf-waveform.h"
+
+/*
+ * The analysis and drawing hot paths, on audio generated with
+ * audiotestsrc: how fast a file is turned into peaks, how long the peaks
+ * take to resample into seek bar bars at a few widths, how long one
+ * spectrum message takes to convert, how soon audio reaches a sink
+ * after a flushing seek, and whether a segment loop joins its passes on
+ * the exact sample. The source case reads a file through filesrc and
+ * through wfmmapsrc, for the wall and CPU time each takes. The readahead
+ * case drops a file from the page cache, reads it cold, then has
+ * WfReadahead pull it in behind a seek window and reads it again. The
+ * pcm-cache case analyses a file while keeping its decoded audio, for
+ * what that costs in time and memory per minute of audio, and how long
+ * a file the default budget holds. Each result is one JSON object on a
+ * line of its own, so runs can be compared over time.
+ *
+ * Usage: bench-analysis [peaks|bars|spectra|seek|loop|source|readahead|pcm-cache] [seconds of audio]
+ */
+
+#define SAMPLE_RATE      44100
+#define DEFAULT_SECONDS  600
+#define BAR_WIDTH        4.0
+#define BAR_SPACING      2.2
+#define BAR_PEAKS        14400 /* an hour */
+#define BAR_ROUNDS       2000
+#define SPECTRA_ROUNDS   200000
+#define N_SEEKS          50
+#define SEEK_TIMEOUT     (5 * G_TIME_SPAN_SECOND)
+#define N_PASSES         20
+#define LOOP_START       (1234567 * GST_USECOND) /* off any buffer boundary */
+#define LOOP_END         (3456789 * GST_USECOND)
+#define SOURCE_ROUNDS    5
+#define READ_CHUNK       (1024 * 1024)
+#define CACHE_TIMEOUT    (30 * G_TIME_SPAN_SECOND)
+
+typedef struct
+{
+    GMutex lock;
+    GCond cond;
+    gboolean waiting;
+    gboolean flushed;
+    gint64 seek_time;
+    gint64 latency;
+} SeekProbe;
+
+typedef struct
+{
+    GMutex lock;
+    GstSegment segment;
+    gboolean in_pass;
+    gint64 first_sample;
+    gint64 pass_samples;
+    gint64 max_length_error;
+    gint64 max_start_error;
+    guint passes;
+} LoopProbe;
+
+/* Encodes a stereo tick track with @encoder; returns NULL if there is no
+ * such encoder. */
+static gchar *
+write_audio (const gchar *dir,
+             const gchar *name,
+             const gchar *encoder,
+             guint        seconds)
+{
+    GstElementFactory *factory;
+    GstElement *pipeline;
+    GstMessage *message;
+    GstBus *bus;
+    gchar *path, *description;
+
+    factory = gst_element_factory_find (encoder);
+    if (!factory)
+        return NULL;
+    gst_object_unref (factory);
+
+    path = g_build_filename (dir, name, NULL);
+    description = g_strdup_printf ("audiotestsrc wave=ticks num-buffers=%u samplesperbuffer=%u "
+                                   "! audio/x-raw,rate=%u,channels=2 ! audioconvert ! %s "
+                                   "! filesink location=\"%s\"",
+                                   seconds * 10, SAMPLE_RATE / 10, SAMPLE_RATE, encoder, path);
+    pipeline = gst_parse_launch (description, NULL);
+    g_free (description);
+    if (!pipeline) {
+        g_free (path);
+        return NULL;
+    }
+
+    bus = gst_element_get_bus (pipeline);
+    gst_element_set_state (pipeline, GST_STATE_PLAYING);
+    message = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+                                          GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_ERROR)
+        g_clear_pointer (&path, g_free);
+    gst_message_unref (message);
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (bus);
+    gst_object_unref (pipeline);
+
+    return path;
+}
+
+static void
+remove_tree (const gchar *path)
+{
+    const gchar *name;
+    gchar *child;
+    GDir *dir;
+
+    dir = g_dir_open (path, 0, NULL);
+    if (dir) {
+        while ((name = g_dir_read_name (dir))) {
+            child = g_build_filename (path, name, NULL);
+            remove_tree (child);
+            g_free (child);
+        }
+        g_dir_close (dir);
+    }
+
+    g_remove (path);
+}
+
+static gint
+compare_latency (gconstpointer a,
+                 gconstpointer b)
+{
+    gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Decoding and the level element, as when a file is opened. The decoded
+ * audio is not kept, so only the analysis itself is timed. */
+static gboolean
+bench_peaks (const gchar *path,
+             const gchar *format,
+             guint        seconds)
+{
+    WfWaveform *waveform;
+    GMainLoop *loop;
+    GArray *peaks;
+    gchar *uri;
+    gint64 start;
+    gdouble elapsed;
+
+    waveform = wf_waveform_new ();
+    g_object_set (waveform, "cache-budget", 0, NULL);
+    loop = g_main_loop_new (NULL, FALSE);
+    g_signal_connect_swapped (waveform, "ready", G_CALLBACK (g_main_loop_quit), loop);
+
+    uri = g_filename_to_uri (path, NULL, NULL);
+    start = g_get_monotonic_time ();
+    wf_waveform_set_file (waveform, uri);
+    g_main_loop_run (loop);
+    elapsed = (g_get_monotonic_time () - start) / (gdouble) G_TIME_SPAN_SECOND;
+
+    peaks = wf_waveform_get_peaks (waveform);
+    g_print ("{\"benchmark\": \"peaks\", \"format\": \"%s\", \"seconds\": %u, "
+             "\"peaks\": %u, \"time_ms\": %.1f, \"realtime\": %.1f}\n",
+             format, seconds, peaks->len, elapsed * 1000, seconds / elapsed);
+
+    g_free (uri);
+    g_main_loop_unref (loop);
+    g_object_unref (waveform);
+
+    return peaks->len > 0;
+}
+
+/* Sized as WfSeekBar sizes them. */
+static gboolean
+bench_bars (void)
+{
+    const guint widths[] = {320, 800, 1920, 3840};
+    GArray *peaks, *bars;
+    WfPeakData peak;
+    gdouble sum = 0.0;
+    guint n_bars;
+    gint64 start;
+    gdouble elapsed;
+
+    peaks = g_array_sized_new (FALSE, FALSE, sizeof (WfPeakData), BAR_PEAKS);
+    for (guint i = 0; i < BAR_PEAKS; i++) {
+        peak.left = g_random_double ();
+        peak.right = g_random_double ();
+        g_array_append_val (peaks, peak);
+    }
+
+    for (guint i = 0; i < G_N_ELEMENTS (widths); i++) {
+        n_bars = (widths[i] - BAR_SPACING) / (BAR_WIDTH + BAR_SPACING);
+        start = g_get_monotonic_time ();
+        for (guint j = 0; j < BAR_ROUNDS; j++) {
+            bars = wf_peak_data_to_bars (peaks, 0, peaks->len, n_bars);
+            sum += g_array_index (bars, gdouble, j % n_bars);
+            g_array_unref (bars);
+        }
+        elapsed = g_get_monotonic_time () - start;
+
+        g_print ("{\"benchmark\": \"bars\", \"width\": %u, \"bars\": %u, \"peaks\": %u, "
+                 "\"us_per_op\": %.2f}\n",
+                 widths[i], n_bars, peaks->len, elapsed / BAR_ROUNDS);
+    }
+
+    g_array_unref (peaks);
+
+    return sum > 0.0;
+}
+
+static void
+fill_list (GValue *list,
+           guint   n_bands,
+           gfloat  first,
+           gfloat  step)
+{
+    GValue value = G_VALUE_INIT;
+
+    g_value_init (list, GST_TYPE_LIST);
+    g_value_init (&value, G_TYPE_FLOAT);
+    for (guint i = 0; i < n_bands; i++) {
+        g_value_set_float (&value, first + i * step);
+        gst_value_list_append_value (list, &value);
+    }
+    g_value_unset (&value);
+}
+
+/* The spectrum element's magnitudes and phases, as the player gets them
+ * for every message. */
+static gboolean
+bench_spectra (void)
+{
+    const guint bands[] = {20, 128, 1024};
+    GValue magnitude = G_VALUE_INIT, phase = G_VALUE_INIT;
+    WfSpectra *spectra;
+    gdouble sum = 0.0;
+    guint rounds;
+    gint64 start;
+    gdouble elapsed;
+
+    for (guint i = 0; i < G_N_ELEMENTS (bands); i++) {
+        fill_list (&magnitude, bands[i], -80.0f, 60.0f / bands[i]);
+        fill_list (&phase, bands[i], -3.0f, 6.0f / bands[i]);
+        spectra = wf_spectra_new (bands[i]);
+
+        rounds = SPECTRA_ROUNDS / bands[i] * 20;
+        start = g_get_monotonic_time ();
+        for (guint j = 0; j < rounds; j++) {
+            wf_spectra_set_values (spectra, &magnitude, &phase);
+            sum += spectra->magnitude[j % bands[i]];
+        }
+        elapsed = g_get_monotonic_time () - start;
+
+        g_print ("{\"benchmark\": \"spectra\", \"bands\": %u, \"ns_per_op\": %.1f, "
+                 "\"ns_per_band\": %.2f}\n",
+                 bands[i], elapsed * 1000.0 / rounds, elapsed * 1000.0 / rounds / bands[i]);
+
+        wf_spectra_free (spectra);
+        g_value_unset (&magnitude);
+        g_value_unset (&phase);
+    }
+
+    return sum > 0.0;
+}
+
+/* Only a buffer after the flush counts; one still on its way from before
+ * the seek says nothing about it. */
+static GstPadProbeReturn
+seek_probe_cb (GstPad          *pad,
+               GstPadProbeInfo *info,
+               gpointer         user_data)
+{
+    SeekProbe *probe = user_data;
+    GstEvent *event;
+
+    g_mutex_lock (&probe->lock);
+    if (info->type & GST_PAD_PROBE_TYPE_EVENT_FLUSH) {
+        event = GST_PAD_PROBE_INFO_EVENT (info);
+        if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP)
+            probe->flushed = TRUE;
+    } else if (probe->waiting && probe->flushed) {
+        probe->latency = g_get_monotonic_time () - probe->seek_time;
+        probe->waiting = FALSE;
+        g_cond_signal (&probe->cond);
+    }
+    g_mutex_unlock (&probe->lock);
+
+    return GST_PAD_PROBE_OK;
+}
+
+/* Accurate flushing seeks, as the player makes them, into a playing
+ * pipeline with a clock-synced fakesink in place of the audio device. */
+static gboolean
+bench_seek (const gchar *path,
+            const gchar *format,
+            guint        seconds)
+{
+    GstElement *playbin, *sink;
+    GstPad *pad;
+    SeekProbe probe = {0};
+    GArray *latencies;
+    gdouble total = 0.0;
+    gchar *uri;
+    gint64 end_time, latency;
+    gboolean ok = TRUE;
+
+    playbin = gst_element_factory_make ("playbin", NULL);
+    sink = gst_element_factory_make ("fakesink", NULL);
+    if (!playbin || !sink) {
+        g_clear_object (&playbin);
+        g_clear_object (&sink);
+        return FALSE;
+    }
+
+    g_mutex_init (&probe.lock);
+    g_cond_init (&probe.cond);
+    g_object_set (sink, "sync", TRUE, NULL);
+    pad = gst_element_get_static_pad (sink, "sink");
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+                       seek_probe_cb, &probe, NULL);
+    gst_object_unref (pad);
+
+    uri = g_filename_to_uri (path, NULL, NULL);
+    g_object_set (playbin, "uri", uri, "audio-sink", sink, NULL);
+    gst_element_set_state (playbin, GST_STATE_PLAYING);
+    gst_element_get_state (playbin, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+    latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+    for (guint i = 0; i < N_SEEKS && ok; i++) {
+        g_mutex_lock (&probe.lock);
+        probe.waiting = TRUE;
+        probe.flushed = FALSE;
+        probe.seek_time = g_get_monotonic_time ();
+        g_mutex_unlock (&probe.lock);
+
+        gst_element_seek_simple (playbin, GST_FORMAT_TIME,
+                                 GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE,
+                                 g_random_int_range (0, seconds - 1) * GST_SECOND +
+                                 g_random_int_range (0, 1000) * GST_MSECOND);
+
+        end_time = g_get_monotonic_time () + SEEK_TIMEOUT;
+        g_mutex_lock (&probe.lock);
+        while (probe.waiting && ok)
+            ok = g_cond_wait_until (&probe.cond, &probe.lock, end_time);
+        latency = probe.latency;
+        g_mutex_unlock (&probe.lock);
+
+        if (ok) {
+            g_array_append_val (latencies, latency);
+            total += latency;
+        }
+        g_usleep (20000);
+    }
+
+    gst_element_set_state (playbin, GST_STATE_NULL);
+
+    if (latencies->len > 0) {
+        g_array_sort (latencies, compare_latency);
+        g_print ("{\"benchmark\": \"seek\", \"format\": \"%s\", \"seeks\": %u, "
+                 "\"mean_ms\": %.2f, \"median_ms\": %.2f, \"max_ms\": %.2f}\n",
+                 format, latencies->len, total / latencies->len / 1000.0,
+                 g_array_index (latencies, gint64, latencies->len / 2) / 1000.0,
+                 g_array_index (latencies, gint64, latencies->len - 1) / 1000.0);
+    }
+
+    g_array_unref (latencies);
+    g_free (uri);
+    gst_object_unref (playbin);
+    g_mutex_clear (&probe.lock);
+    g_cond_clear (&probe.cond);
+
+    return ok;
+}
+
+static inline gint64
+time_to_samples (GstClockTime time)
+{
+    return (gint64) gst_util_uint64_scale_round (time, SAMPLE_RATE, GST_SECOND);
+}
+
+static void
+end_pass (LoopProbe *probe)
+{
+    gint64 expected;
+
+    if (!probe->in_pass)
+        return;
+
+    expected = time_to_samples (LOOP_END) - time_to_samples (LOOP_START);
+    probe->max_length_error = MAX (probe->max_length_error,
+                                   ABS (probe->pass_samples - expected));
+    probe->max_start_error = MAX (probe->max_start_error,
+                                  ABS (probe->first_sample - time_to_samples (LOOP_START)));
+    probe->passes++;
+    probe->in_pass = FALSE;
+}
+
+/* Counts the samples each pass hands to the sink, clipped to the segment
+ * as an audio sink clips them. Every pass of a segment loop starts with
+ * a segment event of its own. */
+static GstPadProbeReturn
+loop_probe_cb (GstPad          *pad,
+               GstPadProbeInfo *info,
+               gpointer         user_data)
+{
+    LoopProbe *probe = user_data;
+    GstEvent *event;
+    GstBuffer *buffer;
+    guint64 start, stop;
+
+    g_mutex_lock (&probe->lock);
+    if (info->type & (GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM | GST_PAD_PROBE_TYPE_EVENT_FLUSH)) {
+        event = GST_PAD_PROBE_INFO_EVENT (info);
+        /* The preroll before the first seek is not a pass. */
+        if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+            probe->in_pass = FALSE;
+        } else if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT) {
+            end_pass (probe);
+            gst_event_copy_segment (event, &probe->segment);
+        }
+    } else {
+        buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+        start = GST_BUFFER_PTS (buffer);
+        stop = start + GST_BUFFER_DURATION (buffer);
+        if (probe->segment.format == GST_FORMAT_TIME &&
+            GST_BUFFER_PTS_IS_VALID (buffer) && GST_BUFFER_DURATION_IS_VALID (buffer) &&
+            gst_segment_clip (&probe->segment, GST_FORMAT_TIME, start, stop, &start, &stop)) {
+            if (!probe->in_pass) {
+                probe->in_pass = TRUE;
+                probe->first_sample = time_to_samples (start);
+                probe->pass_samples = 0;
+            }
+            probe->pass_samples += time_to_samples (stop) - time_to_samples (start);
+        }
+    }
+    g_mutex_unlock (&probe->lock);
+
+    return GST_PAD_PROBE_OK;
+}
+
+/* A loop as the player plays it: a flushing segment seek to start with,
+ * then a non-flushing one back to the start on every segment-done. The
+ * sink does not sync, so the passes run as fast as they decode. */
+static gboolean
+bench_loop (const gchar *path,
+            const gchar *format)
+{
+    GstElement *playbin, *sink;
+    GstMessage *message;
+    GstBus *bus;
+    GstPad *pad;
+    LoopProbe probe = {0};
+    gchar *uri;
+    gint64 start;
+    gdouble elapsed;
+    guint segments = 0;
+    gboolean ok;
+
+    playbin = gst_element_factory_make ("playbin", NULL);
+    sink = gst_element_factory_make ("fakesink", NULL);
+    if (!playbin || !sink) {
+        g_clear_object (&playbin);
+        g_clear_object (&sink);
+        return FALSE;
+    }
+
+    g_mutex_init (&probe.lock);
+    gst_segment_init (&probe.segment, GST_FORMAT_UNDEFINED);
+    pad = gst_element_get_static_pad (sink, "sink");
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM |
+                       GST_PAD_PROBE_TYPE_EVENT_FLUSH, loop_probe_cb, &probe, NULL);
+    gst_object_unref (pad);
+
+    uri = g_filename_to_uri (path, NULL, NULL);
+    g_object_set (playbin, "uri", uri, "audio-sink", sink, NULL);
+    bus = gst_element_get_bus (playbin);
+    gst_element_set_state (playbin, GST_STATE_PAUSED);
+    gst_element_get_state (playbin, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+    start = g_get_monotonic_time ();
+    ok = gst_element_seek (playbin, 1.0, GST_FORMAT_TIME,
+                           GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_SEGMENT | GST_SEEK_FLAG_ACCURATE,
+                           GST_SEEK_TYPE_SET, LOOP_START, GST_SEEK_TYPE_SET, LOOP_END);
+    gst_element_set_state (playbin, GST_STATE_PLAYING);
+
+    while (ok && segments < N_PASSES) {
+        message = gst_bus_timed_pop_filtered (bus, SEEK_TIMEOUT * GST_USECOND,
+                                              GST_MESSAGE_SEGMENT_DONE | GST_MESSAGE_EOS |
+                                              GST_MESSAGE_ERROR);
+        ok = message && GST_MESSAGE_TYPE (message) == GST_MESSAGE_SEGMENT_DONE;
+        g_clear_pointer (&message, gst_message_unref);
+
+        if (ok && ++segments < N_PASSES)
+            ok = gst_element_seek (playbin, 1.0, GST_FORMAT_TIME,
+                                   GST_SEEK_FLAG_SEGMENT | GST_SEEK_FLAG_ACCURATE,
+                                   GST_SEEK_TYPE_SET, LOOP_START, GST_SEEK_TYPE_SET, LOOP_END);
+    }
+    elapsed = (g_get_monotonic_time () - start) / (gdouble) G_TIME_SPAN_MILLISECOND;
+
+    gst_element_set_state (playbin, GST_STATE_NULL);
+
+    /* Both are off by at most one sample from rounding. */
+    g_mutex_lock (&probe.lock);
+    end_pass (&probe);
+    ok = ok && probe.passes == N_PASSES &&
+         probe.max_length_error <= 1 && probe.max_start_error <= 1;
+    g_print ("{\"benchmark\": \"loop\", \"format\": \"%s\", \"passes\": %u, "
+             "\"max_length_error\": %" G_GINT64_FORMAT ", "
+             "\"max_start_error\": %" G_GINT64_FORMAT ", \"ms_per_pass\": %.2f}\n",
+             format, probe.passes, probe.max_length_error, probe.max_start_error,
+             elapsed / MAX (probe.passes, 1));
+    g_mutex_unlock (&probe.lock);
+
+    gst_object_unref (bus);
+    g_free (uri);
+    gst_object_unref (playbin);
+    g_mutex_clear (&probe.lock);
+
+    return ok;
+}
+
+static gint64
+cpu_time (void)
+{
+    struct rusage usage;
+
+    getrusage (RUSAGE_SELF, &usage);
+
+    return (gint64) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * G_USEC_PER_SEC +
+           usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+/* The file is read whole into a fakesink, first once to have it in the
+ * page cache, then SOURCE_ROUNDS times for the figures. Parsing it shows
+ * what the copy in filesrc costs next to what a parser does anyway. */
+static gboolean
+bench_source (const gchar *path,
+              const gchar *format)
+{
+    const gchar *sources[] = {"filesrc", "wfmmapsrc"};
+    GstElement *pipeline;
+    GstMessage *message;
+    GstBus *bus;
+    gchar *description;
+    gint64 start, cpu_start, wall = 0, cpu = 0;
+    gboolean ok = TRUE;
+
+    for (guint i = 0; i < G_N_ELEMENTS (sources) && ok; i++) {
+        description = g_strdup_printf ("%s location=\"%s\" ! parsebin ! fakesink sync=false",
+                                       sources[i], path);
+        wall = cpu = 0;
+        for (guint round = 0; round <= SOURCE_ROUNDS && ok; round++) {
+            pipeline = gst_parse_launch (description, NULL);
+            if (!pipeline) {
+                ok = FALSE;
+                break;
+            }
+
+            bus = gst_element_get_bus (pipeline);
+            start = g_get_monotonic_time ();
+            cpu_start = cpu_time ();
+            gst_element_set_state (pipeline, GST_STATE_PLAYING);
+            message = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+                                                  GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+            ok = GST_MESSAGE_TYPE (message) == GST_MESSAGE_EOS;
+            gst_message_unref (message);
+            gst_element_set_state (pipeline, GST_STATE_NULL);
+            if (round > 0) {
+                wall += g_get_monotonic_time () - start;
+                cpu += cpu_time () - cpu_start;
+            }
+
+            gst_object_unref (bus);
+            gst_object_unref (pipeline);
+        }
+        g_free (description);
+
+        if (ok)
+            g_print ("{\"benchmark\": \"source\", \"format\": \"%s\", \"element\": \"%s\", "
+                     "\"wall_ms\": %.2f, \"cpu_ms\": %.2f}\n",
+                     format, sources[i], wall / 1000.0 / SOURCE_ROUNDS,
+                     cpu / 1000.0 / SOURCE_ROUNDS);
+    }
+
+    return ok;
+}
+
+/* The share of @path in the page cache. */
+static gdouble
+cached_fraction (const gchar *path)
+{
+    guchar *pages;
+    gsize n_pages, n_cached = 0, page_size;
+    gpointer map;
+    GStatBuf st;
+    gint fd;
+
+    fd = g_open (path, O_RDONLY, 0);
+    if (fd < 0 || fstat (fd, &st) < 0 || st.st_size == 0) {
+        if (fd >= 0)
+            g_close (fd, NULL);
+        return 0.0;
+    }
+
+    page_size = sysconf (_SC_PAGESIZE);
+    n_pages = (st.st_size + page_size - 1) / page_size;
+    map = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    g_close (fd, NULL);
+    if (map == MAP_FAILED)
+        return 0.0;
+
+    pages = g_malloc (n_pages);
+    if (mincore (map, st.st_size, pages) == 0) {
+        for (gsize i = 0; i < n_pages; i++)
+            n_cached += pages[i] & 1;
+    }
+    g_free (pages);
+    munmap (map, st.st_size);
+
+    return (gdouble) n_cached / n_pages;
+}
+
+/* Writes @path out and asks for it to leave the page cache. */
+static void
+drop_cache (const gchar *path)
+{
+    gint fd;
+
+    fd = g_open (path, O_RDONLY, 0);
+    if (fd < 0)
+        return;
+
+    fdatasync (fd);
+    posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+    g_close (fd, NULL);
+}
+
+/* Reads all of @path and returns how long that took, in microseconds. */
+static gint64
+read_file (const gchar *path)
+{
+    gchar *buffer;
+    gint64 start;
+    gint fd;
+
+    fd = g_open (path, O_RDONLY, 0);
+    if (fd < 0)
+        return -1;
+
+    buffer = g_malloc (READ_CHUNK);
+    start = g_get_monotonic_time ();
+    while (read (fd, buffer, READ_CHUNK) > 0)
+        ;
+    start = g_get_monotonic_time () - start;
+    g_free (buffer);
+    g_close (fd, NULL);
+
+    return start;
+}
+
+/* A seek window is queued before the whole file, as when the player
+ * seeks into a track it is about to read ahead: the window must not stand
+ * in for the file, so all of it is expected in the cache in the end. On
+ * a file system without a page cache to drop from, such as a tmpfs
+ * /tmp, the case is skipped; TMPDIR can point elsewhere. */
+static gboolean
+bench_readahead (const gchar *path,
+                 const gchar *format)
+{
+    WfReadahead *readahead;
+    gint64 cold, warm, start, ready;
+    gdouble before, cached;
+    gchar *uri;
+
+    drop_cache (path);
+    before = cached_fraction (path);
+    if (before > 0.5) {
+        g_print ("{\"benchmark\": \"readahead\", \"format\": \"%s\", \"skipped\": "
+                 "\"the file stays cached\"}\n", format);
+        return TRUE;
+    }
+    cold = read_file (path);
+
+    drop_cache (path);
+    readahead = wf_readahead_get_default ();
+    uri = g_filename_to_uri (path, NULL, NULL);
+    start = g_get_monotonic_time ();
+    wf_readahead_queue_position (readahead, uri, 0.5);
+    wf_readahead_queue_file (readahead, uri, 0);
+
+    do {
+        g_usleep (10 * 1000);
+        cached = cached_fraction (path);
+        ready = g_get_monotonic_time () - start;
+    } while (cached < 0.99 && ready < CACHE_TIMEOUT);
+    warm = read_file (path);
+    g_free (uri);
+
+    g_print ("{\"benchmark\": \"readahead\", \"format\": \"%s\", \"cold_read_ms\": %.2f, "
+             "\"readahead_ms\": %.2f, \"cached\": %.3f, \"warm_read_ms\": %.2f}\n",
+             format, cold / 1000.0, ready / 1000.0, cached, warm / 1000.0);
+
+    return cold >= 0 && cached >= 0.99;
+}
+
+static gsize
+resident_size (void)
+{
+    gchar *contents;
+    gsize pages = 0;
+
+    if (g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL)) {
+        sscanf (contents, "%*u %" G_GSIZE_FORMAT, &pages);
+        g_free (contents);
+    }
+
+    return pages * sysconf (_SC_PAGESIZE);
+}
+
+/* Analyses @path once without keeping the decoded audio and once with
+ * the largest budget, so the cache always fills. */
+static gboolean
+bench_pcm_cache (const gchar *path,
+                 const gchar *format,
+                 guint        seconds)
+{
+    WfWaveform *waveform;
+    WfPcmCache *cache;
+    GObjectClass *klass;
+    GParamSpec *pspec;
+    GMainLoop *loop;
+    gchar *uri, *peaks_dir;
+    gint64 start, elapsed[2];
+    gsize resident;
+    gssize grown = 0;
+    guint64 size = 0;
+    gdouble per_minute;
+    guint budget;
+
+    klass = g_type_class_ref (WF_TYPE_WAVEFORM);
+    pspec = g_object_class_find_property (klass, "cache-budget");
+    budget = G_PARAM_SPEC_UINT (pspec)->default_value;
+    uri = g_filename_to_uri (path, NULL, NULL);
+    peaks_dir = g_build_filename (g_get_user_cache_dir (), "wavefront", "peaks", NULL);
+    loop = g_main_loop_new (NULL, FALSE);
+
+    for (guint i = 0; i < 2; i++) {
+        /* Neither run may find the peaks cached. */
+        remove_tree (peaks_dir);
+
+        waveform = wf_waveform_new ();
+        g_object_set (waveform, "cache-budget", i ? G_PARAM_SPEC_UINT (pspec)->maximum : 0, NULL);
+        g_signal_connect_swapped (waveform, "ready", G_CALLBACK (g_main_loop_quit), loop);
+
+        resident = resident_size ();
+        start = g_get_monotonic_time ();
+        wf_waveform_set_file (waveform, uri);
+        g_main_loop_run (loop);
+        elapsed[i] = g_get_monotonic_time () - start;
+
+        if (i) {
+            grown = (gssize) resident_size () - (gssize) resident;
+            cache = wf_pcm_cache_lookup (uri);
+            if (cache) {
+                size = wf_pcm_cache_get_size (cache);
+                g_object_unref (cache);
+            }
+        }
+        g_object_unref (waveform);
+    }
+
+    per_minute = size * 60.0 / seconds / (1024 * 1024);
+    g_print ("{\"benchmark\": \"pcm-cache\", \"format\": \"%s\", \"seconds\": %u, "
+             "\"uncached_ms\": %.1f, \"cached_ms\": %.1f, \"cache_mib\": %.1f, "
+             "\"resident_mib\": %.1f, \"mib_per_minute\": %.2f, "
+             "\"default_budget_mib\": %u, \"default_budget_minutes\": %.1f}\n",
+             format, seconds, elapsed[0] / 1000.0, elapsed[1] / 1000.0,
+             size / (1024.0 * 1024), grown / (1024.0 * 1024), per_minute,
+             budget, per_minute > 0 ? budget / per_minute : 0.0);
+
+    g_main_loop_unref (loop);
+    g_type_class_unref (klass);
+    g_free (peaks_dir);
+    g_free (uri);
+
+    return size > 0;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const gchar *formats[][3] = {
+        {"wav", "bench.wav", "wavenc"},
+        {"flac", "bench.flac", "flacenc"},
+    };
+    const gchar *which;
+    GError *error = NULL;
+    gchar *root, *path;
+    guint seconds;
+    gboolean ok = TRUE;
+
+    which = argc > 1 ? argv[1] : NULL;
+    seconds = argc > 2 ? (guint) strtoul (argv[2], NULL, 10) : DEFAULT_SECONDS;
+    seconds = MAX (seconds, 2);
+
+    root = g_dir_make_tmp ("wf-bench-analysis-XXXXXX", &error);
+    if (!root) {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+
+    /* Keeps the peak cache of the runs out of the user's cache. */
+    g_setenv ("XDG_CACHE_HOME", root, TRUE);
+    gst_init (&argc, &argv);
+    wf_gst_ensure ();
+
+    if (!which || !strcmp (which, "bars"))
+        ok = bench_bars () && ok;
+    if (!which || !strcmp (which, "spectra"))
+        ok = bench_spectra () && ok;
+
+    for (guint i = 0; i < G_N_ELEMENTS (formats); i++) {
+        if (which && strcmp (which, "peaks") && strcmp (which, "seek") &&
+            strcmp (which, "loop") && strcmp (which, "source") &&
+            strcmp (which, "readahead") && strcmp (which, "pcm-cache"))
+            break;
+
+        path = write_audio (root, formats[i][1], formats[i][2], seconds);
+        if (!path)
+            continue;
+        if (!which || !strcmp (which, "peaks"))
+            ok = bench_peaks (path, formats[i][0], seconds) && ok;
+        if (!which || !strcmp (which, "seek"))
+            ok = bench_seek (path, formats[i][0], seconds) && ok;
+        if (!which || !strcmp (which, "loop"))
+            ok = bench_loop (path, formats[i][0]) && ok;
+        if (!which || !strcmp (which, "source"))
+            ok = bench_source (path, formats[i][0]) && ok;
+        if (!which || !strcmp (which, "readahead"))
+            ok = bench_readahead (path, formats[i][0]) && ok;
+        if (!which || !strcmp (which, "pcm-cache"))
+            ok = bench_pcm_cache (path, formats[i][0], seconds) && ok;
+        g_remove (path);
+        g_free (path);
+    }
+
+    remove_tree (root);
+    g_free (root);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+/*
+ * bench-attach.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <gio/gio.h>
+
+/*
+ * Wall-clock time from launching wavefront to its first painted frame,
+ * once as a cold start and once handing over to an instance already
+ * running with --daemon. Needs a display and a session bus.
+ */
+
+#define DAEMON_TIMEOUT  10    /* seconds */
+#define SETTLE_TIME     1000  /* milliseconds */
+
+/* Waits for the instance that logs the first-frame line to do so. Debug
+ * messages go to standard output. */
+static gboolean
+wait_first_frame (GSubprocess *process)
+{
+    GDataInputStream *stream;
+    gboolean found = FALSE;
+    gchar *line;
+
+    stream = g_data_input_stream_new (g_subprocess_get_stdout_pipe (process));
+    while (!found && (line = g_data_input_stream_read_line (stream, NULL, NULL, NULL))) {
+        found = strstr (line, "first-frame") != NULL;
+        g_free (line);
+    }
+    g_object_unref (stream);
+
+    return found;
+}
+
+static gboolean
+wait_name (GDBusConnection *bus)
+{
+    GVariant *reply;
+    gboolean has_owner = FALSE;
+
+    for (guint i = 0; !has_owner && i < DAEMON_TIMEOUT * 100; i++) {
+        reply = g_dbus_connection_call_sync (bus, "org.freedesktop.DBus",
+                                             "/org/freedesktop/DBus", "org.freedesktop.DBus",
+                                             "NameHasOwner", g_variant_new ("(s)", FW_APP_ID),
+                                             G_VARIANT_TYPE ("(b)"), G_DBUS_CALL_FLAGS_NONE,
+                                             -1, NULL, NULL);
+        if (reply) {
+            g_variant_get (reply, "(b)", &has_owner);
+            g_variant_unref (reply);
+        }
+        if (!has_owner)
+            g_usleep (10 * 1000);
+    }
+
+    return has_owner;
+}
+
+static gdouble
+run_cold (const gchar *exe)
+{
+    GSubprocessLauncher *launcher;
+    GSubprocess *process;
+    gint64 start;
+    gdouble elapsed = -1.0;
+
+    launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_STDOUT_PIPE);
+    g_subprocess_launcher_setenv (launcher, "WAVEFRONT_BENCHMARK_STARTUP", "1", TRUE);
+    g_subprocess_launcher_setenv (launcher, "G_MESSAGES_DEBUG", "all", TRUE);
+
+    start = g_get_monotonic_time ();
+    process = g_subprocess_launcher_spawn (launcher, NULL, exe, NULL);
+    if (process && wait_first_frame (process))
+        elapsed = (g_get_monotonic_time () - start) / 1000.0;
+
+    if (process) {
+        g_subprocess_wait (process, NULL, NULL);
+        g_object_unref (process);
+    }
+    g_object_unref (launcher);
+
+    return elapsed;
+}
+
+static gdouble
+run_attach (const gchar     *exe,
+            GDBusConnection *bus)
+{
+    GSubprocessLauncher *launcher;
+    GSubprocess *daemon, *client = NULL;
+    gint64 start;
+    gdouble elapsed = -1.0;
+
+    launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_STDOUT_PIPE);
+    g_subprocess_launcher_setenv (launcher, "WAVEFRONT_BENCHMARK_STARTUP", "attach", TRUE);
+    g_subprocess_launcher_setenv (launcher, "G_MESSAGES_DEBUG", "all", TRUE);
+    daemon = g_subprocess_launcher_spawn (launcher, NULL, exe, "--daemon", NULL);
+    g_object_unref (launcher);
+    if (!daemon)
+        return elapsed;
+
+    if (!wait_name (bus)) {
+        g_subprocess_force_exit (daemon);
+        goto out;
+    }
+
+    /* Let the daemon finish loading GStreamer, as it would have long
+     * before anyone reopens a window. */
+    g_usleep (SETTLE_TIME * 1000);
+
+    launcher = g_subprocess_launcher_new (G_SUBPROCESS_FLAGS_NONE);
+    g_subprocess_launcher_unsetenv (launcher, "WAVEFRONT_BENCHMARK_STARTUP");
+
+    start = g_get_monotonic_time ();
+    client = g_subprocess_launcher_spawn (launcher, NULL, exe, NULL);
+    if (client && wait_first_frame (daemon))
+        elapsed = (g_get_monotonic_time () - start) / 1000.0;
+    else
+        g_subprocess_force_exit (daemon);
+    g_object_unref (launcher);
+
+out:
+    g_subprocess_wait (daemon, NULL, NULL);
+    g_object_unref (daemon);
+    if (client) {
+        g_subprocess_wait (client, NULL, NULL);
+        g_object_unref (client);
+    }
+
+    return elapsed;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    GDBusConnection *bus;
+    GError *error = NULL;
+    gdouble cold, attach;
+
+    if (argc < 2) {
+        g_printerr ("Usage: %s WAVEFRONT\n", argv[0]);
+        return 1;
+    }
+
+    bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+    if (!bus) {
+        g_printerr ("No session bus: %s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+
+    cold = run_cold (argv[1]);
+    attach = run_attach (argv[1], bus);
+    g_object_unref (bus);
+
+    if (cold < 0 || attach < 0) {
+        g_printerr ("wavefront did not show a window\n");
+        return 1;
+    }
+
+    g_print ("cold start  %8.1f ms\n", cold);
+    g_print ("attach      %8.1f ms\n", attach);
+
+    return 0;
+}
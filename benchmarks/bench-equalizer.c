@@ -0,0 +1,157 @@
+/*
+ * bench-equalizer.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <time.h>
+#include <gst/gst.h>
+
+#include "wf-equalizer.h"
+
+/*
+ * CPU cost of WfEqualizer against equalizer-10bands, in microseconds of
+ * CPU time per second of audio per channel. A run through identity is
+ * subtracted so that only the filter itself is measured.
+ *
+ * Each result is one JSON object on a line of its own.
+ */
+
+#define SECONDS          120
+#define CHANNELS         2
+#define SAMPLES_PER_BUF  1024
+
+static gdouble
+cpu_time (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static gdouble
+run (GstElement *filter,
+     gint        rate)
+{
+    GstElement *pipeline, *src, *capsfilter, *sink;
+    GstCaps *caps;
+    GstBus *bus;
+    GstMessage *msg;
+    gdouble start, end;
+
+    pipeline = gst_pipeline_new (NULL);
+    src = gst_element_factory_make ("audiotestsrc", NULL);
+    capsfilter = gst_element_factory_make ("capsfilter", NULL);
+    sink = gst_element_factory_make ("fakesink", NULL);
+
+    caps = gst_caps_new_simple ("audio/x-raw",
+                                "format", G_TYPE_STRING, GST_AUDIO_NE (F32),
+                                "layout", G_TYPE_STRING, "interleaved",
+                                "rate", G_TYPE_INT, rate,
+                                "channels", G_TYPE_INT, CHANNELS,
+                                NULL);
+    g_object_set (src, "wave", 5 /* white noise */, "samplesperbuffer", SAMPLES_PER_BUF,
+                  "num-buffers", SECONDS * rate / SAMPLES_PER_BUF, NULL);
+    g_object_set (capsfilter, "caps", caps, NULL);
+    g_object_set (sink, "sync", FALSE, NULL);
+    gst_caps_unref (caps);
+
+    gst_bin_add_many (GST_BIN (pipeline), src, capsfilter, filter, sink, NULL);
+    gst_element_link_many (src, capsfilter, filter, sink, NULL);
+
+    bus = gst_element_get_bus (pipeline);
+    start = cpu_time ();
+    gst_element_set_state (pipeline, GST_STATE_PLAYING);
+    msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    end = cpu_time ();
+
+    if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+        g_printerr ("Error: pipeline failed at %d Hz\n", rate);
+
+    gst_message_unref (msg);
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (bus);
+    gst_object_unref (pipeline);
+
+    return end - start;
+}
+
+static GstElement *
+make_wf_equalizer (void)
+{
+    WfEqBand bands[WF_EQUALIZER_MAX_BANDS];
+    const WfEqBand *defaults;
+    WfEqualizer *equalizer;
+    guint n_bands;
+
+    defaults = wf_equalizer_get_default_bands (&n_bands);
+    for (guint i = 0; i < n_bands; i++) {
+        bands[i] = defaults[i];
+        bands[i].gain = i % 2 ? -6.0 : 6.0;
+    }
+
+    equalizer = wf_equalizer_new ();
+    wf_equalizer_set_bands (equalizer, bands, n_bands);
+
+    return GST_ELEMENT (equalizer);
+}
+
+static GstElement *
+make_equalizer_10bands (void)
+{
+    GstElement *equalizer;
+    gchar *name;
+
+    equalizer = gst_element_factory_make ("equalizer-10bands", NULL);
+    for (guint i = 0; i < 10; i++) {
+        name = g_strdup_printf ("band%u", i);
+        g_object_set (equalizer, name, i % 2 ? -6.0 : 6.0, NULL);
+        g_free (name);
+    }
+
+    return equalizer;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const gint rates[] = {48000, 192000};
+    gdouble base, ours, theirs, channel_seconds;
+
+    gst_init (&argc, &argv);
+
+    for (guint i = 0; i < G_N_ELEMENTS (rates); i++) {
+        channel_seconds = (gdouble) SECONDS * CHANNELS;
+        base = run (gst_element_factory_make ("identity", NULL), rates[i]);
+        ours = run (make_wf_equalizer (), rates[i]);
+        theirs = run (make_equalizer_10bands (), rates[i]);
+
+        g_print ("{\"benchmark\": \"equalizer\", \"element\": \"wfequalizer\", "
+                 "\"rate\": %d, \"us_per_channel_second\": %.2f}\n",
+                 rates[i], (ours - base) * 1e6 / channel_seconds);
+        g_print ("{\"benchmark\": \"equalizer\", \"element\": \"equalizer-10bands\", "
+                 "\"rate\": %d, \"us_per_channel_second\": %.2f}\n",
+                 rates[i], (theirs - base) * 1e6 / channel_seconds);
+    }
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * bench-library.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#include "wf-library.h"
+
+/*
+ * Scans a generated library of short WAV files, 100 to a directory: once
+ * with no index, then again as a later start would, loading the index the
+ * first run wrote and rescanning with nothing changed.
+ */
+
+#define DEFAULT_TRACKS   2000
+#define TRACKS_PER_DIR   100
+#define SAMPLE_RATE      8000
+#define SAMPLES          800
+
+static void
+write_wav (const gchar *path)
+{
+    guint8 header[44];
+    guint8 *contents;
+    guint32 data_size = SAMPLES * 2;
+
+    memcpy (header, "RIFF", 4);
+    GST_WRITE_UINT32_LE (header + 4, 36 + data_size);
+    memcpy (header + 8, "WAVEfmt ", 8);
+    GST_WRITE_UINT32_LE (header + 16, 16);
+    GST_WRITE_UINT16_LE (header + 20, 1);
+    GST_WRITE_UINT16_LE (header + 22, 1);
+    GST_WRITE_UINT32_LE (header + 24, SAMPLE_RATE);
+    GST_WRITE_UINT32_LE (header + 28, SAMPLE_RATE * 2);
+    GST_WRITE_UINT16_LE (header + 32, 2);
+    GST_WRITE_UINT16_LE (header + 34, 16);
+    memcpy (header + 36, "data", 4);
+    GST_WRITE_UINT32_LE (header + 40, data_size);
+
+    contents = g_malloc0 (sizeof (header) + data_size);
+    memcpy (contents, header, sizeof (header));
+    g_file_set_contents (path, (const gchar *) contents, sizeof (header) + data_size, NULL);
+    g_free (contents);
+}
+
+static void
+write_library (const gchar *root,
+               guint        n_tracks)
+{
+    gchar *dir, *path, *name;
+
+    for (guint i = 0; i < n_tracks; i++) {
+        name = g_strdup_printf ("artist-%04u", i / TRACKS_PER_DIR);
+        dir = g_build_filename (root, name, NULL);
+        g_free (name);
+        if (i % TRACKS_PER_DIR == 0)
+            g_mkdir (dir, 0700);
+
+        name = g_strdup_printf ("track-%06u.wav", i);
+        path = g_build_filename (dir, name, NULL);
+        write_wav (path);
+
+        g_free (path);
+        g_free (name);
+        g_free (dir);
+    }
+}
+
+static void
+remove_tree (const gchar *path)
+{
+    const gchar *name;
+    gchar *child;
+    GDir *dir;
+
+    dir = g_dir_open (path, 0, NULL);
+    if (dir) {
+        while ((name = g_dir_read_name (dir))) {
+            child = g_build_filename (path, name, NULL);
+            remove_tree (child);
+            g_free (child);
+        }
+        g_dir_close (dir);
+    }
+
+    g_remove (path);
+}
+
+static void
+scanning_cb (WfLibrary  *library,
+             GParamSpec *pspec,
+             GMainLoop  *loop)
+{
+    if (!wf_library_get_scanning (library))
+        g_main_loop_quit (loop);
+}
+
+static gdouble
+scan (WfLibrary   *library,
+      const gchar *root)
+{
+    const gchar *folders[] = {root, NULL};
+    GMainLoop *loop;
+    gint64 start;
+
+    loop = g_main_loop_new (NULL, FALSE);
+    g_signal_connect (library, "notify::scanning", G_CALLBACK (scanning_cb), loop);
+
+    start = g_get_monotonic_time ();
+    wf_library_set_folders (library, folders);
+    wf_library_rescan (library);
+    if (wf_library_get_scanning (library))
+        g_main_loop_run (loop);
+
+    g_signal_handlers_disconnect_by_func (library, scanning_cb, loop);
+    g_main_loop_unref (loop);
+
+    return (g_get_monotonic_time () - start) / 1000.0;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    WfLibrary *library;
+    GError *error = NULL;
+    gchar *root, *library_dir, *index;
+    gdouble cold, load, warm;
+    guint n_tracks, n_found;
+    gint64 start;
+
+    gst_init (&argc, &argv);
+
+    n_tracks = argc > 1 ? (guint) strtoul (argv[1], NULL, 10) : DEFAULT_TRACKS;
+
+    root = g_dir_make_tmp ("wf-bench-library-XXXXXX", &error);
+    if (!root) {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+    library_dir = g_build_filename (root, "music", NULL);
+    g_mkdir (library_dir, 0700);
+    index = g_build_filename (root, "library", NULL);
+    write_library (library_dir, n_tracks);
+
+    library = wf_library_new (index);
+    cold = scan (library, library_dir);
+    n_found = wf_track_store_get_n_tracks (wf_library_get_store (library));
+    wf_library_save (library, NULL);
+    g_object_unref (library);
+
+    start = g_get_monotonic_time ();
+    library = wf_library_new (index);
+    load = (g_get_monotonic_time () - start) / 1000.0;
+    warm = scan (library, library_dir);
+    g_object_unref (library);
+
+    g_print ("cold scan    %7u tracks %9.1f ms %9.0f tracks/s\n",
+             n_found, cold, n_found / (cold / 1000.0));
+    g_print ("index load   %7u tracks %9.1f ms\n", n_found, load);
+    g_print ("warm rescan  %7u tracks %9.1f ms\n", n_found, warm);
+
+    remove_tree (root);
+    g_free (index);
+    g_free (library_dir);
+    g_free (root);
+
+    return n_found == n_tracks ? 0 : 1;
+}
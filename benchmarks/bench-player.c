@@ -0,0 +1,696 @@
+/*
+ * bench-player.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+#include "wf-gst.h"
+#include "wf-player.h"
+#include "wf-waveform.h"
+
+/*
+ * WfPlayer end to end, on generated audio. It plays into wfbenchsink, an
+ * audio sink defined here that takes its samples at the rate a device
+ * would without opening one, so the sink buffering the player sets up
+ * applies as it would to a real device.
+ *
+ * The seek case seeks a long VBR MP3 (FLAC if there is no MP3 encoder),
+ * with and without the seek points the analysis records. It reports how
+ * long each seek takes to be heard and how far from the target playback
+ * resumed. The latency case reports the output latency the player
+ * measures and the seek latency, in the normal and the low-latency mode.
+ * The hidden case reports the CPU time, context switches and position
+ * updates per second of playback with analysis on, as while a window
+ * shows it, and off, as while all are hidden. The idle case reports
+ * resident memory while paused, before and after the pipelines are
+ * released, and how long playback takes to resume. The cache case plays
+ * from the decoded audio cache while the analysis fills it, through the
+ * end of the analysis and through the analysis being dropped halfway, and
+ * reports how long playback goes on in each case.
+ *
+ * Each result is one JSON object on a line of its own.
+ *
+ * Usage: bench-player [seek|latency|hidden|idle|cache] [seconds of audio]
+ */
+
+#define SAMPLE_RATE      44100
+#define DEFAULT_SECONDS  600
+#define N_SEEKS          50
+#define SEEK_TIMEOUT     5000  /* milliseconds */
+#define SETTLE_TIME      500   /* milliseconds */
+#define LATENCY_TIME     2000  /* milliseconds */
+#define HIDDEN_TIME      5000  /* milliseconds */
+#define IDLE_TIMEOUT     1     /* seconds */
+#define ANALYSIS_TIMEOUT 60000 /* milliseconds */
+
+typedef struct
+{
+    GstAudioSink parent;
+
+    gint rate;
+    gint bpf;
+} BenchSink;
+
+typedef GstAudioSinkClass BenchSinkClass;
+
+G_DEFINE_TYPE (BenchSink, bench_sink, GST_TYPE_AUDIO_SINK)
+
+static gboolean
+bench_sink_open (GstAudioSink *sink)
+{
+    return TRUE;
+}
+
+static gboolean
+bench_sink_prepare (GstAudioSink           *sink,
+                    GstAudioRingBufferSpec *spec)
+{
+    BenchSink *self = (BenchSink *) sink;
+
+    self->rate = GST_AUDIO_INFO_RATE (&spec->info);
+    self->bpf = GST_AUDIO_INFO_BPF (&spec->info);
+
+    return self->rate > 0 && self->bpf > 0;
+}
+
+static gboolean
+bench_sink_unprepare (GstAudioSink *sink)
+{
+    return TRUE;
+}
+
+static gboolean
+bench_sink_close (GstAudioSink *sink)
+{
+    return TRUE;
+}
+
+/* Takes a segment in the time it lasts, as a device drains it. */
+static gint
+bench_sink_write (GstAudioSink *sink,
+                  gpointer      data,
+                  guint         length)
+{
+    BenchSink *self = (BenchSink *) sink;
+
+    g_usleep ((guint64) length / self->bpf * G_USEC_PER_SEC / self->rate);
+
+    return length;
+}
+
+static guint
+bench_sink_delay (GstAudioSink *sink)
+{
+    return 0;
+}
+
+static void
+bench_sink_reset (GstAudioSink *sink)
+{
+}
+
+static void
+bench_sink_class_init (BenchSinkClass *klass)
+{
+    GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+    GstPadTemplate *template;
+    GstCaps *caps;
+
+    klass->open = bench_sink_open;
+    klass->prepare = bench_sink_prepare;
+    klass->unprepare = bench_sink_unprepare;
+    klass->close = bench_sink_close;
+    klass->write = bench_sink_write;
+    klass->delay = bench_sink_delay;
+    klass->reset = bench_sink_reset;
+
+    caps = gst_caps_from_string (GST_AUDIO_CAPS_MAKE (GST_AUDIO_FORMATS_ALL)
+                                 ", layout = (string) interleaved");
+    template = gst_pad_template_new ("sink", GST_PAD_SINK, GST_PAD_ALWAYS, caps);
+    gst_element_class_add_pad_template (element_class, template);
+    gst_caps_unref (caps);
+
+    gst_element_class_set_static_metadata (element_class,
+                                           "Benchmark audio sink",
+                                           "Sink/Audio",
+                                           "Plays in real time to nowhere",
+                                           "Dilnavas Roshan <dilnavasroshan@gmail.com>");
+}
+
+static void
+bench_sink_init (BenchSink *self)
+{
+}
+
+static GMainLoop *loop;
+static gboolean timed_out;
+static guint n_positions;
+
+static gboolean
+timeout_cb (gpointer user_data)
+{
+    timed_out = TRUE;
+    g_main_loop_quit (loop);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Runs the main loop until a handler quits it or @ms have passed;
+ * returns FALSE in the latter case. */
+static gboolean
+run_loop (guint ms)
+{
+    guint id;
+
+    timed_out = FALSE;
+    id = g_timeout_add (ms, timeout_cb, NULL);
+    g_main_loop_run (loop);
+    if (!timed_out)
+        g_source_remove (id);
+
+    return !timed_out;
+}
+
+static void
+quit_cb (void)
+{
+    g_main_loop_quit (loop);
+}
+
+static void
+position_cb (WfPlayer *player,
+             guint64   position,
+             gpointer  user_data)
+{
+    n_positions++;
+}
+
+static gint
+compare_gint64 (gconstpointer a,
+                gconstpointer b)
+{
+    gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+static gdouble
+median_ms (GArray *values)
+{
+    if (values->len == 0)
+        return 0.0;
+
+    g_array_sort (values, compare_gint64);
+
+    return g_array_index (values, gint64, values->len / 2) / 1000.0;
+}
+
+static gdouble
+max_ms (GArray *values)
+{
+    gint64 max = 0;
+
+    for (guint i = 0; i < values->len; i++)
+        max = MAX (max, g_array_index (values, gint64, i));
+
+    return max / 1000.0;
+}
+
+static gsize
+resident_size (void)
+{
+    gchar *contents;
+    gsize pages = 0;
+
+    if (g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL)) {
+        sscanf (contents, "%*u %" G_GSIZE_FORMAT, &pages);
+        g_free (contents);
+    }
+
+    return pages * sysconf (_SC_PAGESIZE);
+}
+
+static void
+remove_tree (const gchar *path)
+{
+    const gchar *name;
+    gchar *child;
+    GDir *dir;
+
+    dir = g_dir_open (path, 0, NULL);
+    if (dir) {
+        while ((name = g_dir_read_name (dir))) {
+            child = g_build_filename (path, name, NULL);
+            remove_tree (child);
+            g_free (child);
+        }
+        g_dir_close (dir);
+    }
+
+    g_remove (path);
+}
+
+/* Encodes a stereo tick track with @description; returns NULL if there
+ * is no @encoder. */
+static gchar *
+write_audio (const gchar *dir,
+             const gchar *name,
+             const gchar *encoder,
+             const gchar *description,
+             guint        seconds)
+{
+    GstElementFactory *factory;
+    GstElement *pipeline;
+    GstMessage *message;
+    GstBus *bus;
+    gchar *path, *launch;
+
+    factory = gst_element_factory_find (encoder);
+    if (!factory)
+        return NULL;
+    gst_object_unref (factory);
+
+    path = g_build_filename (dir, name, NULL);
+    launch = g_strdup_printf ("audiotestsrc wave=ticks num-buffers=%u samplesperbuffer=%u "
+                              "! audio/x-raw,rate=%u,channels=2 ! audioconvert ! %s "
+                              "! filesink location=\"%s\"",
+                              seconds * 10, SAMPLE_RATE / 10, SAMPLE_RATE, description, path);
+    pipeline = gst_parse_launch (launch, NULL);
+    g_free (launch);
+    if (!pipeline) {
+        g_free (path);
+        return NULL;
+    }
+
+    bus = gst_element_get_bus (pipeline);
+    gst_element_set_state (pipeline, GST_STATE_PLAYING);
+    message = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+                                          GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_ERROR)
+        g_clear_pointer (&path, g_free);
+    gst_message_unref (message);
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (bus);
+    gst_object_unref (pipeline);
+
+    return path;
+}
+
+/* The seek points the analysis of @uri records. */
+static GArray *
+analyze (const gchar *uri)
+{
+    WfWaveform *waveform;
+    GArray *points;
+
+    waveform = wf_waveform_new ();
+    g_object_set (waveform, "cache-budget", 0, NULL);
+    g_signal_connect_swapped (waveform, "ready", G_CALLBACK (quit_cb), NULL);
+    wf_waveform_set_file (waveform, uri);
+    g_main_loop_run (loop);
+
+    points = wf_waveform_get_seek_points (waveform);
+    points = points ? g_array_ref (points) : NULL;
+    g_object_unref (waveform);
+
+    return points;
+}
+
+/* A player with nothing else going on: no neighbours are prerolled and
+ * it never goes idle unless asked to. */
+static WfPlayer *
+new_player (gboolean low_latency)
+{
+    WfPlayer *player;
+
+    player = wf_player_new ();
+    wf_player_set_audio_sink (player, "wfbenchsink");
+    wf_player_set_pool_size (player, 0);
+    wf_player_set_idle_timeout (player, 0);
+    wf_player_set_low_latency (player, low_latency);
+    g_signal_connect (player, "position-changed", G_CALLBACK (position_cb), NULL);
+
+    return player;
+}
+
+static void
+free_player (WfPlayer *player)
+{
+    g_object_unref (player);
+
+    /* Lets GstPlay wind down its pipeline before the next one starts. */
+    run_loop (100);
+}
+
+/* Seeks into the playing @player at random, N_SEEKS times. The drift is
+ * how far from the target the position is once the seek is heard. */
+static gboolean
+run_seeks (WfPlayer *player,
+           guint     seconds,
+           GArray   *latencies,
+           GArray   *drifts)
+{
+    gulong handler;
+    guint64 target;
+    gint64 drift, latency;
+    gboolean ok = TRUE;
+
+    handler = g_signal_connect_swapped (player, "notify::seek-latency", G_CALLBACK (quit_cb), NULL);
+
+    for (guint i = 0; i < N_SEEKS && ok; i++) {
+        target = g_random_int_range (0, seconds - 1) * GST_SECOND +
+                 g_random_int_range (0, 1000) * GST_MSECOND;
+        wf_player_set_position (player, target);
+        ok = run_loop (SEEK_TIMEOUT);
+        if (!ok)
+            break;
+
+        latency = wf_player_get_seek_latency (player);
+        drift = ABS ((gint64) wf_player_get_position (player) - (gint64) target) / GST_USECOND;
+        g_array_append_val (latencies, latency);
+        g_array_append_val (drifts, drift);
+        run_loop (20);
+    }
+
+    g_signal_handler_disconnect (player, handler);
+
+    return ok;
+}
+
+static gboolean
+bench_seek (const gchar *uri,
+            const gchar *format,
+            guint        seconds)
+{
+    WfPlayer *player;
+    GArray *points, *latencies, *drifts;
+    gboolean ok = TRUE;
+
+    points = analyze (uri);
+    latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+    drifts = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+    for (guint with_points = 0; with_points < 2 && ok; with_points++) {
+        player = new_player (FALSE);
+        if (with_points)
+            wf_player_set_seek_points (player, uri, points);
+        wf_player_set_file (player, uri);
+        wf_player_play (player);
+        run_loop (SETTLE_TIME);
+
+        g_array_set_size (latencies, 0);
+        g_array_set_size (drifts, 0);
+        ok = run_seeks (player, seconds, latencies, drifts);
+        free_player (player);
+
+        g_print ("{\"benchmark\": \"seek\", \"format\": \"%s\", \"seek_points\": %s, "
+                 "\"seeks\": %u, \"median_ms\": %.2f, \"max_ms\": %.2f, "
+                 "\"median_drift_ms\": %.2f, \"max_drift_ms\": %.2f}\n",
+                 format, with_points ? "true" : "false", latencies->len,
+                 median_ms (latencies), max_ms (latencies),
+                 median_ms (drifts), max_ms (drifts));
+    }
+
+    g_array_unref (latencies);
+    g_array_unref (drifts);
+    g_clear_pointer (&points, g_array_unref);
+
+    return ok;
+}
+
+/* The output latency is measured from the spectra, so analysis is on. */
+static gboolean
+bench_latency (const gchar *uri,
+               const gchar *format,
+               guint        seconds)
+{
+    WfPlayer *player;
+    GArray *latencies, *drifts;
+    guint64 output;
+    gboolean ok = TRUE;
+
+    latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+    drifts = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+    for (guint low_latency = 0; low_latency < 2 && ok; low_latency++) {
+        player = new_player (low_latency);
+        wf_player_set_file (player, uri);
+        wf_player_play (player);
+        run_loop (LATENCY_TIME);
+        output = wf_player_get_output_latency (player);
+
+        g_array_set_size (latencies, 0);
+        g_array_set_size (drifts, 0);
+        ok = run_seeks (player, seconds, latencies, drifts) && output > 0;
+        free_player (player);
+
+        g_print ("{\"benchmark\": \"latency\", \"format\": \"%s\", \"low_latency\": %s, "
+                 "\"output_latency_ms\": %.2f, \"seek_median_ms\": %.2f, "
+                 "\"seek_max_ms\": %.2f}\n",
+                 format, low_latency ? "true" : "false", output / (gdouble) GST_MSECOND,
+                 median_ms (latencies), max_ms (latencies));
+    }
+
+    g_array_unref (latencies);
+    g_array_unref (drifts);
+
+    return ok;
+}
+
+static void
+usage (gint64 *cpu,
+       gint64 *switches)
+{
+    struct rusage usage;
+
+    getrusage (RUSAGE_SELF, &usage);
+    *cpu = (gint64) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * G_USEC_PER_SEC +
+           usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+    *switches = usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+/* Only what the player does: the seek bar redraws a window skips while
+ * hidden are not part of it. */
+static gboolean
+bench_hidden (const gchar *uri,
+              const gchar *format)
+{
+    WfPlayer *player;
+    gint64 cpu, switches, cpu_end, switches_end;
+    gdouble seconds = HIDDEN_TIME / 1000.0;
+
+    player = new_player (FALSE);
+    wf_player_set_file (player, uri);
+    wf_player_play (player);
+    run_loop (SETTLE_TIME);
+
+    for (guint hidden = 0; hidden < 2; hidden++) {
+        wf_player_set_analyze (player, !hidden);
+        run_loop (SETTLE_TIME);
+
+        n_positions = 0;
+        usage (&cpu, &switches);
+        run_loop (HIDDEN_TIME);
+        usage (&cpu_end, &switches_end);
+
+        g_print ("{\"benchmark\": \"hidden\", \"format\": \"%s\", \"hidden\": %s, "
+                 "\"cpu_ms_per_s\": %.2f, \"switches_per_s\": %.1f, "
+                 "\"positions_per_s\": %.1f}\n",
+                 format, hidden ? "true" : "false", (cpu_end - cpu) / 1000.0 / seconds,
+                 (switches_end - switches) / seconds, n_positions / seconds);
+    }
+
+    free_player (player);
+
+    return TRUE;
+}
+
+static gboolean
+bench_idle (const gchar *uri,
+            const gchar *format)
+{
+    WfPlayer *player;
+    gsize paused, idle;
+    gint64 start, resume = -1;
+    gulong handler;
+
+    player = new_player (FALSE);
+    wf_player_set_file (player, uri);
+    wf_player_play (player);
+    run_loop (LATENCY_TIME);
+
+    wf_player_set_idle_timeout (player, IDLE_TIMEOUT);
+    wf_player_pause (player);
+    run_loop (SETTLE_TIME / 2);
+    paused = resident_size ();
+    run_loop (IDLE_TIMEOUT * 1000 + SETTLE_TIME);
+    idle = resident_size ();
+
+    /* Heard again once the pipeline reports a position. */
+    handler = g_signal_connect_swapped (player, "position-changed", G_CALLBACK (quit_cb), NULL);
+    start = g_get_monotonic_time ();
+    wf_player_play (player);
+    if (run_loop (SEEK_TIMEOUT))
+        resume = g_get_monotonic_time () - start;
+    g_signal_handler_disconnect (player, handler);
+    free_player (player);
+
+    g_print ("{\"benchmark\": \"idle\", \"format\": \"%s\", \"paused_mib\": %.1f, "
+             "\"idle_mib\": %.1f, \"released_mib\": %.1f, \"resume_ms\": %.2f}\n",
+             format, paused / (1024.0 * 1024), idle / (1024.0 * 1024),
+             ((gssize) paused - (gssize) idle) / (1024.0 * 1024), resume / 1000.0);
+
+    return resume >= 0;
+}
+
+/* A slot playing from the cache is told when the analysis ends or gives
+ * up, on the main thread; it must keep playing either way, from the
+ * cache or from the file. */
+static gboolean
+bench_cache (const gchar *uri,
+             const gchar *format)
+{
+    WfWaveform *waveform;
+    WfPlayer *player;
+    GObjectClass *klass;
+    GParamSpec *pspec;
+    gchar *peaks_dir;
+    gint64 start, elapsed;
+    gboolean ok = TRUE;
+
+    klass = g_type_class_ref (WF_TYPE_WAVEFORM);
+    pspec = g_object_class_find_property (klass, "cache-budget");
+    peaks_dir = g_build_filename (g_get_user_cache_dir (), "wavefront", "peaks", NULL);
+
+    for (guint dropped = 0; dropped < 2; dropped++) {
+        /* Peaks found on disk would skip the decoding, and the cache. */
+        remove_tree (peaks_dir);
+
+        /* However long the audio, it all goes through the cache. */
+        waveform = wf_waveform_new ();
+        g_object_set (waveform, "cache-budget", G_PARAM_SPEC_UINT (pspec)->maximum, NULL);
+        g_signal_connect_swapped (waveform, "ready", G_CALLBACK (quit_cb), NULL);
+        wf_waveform_set_file (waveform, uri);
+
+        player = new_player (FALSE);
+        wf_player_set_file (player, uri);
+        start = g_get_monotonic_time ();
+        wf_player_play (player);
+
+        if (dropped) {
+            run_loop (SETTLE_TIME);
+            g_clear_object (&waveform);
+            elapsed = g_get_monotonic_time () - start;
+        } else {
+            ok = run_loop (ANALYSIS_TIMEOUT) && ok;
+            elapsed = g_get_monotonic_time () - start;
+        }
+
+        n_positions = 0;
+        run_loop (LATENCY_TIME);
+        ok = n_positions > 0 && wf_player_get_playing (player) && ok;
+
+        g_print ("{\"benchmark\": \"cache\", \"format\": \"%s\", \"ending\": \"%s\", "
+                 "\"analysis_ms\": %.2f, \"positions_after\": %u}\n",
+                 format, dropped ? "dropped" : "eos", elapsed / 1000.0, n_positions);
+
+        free_player (player);
+        g_clear_object (&waveform);
+    }
+
+    g_type_class_unref (klass);
+    g_free (peaks_dir);
+
+    return ok;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const gchar *formats[][4] = {
+        {"mp3-vbr", "bench.mp3", "lamemp3enc", "lamemp3enc target=quality quality=2"},
+        {"flac", "bench.flac", "flacenc", "flacenc"},
+    };
+    const gchar *which;
+    GError *error = NULL;
+    gchar *root, *path = NULL, *uri;
+    const gchar *format = NULL;
+    guint seconds;
+    gboolean ok = TRUE;
+
+    which = argc > 1 ? argv[1] : NULL;
+    seconds = argc > 2 ? (guint) strtoul (argv[2], NULL, 10) : DEFAULT_SECONDS;
+    seconds = MAX (seconds, 2);
+
+    root = g_dir_make_tmp ("wf-bench-player-XXXXXX", &error);
+    if (!root) {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+
+    /* Keeps the peak cache of the runs out of the user's cache. */
+    g_setenv ("XDG_CACHE_HOME", root, TRUE);
+    gst_init (&argc, &argv);
+    wf_gst_ensure ();
+    gst_element_register (NULL, "wfbenchsink", GST_RANK_NONE, bench_sink_get_type ());
+    loop = g_main_loop_new (NULL, FALSE);
+
+    /* The first format there is an encoder for. */
+    for (guint i = 0; i < G_N_ELEMENTS (formats) && !path; i++) {
+        path = write_audio (root, formats[i][1], formats[i][2], formats[i][3], seconds);
+        format = formats[i][0];
+    }
+    if (!path) {
+        g_printerr ("No encoder to write test audio with\n");
+        return 1;
+    }
+
+    uri = g_filename_to_uri (path, NULL, NULL);
+    if (!which || !strcmp (which, "seek"))
+        ok = bench_seek (uri, format, seconds) && ok;
+    if (!which || !strcmp (which, "latency"))
+        ok = bench_latency (uri, format, seconds) && ok;
+    if (!which || !strcmp (which, "hidden"))
+        ok = bench_hidden (uri, format) && ok;
+    if (!which || !strcmp (which, "idle"))
+        ok = bench_idle (uri, format) && ok;
+    if (!which || !strcmp (which, "cache"))
+        ok = bench_cache (uri, format) && ok;
+
+    g_free (path);
+    g_free (uri);
+    g_main_loop_unref (loop);
+
+    remove_tree (root);
+    g_free (root);
+
+    return ok ? 0 : 1;
+}
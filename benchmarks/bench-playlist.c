@@ -0,0 +1,176 @@
+/*
+ * bench-playlist.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "wf-playlist.h"
+
+/*
+ * Loads generated M3U, PLS and XSPF playlists of the same entries and
+ * times how soon the first batch arrives on the main loop, as it would
+ * reach the player, and how long the whole playlist takes. The entries
+ * name files that do not exist, as nothing is looked up while loading.
+ */
+
+#define DEFAULT_ENTRIES 50000
+
+typedef struct
+{
+    GMainLoop *loop;
+    gint64 start;
+    gint64 first;
+    guint n_entries;
+} Load;
+
+static gchar *
+write_playlist (const gchar *dir,
+                const gchar *name,
+                guint        n_entries)
+{
+    GString *contents;
+    gchar *path;
+
+    contents = g_string_new (NULL);
+    if (g_str_has_suffix (name, ".m3u8")) {
+        g_string_append (contents, "#EXTM3U\n");
+        for (guint i = 0; i < n_entries; i++)
+            g_string_append_printf (contents,
+                                    "#EXTINF:%u,Artist %u - Track %u\n"
+                                    "artist-%04u/track-%06u.flac\n",
+                                    180 + i % 240, i / 100, i, i / 100, i);
+    } else if (g_str_has_suffix (name, ".pls")) {
+        g_string_append (contents, "[playlist]\n");
+        for (guint i = 0; i < n_entries; i++)
+            g_string_append_printf (contents,
+                                    "File%u=artist-%04u/track-%06u.flac\n"
+                                    "Title%u=Artist %u - Track %u\n",
+                                    i + 1, i / 100, i, i + 1, i / 100, i);
+        g_string_append_printf (contents, "NumberOfEntries=%u\nVersion=2\n", n_entries);
+    } else {
+        g_string_append (contents,
+                         "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                         "<playlist version=\"1\" xmlns=\"http://xspf.org/ns/0/\">\n"
+                         "  <trackList>\n");
+        for (guint i = 0; i < n_entries; i++)
+            g_string_append_printf (contents,
+                                    "    <track>\n"
+                                    "      <location>artist-%04u/track-%06u.flac</location>\n"
+                                    "      <title>Track %u</title>\n"
+                                    "    </track>\n",
+                                    i / 100, i, i);
+        g_string_append (contents, "  </trackList>\n</playlist>\n");
+    }
+
+    path = g_build_filename (dir, name, NULL);
+    g_file_set_contents (path, contents->str, contents->len, NULL);
+    g_string_free (contents, TRUE);
+
+    return path;
+}
+
+static void
+entries_added_cb (WfPlaylist          *playlist,
+                  const gchar * const *uris,
+                  Load                *load)
+{
+    if (load->n_entries == 0)
+        load->first = g_get_monotonic_time ();
+    load->n_entries += g_strv_length ((gchar **) uris);
+}
+
+static void
+loaded_cb (GObject      *source,
+           GAsyncResult *result,
+           gpointer      user_data)
+{
+    Load *load = user_data;
+
+    wf_playlist_load_finish (WF_PLAYLIST (source), result, NULL);
+    g_main_loop_quit (load->loop);
+}
+
+static gdouble
+load_playlist (const gchar *path,
+               gdouble     *first,
+               guint       *n_entries)
+{
+    WfPlaylist *playlist;
+    GFile *file;
+    Load load = {0};
+
+    playlist = wf_playlist_new ();
+    g_signal_connect (playlist, "entries-added", G_CALLBACK (entries_added_cb), &load);
+    file = g_file_new_for_path (path);
+    load.loop = g_main_loop_new (NULL, FALSE);
+
+    load.start = g_get_monotonic_time ();
+    wf_playlist_load_async (playlist, &file, 1, NULL, loaded_cb, &load);
+    g_main_loop_run (load.loop);
+
+    *first = (load.first - load.start) / 1000.0;
+    *n_entries = load.n_entries;
+
+    g_main_loop_unref (load.loop);
+    g_object_unref (file);
+    g_object_unref (playlist);
+
+    return (g_get_monotonic_time () - load.start) / 1000.0;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    const gchar *names[] = {"playlist.m3u8", "playlist.pls", "playlist.xspf"};
+    GError *error = NULL;
+    gchar *root, *path;
+    gdouble first, total;
+    guint n_entries, n_found;
+    gboolean ok = TRUE;
+
+    n_entries = argc > 1 ? (guint) strtoul (argv[1], NULL, 10) : DEFAULT_ENTRIES;
+
+    root = g_dir_make_tmp ("wf-bench-playlist-XXXXXX", &error);
+    if (!root) {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+
+    for (guint i = 0; i < G_N_ELEMENTS (names); i++) {
+        path = write_playlist (root, names[i], n_entries);
+        total = load_playlist (path, &first, &n_found);
+        g_print ("%-14s %7u entries  first batch %7.2f ms  all %9.1f ms\n",
+                 names[i], n_found, first, total);
+        ok = ok && n_found == n_entries;
+        g_remove (path);
+        g_free (path);
+    }
+
+    g_rmdir (root);
+    g_free (root);
+
+    return ok ? 0 : 1;
+}
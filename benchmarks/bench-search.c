@@ -0,0 +1,412 @@
+/*
+ * bench-search.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "wf-search-index.h"
+#include "wf-track-store.h"
+
+/*
+ * Types a few queries one character at a time into a synthetic library,
+ * as the search entry would, and times each keystroke: with the trigram
+ * index, narrowing the previous result down, and with a plain scan over
+ * every track.
+ *
+ * Then removes the tracks of one artist, scattered all over the store,
+ * times how long the index takes to follow, and types the queries again
+ * over what is left.
+ *
+ * Last, changes and adds tracks in batches, as a library scan does, and
+ * times the snapshot the track list takes after each batch on the main
+ * thread, against the 16.7 ms of a frame at 60 Hz, along with the memory
+ * the snapshots held at once cost.
+ */
+
+#define DEFAULT_TRACKS 500000
+#define N_ARTISTS      20000
+#define ALBUMS_PER     6
+
+#define REMOVED_ARTIST "file:///music/artist-1234"
+
+#define REFRESH_ROUNDS 50
+#define REFRESH_BATCH  1000
+#define HELD_SNAPSHOTS 8
+
+static const gchar *words[] = {
+    "love", "night", "blue", "river", "fire", "heart", "summer", "light",
+    "dream", "road", "rain", "gold", "shadow", "city", "moon", "wild",
+    "song", "home", "stone", "ghost", "silver", "ocean", "winter", "echo",
+    "garden", "storm", "sugar", "paper", "velvet", "thunder", "midnight", "desert",
+};
+
+static const gchar *queries[] = {
+    "midnight river",
+    "the velvet",
+    "artist 1234",
+    "zzq",
+};
+
+static gchar *
+make_words (GRand *rand,
+            guint  n)
+{
+    GString *str = g_string_new (NULL);
+
+    for (guint i = 0; i < n; i++) {
+        if (i > 0)
+            g_string_append_c (str, ' ');
+        g_string_append (str, words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))]);
+    }
+
+    return g_string_free (str, FALSE);
+}
+
+static void
+fill_store (WfTrackStore *store,
+            guint         n_tracks)
+{
+    gchar *title, *artist, *album, *uri, *escaped;
+    WfTrack track = {0, };
+    GRand *rand;
+    guint a;
+
+    rand = g_rand_new_with_seed (42);
+    for (guint i = 0; i < n_tracks; i++) {
+        a = g_rand_int_range (rand, 0, N_ARTISTS);
+        title = make_words (rand, g_rand_int_range (rand, 1, 5));
+        artist = g_strdup_printf ("The Artist %u", a);
+        album = g_strdup_printf ("Album %u of %s", g_rand_int_range (rand, 0, ALBUMS_PER), artist);
+        escaped = g_uri_escape_string (title, NULL, FALSE);
+        uri = g_strdup_printf ("file:///music/artist-%u/%06u%%20%s.flac", a, i, escaped);
+
+        track.uri = uri;
+        track.title = title;
+        track.artist = artist;
+        track.album = album;
+        track.duration = g_rand_int_range (rand, 60, 600) * G_GUINT64_CONSTANT (1000000000);
+        track.size = track.duration / 1000;
+        wf_track_store_set_track (store, &track);
+
+        g_free (uri);
+        g_free (escaped);
+        g_free (album);
+        g_free (artist);
+        g_free (title);
+    }
+    g_rand_free (rand);
+}
+
+/* Narrows @previous down to the tracks matching @query, as the track
+ * list does, or finds them among all tracks if @previous is NULL. */
+static GArray *
+search (WfSearchIndex   *index,
+        WfTrackSnapshot *snapshot,
+        const gchar     *query,
+        GArray          *previous)
+{
+    GArray *candidates, *result;
+    guint8 *in_previous = NULL;
+    guint n_tracks, n;
+    guint32 i, track_index;
+    WfTrack track;
+
+    n_tracks = wf_track_snapshot_get_n_tracks (snapshot);
+    candidates = index ? wf_search_index_query (index, query) : NULL;
+    if (!candidates) {
+        candidates = previous ? g_array_ref (previous) : NULL;
+    } else if (previous) {
+        in_previous = g_new0 (guint8, n_tracks / 8 + 1);
+        for (i = 0; i < previous->len; i++) {
+            track_index = g_array_index (previous, guint32, i);
+            in_previous[track_index / 8] |= 1 << (track_index % 8);
+        }
+    }
+
+    n = candidates ? candidates->len : n_tracks;
+    result = g_array_new (FALSE, FALSE, sizeof (guint32));
+    for (i = 0; i < n; i++) {
+        track_index = candidates ? g_array_index (candidates, guint32, i) : i;
+        if (in_previous && !(in_previous[track_index / 8] & (1 << (track_index % 8))))
+            continue;
+
+        wf_track_snapshot_get_track (snapshot, track_index, &track);
+        if (wf_search_index_match (&track, query))
+            g_array_append_val (result, track_index);
+    }
+
+    g_free (in_previous);
+    if (candidates)
+        g_array_unref (candidates);
+
+    return result;
+}
+
+static gint
+compare_doubles (gconstpointer a,
+                 gconstpointer b)
+{
+    gdouble value_a = *(const gdouble *) a;
+    gdouble value_b = *(const gdouble *) b;
+
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+/* Types every query and reports the median and worst keystroke. */
+static gboolean
+type_queries (const gchar     *name,
+              WfSearchIndex   *index,
+              WfTrackSnapshot *snapshot,
+              GArray          *counts)
+{
+    GArray *times, *result, *previous;
+    gboolean consistent = TRUE;
+    gchar *prefix, *folded;
+    guint keystroke = 0;
+    gdouble ms;
+    gint64 start;
+
+    times = g_array_new (FALSE, FALSE, sizeof (gdouble));
+
+    for (guint q = 0; q < G_N_ELEMENTS (queries); q++) {
+        previous = NULL;
+        for (gsize len = 1; len <= strlen (queries[q]); len++) {
+            prefix = g_strndup (queries[q], len);
+            folded = g_utf8_casefold (prefix, -1);
+
+            start = g_get_monotonic_time ();
+            result = search (index, snapshot, folded, index ? previous : NULL);
+            ms = (g_get_monotonic_time () - start) / 1000.0;
+            g_array_append_val (times, ms);
+
+            /* Both ways must find the same tracks. */
+            if (keystroke == counts->len)
+                g_array_append_val (counts, result->len);
+            else if (g_array_index (counts, guint, keystroke) != result->len)
+                consistent = FALSE;
+            keystroke++;
+
+            if (previous)
+                g_array_unref (previous);
+            previous = result;
+            g_free (folded);
+            g_free (prefix);
+        }
+        g_print ("%-6s %-16s %7u matches\n", name, queries[q], previous->len);
+        g_array_unref (previous);
+    }
+
+    g_array_sort (times, compare_doubles);
+    g_print ("%-6s keystroke median %8.2f ms, worst %8.2f ms\n", name,
+             g_array_index (times, gdouble, times->len / 2),
+             g_array_index (times, gdouble, times->len - 1));
+    g_array_unref (times);
+
+    return consistent;
+}
+
+typedef struct
+{
+    WfSearchIndex *index;
+    gboolean followed;
+    gdouble ms;
+} RemoveData;
+
+static void
+store_changed_cb (WfTrackStore *store,
+                  guint         position,
+                  guint         removed,
+                  guint         added,
+                  RemoveData   *data)
+{
+    gint64 start;
+
+    start = g_get_monotonic_time ();
+    data->followed &= wf_search_index_remove (data->index, store, position, removed, added);
+    data->ms += (g_get_monotonic_time () - start) / 1000.0;
+}
+
+static gboolean
+time_remove (WfTrackStore  *store,
+             WfSearchIndex *index)
+{
+    RemoveData data = {index, TRUE, 0};
+    WfTrackSnapshot *snapshot;
+    GArray *counts;
+    gboolean consistent;
+    guint n_tracks;
+    gulong id;
+
+    n_tracks = wf_track_store_get_n_tracks (store);
+    id = g_signal_connect (store, "items-changed", G_CALLBACK (store_changed_cb), &data);
+    wf_track_store_remove_under (store, REMOVED_ARTIST);
+    g_signal_handler_disconnect (store, id);
+
+    g_print ("remove %7u tracks, index follows in %9.1f ms%s\n",
+             n_tracks - wf_track_store_get_n_tracks (store), data.ms,
+             data.followed ? "" : " (needs a rebuild)");
+
+    snapshot = wf_track_store_snapshot (store);
+    counts = g_array_new (FALSE, FALSE, sizeof (guint));
+    consistent = data.followed &&
+                 wf_search_index_get_n_tracks (index) == wf_track_store_get_n_tracks (store);
+    consistent &= type_queries ("scan", NULL, snapshot, counts);
+    consistent &= type_queries ("index", index, snapshot, counts);
+    g_array_unref (counts);
+    wf_track_snapshot_free (snapshot);
+
+    return consistent;
+}
+
+/* Resident memory in bytes, or 0 where /proc is not there. */
+static gsize
+resident_size (void)
+{
+    gchar *contents;
+    gsize pages = 0;
+
+    if (g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL)) {
+        sscanf (contents, "%*u %" G_GSIZE_FORMAT, &pages);
+        g_free (contents);
+    }
+
+    return pages * sysconf (_SC_PAGESIZE);
+}
+
+static void
+time_refresh (WfTrackStore *store)
+{
+    WfTrackSnapshot *held[HELD_SNAPSHOTS] = {NULL, };
+    WfTrackSnapshot *snapshot;
+    GArray *batches, *snapshots;
+    gchar *title, *uri;
+    WfTrack track = {0, };
+    gint64 start;
+    gsize resident, grown;
+    GRand *rand;
+    guint n_tracks;
+    gdouble ms;
+
+    rand = g_rand_new_with_seed (7);
+    batches = g_array_new (FALSE, FALSE, sizeof (gdouble));
+    snapshots = g_array_new (FALSE, FALSE, sizeof (gdouble));
+    resident = resident_size ();
+
+    for (guint r = 0; r < REFRESH_ROUNDS; r++) {
+        n_tracks = wf_track_store_get_n_tracks (store);
+
+        /* Half of each batch retags tracks anywhere in the library, half
+         * is new files. */
+        start = g_get_monotonic_time ();
+        for (guint i = 0; i < REFRESH_BATCH; i++) {
+            title = make_words (rand, 3);
+            if (i % 2 == 0 && n_tracks > 0) {
+                wf_track_store_get_track (store, g_rand_int_range (rand, 0, n_tracks), &track);
+                uri = g_strdup (track.uri);
+            } else {
+                uri = g_strdup_printf ("file:///music/new/%u-%u.flac", r, i);
+            }
+
+            track.uri = uri;
+            track.title = title;
+            track.artist = "Scanned Artist";
+            track.album = "Scanned Album";
+            track.cover = NULL;
+            wf_track_store_set_track (store, &track);
+
+            g_free (uri);
+            g_free (title);
+        }
+        ms = (g_get_monotonic_time () - start) / 1000.0;
+        g_array_append_val (batches, ms);
+
+        start = g_get_monotonic_time ();
+        snapshot = wf_track_store_snapshot (store);
+        ms = (g_get_monotonic_time () - start) / 1000.0;
+        g_array_append_val (snapshots, ms);
+
+        /* The track list keeps a snapshot until its refresh is done; keep
+         * the last few, as refreshes overlapping a scan would. */
+        g_clear_pointer (&held[r % HELD_SNAPSHOTS], wf_track_snapshot_free);
+        held[r % HELD_SNAPSHOTS] = snapshot;
+    }
+
+    g_array_sort (batches, compare_doubles);
+    g_array_sort (snapshots, compare_doubles);
+    g_print ("refresh %7u tracks, snapshot median %8.3f ms, worst %8.3f ms (frame 16.7 ms)\n",
+             wf_track_store_get_n_tracks (store),
+             g_array_index (snapshots, gdouble, snapshots->len / 2),
+             g_array_index (snapshots, gdouble, snapshots->len - 1));
+    g_print ("refresh %u changes per batch median %8.2f ms, worst %8.2f ms\n", REFRESH_BATCH,
+             g_array_index (batches, gdouble, batches->len / 2),
+             g_array_index (batches, gdouble, batches->len - 1));
+    grown = resident_size ();
+    grown = grown > resident ? grown - resident : 0;
+    g_print ("refresh %u snapshots held, %8.1f MiB more resident\n", HELD_SNAPSHOTS,
+             grown / (1024.0 * 1024.0));
+
+    for (guint h = 0; h < HELD_SNAPSHOTS; h++)
+        g_clear_pointer (&held[h], wf_track_snapshot_free);
+    g_array_unref (snapshots);
+    g_array_unref (batches);
+    g_rand_free (rand);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    WfTrackSnapshot *snapshot;
+    WfSearchIndex *index;
+    WfTrackStore *store;
+    GArray *counts;
+    guint n_tracks;
+    gboolean consistent;
+    gint64 start;
+
+    n_tracks = argc > 1 ? (guint) strtoul (argv[1], NULL, 10) : DEFAULT_TRACKS;
+
+    store = wf_track_store_new ();
+    fill_store (store, n_tracks);
+    snapshot = wf_track_store_snapshot (store);
+
+    start = g_get_monotonic_time ();
+    index = wf_search_index_new_from_snapshot (snapshot);
+    g_print ("index build %7u tracks %9.1f ms\n", n_tracks,
+             (g_get_monotonic_time () - start) / 1000.0);
+
+    counts = g_array_new (FALSE, FALSE, sizeof (guint));
+    consistent = type_queries ("scan", NULL, snapshot, counts);
+    consistent &= type_queries ("index", index, snapshot, counts);
+    g_array_unref (counts);
+    wf_track_snapshot_free (snapshot);
+
+    consistent &= time_remove (store, index);
+    wf_search_index_unref (index);
+
+    time_refresh (store);
+    g_object_unref (store);
+
+    return consistent ? 0 : 1;
+}
@@ -0,0 +1,462 @@
+/*
+ * bench-seek-bar.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <adwaita.h>
+#include <gst/gst.h>
+
+#include "wf-seek-bar.h"
+#include "wf-waveform.h"
+
+/*
+ * Frame cost of WfSeekBar, drawn without ever being shown: its snapshot()
+ * is run at a few sizes, peak counts and states, and the nodes are drawn
+ * into a texture with the Cairo renderer. For each case it reports the
+ * time per frame for the snapshot and the render, the number of render
+ * nodes and the number of allocations, one JSON object per line.
+ *
+ * A sequence of pointer events can also be replayed through the bar's
+ * controllers, each followed by a frame, from a file given as the first
+ * argument with one event per line:
+ *
+ *     motion X Y
+ *     leave
+ *     drag-begin X Y
+ *     drag-update DX DY
+ *     drag-end DX DY
+ *
+ * Other lines are skipped. Without a file, a hover sweep and a drag
+ * across the bar are replayed. GTK still needs a display to start;
+ * without one the benchmark is skipped.
+ */
+
+#define FRAMES          200
+#define REPLAY_WIDTH    1280
+#define REPLAY_HEIGHT   64
+#define REPLAY_PEAKS    14400
+#define DURATION        (G_GUINT64_CONSTANT (3600) * GST_SECOND)
+#define SKIP            77
+
+typedef enum
+{
+    STATE_IDLE,
+    STATE_PLAYING,
+    STATE_HOVER,
+    STATE_LOOP,
+    N_STATES
+} State;
+
+static const gchar *state_names[] = {"idle", "playing", "hover", "loop"};
+
+typedef struct
+{
+    WfSeekBar *bar;
+    GskRenderer *renderer;
+    GtkEventController *motion;
+    GtkEventController *drag;
+} Bench;
+
+#ifdef __GLIBC__
+
+/* Every malloc in the process comes through here, so the ones made for
+ * a frame can be counted. */
+
+extern void *__libc_malloc  (size_t size);
+extern void *__libc_calloc  (size_t n,
+                             size_t size);
+extern void *__libc_realloc (void   *ptr,
+                             size_t  size);
+
+static gint n_allocs;
+
+void *
+malloc (size_t size)
+{
+    g_atomic_int_inc (&n_allocs);
+    return __libc_malloc (size);
+}
+
+void *
+calloc (size_t n,
+        size_t size)
+{
+    g_atomic_int_inc (&n_allocs);
+    return __libc_calloc (n, size);
+}
+
+void *
+realloc (void   *ptr,
+         size_t  size)
+{
+    g_atomic_int_inc (&n_allocs);
+    return __libc_realloc (ptr, size);
+}
+
+static gint
+get_allocs (void)
+{
+    return g_atomic_int_get (&n_allocs);
+}
+
+#else
+
+static gint
+get_allocs (void)
+{
+    return 0;
+}
+
+#endif
+
+static GArray *
+make_peaks (guint n_peaks)
+{
+    GArray *peaks;
+    WfPeakData peak;
+
+    peaks = g_array_sized_new (FALSE, FALSE, sizeof (WfPeakData), n_peaks);
+    for (guint i = 0; i < n_peaks; i++) {
+        peak.left = g_random_double ();
+        peak.right = g_random_double ();
+        g_array_append_val (peaks, peak);
+    }
+
+    return peaks;
+}
+
+static guint
+count_nodes (GskRenderNode *node)
+{
+    guint n = 1;
+
+    switch (gsk_render_node_get_node_type (node)) {
+    case GSK_CONTAINER_NODE:
+        for (guint i = 0; i < gsk_container_node_get_n_children (node); i++)
+            n += count_nodes (gsk_container_node_get_child (node, i));
+        break;
+    case GSK_MASK_NODE:
+        n += count_nodes (gsk_mask_node_get_source (node));
+        n += count_nodes (gsk_mask_node_get_mask (node));
+        break;
+    case GSK_CLIP_NODE:
+        n += count_nodes (gsk_clip_node_get_child (node));
+        break;
+    case GSK_TRANSFORM_NODE:
+        n += count_nodes (gsk_transform_node_get_child (node));
+        break;
+    case GSK_OPACITY_NODE:
+        n += count_nodes (gsk_opacity_node_get_child (node));
+        break;
+    default:
+        break;
+    }
+
+    return n;
+}
+
+/* Runs snapshot() and renders the result, adding the time each took in
+ * µs to @snapshot_us and @render_us. */
+static guint
+draw_frame (Bench   *bench,
+            gdouble *snapshot_us,
+            gdouble *render_us)
+{
+    GtkSnapshot *snapshot;
+    GskRenderNode *node;
+    GdkTexture *texture;
+    guint n_nodes = 0;
+    gint64 start, middle;
+
+    start = g_get_monotonic_time ();
+    snapshot = gtk_snapshot_new ();
+    GTK_WIDGET_GET_CLASS (bench->bar)->snapshot (GTK_WIDGET (bench->bar), snapshot);
+    node = gtk_snapshot_free_to_node (snapshot);
+    middle = g_get_monotonic_time ();
+
+    if (node) {
+        texture = gsk_renderer_render_texture (bench->renderer, node, NULL);
+        n_nodes = count_nodes (node);
+        g_object_unref (texture);
+        gsk_render_node_unref (node);
+    }
+
+    *snapshot_us += middle - start;
+    *render_us += g_get_monotonic_time () - middle;
+
+    return n_nodes;
+}
+
+/* GTK wants a widget measured before it is allocated. */
+static void
+resize (Bench *bench,
+        gint   width,
+        gint   height)
+{
+    gtk_widget_measure (GTK_WIDGET (bench->bar), GTK_ORIENTATION_HORIZONTAL, height,
+                        NULL, NULL, NULL, NULL);
+    gtk_widget_allocate (GTK_WIDGET (bench->bar), width, height, -1, NULL);
+}
+
+static void
+set_state (Bench *bench,
+           State  state,
+           gint   width)
+{
+    wf_seek_bar_set_position (bench->bar, state == STATE_IDLE ? 0 : DURATION / 3);
+    wf_seek_bar_set_loop (bench->bar, 0, 0);
+    g_signal_emit_by_name (bench->motion, "leave");
+
+    if (state == STATE_HOVER)
+        g_signal_emit_by_name (bench->motion, "motion", width * 2 / 3.0, 10.0);
+    else if (state == STATE_LOOP)
+        wf_seek_bar_set_loop (bench->bar, DURATION / 4, DURATION / 2);
+}
+
+static void
+bench_frames (Bench *bench)
+{
+    const gint sizes[][2] = {{320, 32}, {800, 48}, {1920, 64}, {3840, 128}};
+    const guint n_peaks[] = {240, 14400, 172800};
+    GArray *peaks;
+    gdouble snapshot_us, render_us;
+    guint n_nodes;
+    gint allocs;
+
+    for (guint p = 0; p < G_N_ELEMENTS (n_peaks); p++) {
+        peaks = make_peaks (n_peaks[p]);
+        wf_seek_bar_set_peaks (bench->bar, peaks);
+
+        for (guint s = 0; s < G_N_ELEMENTS (sizes); s++) {
+            resize (bench, sizes[s][0], sizes[s][1]);
+
+            for (State state = 0; state < N_STATES; state++) {
+                set_state (bench, state, sizes[s][0]);
+                snapshot_us = render_us = 0.0;
+                n_nodes = 0;
+
+                allocs = get_allocs ();
+                for (guint f = 0; f < FRAMES; f++) {
+                    /* The playhead moves on between frames, as it does
+                     * while playing. */
+                    if (state != STATE_IDLE)
+                        wf_seek_bar_set_position (bench->bar, DURATION / 3 + f * GST_SECOND / 10);
+                    n_nodes = draw_frame (bench, &snapshot_us, &render_us);
+                }
+                allocs = get_allocs () - allocs;
+
+                g_print ("{\"benchmark\": \"seek-bar-frame\", \"width\": %d, \"height\": %d, "
+                         "\"peaks\": %u, \"state\": \"%s\", \"snapshot_us\": %.1f, "
+                         "\"render_us\": %.1f, \"nodes\": %u, \"allocs\": %.1f}\n",
+                         sizes[s][0], sizes[s][1], n_peaks[p], state_names[state],
+                         snapshot_us / FRAMES, render_us / FRAMES, n_nodes,
+                         allocs / (gdouble) FRAMES);
+            }
+        }
+
+        g_array_unref (peaks);
+    }
+}
+
+static void
+seeked_cb (WfSeekBar *bar,
+           guint64    position,
+           gpointer   user_data)
+{
+    wf_seek_bar_set_position (bar, position);
+}
+
+/* One event per line, as described at the top. */
+static gboolean
+replay_event (Bench *bench,
+              gchar *line)
+{
+    gchar **fields;
+    const gchar *name;
+    gdouble x = 0.0, y = 0.0;
+    gboolean ok = TRUE;
+
+    fields = g_strsplit_set (g_strstrip (line), " \t", -1);
+    name = fields[0];
+    if (name[0] != '\0' && fields[1]) {
+        x = g_ascii_strtod (fields[1], NULL);
+        if (fields[2])
+            y = g_ascii_strtod (fields[2], NULL);
+    }
+
+    if (!strcmp (name, "motion"))
+        g_signal_emit_by_name (bench->motion, "motion", x, y);
+    else if (!strcmp (name, "leave"))
+        g_signal_emit_by_name (bench->motion, "leave");
+    else if (!strcmp (name, "drag-begin"))
+        g_signal_emit_by_name (bench->drag, "drag-begin", x, y);
+    else if (!strcmp (name, "drag-update"))
+        g_signal_emit_by_name (bench->drag, "drag-update", x, y);
+    else if (!strcmp (name, "drag-end"))
+        g_signal_emit_by_name (bench->drag, "drag-end", x, y);
+    else
+        ok = FALSE;
+
+    g_strfreev (fields);
+
+    return ok;
+}
+
+static gchar **
+default_events (void)
+{
+    GPtrArray *events;
+
+    events = g_ptr_array_new ();
+    for (guint i = 0; i <= 200; i++)
+        g_ptr_array_add (events, g_strdup_printf ("motion %u 20", i * REPLAY_WIDTH / 200));
+    g_ptr_array_add (events, g_strdup ("drag-begin 100 20"));
+    for (guint i = 1; i <= 100; i++)
+        g_ptr_array_add (events, g_strdup_printf ("drag-update %u 0", i * 8));
+    g_ptr_array_add (events, g_strdup ("drag-end 800 0"));
+    g_ptr_array_add (events, g_strdup ("leave"));
+    g_ptr_array_add (events, NULL);
+
+    return (gchar **) g_ptr_array_free (events, FALSE);
+}
+
+static gboolean
+bench_replay (Bench       *bench,
+              const gchar *path)
+{
+    GArray *peaks;
+    gchar **lines, *contents;
+    gdouble snapshot_us = 0.0, render_us = 0.0;
+    gdouble max_us = 0.0, frame_us;
+    guint n_events = 0;
+    gint64 start, elapsed = 0;
+    gint allocs;
+    GError *error = NULL;
+
+    if (path) {
+        if (!g_file_get_contents (path, &contents, NULL, &error)) {
+            g_printerr ("%s\n", error->message);
+            g_error_free (error);
+            return FALSE;
+        }
+        lines = g_strsplit (contents, "\n", -1);
+        g_free (contents);
+    } else {
+        lines = default_events ();
+    }
+
+    peaks = make_peaks (REPLAY_PEAKS);
+    wf_seek_bar_set_peaks (bench->bar, peaks);
+    wf_seek_bar_set_position (bench->bar, 0);
+    wf_seek_bar_set_loop (bench->bar, 0, 0);
+    resize (bench, REPLAY_WIDTH, REPLAY_HEIGHT);
+    g_signal_connect (bench->bar, "seeked", G_CALLBACK (seeked_cb), NULL);
+
+    allocs = get_allocs ();
+    for (guint i = 0; lines[i]; i++) {
+        start = g_get_monotonic_time ();
+        if (!replay_event (bench, lines[i]))
+            continue;
+        draw_frame (bench, &snapshot_us, &render_us);
+        frame_us = g_get_monotonic_time () - start;
+        max_us = MAX (max_us, frame_us);
+        elapsed += frame_us;
+        n_events++;
+    }
+    allocs = get_allocs () - allocs;
+
+    if (n_events > 0)
+        g_print ("{\"benchmark\": \"seek-bar-replay\", \"events\": %u, \"us_per_event\": %.1f, "
+                 "\"max_us\": %.1f, \"snapshot_us\": %.1f, \"render_us\": %.1f, "
+                 "\"allocs\": %.1f}\n",
+                 n_events, elapsed / (gdouble) n_events, max_us,
+                 snapshot_us / n_events, render_us / n_events,
+                 allocs / (gdouble) n_events);
+
+    g_signal_handlers_disconnect_by_func (bench->bar, seeked_cb, NULL);
+    g_array_unref (peaks);
+    g_strfreev (lines);
+
+    return n_events > 0;
+}
+
+static GtkEventController *
+find_controller (GtkWidget *widget,
+                 GType      type)
+{
+    GListModel *controllers;
+    GtkEventController *controller, *found = NULL;
+
+    controllers = gtk_widget_observe_controllers (widget);
+    for (guint i = 0; i < g_list_model_get_n_items (controllers) && !found; i++) {
+        controller = g_list_model_get_item (controllers, i);
+        if (G_TYPE_CHECK_INSTANCE_TYPE (controller, type))
+            found = controller;
+        g_object_unref (controller);
+    }
+    g_object_unref (controllers);
+
+    return found;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+    GtkWidget *window;
+    Bench bench;
+    GError *error = NULL;
+    gboolean ok;
+
+    /* Keep the C locale so that the JSON has decimal points. */
+    gtk_disable_setlocale ();
+    if (!gtk_init_check ()) {
+        g_print ("No display, skipping\n");
+        return SKIP;
+    }
+    adw_init ();
+
+    bench.renderer = gsk_cairo_renderer_new ();
+    if (!gsk_renderer_realize (bench.renderer, NULL, &error)) {
+        g_printerr ("%s\n", error->message);
+        g_error_free (error);
+        return 1;
+    }
+
+    /* In a window, never shown, so that the bar gets its style. */
+    window = gtk_window_new ();
+    bench.bar = wf_seek_bar_new ();
+    gtk_window_set_child (GTK_WINDOW (window), GTK_WIDGET (bench.bar));
+    wf_seek_bar_set_duration (bench.bar, DURATION);
+    bench.motion = find_controller (GTK_WIDGET (bench.bar), GTK_TYPE_EVENT_CONTROLLER_MOTION);
+    bench.drag = find_controller (GTK_WIDGET (bench.bar), GTK_TYPE_GESTURE_DRAG);
+
+    bench_frames (&bench);
+    ok = bench_replay (&bench, argc > 1 ? argv[1] : NULL);
+
+    gtk_window_destroy (GTK_WINDOW (window));
+    gsk_renderer_unrealize (bench.renderer);
+    g_object_unref (bench.renderer);
+
+    return ok ? 0 : 1;
+}
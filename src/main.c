@@ -21,23 +21,45 @@
 #include "config.h"
 
 #include <glib/gi18n.h>
-#include <gst/gst.h>
 
 #include "wf-application.h"
+#include "wf-gst.h"
 
 int
 main (int   argc,
       char *argv[])
 {
     g_autoptr (WfApplication) app = NULL;
+    GApplicationFlags flags = G_APPLICATION_HANDLES_OPEN;
+    gboolean eager = FALSE;
+#ifdef ENABLE_BENCHMARKS
+    const gchar *benchmark;
+#endif
 
     bindtextdomain (GETTEXT_PACKAGE, LOCALEDIR);
     bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
     textdomain (GETTEXT_PACKAGE);
 
-    app = wf_application_new (FW_APP_ID, G_APPLICATION_DEFAULT_FLAGS);
+#ifdef ENABLE_BENCHMARKS
+    /* A cold start measurement must not hand over to a running instance;
+     * the attach benchmark runs the instance that is handed over to. */
+    benchmark = g_getenv ("WAVEFRONT_BENCHMARK_STARTUP");
+    if (benchmark && g_strcmp0 (benchmark, "attach") != 0)
+        flags |= G_APPLICATION_NON_UNIQUE;
 
-    gst_init (&argc, &argv);
+    /* The baseline for the startup benchmark: load GStreamer up front, as
+     * before, and build the first slot with the player (see there). */
+    eager = g_getenv ("WAVEFRONT_EAGER_GST") != NULL;
+#endif
+
+    app = wf_application_new (FW_APP_ID, flags);
+
+    /* GStreamer options on the command line are not parsed any more; the
+     * GST_* environment variables still apply. */
+    if (eager)
+        wf_gst_ensure ();
+    else
+        wf_gst_init_async ();
 
     return g_application_run (G_APPLICATION (app), argc, argv);
 }
@@ -22,11 +22,40 @@
 #include <glib/gi18n.h>
 
 #include "wf-application.h"
+#include "wf-playlist.h"
+#include "wf-sub-track.h"
 #include "wf-window.h"
 
+/* How long the application stays around once nothing holds it, so that a
+ * relaunch soon after the last window closed finds everything in place. */
+#define INACTIVITY_TIMEOUT 10000
+
+/*
+ * The application, not the window, owns the player and the analysis, so
+ * playback goes on after the last window is closed and a new window picks
+ * up where the old one left off. Started with --daemon, or activated over
+ * D-Bus, it runs without any window at all.
+ */
+
 struct _WfApplication
 {
     AdwApplication parent_instance;
+
+    gint64 start_time;
+    gboolean daemon;
+    gboolean held;
+
+    GSettings *settings;
+    WfPlayer *player;
+    WfWaveform *waveform;
+    WfLibrary *library;
+
+    WfPlaylist *playlist;
+    GCancellable *load_cancellable;
+    gboolean load_started;
+
+    /* Windows currently shown, the spectra are analysed while any is. */
+    guint visible_windows;
 };
 
 G_DEFINE_FINAL_TYPE (WfApplication, wf_application, ADW_TYPE_APPLICATION)
@@ -44,33 +73,334 @@ wf_application_new (const char        *application_id,
                          NULL);
 }
 
+/* Monotonic time the application was created at, close to process start. */
+gint64
+wf_application_get_start_time (WfApplication *self)
+{
+    g_return_val_if_fail (WF_IS_APPLICATION (self), 0);
+
+    return self->start_time;
+}
+
+WfPlayer *
+wf_application_get_player (WfApplication *self)
+{
+    g_return_val_if_fail (WF_IS_APPLICATION (self), NULL);
+
+    return self->player;
+}
+
+WfWaveform *
+wf_application_get_waveform (WfApplication *self)
+{
+    g_return_val_if_fail (WF_IS_APPLICATION (self), NULL);
+
+    return self->waveform;
+}
+
+WfLibrary *
+wf_application_get_library (WfApplication *self)
+{
+    g_return_val_if_fail (WF_IS_APPLICATION (self), NULL);
+
+    return self->library;
+}
+
+/* Called by a window when it is shown or hidden, minimized windows and
+ * those on another workspace count as hidden. */
+void
+wf_application_window_shown (WfApplication *self)
+{
+    g_return_if_fail (WF_IS_APPLICATION (self));
+
+    if (self->visible_windows++ == 0 && self->player)
+        wf_player_set_analyze (self->player, TRUE);
+}
+
+void
+wf_application_window_hidden (WfApplication *self)
+{
+    g_return_if_fail (WF_IS_APPLICATION (self));
+    g_return_if_fail (self->visible_windows > 0);
+
+    if (--self->visible_windows == 0 && self->player)
+        wf_player_set_analyze (self->player, FALSE);
+}
+
 static void
-wf_application_activate (GApplication *app)
+start_queue (WfApplication       *self,
+             const gchar * const *uris)
 {
-    GtkWindow *window;
+    gchar *file_uri;
+
+    /* Start the analysis first, so the player can take the decoded audio
+     * from it rather than decoding the file itself. A sub-track shares
+     * the analysis of its whole file. */
+    if (uris && uris[0]) {
+        wf_sub_track_parse_uri (uris[0], &file_uri, NULL, NULL);
+        wf_waveform_set_file (self->waveform, file_uri);
+        g_free (file_uri);
+    }
+    wf_player_set_queue (self->player, uris);
+}
+
+void
+wf_application_set_queue (WfApplication       *self,
+                          const gchar * const *uris)
+{
+    g_return_if_fail (WF_IS_APPLICATION (self));
+
+    /* Whatever a playlist was still adding goes too. */
+    g_cancellable_cancel (self->load_cancellable);
+    start_queue (self, uris);
+}
+
+/* The first entries of a playlist replace the queue, so that playback
+ * and the analysis of the first one start while the rest is read. */
+static void
+entries_added_cb (WfApplication       *self,
+                  const gchar * const *uris,
+                  WfPlaylist          *playlist)
+{
+    if (!self->load_started) {
+        self->load_started = TRUE;
+        start_queue (self, uris);
+    } else {
+        wf_player_append_queue (self->player, uris);
+    }
+}
+
+static void
+playlist_loaded_cb (GObject      *source,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+    WfApplication *self = WF_APPLICATION (user_data);
+    GError *error = NULL;
+
+    wf_playlist_load_finish (WF_PLAYLIST (source), result, &error);
+    if (error && !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_printerr ("Error: %s\n", error->message);
+    g_clear_error (&error);
+
+    g_application_release (G_APPLICATION (self));
+}
+
+static void
+uri_changed_cb (WfApplication *self,
+                GParamSpec    *pspec,
+                gpointer       user_data)
+{
+    const gchar *uri;
+
+    uri = wf_player_get_uri (self->player);
+    if (uri)
+        wf_waveform_set_file (self->waveform, uri);
+}
+
+/* Keeps the application running while something is playing, with or
+ * without a window. */
+static void
+playing_changed_cb (WfApplication *self,
+                    GParamSpec    *pspec,
+                    gpointer       user_data)
+{
+    gboolean playing;
+
+    playing = wf_player_get_playing (self->player);
+    if (self->held == playing)
+        return;
+
+    self->held = playing;
+    if (playing)
+        g_application_hold (G_APPLICATION (self));
+    else
+        g_application_release (G_APPLICATION (self));
+}
+
+static void
+waveform_ready_cb (WfApplication *self,
+                   WfWaveform    *waveform)
+{
+    wf_player_set_seek_points (self->player,
+                               wf_waveform_get_uri (waveform),
+                               wf_waveform_get_seek_points (waveform));
+}
+
+/* Hands a whole curve to the player in one step, so a preset switch is
+ * heard at once rather than band by band. */
+static void
+eq_bands_changed_cb (WfApplication *self,
+                     const gchar   *key,
+                     GSettings     *settings)
+{
+    WfEqBand bands[WF_EQUALIZER_MAX_BANDS];
+    GVariant *variant;
+    guint n_bands;
+
+    variant = g_settings_get_value (settings, "eq-bands");
+    n_bands = wf_eq_bands_from_variant (variant, bands);
+    g_variant_unref (variant);
+
+    if (n_bands > 0)
+        wf_player_set_eq_bands (self->player, bands, n_bands);
+}
+
+static gint
+wf_application_handle_local_options (GApplication *app,
+                                     GVariantDict *options)
+{
+    WfApplication *self = WF_APPLICATION (app);
+
+    /* Run as a service: no window on startup, and no exit without one. */
+    if (g_variant_dict_contains (options, "daemon")) {
+        g_application_set_flags (app, g_application_get_flags (app) | G_APPLICATION_IS_SERVICE);
+        self->daemon = TRUE;
+    }
+
+    return -1;
+}
+
+static void
+wf_application_startup (GApplication *app)
+{
+    WfApplication *self = WF_APPLICATION (app);
     GtkIconTheme *icon_theme;
 
-    g_assert (WF_IS_APPLICATION (app));
+    G_APPLICATION_CLASS (wf_application_parent_class)->startup (app);
 
     icon_theme = gtk_icon_theme_get_for_display (gdk_display_get_default ());
     gtk_icon_theme_add_resource_path (icon_theme, "/cc/placid/Wavefront/icons");
 
+    self->settings = g_settings_new (FW_APP_ID);
+
+    self->player = wf_player_new ();
+    g_settings_bind (self->settings, "preroll-pool-size",
+                     self->player, "pool-size", G_SETTINGS_BIND_GET);
+    g_settings_bind (self->settings, "readahead-count",
+                     self->player, "readahead", G_SETTINGS_BIND_GET);
+    g_settings_bind (self->settings, "crossfade-duration",
+                     self->player, "crossfade", G_SETTINGS_BIND_GET);
+    g_settings_bind (self->settings, "idle-timeout",
+                     self->player, "idle-timeout", G_SETTINGS_BIND_GET);
+    g_settings_bind (self->settings, "low-latency",
+                     self->player, "low-latency", G_SETTINGS_BIND_GET);
+    g_settings_bind (self->settings, "audio-sink",
+                     self->player, "audio-sink", G_SETTINGS_BIND_GET);
+    g_signal_connect_swapped (self->player, "notify::uri",
+                              G_CALLBACK (uri_changed_cb), self);
+    g_signal_connect_swapped (self->player, "notify::playing",
+                              G_CALLBACK (playing_changed_cb), self);
+
+    /* Nothing shows the spectra until a window does. */
+    wf_player_set_analyze (self->player, FALSE);
+
+    g_signal_connect_swapped (self->settings, "changed::eq-bands",
+                              G_CALLBACK (eq_bands_changed_cb), self);
+    eq_bands_changed_cb (self, "eq-bands", self->settings);
+
+    self->waveform = wf_waveform_new ();
+    g_settings_bind (self->settings, "pcm-cache-budget",
+                     self->waveform, "cache-budget", G_SETTINGS_BIND_GET);
+    g_signal_connect_swapped (self->waveform, "ready", G_CALLBACK (waveform_ready_cb), self);
+
+    self->library = wf_library_new (NULL);
+    g_settings_bind (self->settings, "library-folders",
+                     self->library, "folders", G_SETTINGS_BIND_GET);
+    wf_library_rescan (self->library);
+
+    self->playlist = wf_playlist_new ();
+    g_signal_connect_swapped (self->playlist, "entries-added",
+                              G_CALLBACK (entries_added_cb), self);
+
+    if (self->daemon)
+        g_application_hold (app);
+}
+
+static void
+wf_application_shutdown (GApplication *app)
+{
+    WfApplication *self = WF_APPLICATION (app);
+
+    if (self->player)
+        g_signal_handlers_disconnect_by_data (self->player, self);
+
+    g_clear_object (&self->player);
+    g_clear_object (&self->waveform);
+    g_clear_object (&self->library);
+    g_cancellable_cancel (self->load_cancellable);
+    g_clear_object (&self->load_cancellable);
+    g_clear_object (&self->playlist);
+    g_clear_object (&self->settings);
+
+    G_APPLICATION_CLASS (wf_application_parent_class)->shutdown (app);
+}
+
+static void
+wf_application_activate (GApplication *app)
+{
+    GtkWindow *window;
+
+    g_assert (WF_IS_APPLICATION (app));
+
     window = gtk_application_get_active_window (GTK_APPLICATION (app));
 
     if (window == NULL)
-        window = g_object_new (WF_TYPE_WINDOW,
-                               "application", app,
-                               NULL);
+        window = GTK_WINDOW (wf_window_new (WF_APPLICATION (app)));
 
     gtk_window_present (window);
 }
 
+static void
+wf_application_open (GApplication  *app,
+                     GFile        **files,
+                     gint           n_files,
+                     const gchar   *hint)
+{
+    WfApplication *self = WF_APPLICATION (app);
+    gboolean has_playlist = FALSE;
+    GPtrArray *uris;
+    gchar *name;
+
+    for (gint i = 0; i < n_files && !has_playlist; i++) {
+        name = g_file_get_basename (files[i]);
+        has_playlist = name && wf_playlist_is_playlist (name);
+        g_free (name);
+    }
+
+    /* Playlists can be long, so they are read in the background and
+     * the queue fills as they are. */
+    if (has_playlist) {
+        g_cancellable_cancel (self->load_cancellable);
+        g_clear_object (&self->load_cancellable);
+        self->load_cancellable = g_cancellable_new ();
+        self->load_started = FALSE;
+        g_application_hold (app);
+        wf_playlist_load_async (self->playlist, files, n_files, self->load_cancellable,
+                                playlist_loaded_cb, self);
+    } else {
+        uris = g_ptr_array_new_full (n_files + 1, g_free);
+        for (gint i = 0; i < n_files; i++)
+            g_ptr_array_add (uris, g_file_get_uri (files[i]));
+        g_ptr_array_add (uris, NULL);
+
+        wf_application_set_queue (self, (const gchar * const *) uris->pdata);
+        g_ptr_array_unref (uris);
+    }
+
+    wf_application_activate (app);
+}
+
 static void
 wf_application_class_init (WfApplicationClass *klass)
 {
     GApplicationClass *app_class = G_APPLICATION_CLASS (klass);
 
+    app_class->handle_local_options = wf_application_handle_local_options;
+    app_class->startup = wf_application_startup;
+    app_class->shutdown = wf_application_shutdown;
     app_class->activate = wf_application_activate;
+    app_class->open = wf_application_open;
 }
 
 static void
@@ -115,9 +445,21 @@ static const GActionEntry app_actions[] =
     { "about", wf_application_about_action },
 };
 
+static const GOptionEntry app_options[] =
+{
+    { "daemon", 0, 0, G_OPTION_ARG_NONE, NULL,
+      N_("Keep playing in the background without a window"), NULL },
+    { NULL }
+};
+
 static void
 wf_application_init (WfApplication *self)
 {
+    self->start_time = g_get_monotonic_time ();
+
+    g_application_add_main_option_entries (G_APPLICATION (self), app_options);
+    g_application_set_inactivity_timeout (G_APPLICATION (self), INACTIVITY_TIMEOUT);
+
     g_action_map_add_action_entries (G_ACTION_MAP (self),
                                      app_actions,
                                      G_N_ELEMENTS (app_actions),
@@ -125,5 +467,8 @@ wf_application_init (WfApplication *self)
     gtk_application_set_accels_for_action (GTK_APPLICATION (self),
                                            "app.quit",
                                            (const char *[]) { "<primary>q", NULL });
+    gtk_application_set_accels_for_action (GTK_APPLICATION (self),
+                                           "win.debug",
+                                           (const char *[]) { "<primary><shift>d", NULL });
 }
 
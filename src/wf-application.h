@@ -22,13 +22,25 @@
 
 #include <adwaita.h>
 
+#include "wf-library.h"
+#include "wf-player.h"
+#include "wf-waveform.h"
+
 G_BEGIN_DECLS
 
 #define WF_TYPE_APPLICATION (wf_application_get_type())
 G_DECLARE_FINAL_TYPE (WfApplication, wf_application, WF, APPLICATION, AdwApplication)
 
-WfApplication *wf_application_new (const char        *application_id,
-                                   GApplicationFlags  flags);
+WfApplication *wf_application_new            (const char        *application_id,
+                                              GApplicationFlags  flags);
+gint64         wf_application_get_start_time (WfApplication *self);
+WfPlayer      *wf_application_get_player     (WfApplication *self);
+WfWaveform    *wf_application_get_waveform   (WfApplication *self);
+WfLibrary     *wf_application_get_library    (WfApplication *self);
+void           wf_application_set_queue      (WfApplication       *self,
+                                              const gchar * const *uris);
+void           wf_application_window_shown   (WfApplication *self);
+void           wf_application_window_hidden  (WfApplication *self);
 
 G_END_DECLS
 
@@ -0,0 +1,311 @@
+/*
+ * wf-cover-cache.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "wf-cover-cache.h"
+#include "wf-covers.h"
+
+/*
+ * Cover textures at the sizes they are drawn at. A miss is loaded by a
+ * small pool of workers: from the scaled copy on disk if there is one,
+ * otherwise by decoding the original at the wanted size and writing the
+ * scaled copy for next time. Finished textures come back to the main
+ * thread in batches and are kept, most recently drawn first, up to the
+ * memory budget. A cover that failed to load is remembered the same way,
+ * at a nominal cost, so it is tried again once it ages out.
+ */
+
+#define N_WORKERS     2
+#define MISSING_BYTES 256
+
+typedef struct
+{
+    gchar *key;
+    GdkTexture *texture;
+    gboolean loading;
+    gsize bytes;
+    GList link;
+} Entry;
+
+typedef struct
+{
+    gchar *key;
+    gchar *hash;
+    guint size;
+    GdkTexture *texture;
+} LoadJob;
+
+struct _WfCoverCache
+{
+    GObject parent;
+
+    gsize budget;
+    gsize used;
+    GHashTable *entries;
+    GQueue lru;
+
+    GThreadPool *pool;
+    GMutex lock;
+    GPtrArray *done;
+    guint flush_id;
+};
+
+enum
+{
+    LOADED,
+    N_SIGNALS
+};
+
+static guint signals[N_SIGNALS] = {0, };
+
+static void dispose  (GObject *object);
+static void finalize (GObject *object);
+static void load_func (gpointer data,
+                       gpointer user_data);
+
+G_DEFINE_FINAL_TYPE (WfCoverCache, wf_cover_cache, G_TYPE_OBJECT)
+
+static void
+wf_cover_cache_class_init (WfCoverCacheClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->dispose = dispose;
+    object_class->finalize = finalize;
+
+    /* Emitted after a batch of covers was loaded. */
+    signals[LOADED] =
+        g_signal_new ("loaded",
+                      G_TYPE_FROM_CLASS (object_class),
+                      G_SIGNAL_RUN_LAST,
+                      0, NULL, NULL, NULL,
+                      G_TYPE_NONE, 0);
+}
+
+static void
+entry_free (Entry *entry)
+{
+    g_clear_object (&entry->texture);
+    g_free (entry->key);
+    g_free (entry);
+}
+
+static void
+load_job_free (LoadJob *job)
+{
+    g_clear_object (&job->texture);
+    g_free (job->hash);
+    g_free (job->key);
+    g_free (job);
+}
+
+static void
+wf_cover_cache_init (WfCoverCache *self)
+{
+    self->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) entry_free);
+    g_queue_init (&self->lru);
+    g_mutex_init (&self->lock);
+    self->done = g_ptr_array_new_with_free_func ((GDestroyNotify) load_job_free);
+    self->pool = g_thread_pool_new (load_func, self, N_WORKERS, FALSE, NULL);
+}
+
+static void
+dispose (GObject *object)
+{
+    WfCoverCache *cache = WF_COVER_CACHE (object);
+
+    if (cache->pool) {
+        g_thread_pool_free (cache->pool, TRUE, TRUE);
+        cache->pool = NULL;
+    }
+    g_clear_handle_id (&cache->flush_id, g_source_remove);
+
+    G_OBJECT_CLASS (wf_cover_cache_parent_class)->dispose (object);
+}
+
+static void
+finalize (GObject *object)
+{
+    WfCoverCache *cache = WF_COVER_CACHE (object);
+
+    g_hash_table_unref (cache->entries);
+    g_ptr_array_unref (cache->done);
+    g_mutex_clear (&cache->lock);
+
+    G_OBJECT_CLASS (wf_cover_cache_parent_class)->finalize (object);
+}
+
+/* Decodes the original straight to @size, which for JPEG skips most of
+ * the work, and keeps the result at @path. The texture is made from the
+ * decoded pixels; the PNG is only written, never read back. */
+static GdkTexture *
+scale_cover (const gchar *hash,
+             guint        size,
+             const gchar *path)
+{
+    GdkTexture *texture;
+    GdkPixbuf *pixbuf;
+    gchar *original, *buffer, *dir;
+    gsize length;
+
+    original = wf_covers_get_path (hash, 0);
+    pixbuf = gdk_pixbuf_new_from_file_at_scale (original, size, size, TRUE, NULL);
+    g_free (original);
+    if (!pixbuf)
+        return NULL;
+
+    G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+    texture = gdk_texture_new_for_pixbuf (pixbuf);
+    G_GNUC_END_IGNORE_DEPRECATIONS
+
+    if (gdk_pixbuf_save_to_buffer (pixbuf, &buffer, &length, "png", NULL, NULL)) {
+        dir = g_path_get_dirname (path);
+        g_mkdir_with_parents (dir, 0700);
+        g_free (dir);
+        g_file_set_contents (path, buffer, length, NULL);
+        g_free (buffer);
+    }
+    g_object_unref (pixbuf);
+
+    return texture;
+}
+
+static gboolean
+flush_cb (gpointer user_data)
+{
+    WfCoverCache *self = WF_COVER_CACHE (user_data);
+    GPtrArray *done;
+    LoadJob *job;
+    Entry *entry;
+    GList *oldest;
+
+    g_mutex_lock (&self->lock);
+    done = g_steal_pointer (&self->done);
+    self->done = g_ptr_array_new_with_free_func ((GDestroyNotify) load_job_free);
+    self->flush_id = 0;
+    g_mutex_unlock (&self->lock);
+
+    for (guint i = 0; i < done->len; i++) {
+        job = g_ptr_array_index (done, i);
+        entry = g_hash_table_lookup (self->entries, job->key);
+        if (!entry || !entry->loading)
+            continue;
+
+        entry->loading = FALSE;
+        entry->texture = g_steal_pointer (&job->texture);
+        if (entry->texture)
+            entry->bytes = (gsize) gdk_texture_get_width (entry->texture) *
+                           gdk_texture_get_height (entry->texture) * 4;
+        else
+            entry->bytes = MISSING_BYTES;
+        self->used += entry->bytes;
+        g_queue_push_head_link (&self->lru, &entry->link);
+
+        while (self->used > self->budget && self->lru.length > 1) {
+            oldest = g_queue_pop_tail_link (&self->lru);
+            entry = oldest->data;
+            self->used -= entry->bytes;
+            g_hash_table_remove (self->entries, entry->key);
+        }
+    }
+
+    g_ptr_array_unref (done);
+    g_signal_emit (self, signals[LOADED], 0);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+load_func (gpointer data,
+           gpointer user_data)
+{
+    WfCoverCache *self = WF_COVER_CACHE (user_data);
+    LoadJob *job = data;
+    gchar *path;
+
+    path = wf_covers_get_path (job->hash, job->size);
+    job->texture = gdk_texture_new_from_filename (path, NULL);
+    if (!job->texture)
+        job->texture = scale_cover (job->hash, job->size, path);
+    g_free (path);
+
+    g_mutex_lock (&self->lock);
+    g_ptr_array_add (self->done, job);
+    if (!self->flush_id)
+        self->flush_id = g_idle_add (flush_cb, self);
+    g_mutex_unlock (&self->lock);
+}
+
+/* @budget is the most memory the textures may take, in bytes. */
+WfCoverCache *
+wf_cover_cache_new (gsize budget)
+{
+    WfCoverCache *self;
+
+    self = g_object_new (WF_TYPE_COVER_CACHE, NULL);
+    self->budget = budget;
+
+    return self;
+}
+
+/* Returns the cover @hash scaled to fit @size pixels square, or NULL
+ * while it is being loaded or if it failed to; ::loaded is emitted when
+ * it might be there. */
+GdkTexture *
+wf_cover_cache_lookup (WfCoverCache *self,
+                       const gchar  *hash,
+                       guint         size)
+{
+    LoadJob *job;
+    Entry *entry;
+    gchar *key;
+
+    g_return_val_if_fail (WF_IS_COVER_CACHE (self), NULL);
+    g_return_val_if_fail (hash != NULL, NULL);
+    g_return_val_if_fail (size > 0, NULL);
+
+    key = g_strdup_printf ("%u/%s", size, hash);
+    entry = g_hash_table_lookup (self->entries, key);
+    if (entry) {
+        g_free (key);
+        if (entry->loading)
+            return NULL;
+
+        g_queue_unlink (&self->lru, &entry->link);
+        g_queue_push_head_link (&self->lru, &entry->link);
+        return entry->texture;
+    }
+
+    entry = g_new0 (Entry, 1);
+    entry->key = key;
+    entry->loading = TRUE;
+    entry->link.data = entry;
+    g_hash_table_insert (self->entries, entry->key, entry);
+
+    job = g_new0 (LoadJob, 1);
+    job->key = g_strdup (key);
+    job->hash = g_strdup (hash);
+    job->size = size;
+    g_thread_pool_push (self->pool, job, NULL);
+
+    return NULL;
+}
@@ -0,0 +1,36 @@
+/*
+ * wf-cover-cache.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define WF_TYPE_COVER_CACHE (wf_cover_cache_get_type ())
+G_DECLARE_FINAL_TYPE (WfCoverCache, wf_cover_cache, WF, COVER_CACHE, GObject)
+
+WfCoverCache *wf_cover_cache_new    (gsize budget);
+GdkTexture   *wf_cover_cache_lookup (WfCoverCache *self,
+                                     const gchar  *hash,
+                                     guint         size);
+
+G_END_DECLS
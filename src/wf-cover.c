@@ -0,0 +1,177 @@
+/*
+ * wf-cover.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "wf-cover.h"
+
+/* A square cover image, or a blank tile while there is none. The texture
+ * is asked for at the size it is drawn at on this display. */
+
+#define CORNER_RADIUS 4
+
+struct _WfCover
+{
+    GtkWidget parent;
+
+    WfCoverCache *cache;
+    gint size;
+    gchar *hash;
+};
+
+static void dispose  (GObject *object);
+static void finalize (GObject *object);
+static void measure  (GtkWidget      *widget,
+                      GtkOrientation  orientation,
+                      gint            for_size,
+                      gint           *minimum,
+                      gint           *natural,
+                      gint           *minimum_baseline,
+                      gint           *natural_baseline);
+static void snapshot (GtkWidget   *widget,
+                      GtkSnapshot *snapshot);
+
+G_DEFINE_FINAL_TYPE (WfCover, wf_cover, GTK_TYPE_WIDGET)
+
+static void
+wf_cover_class_init (WfCoverClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+    object_class->dispose = dispose;
+    object_class->finalize = finalize;
+
+    widget_class->measure = measure;
+    widget_class->snapshot = snapshot;
+
+    gtk_widget_class_set_css_name (widget_class, "wfcover");
+}
+
+static void
+wf_cover_init (WfCover *self)
+{
+}
+
+static void
+dispose (GObject *object)
+{
+    WfCover *cover = WF_COVER (object);
+
+    g_clear_object (&cover->cache);
+
+    G_OBJECT_CLASS (wf_cover_parent_class)->dispose (object);
+}
+
+static void
+finalize (GObject *object)
+{
+    WfCover *cover = WF_COVER (object);
+
+    g_free (cover->hash);
+
+    G_OBJECT_CLASS (wf_cover_parent_class)->finalize (object);
+}
+
+static void
+measure (GtkWidget      *widget,
+         GtkOrientation  orientation,
+         gint            for_size,
+         gint           *minimum,
+         gint           *natural,
+         gint           *minimum_baseline,
+         gint           *natural_baseline)
+{
+    *minimum = *natural = WF_COVER (widget)->size;
+}
+
+static void
+snapshot (GtkWidget   *widget,
+          GtkSnapshot *snapshot)
+{
+    WfCover *cover = WF_COVER (widget);
+    GdkTexture *texture = NULL;
+    graphene_rect_t bounds;
+    GskRoundedRect clip;
+    GdkRGBA color;
+    gdouble width, height, scale;
+
+    width = gtk_widget_get_width (widget);
+    height = gtk_widget_get_height (widget);
+
+    if (cover->hash && *cover->hash && cover->cache)
+        texture = wf_cover_cache_lookup (cover->cache, cover->hash,
+                                         cover->size * gtk_widget_get_scale_factor (widget));
+
+    bounds = GRAPHENE_RECT_INIT (0, 0, width, height);
+    gsk_rounded_rect_init_from_rect (&clip, &bounds, CORNER_RADIUS);
+    gtk_snapshot_push_rounded_clip (snapshot, &clip);
+
+    if (texture) {
+        /* Fitted and centred, for the covers that are not square. */
+        scale = MIN (width / gdk_texture_get_width (texture),
+                     height / gdk_texture_get_height (texture));
+        bounds.size.width = gdk_texture_get_width (texture) * scale;
+        bounds.size.height = gdk_texture_get_height (texture) * scale;
+        bounds.origin.x = (width - bounds.size.width) / 2;
+        bounds.origin.y = (height - bounds.size.height) / 2;
+        gtk_snapshot_append_texture (snapshot, texture, &bounds);
+    } else {
+        gtk_widget_get_color (widget, &color);
+        color.alpha *= 0.1;
+        gtk_snapshot_append_color (snapshot, &color, &bounds);
+    }
+
+    gtk_snapshot_pop (snapshot);
+}
+
+/* @size is the width and height in application pixels. */
+GtkWidget *
+wf_cover_new (WfCoverCache *cache,
+              gint          size)
+{
+    WfCover *self;
+
+    g_return_val_if_fail (WF_IS_COVER_CACHE (cache), NULL);
+
+    self = g_object_new (WF_TYPE_COVER, NULL);
+    self->cache = g_object_ref (cache);
+    self->size = size;
+    g_signal_connect_object (cache, "loaded",
+                             G_CALLBACK (gtk_widget_queue_draw), self, G_CONNECT_SWAPPED);
+
+    return GTK_WIDGET (self);
+}
+
+/* @hash names the image in the cover cache; NULL or empty for none. */
+void
+wf_cover_set_hash (WfCover     *self,
+                   const gchar *hash)
+{
+    g_return_if_fail (WF_IS_COVER (self));
+
+    if (g_strcmp0 (self->hash, hash) == 0)
+        return;
+
+    g_free (self->hash);
+    self->hash = g_strdup (hash);
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
@@ -0,0 +1,38 @@
+/*
+ * wf-cover.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+#include "wf-cover-cache.h"
+
+G_BEGIN_DECLS
+
+#define WF_TYPE_COVER (wf_cover_get_type ())
+G_DECLARE_FINAL_TYPE (WfCover, wf_cover, WF, COVER, GtkWidget)
+
+GtkWidget *wf_cover_new      (WfCoverCache *cache,
+                              gint          size);
+void       wf_cover_set_hash (WfCover     *self,
+                              const gchar *hash);
+
+G_END_DECLS
@@ -0,0 +1,190 @@
+/*
+ * wf-covers.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "wf-covers.h"
+
+/*
+ * Cover images on disk, named by the SHA-1 of the image as it came out of
+ * the tags: the tracks of an album that all embed the same picture share
+ * one file. Scaled copies live next to them, one directory per size.
+ *
+ * Covers no track refers to any more are deleted with their scaled copies
+ * once the library has settled, and the scaled copies, which can always
+ * be made again, are kept to a budget of their own.
+ */
+
+#define SCALED_BUDGET (32 * 1024 * 1024)
+
+typedef struct
+{
+    gchar *path;
+    gint64 mtime;
+    gint64 size;
+} ScaledCopy;
+
+/* Returns where the cover @hash is kept, as found in the tags if @size
+ * is 0 and otherwise as a PNG fitting in @size pixels square. */
+gchar *
+wf_covers_get_path (const gchar *hash,
+                    guint        size)
+{
+    gchar *dir, *name, *path;
+
+    g_return_val_if_fail (hash != NULL, NULL);
+
+    if (size == 0)
+        return g_build_filename (g_get_user_cache_dir (), "wavefront", "covers", hash, NULL);
+
+    dir = g_strdup_printf ("%u", size);
+    name = g_strconcat (hash, ".png", NULL);
+    path = g_build_filename (g_get_user_cache_dir (), "wavefront", "covers", dir, name, NULL);
+    g_free (name);
+    g_free (dir);
+
+    return path;
+}
+
+/* Keeps the image unless the same one is already there, and returns its
+ * hash, or NULL if it could not be written. Any thread may call this. */
+gchar *
+wf_covers_store (gconstpointer data,
+                 gsize         length)
+{
+    GError *error = NULL;
+    gchar *hash, *path, *dir;
+
+    g_return_val_if_fail (data != NULL, NULL);
+
+    hash = g_compute_checksum_for_data (G_CHECKSUM_SHA1, data, length);
+    path = wf_covers_get_path (hash, 0);
+
+    if (!g_file_test (path, G_FILE_TEST_EXISTS)) {
+        dir = g_path_get_dirname (path);
+        g_mkdir_with_parents (dir, 0700);
+        g_free (dir);
+
+        if (!g_file_set_contents (path, data, length, &error)) {
+            g_debug ("Failed to keep cover %s: %s", hash, error->message);
+            g_clear_error (&error);
+            g_clear_pointer (&hash, g_free);
+        }
+    }
+    g_free (path);
+
+    return hash;
+}
+
+static gint
+compare_mtime (gconstpointer a,
+               gconstpointer b)
+{
+    const ScaledCopy *copy_a = a;
+    const ScaledCopy *copy_b = b;
+
+    return (copy_a->mtime > copy_b->mtime) - (copy_a->mtime < copy_b->mtime);
+}
+
+/* Deletes @path if it is older than @since; returns whether it did. */
+static gboolean
+remove_older (const gchar *path,
+              gint64       since)
+{
+    GStatBuf st;
+
+    return g_stat (path, &st) == 0 && st.st_mtime < since && g_remove (path) == 0;
+}
+
+/* Deletes the covers whose hash is not in @live, and their scaled copies,
+ * then the oldest scaled copies while they take more than SCALED_BUDGET.
+ * Files changed since @since, in seconds since the epoch, are spared: a
+ * track being discovered may have just stored them. Blocks on the disk,
+ * so meant for a worker thread. */
+void
+wf_covers_prune (GHashTable *live,
+                 gint64      since)
+{
+    const gchar *name, *scaled_name;
+    GArray *copies;
+    ScaledCopy copy;
+    gchar *root, *path, *hash;
+    GDir *dir, *scaled;
+    gint64 total = 0;
+    GStatBuf st;
+
+    g_return_if_fail (live != NULL);
+
+    root = g_build_filename (g_get_user_cache_dir (), "wavefront", "covers", NULL);
+    dir = g_dir_open (root, 0, NULL);
+    if (!dir) {
+        g_free (root);
+        return;
+    }
+
+    copies = g_array_new (FALSE, FALSE, sizeof (ScaledCopy));
+    while ((name = g_dir_read_name (dir))) {
+        path = g_build_filename (root, name, NULL);
+
+        if (!g_file_test (path, G_FILE_TEST_IS_DIR)) {
+            if (!g_hash_table_contains (live, name))
+                remove_older (path, since);
+            g_free (path);
+            continue;
+        }
+
+        scaled = g_dir_open (path, 0, NULL);
+        while (scaled && (scaled_name = g_dir_read_name (scaled))) {
+            copy.path = g_build_filename (path, scaled_name, NULL);
+            hash = g_strndup (scaled_name, strcspn (scaled_name, "."));
+
+            if (!g_hash_table_contains (live, hash) && remove_older (copy.path, since)) {
+                g_free (copy.path);
+            } else if (g_stat (copy.path, &st) == 0) {
+                copy.mtime = st.st_mtime;
+                copy.size = st.st_size;
+                total += copy.size;
+                g_array_append_val (copies, copy);
+            } else {
+                g_free (copy.path);
+            }
+            g_free (hash);
+        }
+        if (scaled)
+            g_dir_close (scaled);
+        g_free (path);
+    }
+    g_dir_close (dir);
+
+    g_array_sort (copies, compare_mtime);
+    for (guint i = 0; i < copies->len; i++) {
+        copy = g_array_index (copies, ScaledCopy, i);
+        if (total > SCALED_BUDGET && g_remove (copy.path) == 0)
+            total -= copy.size;
+        g_free (copy.path);
+    }
+
+    g_array_unref (copies);
+    g_free (root);
+}
@@ -0,0 +1,296 @@
+/*
+ * wf-cue-sheet.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <gio/gio.h>
+#include <glib/gi18n.h>
+
+#include "wf-cue-sheet.h"
+
+/*
+ * CUE sheets as ripping tools write them: a FILE line, then a TRACK with
+ * its TITLE, PERFORMER and INDEX lines for each track in that file. Only
+ * INDEX 01 matters here. A track runs up to the next one's INDEX 01, so a
+ * pregap is heard at the end of the track before it and the tracks of a
+ * file cover it without holes. Sheets that are not UTF-8 are taken to be
+ * Windows-1252, which is what most older rips use.
+ */
+
+#define SECOND           G_GUINT64_CONSTANT (1000000000)
+#define FRAMES_PER_SEC   75
+#define MAX_SHEET_SIZE   (1024 * 1024)
+
+/* Returns the names a CUE sheet that goes with @name may have: the name
+ * with its extension replaced, then with .cue added. @name may be a file
+ * name, a path or a uri. */
+gchar **
+wf_cue_sheet_get_sidecars (const gchar *name)
+{
+    GStrvBuilder *builder;
+    const gchar *base, *dot;
+    gchar *stem;
+
+    g_return_val_if_fail (name != NULL, NULL);
+
+    builder = g_strv_builder_new ();
+    base = strrchr (name, '/');
+    base = base ? base + 1 : name;
+    dot = strrchr (base, '.');
+    if (dot && dot != base) {
+        stem = g_strndup (name, dot - name);
+        g_strv_builder_take (builder, g_strconcat (stem, ".cue", NULL));
+        g_free (stem);
+    }
+    g_strv_builder_take (builder, g_strconcat (name, ".cue", NULL));
+
+    return g_strv_builder_unref_to_strv (builder);
+}
+
+/* Takes the next word of @p, or everything between a pair of quotes. */
+static gchar *
+next_token (const gchar **p)
+{
+    const gchar *s = *p, *end;
+    gchar *token;
+
+    while (*s == ' ' || *s == '\t')
+        s++;
+
+    if (*s == '"') {
+        s++;
+        end = strchr (s, '"');
+        if (!end)
+            end = s + strlen (s);
+        token = g_strndup (s, end - s);
+        *p = *end ? end + 1 : end;
+        return token;
+    }
+
+    end = s;
+    while (*end && *end != ' ' && *end != '\t')
+        end++;
+    token = g_strndup (s, end - s);
+    *p = end;
+
+    return token;
+}
+
+static gboolean
+parse_index (const gchar *str,
+             guint64     *time)
+{
+    guint minutes, seconds, frames;
+
+    if (sscanf (str, "%u:%u:%u", &minutes, &seconds, &frames) != 3 ||
+        seconds >= 60 || frames >= FRAMES_PER_SEC)
+        return FALSE;
+
+    *time = (minutes * G_GUINT64_CONSTANT (60) + seconds) * SECOND +
+            frames * SECOND / FRAMES_PER_SEC;
+
+    return TRUE;
+}
+
+static gchar *
+resolve_file (const gchar *sheet_uri,
+              const gchar *name)
+{
+    GFile *sheet, *dir, *file;
+    gchar *uri;
+
+    sheet = g_file_new_for_uri (sheet_uri);
+    dir = g_file_get_parent (sheet);
+    file = g_file_resolve_relative_path (dir ? dir : sheet, name);
+    uri = g_file_get_uri (file);
+
+    g_object_unref (file);
+    g_clear_object (&dir);
+    g_object_unref (sheet);
+
+    return uri;
+}
+
+/* Returns the tracks @contents lays out over @file_uri as an array of
+ * WfSubTrack, or NULL if there are none, along with the title and
+ * performer of the whole sheet. A sheet that names a single file is
+ * taken to be about @file_uri whatever that file is called, as sheets
+ * often outlive a conversion to another format. */
+GPtrArray *
+wf_cue_sheet_parse (const gchar  *contents,
+                    gsize         length,
+                    const gchar  *sheet_uri,
+                    const gchar  *file_uri,
+                    gchar       **title,
+                    gchar       **performer)
+{
+    GPtrArray *matched, *other, *tracks;
+    WfSubTrack *track = NULL, *previous;
+    gchar *converted = NULL, *sheet_title = NULL, *sheet_performer = NULL;
+    gchar **lines, *keyword, *value, *uri;
+    const gchar *p;
+    gboolean in_file = FALSE;
+    guint n_files = 0, number;
+    guint64 start;
+
+    g_return_val_if_fail (contents != NULL, NULL);
+    g_return_val_if_fail (sheet_uri != NULL, NULL);
+    g_return_val_if_fail (file_uri != NULL, NULL);
+
+    if (length >= 3 && memcmp (contents, "\xef\xbb\xbf", 3) == 0) {
+        contents += 3;
+        length -= 3;
+    }
+    if (!g_utf8_validate_len (contents, length, NULL)) {
+        converted = g_convert (contents, length, "UTF-8", "WINDOWS-1252", NULL, &length, NULL);
+        if (!converted)
+            return NULL;
+        contents = converted;
+    }
+
+    matched = g_ptr_array_new_with_free_func ((GDestroyNotify) wf_sub_track_free);
+    other = g_ptr_array_new_with_free_func ((GDestroyNotify) wf_sub_track_free);
+
+    converted = converted ? converted : g_strndup (contents, length);
+    lines = g_strsplit_set (converted, "\r\n", -1);
+    for (guint i = 0; lines[i]; i++) {
+        p = lines[i];
+        keyword = next_token (&p);
+
+        if (!g_ascii_strcasecmp (keyword, "FILE")) {
+            value = next_token (&p);
+            uri = resolve_file (sheet_uri, value);
+            in_file = !g_strcmp0 (uri, file_uri);
+            n_files++;
+            track = NULL;
+            g_free (uri);
+            g_free (value);
+        } else if (!g_ascii_strcasecmp (keyword, "TRACK")) {
+            value = next_token (&p);
+            number = (guint) g_ascii_strtoull (value, NULL, 10);
+            track = g_new0 (WfSubTrack, 1);
+            track->start = G_MAXUINT64;
+            track->end = G_MAXUINT64;
+            track->title = g_strdup_printf (_("Track %02u"), number);
+            g_ptr_array_add (in_file ? matched : other, track);
+            g_free (value);
+        } else if (!g_ascii_strcasecmp (keyword, "TITLE")) {
+            value = next_token (&p);
+            if (track) {
+                g_free (track->title);
+                track->title = value;
+            } else {
+                g_free (sheet_title);
+                sheet_title = value;
+            }
+        } else if (!g_ascii_strcasecmp (keyword, "PERFORMER")) {
+            value = next_token (&p);
+            if (track) {
+                g_free (track->performer);
+                track->performer = value;
+            } else {
+                g_free (sheet_performer);
+                sheet_performer = value;
+            }
+        } else if (!g_ascii_strcasecmp (keyword, "INDEX") && track) {
+            value = next_token (&p);
+            number = (guint) g_ascii_strtoull (value, NULL, 10);
+            g_free (value);
+            value = next_token (&p);
+            if (number == 1 && parse_index (value, &start))
+                track->start = start;
+            g_free (value);
+        }
+
+        g_free (keyword);
+    }
+    g_strfreev (lines);
+    g_free (converted);
+
+    tracks = matched->len == 0 && n_files == 1 ? other : matched;
+
+    /* Each track ends where the next begins. Tracks without an INDEX 01,
+     * or that do not come after the one before, are left out. */
+    for (guint i = tracks->len; i > 0; i--) {
+        track = g_ptr_array_index (tracks, i - 1);
+        if (track->start == G_MAXUINT64)
+            g_ptr_array_remove_index (tracks, i - 1);
+    }
+    for (guint i = 1; i < tracks->len;) {
+        previous = g_ptr_array_index (tracks, i - 1);
+        track = g_ptr_array_index (tracks, i);
+        if (track->start <= previous->start) {
+            g_ptr_array_remove_index (tracks, i);
+            continue;
+        }
+        previous->end = track->start;
+        i++;
+    }
+
+    g_ptr_array_ref (tracks);
+    g_ptr_array_unref (matched);
+    g_ptr_array_unref (other);
+
+    if (tracks->len == 0)
+        g_clear_pointer (&tracks, g_ptr_array_unref);
+
+    if (title)
+        *title = tracks ? g_steal_pointer (&sheet_title) : NULL;
+    if (performer)
+        *performer = tracks ? g_steal_pointer (&sheet_performer) : NULL;
+    g_free (sheet_title);
+    g_free (sheet_performer);
+
+    return tracks;
+}
+
+/* Reads the tracks of @file_uri from a CUE sheet next to it, if there is
+ * one. Any thread may call this. */
+GPtrArray *
+wf_cue_sheet_load (const gchar  *file_uri,
+                   gchar       **title,
+                   gchar       **performer)
+{
+    GPtrArray *tracks = NULL;
+    gchar **sidecars;
+    gchar *contents;
+    gsize length;
+    GFile *file;
+
+    g_return_val_if_fail (file_uri != NULL, NULL);
+
+    sidecars = wf_cue_sheet_get_sidecars (file_uri);
+    for (guint i = 0; sidecars[i] && !tracks; i++) {
+        file = g_file_new_for_uri (sidecars[i]);
+        if (g_file_load_contents (file, NULL, &contents, &length, NULL, NULL)) {
+            if (length <= MAX_SHEET_SIZE)
+                tracks = wf_cue_sheet_parse (contents, length, sidecars[i], file_uri,
+                                             title, performer);
+            g_free (contents);
+        }
+        g_object_unref (file);
+    }
+    g_strfreev (sidecars);
+
+    return tracks;
+}
@@ -0,0 +1,41 @@
+/*
+ * wf-cue-sheet.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "wf-sub-track.h"
+
+G_BEGIN_DECLS
+
+gchar    **wf_cue_sheet_get_sidecars (const gchar  *name);
+GPtrArray *wf_cue_sheet_parse        (const gchar  *contents,
+                                      gsize         length,
+                                      const gchar  *sheet_uri,
+                                      const gchar  *file_uri,
+                                      gchar       **title,
+                                      gchar       **performer);
+GPtrArray *wf_cue_sheet_load         (const gchar  *file_uri,
+                                      gchar       **title,
+                                      gchar       **performer);
+
+G_END_DECLS
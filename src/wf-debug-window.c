@@ -0,0 +1,227 @@
+/*
+ * wf-debug-window.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <glib/gi18n.h>
+
+#include "wf-debug-window.h"
+
+/*
+ * Shows the player's dropout counters and latencies, refreshed twice a
+ * second. Every change of a counter is logged with the wall clock time
+ * and how late the refresh itself ran, so dropouts can be lined up with
+ * analysis runs or a stalled main loop.
+ */
+
+#define REFRESH_INTERVAL 500
+
+struct _WfDebugWindow
+{
+    AdwWindow parent;
+
+    WfPlayer *player;
+    guint refresh_id;
+
+    guint underruns;
+    guint late_buffers;
+    guint qos_events;
+    gint64 last_refresh;
+    gint64 main_loop_lag;
+
+    /* Template widgets */
+    GtkLabel *priority_label;
+    GtkLabel *underruns_label;
+    GtkLabel *late_buffers_label;
+    GtkLabel *qos_events_label;
+    GtkLabel *output_latency_label;
+    GtkLabel *switch_latency_label;
+    GtkLabel *seek_latency_label;
+    GtkTextView *log_view;
+};
+
+static void dispose (GObject *object);
+
+G_DEFINE_FINAL_TYPE (WfDebugWindow, wf_debug_window, ADW_TYPE_WINDOW)
+
+static void
+wf_debug_window_class_init (WfDebugWindowClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+    object_class->dispose = dispose;
+
+    gtk_widget_class_set_template_from_resource (widget_class,
+                                                 "/cc/placid/Wavefront/ui/wf-debug-window.ui");
+
+    gtk_widget_class_bind_template_child (widget_class, WfDebugWindow, priority_label);
+    gtk_widget_class_bind_template_child (widget_class, WfDebugWindow, underruns_label);
+    gtk_widget_class_bind_template_child (widget_class, WfDebugWindow, late_buffers_label);
+    gtk_widget_class_bind_template_child (widget_class, WfDebugWindow, qos_events_label);
+    gtk_widget_class_bind_template_child (widget_class, WfDebugWindow, output_latency_label);
+    gtk_widget_class_bind_template_child (widget_class, WfDebugWindow, switch_latency_label);
+    gtk_widget_class_bind_template_child (widget_class, WfDebugWindow, seek_latency_label);
+    gtk_widget_class_bind_template_child (widget_class, WfDebugWindow, log_view);
+}
+
+static void
+wf_debug_window_init (WfDebugWindow *self)
+{
+    gtk_widget_init_template (GTK_WIDGET (self));
+}
+
+static void
+dispose (GObject *object)
+{
+    WfDebugWindow *window = WF_DEBUG_WINDOW (object);
+
+    g_clear_handle_id (&window->refresh_id, g_source_remove);
+    g_clear_object (&window->player);
+    G_OBJECT_CLASS (wf_debug_window_parent_class)->dispose (object);
+}
+
+static void
+set_label_uint (GtkLabel *label,
+                guint     value)
+{
+    gchar *text;
+
+    text = g_strdup_printf ("%u", value);
+    gtk_label_set_text (label, text);
+    g_free (text);
+}
+
+static void
+set_label_time (GtkLabel *label,
+                guint64   us)
+{
+    gchar *text;
+
+    text = g_strdup_printf ("%.1f ms", us / 1000.0);
+    gtk_label_set_text (label, text);
+    g_free (text);
+}
+
+static void
+log_change (WfDebugWindow *self,
+            const gchar   *name,
+            guint          value,
+            guint          previous)
+{
+    GtkTextBuffer *buffer;
+    GtkTextIter end;
+    GDateTime *now;
+    gchar *stamp, *line;
+
+    now = g_date_time_new_now_local ();
+    stamp = g_date_time_format (now, "%H:%M:%S.%f");
+    line = g_strdup_printf ("%.12s  %s %u (+%u), main loop %.0f ms late\n",
+                            stamp, name, value, value - previous,
+                            self->main_loop_lag / 1000.0);
+
+    buffer = gtk_text_view_get_buffer (self->log_view);
+    gtk_text_buffer_get_end_iter (buffer, &end);
+    gtk_text_buffer_insert (buffer, &end, line, -1);
+
+    g_free (line);
+    g_free (stamp);
+    g_date_time_unref (now);
+}
+
+static void
+update_counter (WfDebugWindow *self,
+                GtkLabel      *label,
+                const gchar   *name,
+                guint         *last,
+                guint          value)
+{
+    if (value != *last)
+        log_change (self, name, value, *last);
+    *last = value;
+    set_label_uint (label, value);
+}
+
+static gboolean
+refresh_cb (gpointer user_data)
+{
+    WfDebugWindow *self = user_data;
+    const gchar *priority;
+    gint64 now;
+
+    /* A refresh that runs late means the main loop was busy. */
+    now = g_get_monotonic_time ();
+    self->main_loop_lag = self->last_refresh ?
+        MAX (now - self->last_refresh - REFRESH_INTERVAL * 1000, 0) : 0;
+    self->last_refresh = now;
+
+    switch (wf_player_get_audio_priority (self->player)) {
+    case WF_AUDIO_PRIORITY_REALTIME:
+        priority = _("Real-time");
+        break;
+    case WF_AUDIO_PRIORITY_ELEVATED:
+        priority = _("Elevated");
+        break;
+    case WF_AUDIO_PRIORITY_NORMAL:
+    default:
+        priority = _("Normal");
+        break;
+    }
+    gtk_label_set_text (self->priority_label, priority);
+
+    update_counter (self, self->underruns_label, "underruns", &self->underruns,
+                    wf_player_get_underruns (self->player));
+    update_counter (self, self->late_buffers_label, "late buffers", &self->late_buffers,
+                    wf_player_get_late_buffers (self->player));
+    update_counter (self, self->qos_events_label, "QoS events", &self->qos_events,
+                    wf_player_get_qos_events (self->player));
+
+    set_label_time (self->output_latency_label, wf_player_get_output_latency (self->player) / 1000);
+    set_label_time (self->switch_latency_label, wf_player_get_switch_latency (self->player));
+    set_label_time (self->seek_latency_label, wf_player_get_seek_latency (self->player));
+
+    return G_SOURCE_CONTINUE;
+}
+
+WfDebugWindow *
+wf_debug_window_new (GtkWindow *parent,
+                     WfPlayer  *player)
+{
+    WfDebugWindow *self;
+
+    g_return_val_if_fail (WF_IS_PLAYER (player), NULL);
+
+    self = g_object_new (WF_TYPE_DEBUG_WINDOW,
+                         "transient-for", parent,
+                         "destroy-with-parent", TRUE,
+                         NULL);
+    self->player = g_object_ref (player);
+
+    /* Counts from before the window was opened are not logged as changes. */
+    self->underruns = wf_player_get_underruns (player);
+    self->late_buffers = wf_player_get_late_buffers (player);
+    self->qos_events = wf_player_get_qos_events (player);
+
+    refresh_cb (self);
+    self->refresh_id = g_timeout_add (REFRESH_INTERVAL, refresh_cb, self);
+
+    return self;
+}
@@ -0,0 +1,177 @@
+/*
+ * wf-eq-panel.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "wf-eq-panel.h"
+
+#define MAX_GAIN 12.0
+
+struct _WfEqPanel
+{
+    GtkWidget parent;
+
+    GPtrArray *scales;
+    gboolean updating;
+};
+
+enum
+{
+    GAIN_CHANGED,
+    N_SIGNALS
+};
+
+static guint signals[N_SIGNALS] = {0, };
+
+static void dispose (GObject *object);
+
+G_DEFINE_FINAL_TYPE (WfEqPanel, wf_eq_panel, GTK_TYPE_WIDGET)
+
+static void
+wf_eq_panel_class_init (WfEqPanelClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+    object_class->dispose = dispose;
+
+    /* Emitted with the band index and its new gain in dB. */
+    signals[GAIN_CHANGED] =
+        g_signal_new ("gain-changed",
+                      G_TYPE_FROM_CLASS (klass),
+                      G_SIGNAL_RUN_FIRST | G_SIGNAL_NO_RECURSE,
+                      0,
+                      NULL, NULL, NULL,
+                      G_TYPE_NONE,
+                      2,
+                      G_TYPE_UINT, G_TYPE_DOUBLE);
+
+    gtk_widget_class_set_layout_manager_type (widget_class, GTK_TYPE_BOX_LAYOUT);
+    gtk_widget_class_set_css_name (widget_class, "eqpanel");
+}
+
+static void
+wf_eq_panel_init (WfEqPanel *self)
+{
+    GtkLayoutManager *layout;
+
+    self->scales = g_ptr_array_new ();
+
+    layout = gtk_widget_get_layout_manager (GTK_WIDGET (self));
+    gtk_box_layout_set_spacing (GTK_BOX_LAYOUT (layout), 6);
+}
+
+static void
+clear_bands (WfEqPanel *self)
+{
+    GtkWidget *child;
+
+    while ((child = gtk_widget_get_first_child (GTK_WIDGET (self))))
+        gtk_widget_unparent (child);
+    g_ptr_array_set_size (self->scales, 0);
+}
+
+static void
+dispose (GObject *object)
+{
+    WfEqPanel *panel = WF_EQ_PANEL (object);
+
+    clear_bands (panel);
+    g_clear_pointer (&panel->scales, g_ptr_array_unref);
+    G_OBJECT_CLASS (wf_eq_panel_parent_class)->dispose (object);
+}
+
+static void
+value_changed_cb (WfEqPanel *self,
+                  GtkRange  *range)
+{
+    guint index;
+
+    if (self->updating || !g_ptr_array_find (self->scales, range, &index))
+        return;
+
+    g_signal_emit (self, signals[GAIN_CHANGED], 0, index, gtk_range_get_value (range));
+}
+
+static gchar *
+format_frequency (gdouble frequency)
+{
+    if (frequency >= 1000.0)
+        return g_strdup_printf ("%gk", frequency / 1000.0);
+
+    return g_strdup_printf ("%g", frequency);
+}
+
+WfEqPanel *
+wf_eq_panel_new (void)
+{
+    return g_object_new (WF_TYPE_EQ_PANEL, NULL);
+}
+
+/* Shows one slider per band, set to the band's gain and labelled with its
+ * frequency. Rebuilt only when the number of bands changes; otherwise the
+ * sliders are just moved and relabelled. */
+
+void
+wf_eq_panel_set_bands (WfEqPanel      *self,
+                       const WfEqBand *bands,
+                       guint           n_bands)
+{
+    GtkWidget *box, *scale, *label;
+    gchar *text;
+
+    g_return_if_fail (WF_IS_EQ_PANEL (self));
+    g_return_if_fail (bands != NULL || n_bands == 0);
+
+    self->updating = TRUE;
+
+    if (self->scales->len != n_bands) {
+        clear_bands (self);
+        for (guint i = 0; i < n_bands; i++) {
+            box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 6);
+
+            scale = gtk_scale_new_with_range (GTK_ORIENTATION_VERTICAL, -MAX_GAIN, MAX_GAIN, 0.5);
+            gtk_range_set_inverted (GTK_RANGE (scale), TRUE);
+            gtk_scale_add_mark (GTK_SCALE (scale), 0.0, GTK_POS_RIGHT, NULL);
+            gtk_widget_set_vexpand (scale, TRUE);
+            gtk_widget_set_size_request (scale, -1, 160);
+            g_signal_connect_swapped (scale, "value-changed", G_CALLBACK (value_changed_cb), self);
+            gtk_box_append (GTK_BOX (box), scale);
+
+            label = gtk_label_new (NULL);
+            gtk_widget_add_css_class (label, "caption");
+            gtk_box_append (GTK_BOX (box), label);
+
+            gtk_widget_set_parent (box, GTK_WIDGET (self));
+            g_ptr_array_add (self->scales, scale);
+        }
+    }
+
+    /* A preset with as many bands may still put them elsewhere. */
+    for (guint i = 0; i < n_bands; i++) {
+        scale = g_ptr_array_index (self->scales, i);
+        gtk_range_set_value (GTK_RANGE (scale), bands[i].gain);
+
+        text = format_frequency (bands[i].frequency);
+        gtk_label_set_text (GTK_LABEL (gtk_widget_get_next_sibling (scale)), text);
+        g_free (text);
+    }
+
+    self->updating = FALSE;
+}
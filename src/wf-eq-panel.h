@@ -0,0 +1,38 @@
+/*
+ * wf-eq-panel.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <adwaita.h>
+
+#include "wf-equalizer.h"
+
+G_BEGIN_DECLS
+
+#define WF_TYPE_EQ_PANEL (wf_eq_panel_get_type ())
+G_DECLARE_FINAL_TYPE (WfEqPanel, wf_eq_panel, WF, EQ_PANEL, GtkWidget)
+
+WfEqPanel *wf_eq_panel_new       (void);
+void       wf_eq_panel_set_bands (WfEqPanel      *self,
+                                  const WfEqBand *bands,
+                                  guint           n_bands);
+
+G_END_DECLS
@@ -0,0 +1,504 @@
+/*
+ * wf-equalizer.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "wf-equalizer.h"
+
+/*
+ * A parametric equalizer made of RBJ biquads in transposed direct form II.
+ *
+ * Interleaved frames are loaded into 4-lane vectors, one lane per channel,
+ * so every band filters all channels of a frame with one set of vector
+ * operations. Only 32-bit float is accepted; playbin converts as needed.
+ *
+ * Bands are set by publishing a whole parameter block through a triple
+ * buffer: the publisher fills the spare block and swaps it in with one
+ * atomic exchange, and the streaming thread swaps the newest one out at
+ * the start of the next buffer. A curve is never applied half updated,
+ * and the streaming thread neither allocates nor waits. It then glides
+ * the band parameters towards the new ones block by block, so changes
+ * do not click.
+ */
+
+#define MAX_CHANNELS  8
+#define N_VECS        (MAX_CHANNELS / 4)
+#define BLOCK_FRAMES  64
+#define SMOOTH_TIME   0.01
+#define SETTLED       1e-4
+#define DENORMAL      1e-18f
+#define MIN_FREQUENCY 10.0
+#define MAX_FRACTION  0.49  /* of the sample rate, just under Nyquist */
+#define FRESH         0x4
+
+typedef gfloat v4sf __attribute__ ((vector_size (16)));
+
+typedef struct
+{
+    guint n_bands;
+    WfEqBand bands[WF_EQUALIZER_MAX_BANDS];
+} WfEqParams;
+
+typedef struct
+{
+    WfEqBand current;
+    WfEqBand target;
+
+    v4sf b0, b1, b2, a1, a2;
+    v4sf z1[N_VECS];
+    v4sf z2[N_VECS];
+} WfEqBandState;
+
+struct _WfEqualizer
+{
+    GstAudioFilter parent;
+
+    /* Triple buffer. The middle index carries FRESH while it holds a block
+     * the streaming thread has not taken yet. */
+    WfEqParams params[3];
+    gint middle;
+    gint back;
+    gint front;
+
+    /* Streaming thread only. Bands past n_wanted are left from a longer
+     * curve and fading out; they are dropped once flat. */
+    guint n_bands;
+    guint n_wanted;
+    WfEqBandState bands[WF_EQUALIZER_MAX_BANDS];
+    gboolean settling;
+    gboolean flat;
+    gdouble smoothing;
+    gint rate;
+    gint channels;
+};
+
+static const WfEqBand default_bands[] = {
+    {WF_EQ_BAND_LOW_SHELF,     31.0, 0.0, 0.707},
+    {WF_EQ_BAND_PEAK,          62.0, 0.0, 1.41},
+    {WF_EQ_BAND_PEAK,         125.0, 0.0, 1.41},
+    {WF_EQ_BAND_PEAK,         250.0, 0.0, 1.41},
+    {WF_EQ_BAND_PEAK,         500.0, 0.0, 1.41},
+    {WF_EQ_BAND_PEAK,        1000.0, 0.0, 1.41},
+    {WF_EQ_BAND_PEAK,        2000.0, 0.0, 1.41},
+    {WF_EQ_BAND_PEAK,        4000.0, 0.0, 1.41},
+    {WF_EQ_BAND_PEAK,        8000.0, 0.0, 1.41},
+    {WF_EQ_BAND_HIGH_SHELF, 16000.0, 0.0, 0.707},
+};
+
+static gboolean      setup        (GstAudioFilter     *filter,
+                                   const GstAudioInfo *info);
+static GstFlowReturn transform_ip (GstBaseTransform *trans,
+                                   GstBuffer        *buffer);
+
+G_DEFINE_FINAL_TYPE (WfEqualizer, wf_equalizer, GST_TYPE_AUDIO_FILTER)
+
+static void
+wf_equalizer_class_init (WfEqualizerClass *klass)
+{
+    GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+    GstBaseTransformClass *transform_class = GST_BASE_TRANSFORM_CLASS (klass);
+    GstAudioFilterClass *filter_class = GST_AUDIO_FILTER_CLASS (klass);
+    GstCaps *caps;
+
+    transform_class->transform_ip = transform_ip;
+    filter_class->setup = setup;
+
+    caps = gst_caps_from_string (GST_AUDIO_CAPS_MAKE (GST_AUDIO_NE (F32))
+                                 ", layout = (string) interleaved, channels = (int) [ 1, 8 ]");
+    gst_audio_filter_class_add_pad_templates (filter_class, caps);
+    gst_caps_unref (caps);
+
+    gst_element_class_set_static_metadata (element_class,
+                                           "Wavefront equalizer",
+                                           "Filter/Effect/Audio",
+                                           "Parametric equalizer",
+                                           "Dilnavas Roshan <dilnavasroshan@gmail.com>");
+}
+
+static void
+wf_equalizer_init (WfEqualizer *self)
+{
+    self->flat = TRUE;
+    self->front = 0;
+    self->middle = 1;
+    self->back = 2;
+    wf_equalizer_set_bands (self, default_bands, G_N_ELEMENTS (default_bands));
+}
+
+static inline v4sf
+splat (gdouble value)
+{
+    gfloat f = value;
+
+    return (v4sf) {f, f, f, f};
+}
+
+static void
+compute_coeffs (WfEqualizer   *self,
+                WfEqBandState *state)
+{
+    const WfEqBand *band = &state->current;
+    gdouble a, w0, cos_w0, alpha, sqrt_a;
+    gdouble b0, b1, b2, a0, a1, a2;
+
+    a = pow (10.0, band->gain / 40.0);
+    w0 = 2.0 * G_PI * CLAMP (band->frequency, MIN_FREQUENCY, self->rate * MAX_FRACTION) / self->rate;
+    cos_w0 = cos (w0);
+    alpha = sin (w0) / (2.0 * MAX (band->q, 0.01));
+    sqrt_a = sqrt (a);
+
+    switch (band->type) {
+    case WF_EQ_BAND_LOW_SHELF:
+        b0 = a * ((a + 1) - (a - 1) * cos_w0 + 2 * sqrt_a * alpha);
+        b1 = 2 * a * ((a - 1) - (a + 1) * cos_w0);
+        b2 = a * ((a + 1) - (a - 1) * cos_w0 - 2 * sqrt_a * alpha);
+        a0 = (a + 1) + (a - 1) * cos_w0 + 2 * sqrt_a * alpha;
+        a1 = -2 * ((a - 1) + (a + 1) * cos_w0);
+        a2 = (a + 1) + (a - 1) * cos_w0 - 2 * sqrt_a * alpha;
+        break;
+    case WF_EQ_BAND_HIGH_SHELF:
+        b0 = a * ((a + 1) + (a - 1) * cos_w0 + 2 * sqrt_a * alpha);
+        b1 = -2 * a * ((a - 1) + (a + 1) * cos_w0);
+        b2 = a * ((a + 1) + (a - 1) * cos_w0 - 2 * sqrt_a * alpha);
+        a0 = (a + 1) - (a - 1) * cos_w0 + 2 * sqrt_a * alpha;
+        a1 = 2 * ((a - 1) - (a + 1) * cos_w0);
+        a2 = (a + 1) - (a - 1) * cos_w0 - 2 * sqrt_a * alpha;
+        break;
+    case WF_EQ_BAND_PEAK:
+    default:
+        b0 = 1 + alpha * a;
+        b1 = -2 * cos_w0;
+        b2 = 1 - alpha * a;
+        a0 = 1 + alpha / a;
+        a1 = -2 * cos_w0;
+        a2 = 1 - alpha / a;
+        break;
+    }
+
+    state->b0 = splat (b0 / a0);
+    state->b1 = splat (b1 / a0);
+    state->b2 = splat (b2 / a0);
+    state->a1 = splat (a1 / a0);
+    state->a2 = splat (a2 / a0);
+}
+
+static void
+reset_state (WfEqualizer *self)
+{
+    for (guint i = 0; i < self->n_bands; i++) {
+        for (guint v = 0; v < N_VECS; v++) {
+            self->bands[i].z1[v] = (v4sf) {0};
+            self->bands[i].z2[v] = (v4sf) {0};
+        }
+    }
+}
+
+/* Keeps a frequency between MIN_FREQUENCY and just under Nyquist, once
+ * the rate is known: outside, the coefficients make no sense and the
+ * glide in the log domain gives NaN. */
+
+static gdouble
+clamp_frequency (WfEqualizer *self,
+                 gdouble      frequency)
+{
+    if (!(frequency >= MIN_FREQUENCY))
+        return MIN_FREQUENCY;
+    if (self->rate > 0)
+        return MIN (frequency, self->rate * MAX_FRACTION);
+
+    return frequency;
+}
+
+/* Takes a published block. Bands that disappear are faded to 0 dB before
+ * they are dropped, and new bands fade in from 0 dB. */
+
+static void
+take_params (WfEqualizer *self,
+             WfEqParams  *params)
+{
+    WfEqBandState *state;
+
+    for (guint i = 0; i < MAX (params->n_bands, self->n_bands); i++) {
+        state = &self->bands[i];
+        if (i >= self->n_bands) {
+            memset (state, 0, sizeof (*state));
+            state->current = params->bands[i];
+            state->current.frequency = clamp_frequency (self, state->current.frequency);
+            state->current.gain = 0.0;
+        }
+
+        if (i < params->n_bands) {
+            state->target = params->bands[i];
+            state->target.frequency = clamp_frequency (self, state->target.frequency);
+        } else {
+            state->target = state->current;
+            state->target.gain = 0.0;
+        }
+    }
+
+    self->n_bands = MAX (params->n_bands, self->n_bands);
+    self->n_wanted = params->n_bands;
+    self->settling = TRUE;
+}
+
+/* Moves every band one block closer to its target and recomputes its
+ * coefficients. Frequency glides in the log domain. Switching the type
+ * of a band at any other gain would jump the response, but at 0 dB every
+ * type passes audio through unchanged: a band that changes type glides
+ * to 0 dB first, switches there and glides on to its target. */
+
+static void
+smooth_step (WfEqualizer *self)
+{
+    WfEqBandState *state;
+    gboolean settling = FALSE;
+    gboolean flat = TRUE;
+    gdouble k = self->smoothing;
+    gdouble gain;
+
+    for (guint i = 0; i < self->n_bands; i++) {
+        state = &self->bands[i];
+        if (state->current.type != state->target.type && fabs (state->current.gain) < SETTLED) {
+            state->current.type = state->target.type;
+            state->current.gain = 0.0;
+        }
+        gain = state->current.type == state->target.type ? state->target.gain : 0.0;
+
+        if (state->current.type == state->target.type &&
+            fabs (state->target.gain - state->current.gain) < SETTLED &&
+            fabs (log (state->target.frequency / state->current.frequency)) < SETTLED &&
+            fabs (state->target.q - state->current.q) < SETTLED) {
+            state->current = state->target;
+        } else {
+            state->current.gain += (gain - state->current.gain) * k;
+            state->current.frequency *= pow (state->target.frequency / state->current.frequency, k);
+            state->current.q += (state->target.q - state->current.q) * k;
+            settling = TRUE;
+        }
+
+        if (state->current.gain != 0.0)
+            flat = FALSE;
+
+        compute_coeffs (self, state);
+    }
+
+    /* The bands left over have reached 0 dB, which passes audio through
+     * unchanged: the chain is cut back to the curve. */
+    if (!settling)
+        self->n_bands = self->n_wanted;
+
+    self->settling = settling;
+    if (flat && !self->flat)
+        reset_state (self);
+    self->flat = flat;
+}
+
+static void
+process_block (WfEqualizer *self,
+               gfloat      *data,
+               guint        n_frames)
+{
+    WfEqBandState *state;
+    gint channels = self->channels;
+    guint n_vecs = (channels + 3) / 4;
+    guint lanes;
+    v4sf x, y;
+
+    for (guint f = 0; f < n_frames; f++, data += channels) {
+        for (guint v = 0; v < n_vecs; v++) {
+            lanes = MIN (4, channels - v * 4);
+
+            x = (v4sf) {0};
+            for (guint c = 0; c < lanes; c++)
+                x[c] = data[v * 4 + c];
+
+            for (guint i = 0; i < self->n_bands; i++) {
+                state = &self->bands[i];
+                y = state->b0 * x + state->z1[v];
+                state->z1[v] = state->b1 * x - state->a1 * y + state->z2[v];
+                state->z2[v] = state->b2 * x - state->a2 * y;
+                x = y;
+            }
+
+            for (guint c = 0; c < lanes; c++)
+                data[v * 4 + c] = x[c];
+        }
+    }
+
+    /* Decaying feedback would otherwise end up in denormals, which are
+     * very slow on some CPUs. Adding and removing a tiny constant flushes
+     * them to zero. */
+    for (guint i = 0; i < self->n_bands; i++) {
+        state = &self->bands[i];
+        for (guint v = 0; v < n_vecs; v++) {
+            state->z1[v] = (state->z1[v] + DENORMAL) - DENORMAL;
+            state->z2[v] = (state->z2[v] + DENORMAL) - DENORMAL;
+        }
+    }
+}
+
+static gboolean
+setup (GstAudioFilter     *filter,
+       const GstAudioInfo *info)
+{
+    WfEqualizer *self = WF_EQUALIZER (filter);
+
+    self->rate = GST_AUDIO_INFO_RATE (info);
+    self->channels = GST_AUDIO_INFO_CHANNELS (info);
+    self->smoothing = 1.0 - exp (-BLOCK_FRAMES / (SMOOTH_TIME * self->rate));
+
+    /* Coefficients depend on the rate; recompute them for the current curve. */
+    for (guint i = 0; i < self->n_bands; i++) {
+        self->bands[i].current.frequency = clamp_frequency (self, self->bands[i].current.frequency);
+        self->bands[i].target.frequency = clamp_frequency (self, self->bands[i].target.frequency);
+        compute_coeffs (self, &self->bands[i]);
+    }
+    reset_state (self);
+
+    return TRUE;
+}
+
+static GstFlowReturn
+transform_ip (GstBaseTransform *trans,
+              GstBuffer        *buffer)
+{
+    WfEqualizer *self = WF_EQUALIZER (trans);
+    GstMapInfo info;
+    gfloat *data;
+    guint n_frames, n;
+
+    if (g_atomic_int_get (&self->middle) & FRESH) {
+        self->front = g_atomic_int_exchange (&self->middle, self->front) & ~FRESH;
+        take_params (self, &self->params[self->front]);
+    }
+
+    if (self->rate == 0 || (self->flat && !self->settling))
+        return GST_FLOW_OK;
+
+    if (!gst_buffer_map (buffer, &info, GST_MAP_READWRITE))
+        return GST_FLOW_ERROR;
+
+    data = (gfloat *) info.data;
+    n_frames = info.size / (sizeof (gfloat) * self->channels);
+    while (n_frames > 0) {
+        if (self->settling)
+            smooth_step (self);
+
+        n = MIN (n_frames, BLOCK_FRAMES);
+        if (!self->flat || self->settling)
+            process_block (self, data, n);
+
+        data += n * self->channels;
+        n_frames -= n;
+    }
+
+    gst_buffer_unmap (buffer, &info);
+
+    return GST_FLOW_OK;
+}
+
+WfEqualizer *
+wf_equalizer_new (void)
+{
+    return g_object_new (WF_TYPE_EQUALIZER, NULL);
+}
+
+/* Publishes a whole new curve at once. Safe to call while the element is
+ * streaming; a curve that was not picked up yet is replaced. Publishers
+ * are serialized by the object lock, the streaming thread never waits. */
+
+void
+wf_equalizer_set_bands (WfEqualizer    *self,
+                        const WfEqBand *bands,
+                        guint           n_bands)
+{
+    WfEqParams *params;
+
+    g_return_if_fail (WF_IS_EQUALIZER (self));
+    g_return_if_fail (n_bands <= WF_EQUALIZER_MAX_BANDS);
+    g_return_if_fail (bands != NULL || n_bands == 0);
+
+    GST_OBJECT_LOCK (self);
+    params = &self->params[self->back];
+    params->n_bands = n_bands;
+    if (n_bands)
+        memcpy (params->bands, bands, n_bands * sizeof (WfEqBand));
+
+    self->back = g_atomic_int_exchange (&self->middle, self->back | FRESH) & ~FRESH;
+    GST_OBJECT_UNLOCK (self);
+}
+
+/* Octave-spaced bands at the frequencies equalizer-10bands uses, all flat. */
+
+const WfEqBand *
+wf_equalizer_get_default_bands (guint *n_bands)
+{
+    if (n_bands)
+        *n_bands = G_N_ELEMENTS (default_bands);
+
+    return default_bands;
+}
+
+/* Converts an a(iddd) curve as stored in the settings. */
+
+guint
+wf_eq_bands_from_variant (GVariant *variant,
+                          WfEqBand *bands)
+{
+    GVariantIter iter;
+    gint type;
+    gdouble frequency, gain, q;
+    guint n_bands = 0;
+
+    g_return_val_if_fail (variant != NULL, 0);
+    g_return_val_if_fail (bands != NULL, 0);
+
+    g_variant_iter_init (&iter, variant);
+    while (n_bands < WF_EQUALIZER_MAX_BANDS &&
+           g_variant_iter_next (&iter, "(iddd)", &type, &frequency, &gain, &q)) {
+        bands[n_bands].type = CLAMP (type, WF_EQ_BAND_PEAK, WF_EQ_BAND_HIGH_SHELF);
+        bands[n_bands].frequency = frequency;
+        bands[n_bands].gain = gain;
+        bands[n_bands].q = q;
+        n_bands++;
+    }
+
+    return n_bands;
+}
+
+GVariant *
+wf_eq_bands_to_variant (const WfEqBand *bands,
+                        guint           n_bands)
+{
+    GVariantBuilder builder;
+
+    g_return_val_if_fail (bands != NULL || n_bands == 0, NULL);
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(iddd)"));
+    for (guint i = 0; i < n_bands; i++)
+        g_variant_builder_add (&builder, "(iddd)", (gint) bands[i].type,
+                               bands[i].frequency, bands[i].gain, bands[i].q);
+
+    return g_variant_builder_end (&builder);
+}
@@ -0,0 +1,60 @@
+/*
+ * wf-equalizer.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gst/gst.h>
+#include <gst/audio/gstaudiofilter.h>
+
+G_BEGIN_DECLS
+
+#define WF_EQUALIZER_MAX_BANDS 16
+
+typedef enum
+{
+    WF_EQ_BAND_PEAK,
+    WF_EQ_BAND_LOW_SHELF,
+    WF_EQ_BAND_HIGH_SHELF,
+} WfEqBandType;
+
+typedef struct
+{
+    WfEqBandType type;
+    gdouble frequency;
+    gdouble gain;
+    gdouble q;
+} WfEqBand;
+
+#define WF_TYPE_EQUALIZER (wf_equalizer_get_type ())
+G_DECLARE_FINAL_TYPE (WfEqualizer, wf_equalizer, WF, EQUALIZER, GstAudioFilter)
+
+WfEqualizer    *wf_equalizer_new               (void);
+void            wf_equalizer_set_bands         (WfEqualizer    *self,
+                                                const WfEqBand *bands,
+                                                guint           n_bands);
+const WfEqBand *wf_equalizer_get_default_bands (guint *n_bands);
+
+guint     wf_eq_bands_from_variant (GVariant       *variant,
+                                    WfEqBand       *bands);
+GVariant *wf_eq_bands_to_variant   (const WfEqBand *bands,
+                                    guint           n_bands);
+
+G_END_DECLS
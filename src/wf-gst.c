@@ -0,0 +1,87 @@
+/*
+ * wf-gst.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <gst/gst.h>
+
+#include "wf-gst.h"
+#include "wf-mmap-src.h"
+
+/*
+ * gst_init() loads the plugin registry, which on a cold cache means
+ * scanning every plugin. It is started on a worker thread while the
+ * window comes up; the first code that builds a pipeline waits for it.
+ */
+
+static GThread *init_thread = NULL;
+
+#ifdef HAVE_SYSPROF
+/* Traced builds also turn on GStreamer's latency and stats tracers, which
+ * log at GST_TRACER:7 for gst-stats-1.0 to read. Anything set in the
+ * environment wins. It has to run before gst_init(), and in the app it
+ * runs from main() before other threads start, as setenv() needs. */
+static void
+enable_tracers (void)
+{
+    g_setenv ("GST_TRACERS", "latency(flags=pipeline+element);stats", FALSE);
+    g_setenv ("GST_DEBUG", "GST_TRACER:7", FALSE);
+}
+#else
+#define enable_tracers() G_STMT_START { } G_STMT_END
+#endif
+
+static gpointer
+init_func (gpointer data)
+{
+    gst_init (NULL, NULL);
+    wf_mmap_src_register ();
+
+    return NULL;
+}
+
+/* Call once from main(), before the first wf_gst_ensure(). */
+void
+wf_gst_init_async (void)
+{
+    g_return_if_fail (init_thread == NULL);
+
+    enable_tracers ();
+    init_thread = g_thread_new ("gst-init", init_func, NULL);
+}
+
+/* Returns once GStreamer is usable, initializing it in place if no
+ * background initialization was started. Any thread may wait here. */
+void
+wf_gst_ensure (void)
+{
+    static gsize initialized = 0;
+
+    if (g_once_init_enter (&initialized)) {
+        if (init_thread)
+            g_thread_join (g_steal_pointer (&init_thread));
+        else {
+            enable_tracers ();
+            init_func (NULL);
+        }
+        g_once_init_leave (&initialized, 1);
+    }
+}
@@ -0,0 +1,1338 @@
+/*
+ * wf-library.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <gio/gio.h>
+#include <glib/gi18n.h>
+#include <gst/pbutils/pbutils.h>
+
+#include "wf-library.h"
+#include "wf-covers.h"
+#include "wf-cue-sheet.h"
+#include "wf-gst.h"
+
+/*
+ * Keeps a WfTrackStore in step with the music folders. A scan walks the
+ * folders on a worker thread and only stats files; files that are new,
+ * or whose size or modification time changed since the index was
+ * written, go to a pool of GstDiscoverer workers. Their results come back
+ * to the main thread in batches. A track is only dropped when its file is
+ * gone or no longer audio, not when discovery timed out or failed. Each
+ * folder is watched afterwards, a batch of folders per idle, so later
+ * changes touch just the files concerned. The store is written back to
+ * disk whenever things have settled, and the covers no track refers to
+ * any more are deleted then.
+ *
+ * A file with a CUE sheet next to it, or with chapters, is also listed
+ * as one sub-track per entry, under the uri WfSubTrack gives it. Such a
+ * file is recorded with the modification time of its sheet if that is
+ * later, so that editing the sheet counts as a change to the file.
+ */
+
+#define MAX_DISCOVERERS  4
+#define DISCOVER_TIMEOUT (5 * GST_SECOND)
+#define SAVE_DELAY       2 /* seconds */
+#define WATCH_BATCH      64
+
+#define SCAN_ATTRIBUTES \
+    G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+    G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+    G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE "," \
+    G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+    G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+    G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC
+
+struct _WfLibrary
+{
+    GObject parent;
+
+    gchar *index_path;
+    gchar **folders;
+    gboolean started;
+
+    WfTrackStore *store;
+    gboolean dirty;
+    guint save_id;
+    gboolean pruning;
+
+    GCancellable *cancellable;
+    guint n_scans;
+    guint n_pending;
+    gboolean scanning;
+
+    GThreadPool *pool;
+    GMutex lock;
+    GPtrArray *done;
+    guint flush_id;
+
+    /* Directory uri to GFileMonitor, and directories still to watch. */
+    GHashTable *monitors;
+    GPtrArray *unwatched;
+    guint watch_id;
+};
+
+typedef struct
+{
+    gchar *uri;
+    guint64 size;
+    gint64 mtime;
+} ScanEntry;
+
+typedef struct
+{
+    GHashTable *live;
+    gint64 since;
+} PruneData;
+
+typedef struct
+{
+    gchar **roots;
+    gboolean full;
+    GArray *entries;
+    GPtrArray *dirs;
+} ScanData;
+
+typedef struct
+{
+    gchar *uri;
+    guint64 size;
+    gint64 mtime;
+
+    gboolean found;
+    gboolean gone;
+    gchar *title;
+    gchar *artist;
+    gchar *album;
+    gchar *cover;
+    guint64 duration;
+
+    /* WfSubTrack, and the album they are listed under. */
+    GPtrArray *sub_tracks;
+    gchar *sub_album;
+} DiscoverJob;
+
+enum
+{
+    PROP_ZERO,
+    PROP_FOLDERS,
+    PROP_SCANNING,
+    N_PROPS
+};
+
+static GParamSpec *properties[N_PROPS] = {NULL, };
+
+/* Each worker thread keeps its own discoverer. */
+static GPrivate discoverer_key = G_PRIVATE_INIT (g_object_unref);
+
+static void get_property (GObject    *object,
+                          guint       property_id,
+                          GValue     *value,
+                          GParamSpec *pspec);
+static void set_property (GObject      *object,
+                          guint         property_id,
+                          const GValue *value,
+                          GParamSpec   *pspec);
+static void dispose      (GObject *object);
+static void finalize     (GObject *object);
+
+static void discover_func (gpointer data,
+                           gpointer user_data);
+static void job_free      (DiscoverJob *job);
+
+G_DEFINE_FINAL_TYPE (WfLibrary, wf_library, G_TYPE_OBJECT)
+
+static void
+wf_library_class_init (WfLibraryClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->get_property = get_property;
+    object_class->set_property = set_property;
+    object_class->dispose = dispose;
+    object_class->finalize = finalize;
+
+    /* Paths or uris; empty for the XDG music directory. */
+    properties[PROP_FOLDERS] =
+        g_param_spec_boxed ("folders",
+                            NULL, NULL,
+                            G_TYPE_STRV, G_PARAM_READWRITE);
+
+    properties[PROP_SCANNING] =
+        g_param_spec_boolean ("scanning",
+                              NULL, NULL,
+                              FALSE, G_PARAM_READABLE);
+
+    g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+wf_library_init (WfLibrary *self)
+{
+    self->folders = g_new0 (gchar *, 1);
+    self->store = wf_track_store_new ();
+    self->cancellable = g_cancellable_new ();
+
+    g_mutex_init (&self->lock);
+    self->done = g_ptr_array_new_with_free_func ((GDestroyNotify) job_free);
+    self->pool = g_thread_pool_new_full (discover_func, self, (GDestroyNotify) job_free,
+                                         MIN (g_get_num_processors (), MAX_DISCOVERERS),
+                                         FALSE, NULL);
+
+    self->monitors = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+    self->unwatched = g_ptr_array_new_with_free_func (g_free);
+}
+
+typedef struct
+{
+    WfLibrary *library;
+    const gchar *under;
+    GHashTable *keep;
+} DropData;
+
+/* Drops the watch on directories below @under, or not in @keep. */
+static gboolean
+drop_monitor (gpointer key,
+              gpointer value,
+              gpointer user_data)
+{
+    DropData *data = user_data;
+    const gchar *uri = key;
+    gsize length;
+
+    if (data->under) {
+        length = strlen (data->under);
+        if (strncmp (uri, data->under, length) != 0 ||
+            (uri[length] != '/' && uri[length] != '\0'))
+            return FALSE;
+    }
+    if (data->keep && g_hash_table_contains (data->keep, uri))
+        return FALSE;
+
+    g_signal_handlers_disconnect_by_data (value, data->library);
+    g_file_monitor_cancel (value);
+
+    return TRUE;
+}
+
+static void
+dispose (GObject *object)
+{
+    WfLibrary *library = WF_LIBRARY (object);
+    DropData drop = {library, NULL, NULL};
+
+    g_cancellable_cancel (library->cancellable);
+
+    if (library->pool) {
+        g_thread_pool_free (library->pool, TRUE, TRUE);
+        library->pool = NULL;
+    }
+
+    g_mutex_lock (&library->lock);
+    g_clear_handle_id (&library->flush_id, g_source_remove);
+    g_mutex_unlock (&library->lock);
+
+    g_clear_handle_id (&library->watch_id, g_source_remove);
+    if (library->monitors) {
+        g_hash_table_foreach_remove (library->monitors, drop_monitor, &drop);
+        g_clear_pointer (&library->monitors, g_hash_table_unref);
+    }
+
+    /* Whatever was found since the last save is kept. */
+    g_clear_handle_id (&library->save_id, g_source_remove);
+    if (library->dirty && library->store)
+        wf_library_save (library, NULL);
+
+    g_clear_object (&library->store);
+
+    G_OBJECT_CLASS (wf_library_parent_class)->dispose (object);
+}
+
+static void
+finalize (GObject *object)
+{
+    WfLibrary *library = WF_LIBRARY (object);
+
+    g_ptr_array_unref (library->done);
+    g_ptr_array_unref (library->unwatched);
+    g_mutex_clear (&library->lock);
+    g_object_unref (library->cancellable);
+    g_strfreev (library->folders);
+    g_free (library->index_path);
+
+    G_OBJECT_CLASS (wf_library_parent_class)->finalize (object);
+}
+
+static void
+get_property (GObject    *object,
+              guint       property_id,
+              GValue     *value,
+              GParamSpec *pspec)
+{
+    WfLibrary *library = WF_LIBRARY (object);
+
+    switch (property_id) {
+    case PROP_FOLDERS:
+        g_value_set_boxed (value, library->folders);
+        break;
+    case PROP_SCANNING:
+        g_value_set_boolean (value, library->scanning);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+set_property (GObject      *object,
+              guint         property_id,
+              const GValue *value,
+              GParamSpec   *pspec)
+{
+    WfLibrary *library = WF_LIBRARY (object);
+
+    switch (property_id) {
+    case PROP_FOLDERS:
+        wf_library_set_folders (library, g_value_get_boxed (value));
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+job_free (DiscoverJob *job)
+{
+    g_free (job->uri);
+    g_free (job->title);
+    g_free (job->artist);
+    g_free (job->album);
+    g_free (job->cover);
+    g_clear_pointer (&job->sub_tracks, g_ptr_array_unref);
+    g_free (job->sub_album);
+    g_free (job);
+}
+
+static void
+scan_data_free (ScanData *data)
+{
+    for (guint i = 0; i < data->entries->len; i++)
+        g_free (g_array_index (data->entries, ScanEntry, i).uri);
+    g_array_unref (data->entries);
+    g_ptr_array_unref (data->dirs);
+    g_strfreev (data->roots);
+    g_free (data);
+}
+
+static gboolean
+is_audio (GFileInfo *info)
+{
+    const gchar *content_type;
+
+    content_type = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE);
+    if (!content_type)
+        return FALSE;
+
+    return g_str_has_prefix (content_type, "audio/") ||
+           g_content_type_is_a (content_type, "application/ogg");
+}
+
+static gboolean
+is_cue_sheet (GFileInfo *info)
+{
+    return g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR &&
+           g_str_has_suffix (g_file_info_get_name (info), ".cue");
+}
+
+static gint64
+get_mtime (GFileInfo *info)
+{
+    GDateTime *mtime;
+    gint64 usec;
+
+    mtime = g_file_info_get_modification_date_time (info);
+    if (!mtime)
+        return 0;
+
+    usec = g_date_time_to_unix_usec (mtime);
+    g_date_time_unref (mtime);
+
+    return usec;
+}
+
+/* Returns the later of @mtime and that of a CUE sheet next to @uri. */
+static gint64
+get_sheet_mtime (const gchar *uri,
+                 gint64       mtime)
+{
+    GFileInfo *info;
+    GFile *file;
+    gchar **sidecars;
+
+    sidecars = wf_cue_sheet_get_sidecars (uri);
+    for (guint i = 0; sidecars[i]; i++) {
+        file = g_file_new_for_uri (sidecars[i]);
+        info = g_file_query_info (file, SCAN_ATTRIBUTES, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                  NULL, NULL);
+        if (info) {
+            mtime = MAX (mtime, get_mtime (info));
+            g_object_unref (info);
+        }
+        g_object_unref (file);
+    }
+    g_strfreev (sidecars);
+
+    return mtime;
+}
+
+/* Walks the roots breadth first. Symbolic links are not followed, which
+ * also keeps loops out. */
+static void
+scan_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+    ScanData *data = task_data;
+    GQueue dirs = G_QUEUE_INIT;
+    GFileEnumerator *enumerator;
+    GFileInfo *info;
+    GFile *dir, *child;
+    GHashTable *sheets;
+    ScanEntry entry, *found;
+    gchar **sidecars;
+    gint64 mtime, *sheet_mtime;
+    guint first;
+    GError *error = NULL;
+
+    /* CUE sheet uri to its modification time, for one directory. */
+    sheets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+    for (guint i = 0; data->roots[i]; i++)
+        g_queue_push_tail (&dirs, g_file_new_for_uri (data->roots[i]));
+
+    while ((dir = g_queue_pop_head (&dirs))) {
+        enumerator = NULL;
+        if (!g_cancellable_is_cancelled (cancellable))
+            enumerator = g_file_enumerate_children (dir, SCAN_ATTRIBUTES,
+                                                    G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                                    cancellable, NULL);
+        if (!enumerator) {
+            g_object_unref (dir);
+            continue;
+        }
+
+        g_ptr_array_add (data->dirs, g_file_get_uri (dir));
+        first = data->entries->len;
+        while ((info = g_file_enumerator_next_file (enumerator, cancellable, NULL))) {
+            if (g_file_info_get_name (info)[0] == '.') {
+                g_object_unref (info);
+                continue;
+            }
+
+            child = g_file_enumerator_get_child (enumerator, info);
+            if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+                g_queue_push_tail (&dirs, child);
+            } else {
+                if (g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR && is_audio (info)) {
+                    entry.uri = g_file_get_uri (child);
+                    entry.size = g_file_info_get_size (info);
+                    entry.mtime = get_mtime (info);
+                    g_array_append_val (data->entries, entry);
+                } else if (is_cue_sheet (info)) {
+                    mtime = get_mtime (info);
+                    g_hash_table_insert (sheets, g_file_get_uri (child),
+                                         g_memdup2 (&mtime, sizeof (mtime)));
+                }
+                g_object_unref (child);
+            }
+            g_object_unref (info);
+        }
+
+        for (guint i = first; i < data->entries->len && g_hash_table_size (sheets) > 0; i++) {
+            found = &g_array_index (data->entries, ScanEntry, i);
+            sidecars = wf_cue_sheet_get_sidecars (found->uri);
+            for (guint j = 0; sidecars[j]; j++) {
+                sheet_mtime = g_hash_table_lookup (sheets, sidecars[j]);
+                if (sheet_mtime)
+                    found->mtime = MAX (found->mtime, *sheet_mtime);
+            }
+            g_strfreev (sidecars);
+        }
+        g_hash_table_remove_all (sheets);
+
+        g_object_unref (enumerator);
+        g_object_unref (dir);
+    }
+    g_hash_table_unref (sheets);
+
+    if (g_cancellable_set_error_if_cancelled (cancellable, &error))
+        g_task_return_error (task, error);
+    else
+        g_task_return_boolean (task, TRUE);
+}
+
+static void
+prune_data_free (PruneData *data)
+{
+    g_hash_table_unref (data->live);
+    g_free (data);
+}
+
+static void
+prune_thread (GTask        *task,
+              gpointer      source_object,
+              gpointer      task_data,
+              GCancellable *cancellable)
+{
+    PruneData *data = task_data;
+
+    wf_covers_prune (data->live, data->since);
+    g_task_return_boolean (task, TRUE);
+}
+
+static void
+prune_done_cb (GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+    WF_LIBRARY (source)->pruning = FALSE;
+}
+
+/* Hands the covers the tracks refer to now to a worker, which deletes
+ * the rest. */
+static void
+prune_covers (WfLibrary *self)
+{
+    PruneData *data;
+    WfTrack track;
+    GTask *task;
+    guint n_tracks;
+
+    if (self->pruning)
+        return;
+
+    data = g_new0 (PruneData, 1);
+    data->live = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    data->since = g_get_real_time () / G_USEC_PER_SEC;
+
+    n_tracks = wf_track_store_get_n_tracks (self->store);
+    for (guint i = 0; i < n_tracks; i++) {
+        wf_track_store_get_track (self->store, i, &track);
+        if (*track.cover && !g_hash_table_contains (data->live, track.cover))
+            g_hash_table_add (data->live, g_strdup (track.cover));
+    }
+
+    self->pruning = TRUE;
+    task = g_task_new (self, NULL, prune_done_cb, NULL);
+    g_task_set_task_data (task, data, (GDestroyNotify) prune_data_free);
+    g_task_run_in_thread (task, prune_thread);
+    g_object_unref (task);
+}
+
+static gboolean
+save_cb (gpointer user_data)
+{
+    WfLibrary *self = WF_LIBRARY (user_data);
+    GError *error = NULL;
+
+    self->save_id = 0;
+    if (!wf_library_save (self, &error)) {
+        g_warning ("Failed to write the library index: %s", error->message);
+        g_error_free (error);
+        return G_SOURCE_REMOVE;
+    }
+
+    prune_covers (self);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Writes the index once scanning and discovery have settled, rather than
+ * after every batch of a large scan. */
+static void
+update_scanning (WfLibrary *self)
+{
+    gboolean scanning;
+
+    scanning = self->n_scans > 0 || self->n_pending > 0;
+    if (!scanning && self->dirty && !self->save_id)
+        self->save_id = g_timeout_add_seconds (SAVE_DELAY, save_cb, self);
+
+    if (self->scanning == scanning)
+        return;
+
+    self->scanning = scanning;
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_SCANNING]);
+}
+
+/* Sub-track uris are the uri of their file and a fragment. */
+static gchar *
+get_file_uri (const gchar *uri)
+{
+    const gchar *hash;
+
+    hash = strchr (uri, '#');
+
+    return hash ? g_strndup (uri, hash - uri) : NULL;
+}
+
+typedef struct
+{
+    /* Files that were discovered again, and their sub-tracks now. */
+    GHashTable *changed;
+    GHashTable *current;
+} StaleData;
+
+static gboolean
+is_current (const gchar *uri,
+            gpointer     user_data)
+{
+    StaleData *data = user_data;
+    gboolean changed;
+    gchar *file_uri;
+
+    file_uri = get_file_uri (uri);
+    if (!file_uri)
+        return TRUE;
+
+    changed = g_hash_table_contains (data->changed, file_uri);
+    g_free (file_uri);
+
+    return !changed || g_hash_table_contains (data->current, uri);
+}
+
+static void
+add_sub_tracks (WfLibrary   *self,
+                DiscoverJob *job,
+                GHashTable  *current)
+{
+    WfSubTrack *sub_track;
+    WfTrack track;
+    gchar *uri;
+
+    for (guint i = 0; i < job->sub_tracks->len; i++) {
+        sub_track = g_ptr_array_index (job->sub_tracks, i);
+        uri = wf_sub_track_make_uri (job->uri, sub_track->start, sub_track->end);
+
+        track.uri = uri;
+        track.title = sub_track->title ? sub_track->title : job->title;
+        track.artist = sub_track->performer;
+        track.album = job->sub_album;
+        track.cover = job->cover;
+        if (sub_track->end != G_MAXUINT64)
+            track.duration = sub_track->end - sub_track->start;
+        else if (GST_CLOCK_TIME_IS_VALID (job->duration) && job->duration > sub_track->start)
+            track.duration = job->duration - sub_track->start;
+        else
+            track.duration = 0;
+        track.mtime = job->mtime;
+        track.size = job->size;
+        wf_track_store_set_track (self->store, &track);
+
+        if (current)
+            g_hash_table_add (current, uri);
+        else
+            g_free (uri);
+    }
+}
+
+static gboolean
+flush_cb (gpointer user_data)
+{
+    WfLibrary *self = WF_LIBRARY (user_data);
+    StaleData stale = {NULL, NULL};
+    DiscoverJob *job;
+    GPtrArray *done;
+    WfTrack track;
+    gint index;
+
+    g_mutex_lock (&self->lock);
+    done = g_steal_pointer (&self->done);
+    self->done = g_ptr_array_new_with_free_func ((GDestroyNotify) job_free);
+    self->flush_id = 0;
+    g_mutex_unlock (&self->lock);
+
+    for (guint i = 0; i < done->len; i++) {
+        job = g_ptr_array_index (done, i);
+        index = wf_track_store_lookup (self->store, job->uri);
+
+        /* The sub-tracks a file had before may be gone or have moved. A
+         * file that could not be read this time keeps them, as it keeps
+         * its own entry. */
+        if (index >= 0 && (job->found || job->gone)) {
+            if (!stale.changed) {
+                stale.changed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+                stale.current = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+            }
+            g_hash_table_add (stale.changed, g_strdup (job->uri));
+        }
+
+        if (job->found) {
+            track.uri = job->uri;
+            track.title = job->title;
+            track.artist = job->artist;
+            track.album = job->album;
+            track.cover = job->cover;
+            track.duration = job->duration;
+            track.mtime = job->mtime;
+            track.size = job->size;
+            wf_track_store_set_track (self->store, &track);
+            if (job->sub_tracks)
+                add_sub_tracks (self, job, index >= 0 ? stale.current : NULL);
+            self->dirty = TRUE;
+            continue;
+        }
+
+        /* Was audio and no longer is, or the file is gone. A timeout or
+         * another error leaves the track as it was; its recorded size and
+         * time still differ, so the next scan tries again. */
+        if (index >= 0 && job->gone) {
+            wf_track_store_remove (self->store, index);
+            self->dirty = TRUE;
+        }
+    }
+
+    if (stale.changed) {
+        wf_track_store_retain (self->store, is_current, &stale);
+        g_hash_table_unref (stale.changed);
+        g_hash_table_unref (stale.current);
+    }
+
+    self->n_pending -= done->len;
+    g_ptr_array_unref (done);
+    update_scanning (self);
+
+    return G_SOURCE_REMOVE;
+}
+
+static gchar *
+title_from_uri (const gchar *uri)
+{
+    const gchar *name;
+    gchar *title, *dot;
+
+    name = strrchr (uri, '/');
+    title = g_uri_unescape_string (name ? name + 1 : uri, NULL);
+    if (!title)
+        return g_strdup (uri);
+
+    dot = strrchr (title, '.');
+    if (dot && dot != title)
+        *dot = '\0';
+
+    return title;
+}
+
+/* Keeps the cover embedded in @tags, if any, and returns its hash. */
+static gchar *
+cover_from_tags (const GstTagList *tags)
+{
+    GstSample *sample = NULL;
+    GstBuffer *buffer;
+    GstMapInfo map;
+    gchar *hash = NULL;
+
+    if (!gst_tag_list_get_sample (tags, GST_TAG_IMAGE, &sample) &&
+        !gst_tag_list_get_sample (tags, GST_TAG_PREVIEW_IMAGE, &sample))
+        return NULL;
+
+    buffer = gst_sample_get_buffer (sample);
+    if (buffer && gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+        hash = wf_covers_store (map.data, map.size);
+        gst_buffer_unmap (buffer, &map);
+    }
+    gst_sample_unref (sample);
+
+    return hash;
+}
+
+static gint
+compare_start (gconstpointer a,
+               gconstpointer b)
+{
+    const WfSubTrack *first = *(WfSubTrack **) a;
+    const WfSubTrack *second = *(WfSubTrack **) b;
+
+    return first->start < second->start ? -1 : first->start > second->start;
+}
+
+/* Takes the chapters of @toc, or the tracks of an embedded CUE sheet,
+ * which demuxers present the same way. Like the tracks of a CUE sheet,
+ * each one runs up to the next. */
+static void
+collect_chapters (GList     *entries,
+                  GPtrArray *sub_tracks)
+{
+    GstTocEntry *entry;
+    GstTocEntryType type;
+    const GstTagList *tags;
+    WfSubTrack *sub_track;
+    gint64 start, stop;
+
+    for (GList *l = entries; l; l = l->next) {
+        entry = l->data;
+        type = gst_toc_entry_get_entry_type (entry);
+        if (type == GST_TOC_ENTRY_TYPE_EDITION) {
+            collect_chapters (gst_toc_entry_get_sub_entries (entry), sub_tracks);
+            continue;
+        }
+        if (type != GST_TOC_ENTRY_TYPE_CHAPTER && type != GST_TOC_ENTRY_TYPE_TRACK)
+            continue;
+        if (!gst_toc_entry_get_start_stop_times (entry, &start, &stop) || start < 0)
+            continue;
+
+        sub_track = g_new0 (WfSubTrack, 1);
+        sub_track->start = start;
+        sub_track->end = G_MAXUINT64;
+        tags = gst_toc_entry_get_tags (entry);
+        if (tags)
+            gst_tag_list_get_string (tags, GST_TAG_TITLE, &sub_track->title);
+        g_ptr_array_add (sub_tracks, sub_track);
+    }
+}
+
+static GPtrArray *
+sub_tracks_from_toc (const GstToc *toc)
+{
+    GPtrArray *sub_tracks;
+    WfSubTrack *sub_track, *next;
+
+    sub_tracks = g_ptr_array_new_with_free_func ((GDestroyNotify) wf_sub_track_free);
+    if (toc)
+        collect_chapters (gst_toc_get_entries (toc), sub_tracks);
+
+    g_ptr_array_sort (sub_tracks, compare_start);
+    for (guint i = 1; i < sub_tracks->len;) {
+        sub_track = g_ptr_array_index (sub_tracks, i - 1);
+        next = g_ptr_array_index (sub_tracks, i);
+        if (next->start == sub_track->start) {
+            g_ptr_array_remove_index (sub_tracks, i);
+            continue;
+        }
+        sub_track->end = next->start;
+        i++;
+    }
+
+    for (guint i = 0; i < sub_tracks->len; i++) {
+        sub_track = g_ptr_array_index (sub_tracks, i);
+        if (!sub_track->title)
+            sub_track->title = g_strdup_printf (_("Chapter %u"), i + 1);
+    }
+
+    return sub_tracks;
+}
+
+/* A file split in one part is listed as just the file. */
+static void
+find_sub_tracks (DiscoverJob       *job,
+                 GstDiscovererInfo *info)
+{
+    WfSubTrack *sub_track;
+    gchar *title = NULL, *performer = NULL;
+
+    job->sub_tracks = wf_cue_sheet_load (job->uri, &title, &performer);
+    if (!job->sub_tracks)
+        job->sub_tracks = sub_tracks_from_toc (gst_discoverer_info_get_toc (info));
+
+    if (job->sub_tracks->len < 2) {
+        g_clear_pointer (&job->sub_tracks, g_ptr_array_unref);
+        g_free (title);
+        g_free (performer);
+        return;
+    }
+
+    for (guint i = 0; i < job->sub_tracks->len; i++) {
+        sub_track = g_ptr_array_index (job->sub_tracks, i);
+        if (!sub_track->performer)
+            sub_track->performer = g_strdup (performer ? performer : job->artist);
+    }
+    job->sub_album = title ? title : g_strdup (job->album ? job->album : job->title);
+    g_free (performer);
+}
+
+static gboolean
+uri_exists (const gchar *uri)
+{
+    GFile *file;
+    gboolean exists;
+
+    file = g_file_new_for_uri (uri);
+    exists = g_file_query_exists (file, NULL);
+    g_object_unref (file);
+
+    return exists;
+}
+
+static void
+discover_func (gpointer data,
+               gpointer user_data)
+{
+    WfLibrary *self = WF_LIBRARY (user_data);
+    DiscoverJob *job = data;
+    GstDiscoverer *discoverer;
+    GstDiscovererInfo *info = NULL;
+    const GstTagList *tags = NULL;
+    GList *streams;
+
+    discoverer = g_private_get (&discoverer_key);
+    if (!discoverer) {
+        wf_gst_ensure ();
+        discoverer = gst_discoverer_new (DISCOVER_TIMEOUT, NULL);
+        g_private_set (&discoverer_key, discoverer);
+    }
+
+    if (discoverer)
+        info = gst_discoverer_discover_uri (discoverer, job->uri, NULL);
+
+    if (info && gst_discoverer_info_get_result (info) == GST_DISCOVERER_OK) {
+        streams = gst_discoverer_info_get_audio_streams (info);
+        job->found = streams != NULL;
+        job->duration = gst_discoverer_info_get_duration (info);
+        if (streams)
+            tags = gst_discoverer_stream_info_get_tags (streams->data);
+        if (tags) {
+            gst_tag_list_get_string (tags, GST_TAG_TITLE, &job->title);
+            gst_tag_list_get_string (tags, GST_TAG_ARTIST, &job->artist);
+            gst_tag_list_get_string (tags, GST_TAG_ALBUM, &job->album);
+            job->cover = cover_from_tags (tags);
+        }
+        if (!job->title)
+            job->title = title_from_uri (job->uri);
+        if (job->found)
+            find_sub_tracks (job, info);
+        job->gone = !job->found;
+        gst_discoverer_stream_info_list_free (streams);
+    } else {
+        job->gone = !uri_exists (job->uri);
+    }
+    g_clear_object (&info);
+
+    g_mutex_lock (&self->lock);
+    g_ptr_array_add (self->done, job);
+    if (!self->flush_id)
+        self->flush_id = g_idle_add (flush_cb, self);
+    g_mutex_unlock (&self->lock);
+}
+
+static void
+queue_discover (WfLibrary   *self,
+                const gchar *uri,
+                guint64      size,
+                gint64       mtime)
+{
+    DiscoverJob *job;
+
+    job = g_new0 (DiscoverJob, 1);
+    job->uri = g_strdup (uri);
+    job->size = size;
+    job->mtime = mtime;
+
+    self->n_pending++;
+    g_thread_pool_push (self->pool, job, NULL);
+}
+
+static void monitor_changed_cb (WfLibrary         *self,
+                                GFile             *file,
+                                GFile             *other,
+                                GFileMonitorEvent  event,
+                                GFileMonitor      *monitor);
+
+static void
+watch_dir (WfLibrary   *self,
+           const gchar *uri)
+{
+    GFileMonitor *monitor;
+    GFile *file;
+
+    if (g_hash_table_contains (self->monitors, uri))
+        return;
+
+    file = g_file_new_for_uri (uri);
+    monitor = g_file_monitor_directory (file, G_FILE_MONITOR_WATCH_MOVES, NULL, NULL);
+    g_object_unref (file);
+    if (!monitor)
+        return;
+
+    g_signal_connect_swapped (monitor, "changed", G_CALLBACK (monitor_changed_cb), self);
+    g_hash_table_insert (self->monitors, g_strdup (uri), monitor);
+}
+
+/* Setting up a monitor costs a few syscalls per directory, which for a
+ * large library is better spread over idle time than done in one go. */
+static gboolean
+watch_batch_cb (gpointer user_data)
+{
+    WfLibrary *self = WF_LIBRARY (user_data);
+    gchar *uri;
+
+    for (guint i = 0; i < WATCH_BATCH && self->unwatched->len > 0; i++) {
+        uri = g_ptr_array_steal_index_fast (self->unwatched, self->unwatched->len - 1);
+        watch_dir (self, uri);
+        g_free (uri);
+    }
+
+    if (self->unwatched->len > 0)
+        return G_SOURCE_CONTINUE;
+
+    self->watch_id = 0;
+    return G_SOURCE_REMOVE;
+}
+
+static void
+queue_watch (WfLibrary   *self,
+             const gchar *uri)
+{
+    g_ptr_array_add (self->unwatched, g_strdup (uri));
+    if (!self->watch_id)
+        self->watch_id = g_idle_add_full (G_PRIORITY_LOW, watch_batch_cb, self, NULL);
+}
+
+/* Drops directories below @uri that are still waiting for a watch. */
+static void
+unqueue_watches (WfLibrary   *self,
+                 const gchar *uri)
+{
+    const gchar *dir;
+    gsize length;
+
+    length = strlen (uri);
+    for (guint i = self->unwatched->len; i > 0; i--) {
+        dir = g_ptr_array_index (self->unwatched, i - 1);
+        if (strncmp (dir, uri, length) == 0 && (dir[length] == '/' || dir[length] == '\0'))
+            g_ptr_array_remove_index_fast (self->unwatched, i - 1);
+    }
+}
+
+static gboolean
+in_set (const gchar *uri,
+        gpointer     user_data)
+{
+    gchar *file_uri;
+    gboolean found;
+
+    file_uri = get_file_uri (uri);
+    found = g_hash_table_contains (user_data, file_uri ? file_uri : uri);
+    g_free (file_uri);
+
+    return found;
+}
+
+/* Queues what changed since the index was written. A full scan also drops
+ * tracks and watches for whatever is gone. */
+static void
+scan_done_cb (GObject      *source,
+              GAsyncResult *result,
+              gpointer      user_data)
+{
+    WfLibrary *self = WF_LIBRARY (source);
+    ScanData *data = g_task_get_task_data (G_TASK (result));
+    GHashTable *seen = NULL;
+    DropData drop = {self, NULL, NULL};
+    ScanEntry *entry;
+    WfTrack track;
+    guint n_tracks;
+    gint index;
+
+    self->n_scans--;
+    if (!g_task_propagate_boolean (G_TASK (result), NULL) || !self->store) {
+        update_scanning (self);
+        return;
+    }
+
+    if (data->full)
+        seen = g_hash_table_new (g_str_hash, g_str_equal);
+
+    for (guint i = 0; i < data->entries->len; i++) {
+        entry = &g_array_index (data->entries, ScanEntry, i);
+        if (seen)
+            g_hash_table_add (seen, entry->uri);
+
+        index = wf_track_store_lookup (self->store, entry->uri);
+        if (index >= 0) {
+            wf_track_store_get_track (self->store, index, &track);
+            if (track.size == entry->size && track.mtime == entry->mtime)
+                continue;
+        }
+        queue_discover (self, entry->uri, entry->size, entry->mtime);
+    }
+
+    if (seen) {
+        n_tracks = wf_track_store_get_n_tracks (self->store);
+        wf_track_store_retain (self->store, in_set, seen);
+        if (wf_track_store_get_n_tracks (self->store) != n_tracks)
+            self->dirty = TRUE;
+        g_hash_table_unref (seen);
+
+        drop.keep = g_hash_table_new (g_str_hash, g_str_equal);
+        for (guint i = 0; i < data->dirs->len; i++)
+            g_hash_table_add (drop.keep, g_ptr_array_index (data->dirs, i));
+        g_hash_table_foreach_remove (self->monitors, drop_monitor, &drop);
+        g_hash_table_unref (drop.keep);
+
+        /* Every folder still there is in this scan. */
+        g_ptr_array_set_size (self->unwatched, 0);
+    }
+
+    for (guint i = 0; i < data->dirs->len; i++)
+        queue_watch (self, g_ptr_array_index (data->dirs, i));
+
+    update_scanning (self);
+}
+
+static void
+start_scan (WfLibrary *self,
+            gchar    **roots,
+            gboolean   full)
+{
+    ScanData *data;
+    GTask *task;
+
+    data = g_new0 (ScanData, 1);
+    data->roots = roots;
+    data->full = full;
+    data->entries = g_array_new (FALSE, FALSE, sizeof (ScanEntry));
+    data->dirs = g_ptr_array_new_with_free_func (g_free);
+
+    task = g_task_new (self, self->cancellable, scan_done_cb, NULL);
+    g_task_set_task_data (task, data, (GDestroyNotify) scan_data_free);
+    g_task_run_in_thread (task, scan_thread);
+    g_object_unref (task);
+
+    self->n_scans++;
+    update_scanning (self);
+}
+
+/* The files a CUE sheet belongs to are found by looking at the directory
+ * again: their recorded modification time no longer matches. */
+static void
+rescan_parent (WfLibrary *self,
+               GFile     *file)
+{
+    GFile *parent;
+    gchar **roots;
+
+    parent = g_file_get_parent (file);
+    if (!parent)
+        return;
+
+    roots = g_new0 (gchar *, 2);
+    roots[0] = g_file_get_uri (parent);
+    start_scan (self, roots, FALSE);
+    g_object_unref (parent);
+}
+
+static void
+file_added (WfLibrary *self,
+            GFile     *file,
+            gboolean   written)
+{
+    GFileInfo *info;
+    gchar **roots;
+    gchar *uri;
+
+    info = g_file_query_info (file, SCAN_ATTRIBUTES, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                              NULL, NULL);
+    if (!info)
+        return;
+
+    if (g_file_info_get_name (info)[0] != '.') {
+        uri = g_file_get_uri (file);
+        if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+            roots = g_new0 (gchar *, 2);
+            roots[0] = g_steal_pointer (&uri);
+            start_scan (self, roots, FALSE);
+        } else if (written && g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR &&
+                   is_audio (info)) {
+            queue_discover (self, uri, g_file_info_get_size (info),
+                            get_sheet_mtime (uri, get_mtime (info)));
+            update_scanning (self);
+        } else if (written && is_cue_sheet (info)) {
+            rescan_parent (self, file);
+        }
+        g_free (uri);
+    }
+
+    g_object_unref (info);
+}
+
+static void
+file_removed (WfLibrary *self,
+              GFile     *file)
+{
+    DropData drop = {self, NULL, NULL};
+    guint n_tracks;
+    gchar *uri;
+
+    uri = g_file_get_uri (file);
+
+    n_tracks = wf_track_store_get_n_tracks (self->store);
+    wf_track_store_remove_under (self->store, uri);
+    if (wf_track_store_get_n_tracks (self->store) != n_tracks)
+        self->dirty = TRUE;
+    if (g_str_has_suffix (uri, ".cue"))
+        rescan_parent (self, file);
+
+    drop.under = uri;
+    g_hash_table_foreach_remove (self->monitors, drop_monitor, &drop);
+    unqueue_watches (self, uri);
+
+    g_free (uri);
+    update_scanning (self);
+}
+
+/* A new file is picked up once it has been written. A new directory is
+ * scanned at once, since it may have been moved in whole. */
+static void
+monitor_changed_cb (WfLibrary         *self,
+                    GFile             *file,
+                    GFile             *other,
+                    GFileMonitorEvent  event,
+                    GFileMonitor      *monitor)
+{
+    switch (event) {
+    case G_FILE_MONITOR_EVENT_CREATED:
+        file_added (self, file, FALSE);
+        break;
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+    case G_FILE_MONITOR_EVENT_MOVED_IN:
+        file_added (self, file, TRUE);
+        break;
+    case G_FILE_MONITOR_EVENT_DELETED:
+    case G_FILE_MONITOR_EVENT_MOVED_OUT:
+        file_removed (self, file);
+        break;
+    case G_FILE_MONITOR_EVENT_RENAMED:
+        file_removed (self, file);
+        if (other)
+            file_added (self, other, TRUE);
+        break;
+    default:
+        break;
+    }
+}
+
+WfLibrary *
+wf_library_new (const gchar *index_path)
+{
+    WfLibrary *self;
+    GError *error = NULL;
+
+    self = g_object_new (WF_TYPE_LIBRARY, NULL);
+    if (index_path)
+        self->index_path = g_strdup (index_path);
+    else
+        self->index_path = g_build_filename (g_get_user_cache_dir (), "wavefront",
+                                             "library", NULL);
+
+    /* Maps the index, so the last known library is there at once. */
+    if (!wf_track_store_load (self->store, self->index_path, &error)) {
+        if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            g_warning ("Failed to load the library index: %s", error->message);
+        g_error_free (error);
+    }
+
+    return self;
+}
+
+/* Changing the folders rescans, once a first scan was asked for. */
+void
+wf_library_set_folders (WfLibrary           *self,
+                        const gchar * const *folders)
+{
+    g_return_if_fail (WF_IS_LIBRARY (self));
+
+    if (!folders)
+        folders = (const gchar * const []) {NULL};
+    if (g_strv_equal ((const gchar * const *) self->folders, folders))
+        return;
+
+    g_strfreev (self->folders);
+    self->folders = g_strdupv ((gchar **) folders);
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_FOLDERS]);
+
+    if (self->started)
+        wf_library_rescan (self);
+}
+
+const gchar * const *
+wf_library_get_folders (WfLibrary *self)
+{
+    g_return_val_if_fail (WF_IS_LIBRARY (self), NULL);
+
+    return (const gchar * const *) self->folders;
+}
+
+/* Checks every folder again. Unchanged files are only stat()ed. */
+void
+wf_library_rescan (WfLibrary *self)
+{
+    GPtrArray *roots;
+    const gchar *music;
+    GFile *file;
+
+    g_return_if_fail (WF_IS_LIBRARY (self));
+
+    self->started = TRUE;
+
+    g_cancellable_cancel (self->cancellable);
+    g_object_unref (self->cancellable);
+    self->cancellable = g_cancellable_new ();
+
+    roots = g_ptr_array_new ();
+    for (guint i = 0; self->folders[i]; i++) {
+        file = g_file_new_for_commandline_arg (self->folders[i]);
+        g_ptr_array_add (roots, g_file_get_uri (file));
+        g_object_unref (file);
+    }
+    if (roots->len == 0 && (music = g_get_user_special_dir (G_USER_DIRECTORY_MUSIC)))
+        g_ptr_array_add (roots, g_filename_to_uri (music, NULL, NULL));
+    g_ptr_array_add (roots, NULL);
+
+    start_scan (self, (gchar **) g_ptr_array_free (roots, FALSE), TRUE);
+}
+
+gboolean
+wf_library_get_scanning (WfLibrary *self)
+{
+    g_return_val_if_fail (WF_IS_LIBRARY (self), FALSE);
+
+    return self->scanning;
+}
+
+gboolean
+wf_library_save (WfLibrary  *self,
+                 GError    **error)
+{
+    g_return_val_if_fail (WF_IS_LIBRARY (self), FALSE);
+
+    self->dirty = FALSE;
+    return wf_track_store_save (self->store, self->index_path, error);
+}
+
+WfTrackStore *
+wf_library_get_store (WfLibrary *self)
+{
+    g_return_val_if_fail (WF_IS_LIBRARY (self), NULL);
+
+    return self->store;
+}
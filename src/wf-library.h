@@ -0,0 +1,45 @@
+/*
+ * wf-library.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include "wf-track-store.h"
+
+G_BEGIN_DECLS
+
+#define WF_TYPE_LIBRARY (wf_library_get_type ())
+G_DECLARE_FINAL_TYPE (WfLibrary, wf_library, WF, LIBRARY, GObject)
+
+WfLibrary           *wf_library_new          (const gchar *index_path);
+
+void                 wf_library_set_folders  (WfLibrary           *self,
+                                              const gchar * const *folders);
+const gchar * const *wf_library_get_folders  (WfLibrary *self);
+void                 wf_library_rescan       (WfLibrary *self);
+gboolean             wf_library_get_scanning (WfLibrary *self);
+gboolean             wf_library_save         (WfLibrary  *self,
+                                              GError    **error);
+
+WfTrackStore        *wf_library_get_store    (WfLibrary *self);
+
+G_END_DECLS
@@ -0,0 +1,506 @@
+/*
+ * wf-mmap-src.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+#include "wf-mmap-src.h"
+
+/*
+ * A file:// source that maps the file and hands out buffers pointing into
+ * the mapping, instead of read()ing every block into a new allocation as
+ * filesrc does. It is registered above filesrc, so playbin in WfPlayer
+ * and uridecodebin in WfWaveform both pick it up for local files.
+ *
+ * Anything that cannot be mapped (pipes, devices, empty files) is read
+ * with pread() instead, into a new buffer per block as filesrc does.
+ *
+ * Touching a page of the mapping beyond the end of a file that was
+ * truncated raises SIGBUS. The size is checked before every block, and a
+ * file that shrank is unmapped and read with pread() from then on, which
+ * simply ends early. That leaves only the blocks already handed out, for
+ * the short time until downstream has read them.
+ */
+
+#define DEFAULT_BLOCKSIZE (64 * 1024)
+
+GST_DEBUG_CATEGORY_STATIC (wf_mmap_src_debug);
+#define GST_CAT_DEFAULT wf_mmap_src_debug
+
+struct _WfMmapSrc
+{
+    GstBaseSrc parent;
+
+    gchar *location;
+
+    GMappedFile *mapped_file;
+    GBytes *bytes;
+    gint fd;
+    guint64 size;
+    gboolean seekable;
+
+    /* Reported on stop, to compare against filesrc. */
+    guint64 bytes_mapped;
+    guint64 bytes_read;
+    guint n_buffers;
+};
+
+enum
+{
+    PROP_ZERO,
+    PROP_LOCATION,
+    N_PROPS
+};
+
+static GParamSpec *properties[N_PROPS] = {NULL, };
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+                                                                    GST_PAD_SRC,
+                                                                    GST_PAD_ALWAYS,
+                                                                    GST_STATIC_CAPS_ANY);
+
+static void get_property (GObject    *object,
+                          guint       property_id,
+                          GValue     *value,
+                          GParamSpec *pspec);
+static void set_property (GObject      *object,
+                          guint         property_id,
+                          const GValue *value,
+                          GParamSpec   *pspec);
+static void finalize     (GObject *object);
+
+static gboolean      start       (GstBaseSrc *src);
+static gboolean      stop        (GstBaseSrc *src);
+static gboolean      get_size    (GstBaseSrc *src,
+                                  guint64    *size);
+static gboolean      is_seekable (GstBaseSrc *src);
+static GstFlowReturn create      (GstBaseSrc  *src,
+                                  guint64      offset,
+                                  guint        length,
+                                  GstBuffer  **buffer);
+
+static void uri_handler_init (gpointer g_iface,
+                              gpointer iface_data);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (WfMmapSrc, wf_mmap_src, GST_TYPE_BASE_SRC,
+                               G_IMPLEMENT_INTERFACE (GST_TYPE_URI_HANDLER, uri_handler_init);
+                               GST_DEBUG_CATEGORY_INIT (wf_mmap_src_debug, "wfmmapsrc", 0,
+                                                        "Wavefront mmap file source");)
+
+static void
+wf_mmap_src_class_init (WfMmapSrcClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+    GstBaseSrcClass *base_src_class = GST_BASE_SRC_CLASS (klass);
+
+    object_class->get_property = get_property;
+    object_class->set_property = set_property;
+    object_class->finalize = finalize;
+
+    base_src_class->start = start;
+    base_src_class->stop = stop;
+    base_src_class->get_size = get_size;
+    base_src_class->is_seekable = is_seekable;
+    base_src_class->create = create;
+
+    properties[PROP_LOCATION] =
+        g_param_spec_string ("location", NULL, NULL,
+                             NULL,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+    g_object_class_install_properties (object_class, N_PROPS, properties);
+
+    gst_element_class_add_static_pad_template (element_class, &src_template);
+    gst_element_class_set_static_metadata (element_class,
+                                           "Wavefront mmap file source",
+                                           "Source/File",
+                                           "Reads a local file through a memory map",
+                                           "Dilnavas Roshan <dilnavasroshan@gmail.com>");
+}
+
+static void
+wf_mmap_src_init (WfMmapSrc *self)
+{
+    self->fd = -1;
+    gst_base_src_set_blocksize (GST_BASE_SRC (self), DEFAULT_BLOCKSIZE);
+}
+
+static void
+finalize (GObject *object)
+{
+    WfMmapSrc *src = WF_MMAP_SRC (object);
+
+    g_free (src->location);
+    G_OBJECT_CLASS (wf_mmap_src_parent_class)->finalize (object);
+}
+
+static gboolean
+set_location (WfMmapSrc   *self,
+              const gchar *location,
+              GError     **error)
+{
+    GstState state;
+
+    GST_OBJECT_LOCK (self);
+    state = GST_STATE (self);
+    if (state != GST_STATE_READY && state != GST_STATE_NULL) {
+        GST_OBJECT_UNLOCK (self);
+        g_set_error_literal (error, GST_URI_ERROR, GST_URI_ERROR_BAD_STATE,
+                             "Changing the location on a running source is not supported");
+        return FALSE;
+    }
+
+    g_free (self->location);
+    self->location = g_strdup (location);
+    GST_OBJECT_UNLOCK (self);
+
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LOCATION]);
+
+    return TRUE;
+}
+
+static void
+get_property (GObject    *object,
+              guint       property_id,
+              GValue     *value,
+              GParamSpec *pspec)
+{
+    WfMmapSrc *src = WF_MMAP_SRC (object);
+
+    switch (property_id) {
+    case PROP_LOCATION:
+        GST_OBJECT_LOCK (src);
+        g_value_set_string (value, src->location);
+        GST_OBJECT_UNLOCK (src);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+        break;
+    }
+}
+
+static void
+set_property (GObject      *object,
+              guint         property_id,
+              const GValue *value,
+              GParamSpec   *pspec)
+{
+    WfMmapSrc *src = WF_MMAP_SRC (object);
+
+    switch (property_id) {
+    case PROP_LOCATION:
+        set_location (src, g_value_get_string (value), NULL);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+        break;
+    }
+}
+
+static gboolean
+start (GstBaseSrc *src)
+{
+    WfMmapSrc *self = WF_MMAP_SRC (src);
+    GError *error = NULL;
+    GStatBuf st;
+
+    if (!self->location) {
+        GST_ELEMENT_ERROR (self, RESOURCE, NOT_FOUND, ("No file name specified for reading."), (NULL));
+        return FALSE;
+    }
+
+    self->fd = g_open (self->location, O_RDONLY | O_CLOEXEC, 0);
+    if (self->fd < 0) {
+        GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ,
+                           ("Could not open file \"%s\" for reading.", self->location),
+                           GST_ERROR_SYSTEM);
+        return FALSE;
+    }
+
+    if (fstat (self->fd, &st) < 0) {
+        GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ, (NULL), GST_ERROR_SYSTEM);
+        g_close (self->fd, NULL);
+        self->fd = -1;
+        return FALSE;
+    }
+
+    if (S_ISDIR (st.st_mode)) {
+        GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ,
+                           ("\"%s\" is a directory.", self->location), (NULL));
+        g_close (self->fd, NULL);
+        self->fd = -1;
+        return FALSE;
+    }
+
+    self->size = S_ISREG (st.st_mode) ? (guint64) st.st_size : 0;
+    self->bytes_mapped = self->bytes_read = 0;
+    self->n_buffers = 0;
+
+    if (S_ISREG (st.st_mode) && st.st_size > 0)
+        self->mapped_file = g_mapped_file_new_from_fd (self->fd, FALSE, &error);
+
+    if (self->mapped_file) {
+        self->bytes = g_mapped_file_get_bytes (self->mapped_file);
+        self->seekable = TRUE;
+#ifdef HAVE_POSIX_MADVISE
+        posix_madvise (g_mapped_file_get_contents (self->mapped_file), self->size,
+                       POSIX_MADV_SEQUENTIAL);
+#endif
+    } else {
+        if (error) {
+            GST_DEBUG_OBJECT (self, "Falling back to pread: %s", error->message);
+            g_error_free (error);
+        }
+        self->seekable = S_ISREG (st.st_mode) && lseek (self->fd, 0, SEEK_CUR) >= 0;
+    }
+
+    gst_base_src_set_dynamic_size (src, !self->mapped_file);
+
+    return TRUE;
+}
+
+static gboolean
+stop (GstBaseSrc *src)
+{
+    WfMmapSrc *self = WF_MMAP_SRC (src);
+
+    GST_DEBUG_OBJECT (self, "%u buffers, %" G_GUINT64_FORMAT " bytes mapped, %"
+                      G_GUINT64_FORMAT " bytes read", self->n_buffers,
+                      self->bytes_mapped, self->bytes_read);
+
+    /* Buffers still downstream keep the mapping alive through the bytes. */
+    g_clear_pointer (&self->bytes, g_bytes_unref);
+    g_clear_pointer (&self->mapped_file, g_mapped_file_unref);
+    if (self->fd >= 0) {
+        g_close (self->fd, NULL);
+        self->fd = -1;
+    }
+
+    return TRUE;
+}
+
+static gboolean
+get_size (GstBaseSrc *src,
+          guint64    *size)
+{
+    WfMmapSrc *self = WF_MMAP_SRC (src);
+    GStatBuf st;
+
+    if (self->mapped_file) {
+        *size = self->size;
+        return TRUE;
+    }
+
+    if (!self->seekable || fstat (self->fd, &st) < 0)
+        return FALSE;
+
+    *size = st.st_size;
+    return TRUE;
+}
+
+static gboolean
+is_seekable (GstBaseSrc *src)
+{
+    return WF_MMAP_SRC (src)->seekable;
+}
+
+static GstFlowReturn
+create_mapped (WfMmapSrc  *self,
+               guint64     offset,
+               guint       length,
+               GstBuffer **buffer)
+{
+    gconstpointer data;
+    gsize size;
+
+    if (offset >= self->size)
+        return GST_FLOW_EOS;
+
+    length = MIN (length, self->size - offset);
+    data = g_bytes_get_data (self->bytes, &size);
+
+    *buffer = gst_buffer_new_wrapped_full (GST_MEMORY_FLAG_READONLY, (gpointer) data,
+                                           size, offset, length,
+                                           g_bytes_ref (self->bytes),
+                                           (GDestroyNotify) g_bytes_unref);
+    self->bytes_mapped += length;
+
+    return GST_FLOW_OK;
+}
+
+static GstFlowReturn
+create_read (WfMmapSrc  *self,
+             guint64     offset,
+             guint       length,
+             GstBuffer **buffer)
+{
+    GstBuffer *buf;
+    GstMapInfo info;
+    gssize n;
+
+    buf = gst_buffer_new_allocate (NULL, length, NULL);
+    if (!buf)
+        return GST_FLOW_ERROR;
+
+    gst_buffer_map (buf, &info, GST_MAP_WRITE);
+    do {
+        n = self->seekable ? pread (self->fd, info.data, length, offset)
+                           : read (self->fd, info.data, length);
+    } while (n < 0 && errno == EINTR);
+    gst_buffer_unmap (buf, &info);
+
+    if (n < 0) {
+        gst_buffer_unref (buf);
+        GST_ELEMENT_ERROR (self, RESOURCE, READ, (NULL), GST_ERROR_SYSTEM);
+        return GST_FLOW_ERROR;
+    }
+
+    if (n == 0) {
+        gst_buffer_unref (buf);
+        return GST_FLOW_EOS;
+    }
+
+    gst_buffer_resize (buf, 0, n);
+    self->bytes_read += n;
+    *buffer = buf;
+
+    return GST_FLOW_OK;
+}
+
+/* Drops the mapping of a file that got shorter than it was mapped. */
+static void
+check_size (WfMmapSrc *self)
+{
+    GStatBuf st;
+
+    if (fstat (self->fd, &st) < 0 || (guint64) st.st_size >= self->size)
+        return;
+
+    GST_WARNING_OBJECT (self, "File shrank from %" G_GUINT64_FORMAT " to %"
+                        G_GUINT64_FORMAT " bytes, reading instead of mapping",
+                        self->size, (guint64) st.st_size);
+
+    g_clear_pointer (&self->bytes, g_bytes_unref);
+    g_clear_pointer (&self->mapped_file, g_mapped_file_unref);
+    self->size = st.st_size;
+    gst_base_src_set_dynamic_size (GST_BASE_SRC (self), TRUE);
+}
+
+static GstFlowReturn
+create (GstBaseSrc  *src,
+        guint64      offset,
+        guint        length,
+        GstBuffer  **buffer)
+{
+    WfMmapSrc *self = WF_MMAP_SRC (src);
+    GstFlowReturn ret;
+
+    if (self->mapped_file)
+        check_size (self);
+
+    if (self->mapped_file)
+        ret = create_mapped (self, offset, length, buffer);
+    else
+        ret = create_read (self, offset, length, buffer);
+
+    if (ret == GST_FLOW_OK) {
+        GST_BUFFER_OFFSET (*buffer) = offset;
+        GST_BUFFER_OFFSET_END (*buffer) = offset + gst_buffer_get_size (*buffer);
+        self->n_buffers++;
+    }
+
+    return ret;
+}
+
+static GstURIType
+uri_get_type (GType type)
+{
+    return GST_URI_SRC;
+}
+
+static const gchar * const *
+uri_get_protocols (GType type)
+{
+    static const gchar *protocols[] = {"file", NULL};
+
+    return protocols;
+}
+
+static gchar *
+uri_get_uri (GstURIHandler *handler)
+{
+    WfMmapSrc *self = WF_MMAP_SRC (handler);
+    gchar *uri = NULL;
+
+    GST_OBJECT_LOCK (self);
+    if (self->location)
+        uri = g_filename_to_uri (self->location, NULL, NULL);
+    GST_OBJECT_UNLOCK (self);
+
+    return uri;
+}
+
+static gboolean
+uri_set_uri (GstURIHandler *handler,
+             const gchar   *uri,
+             GError       **error)
+{
+    WfMmapSrc *self = WF_MMAP_SRC (handler);
+    gchar *location;
+    gboolean ret;
+
+    location = g_filename_from_uri (uri, NULL, error);
+    if (!location)
+        return FALSE;
+
+    ret = set_location (self, location, error);
+    g_free (location);
+
+    return ret;
+}
+
+static void
+uri_handler_init (gpointer g_iface,
+                  gpointer iface_data)
+{
+    GstURIHandlerInterface *iface = g_iface;
+
+    iface->get_type = uri_get_type;
+    iface->get_protocols = uri_get_protocols;
+    iface->get_uri = uri_get_uri;
+    iface->set_uri = uri_set_uri;
+}
+
+/* Registers the element one rank above filesrc, so that it is chosen for
+ * file:// uris. Needs to run after gst_init(). */
+
+gboolean
+wf_mmap_src_register (void)
+{
+    return gst_element_register (NULL, "wfmmapsrc", GST_RANK_PRIMARY + 1, WF_TYPE_MMAP_SRC);
+}
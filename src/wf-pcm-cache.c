@@ -0,0 +1,486 @@
+/*
+ * wf-pcm-cache.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <gst/audio/audio.h>
+
+#include "wf-pcm-cache.h"
+
+/*
+ * Decoded audio of a file, written once by the WfWaveform analysis
+ * pipeline and read by any number of playback pipelines through appsrc,
+ * so a file that is being analysed is not decoded a second time for
+ * playback. The buffers are kept as the decoder produced them.
+ *
+ * Readers never block a streaming thread: one that has caught up with
+ * the writer is marked hungry and the writer pushes to it as soon as
+ * the next buffer arrives.
+ */
+
+struct _WfPcmCache
+{
+    GObject parent;
+
+    gchar *uri;
+    guint64 budget;
+
+    GMutex lock;
+    WfPcmCacheState state;
+    GstCaps *caps;
+    guint64 duration;
+    GPtrArray *buffers;
+    guint64 size;
+    GPtrArray *readers;
+};
+
+typedef struct
+{
+    WfPcmCache *cache;
+    GstAppSrc *src;
+    guint index;
+    gboolean hungry;
+    gboolean configured;
+} WfPcmReader;
+
+enum
+{
+    PROP_ZERO,
+    PROP_STATE,
+    N_PROPS
+};
+
+static GParamSpec *properties[N_PROPS] = {NULL, };
+
+/* Only the most recent cache is registered; older ones live on for as
+ * long as a playback pipeline still reads from them. */
+static GMutex registry_lock;
+static WfPcmCache *registry;
+
+static void get_property (GObject    *object,
+                          guint       property_id,
+                          GValue     *value,
+                          GParamSpec *pspec);
+static void finalize     (GObject *object);
+
+G_DEFINE_FINAL_TYPE (WfPcmCache, wf_pcm_cache, G_TYPE_OBJECT)
+
+static void
+wf_pcm_cache_class_init (WfPcmCacheClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->get_property = get_property;
+    object_class->finalize = finalize;
+
+    /* Notified on the main context, whichever thread changed it. */
+    properties[PROP_STATE] =
+        g_param_spec_int ("state", NULL, NULL,
+                          WF_PCM_CACHE_FILLING, WF_PCM_CACHE_FAILED,
+                          WF_PCM_CACHE_FILLING,
+                          G_PARAM_READABLE);
+
+    g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+wf_pcm_cache_init (WfPcmCache *self)
+{
+    g_mutex_init (&self->lock);
+    self->duration = GST_CLOCK_TIME_NONE;
+    self->buffers = g_ptr_array_new_with_free_func ((GDestroyNotify) gst_buffer_unref);
+    self->readers = g_ptr_array_new ();
+}
+
+static void
+finalize (GObject *object)
+{
+    WfPcmCache *cache = WF_PCM_CACHE (object);
+
+    g_free (cache->uri);
+    gst_clear_caps (&cache->caps);
+    g_ptr_array_unref (cache->buffers);
+    g_ptr_array_unref (cache->readers);
+    g_mutex_clear (&cache->lock);
+    G_OBJECT_CLASS (wf_pcm_cache_parent_class)->finalize (object);
+}
+
+static void
+get_property (GObject    *object,
+              guint       property_id,
+              GValue     *value,
+              GParamSpec *pspec)
+{
+    WfPcmCache *cache = WF_PCM_CACHE (object);
+
+    switch (property_id) {
+    case PROP_STATE:
+        g_value_set_int (value, wf_pcm_cache_get_state (cache));
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+        break;
+    }
+}
+
+static gboolean
+notify_state_cb (gpointer user_data)
+{
+    g_object_notify_by_pspec (G_OBJECT (user_data), properties[PROP_STATE]);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Called with the lock held; returns whether the state changed, which
+ * is to be notified with notify_state() once the lock is dropped. */
+
+static gboolean
+set_state (WfPcmCache      *self,
+           WfPcmCacheState  state)
+{
+    if (self->state == state)
+        return FALSE;
+
+    self->state = state;
+
+    return TRUE;
+}
+
+/* Called without the lock: on the main thread the handlers run right
+ * away, and they read the state back. */
+
+static void
+notify_state (WfPcmCache *self)
+{
+    g_main_context_invoke_full (NULL, G_PRIORITY_DEFAULT, notify_state_cb,
+                                g_object_ref (self), g_object_unref);
+}
+
+/* Hands the next buffer to @reader, or marks it hungry if the writer has
+ * not got that far yet. Called with the lock held. */
+
+static void
+reader_feed (WfPcmReader *reader)
+{
+    WfPcmCache *cache = reader->cache;
+    GstBuffer *buffer;
+
+    if (!reader->configured && cache->caps) {
+        gst_app_src_set_caps (reader->src, cache->caps);
+        reader->configured = TRUE;
+    }
+
+    if (GST_CLOCK_TIME_IS_VALID (cache->duration))
+        gst_app_src_set_duration (reader->src, cache->duration);
+
+    reader->hungry = FALSE;
+    if (reader->index < cache->buffers->len) {
+        buffer = g_ptr_array_index (cache->buffers, reader->index++);
+        gst_app_src_push_buffer (reader->src, gst_buffer_ref (buffer));
+    } else if (cache->state == WF_PCM_CACHE_COMPLETE) {
+        gst_app_src_end_of_stream (reader->src);
+    } else if (cache->state == WF_PCM_CACHE_FILLING) {
+        reader->hungry = TRUE;
+    }
+}
+
+static void
+need_data_cb (GstAppSrc *src,
+              guint      length,
+              gpointer   user_data)
+{
+    WfPcmReader *reader = user_data;
+
+    g_mutex_lock (&reader->cache->lock);
+    reader_feed (reader);
+    g_mutex_unlock (&reader->cache->lock);
+}
+
+static gboolean
+seek_data_cb (GstAppSrc *src,
+              guint64    offset,
+              gpointer   user_data)
+{
+    WfPcmReader *reader = user_data;
+    WfPcmCache *cache = reader->cache;
+    GstBuffer *buffer;
+    guint lo = 0, hi, mid;
+
+    /* The offset is a time, as the source runs in GST_FORMAT_TIME. Start
+     * from the buffer containing it and let downstream clip the rest. */
+    g_mutex_lock (&cache->lock);
+    hi = cache->buffers->len;
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        buffer = g_ptr_array_index (cache->buffers, mid);
+        if (GST_BUFFER_PTS (buffer) <= offset)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    reader->index = lo;
+    reader->hungry = FALSE;
+    g_mutex_unlock (&cache->lock);
+
+    return TRUE;
+}
+
+static void
+reader_free (WfPcmReader *reader)
+{
+    g_mutex_lock (&reader->cache->lock);
+    g_ptr_array_remove (reader->cache->readers, reader);
+    g_mutex_unlock (&reader->cache->lock);
+
+    g_object_unref (reader->cache);
+    g_free (reader);
+}
+
+WfPcmCache *
+wf_pcm_cache_new (const gchar *uri,
+                  guint64      budget)
+{
+    WfPcmCache *cache;
+
+    g_return_val_if_fail (uri != NULL, NULL);
+
+    cache = g_object_new (WF_TYPE_PCM_CACHE, NULL);
+    cache->uri = g_strdup (uri);
+    cache->budget = budget;
+
+    g_mutex_lock (&registry_lock);
+    g_set_object (&registry, cache);
+    g_mutex_unlock (&registry_lock);
+
+    return cache;
+}
+
+/* Returns a new reference to the cache being or having been filled for
+ * @uri, or NULL if there is none worth reading from. */
+
+WfPcmCache *
+wf_pcm_cache_lookup (const gchar *uri)
+{
+    WfPcmCache *cache = NULL;
+
+    g_return_val_if_fail (uri != NULL, NULL);
+
+    g_mutex_lock (&registry_lock);
+    if (registry && !g_strcmp0 (registry->uri, uri) &&
+        wf_pcm_cache_get_state (registry) != WF_PCM_CACHE_FAILED)
+        cache = g_object_ref (registry);
+    g_mutex_unlock (&registry_lock);
+
+    return cache;
+}
+
+const gchar *
+wf_pcm_cache_get_uri (WfPcmCache *self)
+{
+    g_return_val_if_fail (WF_IS_PCM_CACHE (self), NULL);
+
+    return self->uri;
+}
+
+WfPcmCacheState
+wf_pcm_cache_get_state (WfPcmCache *self)
+{
+    WfPcmCacheState state;
+
+    g_return_val_if_fail (WF_IS_PCM_CACHE (self), WF_PCM_CACHE_FAILED);
+
+    g_mutex_lock (&self->lock);
+    state = self->state;
+    g_mutex_unlock (&self->lock);
+
+    return state;
+}
+
+/* Bytes of decoded audio held so far. */
+
+guint64
+wf_pcm_cache_get_size (WfPcmCache *self)
+{
+    guint64 size;
+
+    g_return_val_if_fail (WF_IS_PCM_CACHE (self), 0);
+
+    g_mutex_lock (&self->lock);
+    size = self->state == WF_PCM_CACHE_FAILED ? 0 : self->size;
+    g_mutex_unlock (&self->lock);
+
+    return size;
+}
+
+/* Gives up early if the decoded file would not fit in the budget, before
+ * a playback pipeline has come to depend on it. */
+
+void
+wf_pcm_cache_set_duration (WfPcmCache *self,
+                           guint64     duration)
+{
+    GstAudioInfo info;
+    guint64 size;
+    gboolean changed = FALSE;
+
+    g_return_if_fail (WF_IS_PCM_CACHE (self));
+
+    g_mutex_lock (&self->lock);
+    self->duration = duration;
+    if (self->caps && gst_audio_info_from_caps (&info, self->caps)) {
+        size = gst_util_uint64_scale (duration, GST_AUDIO_INFO_BPF (&info) * GST_AUDIO_INFO_RATE (&info),
+                                      GST_SECOND);
+        if (size > self->budget) {
+            g_ptr_array_set_size (self->buffers, 0);
+            changed = set_state (self, WF_PCM_CACHE_FAILED);
+        }
+    }
+    g_mutex_unlock (&self->lock);
+
+    if (changed)
+        notify_state (self);
+}
+
+void
+wf_pcm_cache_append (WfPcmCache *self,
+                     GstSample  *sample)
+{
+    GstBuffer *buffer;
+    WfPcmReader *reader;
+    gboolean changed = FALSE;
+
+    g_return_if_fail (WF_IS_PCM_CACHE (self));
+
+    buffer = gst_sample_get_buffer (sample);
+    if (!buffer)
+        return;
+
+    g_mutex_lock (&self->lock);
+    if (self->state != WF_PCM_CACHE_FILLING)
+        goto out;
+
+    if (!self->caps)
+        self->caps = gst_caps_ref (gst_sample_get_caps (sample));
+
+    self->size += gst_buffer_get_size (buffer);
+    if (self->size > self->budget) {
+        g_ptr_array_set_size (self->buffers, 0);
+        changed = set_state (self, WF_PCM_CACHE_FAILED);
+        goto out;
+    }
+
+    g_ptr_array_add (self->buffers, gst_buffer_ref (buffer));
+    for (guint i = 0; i < self->readers->len; i++) {
+        reader = g_ptr_array_index (self->readers, i);
+        if (reader->hungry)
+            reader_feed (reader);
+    }
+
+out:
+    g_mutex_unlock (&self->lock);
+
+    if (changed)
+        notify_state (self);
+}
+
+void
+wf_pcm_cache_finish (WfPcmCache *self)
+{
+    WfPcmReader *reader;
+    GstBuffer *last;
+    gboolean changed = FALSE;
+
+    g_return_if_fail (WF_IS_PCM_CACHE (self));
+
+    g_mutex_lock (&self->lock);
+    if (self->state == WF_PCM_CACHE_FILLING) {
+        if (self->buffers->len > 0) {
+            last = g_ptr_array_index (self->buffers, self->buffers->len - 1);
+            if (GST_BUFFER_PTS_IS_VALID (last) && GST_BUFFER_DURATION_IS_VALID (last))
+                self->duration = GST_BUFFER_PTS (last) + GST_BUFFER_DURATION (last);
+        }
+        changed = set_state (self, WF_PCM_CACHE_COMPLETE);
+        for (guint i = 0; i < self->readers->len; i++) {
+            reader = g_ptr_array_index (self->readers, i);
+            if (reader->hungry)
+                reader_feed (reader);
+        }
+    }
+    g_mutex_unlock (&self->lock);
+
+    if (changed)
+        notify_state (self);
+}
+
+/* Drops what was cached. Readers are expected to watch the state and go
+ * back to the file. */
+
+void
+wf_pcm_cache_fail (WfPcmCache *self)
+{
+    gboolean changed = FALSE;
+
+    g_return_if_fail (WF_IS_PCM_CACHE (self));
+
+    g_mutex_lock (&self->lock);
+    if (self->state == WF_PCM_CACHE_FILLING) {
+        g_ptr_array_set_size (self->buffers, 0);
+        changed = set_state (self, WF_PCM_CACHE_FAILED);
+    }
+    g_mutex_unlock (&self->lock);
+
+    if (changed)
+        notify_state (self);
+}
+
+/* Makes @src, as created by playbin for an appsrc:// uri, play the cache. */
+
+void
+wf_pcm_cache_attach (WfPcmCache *self,
+                     GstAppSrc  *src)
+{
+    GstAppSrcCallbacks callbacks = {
+        .need_data = need_data_cb,
+        .seek_data = seek_data_cb,
+    };
+    WfPcmReader *reader;
+
+    g_return_if_fail (WF_IS_PCM_CACHE (self));
+    g_return_if_fail (GST_IS_APP_SRC (src));
+
+    reader = g_new0 (WfPcmReader, 1);
+    reader->cache = g_object_ref (self);
+    reader->src = src;
+
+    g_object_set (src,
+                  "format", GST_FORMAT_TIME,
+                  "stream-type", GST_APP_STREAM_TYPE_SEEKABLE,
+                  NULL);
+    gst_app_src_set_callbacks (src, &callbacks, reader, (GDestroyNotify) reader_free);
+
+    g_mutex_lock (&self->lock);
+    g_ptr_array_add (self->readers, reader);
+    if (self->caps) {
+        gst_app_src_set_caps (src, self->caps);
+        reader->configured = TRUE;
+    }
+    g_mutex_unlock (&self->lock);
+}
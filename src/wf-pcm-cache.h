@@ -0,0 +1,58 @@
+/*
+ * wf-pcm-cache.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib-object.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    WF_PCM_CACHE_FILLING,
+    WF_PCM_CACHE_COMPLETE,
+    WF_PCM_CACHE_FAILED,
+} WfPcmCacheState;
+
+#define WF_TYPE_PCM_CACHE (wf_pcm_cache_get_type ())
+G_DECLARE_FINAL_TYPE (WfPcmCache, wf_pcm_cache, WF, PCM_CACHE, GObject)
+
+WfPcmCache      *wf_pcm_cache_new          (const gchar *uri,
+                                            guint64      budget);
+WfPcmCache      *wf_pcm_cache_lookup       (const gchar *uri);
+
+const gchar     *wf_pcm_cache_get_uri      (WfPcmCache *self);
+WfPcmCacheState  wf_pcm_cache_get_state    (WfPcmCache *self);
+guint64          wf_pcm_cache_get_size     (WfPcmCache *self);
+
+void             wf_pcm_cache_set_duration (WfPcmCache *self,
+                                            guint64     duration);
+void             wf_pcm_cache_append       (WfPcmCache *self,
+                                            GstSample  *sample);
+void             wf_pcm_cache_finish       (WfPcmCache *self);
+void             wf_pcm_cache_fail         (WfPcmCache *self);
+
+void             wf_pcm_cache_attach       (WfPcmCache *self,
+                                            GstAppSrc  *src);
+
+G_END_DECLS
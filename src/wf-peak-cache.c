@@ -0,0 +1,217 @@
+/*
+ * wf-peak-cache.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <gio/gio.h>
+
+#include "wf-peak-cache.h"
+#include "wf-waveform.h"
+
+/*
+ * Keeps the result of an analysis pass on disk, so that opening a file
+ * again does not decode it again. Entries are keyed on the uri, size and
+ * modification time of the file; a changed file simply misses.
+ *
+ * An entry is a header followed by the peaks and then the seek points,
+ * in host byte order since the cache never leaves the machine.
+ */
+
+#define CACHE_MAGIC   0x4b504657 /* "WFPK" */
+#define CACHE_VERSION 1
+
+typedef struct
+{
+    guint32 magic;
+    guint32 version;
+    guint32 n_peaks;
+    guint32 n_seek_points;
+} CacheHeader;
+
+static gchar *
+cache_path (const gchar *uri)
+{
+    GFile *file;
+    GFileInfo *info;
+    GDateTime *mtime;
+    gchar *key, *checksum, *path;
+
+    file = g_file_new_for_uri (uri);
+    info = g_file_query_info (file,
+                              G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                              G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                              G_FILE_QUERY_INFO_NONE, NULL, NULL);
+    g_object_unref (file);
+    if (!info)
+        return NULL;
+
+    mtime = g_file_info_get_modification_date_time (info);
+    if (!mtime) {
+        g_object_unref (info);
+        return NULL;
+    }
+
+    key = g_strdup_printf ("%s\n%" G_GOFFSET_FORMAT "\n%" G_GINT64_FORMAT,
+                           uri, g_file_info_get_size (info),
+                           g_date_time_to_unix_usec (mtime));
+    checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+    path = g_build_filename (g_get_user_cache_dir (), "wavefront", "peaks", checksum, NULL);
+
+    g_date_time_unref (mtime);
+    g_object_unref (info);
+    g_free (checksum);
+    g_free (key);
+
+    return path;
+}
+
+gboolean
+wf_peak_cache_lookup (const gchar  *uri,
+                      GArray      **peaks,
+                      GArray      **seek_points)
+{
+    CacheHeader header;
+    gchar *path, *contents = NULL;
+    const gchar *data;
+    gsize length, peaks_size, points_size;
+
+    g_return_val_if_fail (uri != NULL, FALSE);
+    g_return_val_if_fail (peaks != NULL && seek_points != NULL, FALSE);
+
+    path = cache_path (uri);
+    if (!path || !g_file_get_contents (path, &contents, &length, NULL)) {
+        g_free (path);
+        return FALSE;
+    }
+    g_free (path);
+
+    if (length < sizeof (header))
+        goto invalid;
+
+    memcpy (&header, contents, sizeof (header));
+    peaks_size = (gsize) header.n_peaks * sizeof (WfPeakData);
+    points_size = (gsize) header.n_seek_points * sizeof (WfSeekPoint);
+    if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+        length != sizeof (header) + peaks_size + points_size)
+        goto invalid;
+
+    data = contents + sizeof (header);
+    *peaks = g_array_sized_new (FALSE, FALSE, sizeof (WfPeakData), header.n_peaks);
+    g_array_append_vals (*peaks, data, header.n_peaks);
+
+    data += peaks_size;
+    *seek_points = g_array_sized_new (FALSE, FALSE, sizeof (WfSeekPoint), header.n_seek_points);
+    g_array_append_vals (*seek_points, data, header.n_seek_points);
+
+    g_free (contents);
+    return TRUE;
+
+invalid:
+    g_free (contents);
+    return FALSE;
+}
+
+/* Maps the entry for @uri rather than reading it in, for when only some
+ * of its peaks are wanted: only the pages touched are read from disk.
+ * Returns NULL if there is none; @peaks stay valid while the mapping is
+ * held. */
+GMappedFile *
+wf_peak_cache_map (const gchar       *uri,
+                   const WfPeakData **peaks,
+                   guint             *n_peaks)
+{
+    CacheHeader header;
+    GMappedFile *map;
+    const gchar *data;
+    gchar *path;
+    gsize length;
+
+    g_return_val_if_fail (uri != NULL, NULL);
+    g_return_val_if_fail (peaks != NULL && n_peaks != NULL, NULL);
+
+    path = cache_path (uri);
+    map = path ? g_mapped_file_new (path, FALSE, NULL) : NULL;
+    g_free (path);
+    if (!map)
+        return NULL;
+
+    data = g_mapped_file_get_contents (map);
+    length = g_mapped_file_get_length (map);
+    if (length < sizeof (header))
+        goto invalid;
+
+    memcpy (&header, data, sizeof (header));
+    if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+        length != sizeof (header) + (gsize) header.n_peaks * sizeof (WfPeakData) +
+                  (gsize) header.n_seek_points * sizeof (WfSeekPoint))
+        goto invalid;
+
+    *peaks = (const WfPeakData *) (data + sizeof (header));
+    *n_peaks = header.n_peaks;
+    return map;
+
+invalid:
+    g_mapped_file_unref (map);
+    return NULL;
+}
+
+void
+wf_peak_cache_store (const gchar *uri,
+                     GArray      *peaks,
+                     GArray      *seek_points)
+{
+    CacheHeader header;
+    GByteArray *bytes;
+    GError *error = NULL;
+    gchar *path, *dir;
+
+    g_return_if_fail (uri != NULL);
+    g_return_if_fail (peaks != NULL && seek_points != NULL);
+
+    path = cache_path (uri);
+    if (!path)
+        return;
+
+    dir = g_path_get_dirname (path);
+    g_mkdir_with_parents (dir, 0700);
+    g_free (dir);
+
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.n_peaks = peaks->len;
+    header.n_seek_points = seek_points->len;
+
+    bytes = g_byte_array_new ();
+    g_byte_array_append (bytes, (const guint8 *) &header, sizeof (header));
+    g_byte_array_append (bytes, (const guint8 *) peaks->data,
+                         peaks->len * sizeof (WfPeakData));
+    g_byte_array_append (bytes, (const guint8 *) seek_points->data,
+                         seek_points->len * sizeof (WfSeekPoint));
+
+    if (!g_file_set_contents (path, (const gchar *) bytes->data, bytes->len, &error)) {
+        g_debug ("Failed to write peak cache for %s: %s", uri, error->message);
+        g_error_free (error);
+    }
+
+    g_byte_array_unref (bytes);
+    g_free (path);
+}
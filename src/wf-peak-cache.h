@@ -0,0 +1,41 @@
+/*
+ * wf-peak-cache.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "wf-waveform.h"
+
+G_BEGIN_DECLS
+
+gboolean wf_peak_cache_lookup (const gchar  *uri,
+                               GArray      **peaks,
+                               GArray      **seek_points);
+void     wf_peak_cache_store  (const gchar  *uri,
+                               GArray       *peaks,
+                               GArray       *seek_points);
+
+GMappedFile *wf_peak_cache_map (const gchar       *uri,
+                                const WfPeakData **peaks,
+                                guint             *n_peaks);
+
+G_END_DECLS
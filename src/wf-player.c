@@ -19,19 +19,229 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include "config.h"
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef HAVE_PTHREAD_SETSCHEDPARAM
+#include <pthread.h>
+#include <sched.h>
+#endif
+#ifdef HAVE_SETPRIORITY
+#include <sys/resource.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#ifdef HAVE_MALLOC_TRIM
+#include <malloc.h>
+#endif
 #include <gst/gst.h>
 #include <gst/play/play.h>
+#include <gst/audio/audio.h>
+#include <gst/base/gstbaseparse.h>
+#include <gst/base/gstbasesink.h>
+#include <gst/controller/gstdirectcontrolbinding.h>
+#include <gst/controller/gstinterpolationcontrolsource.h>
 
 #include "wf-player.h"
+#include "wf-equalizer.h"
+#include "wf-gst.h"
+#include "wf-pcm-cache.h"
+#include "wf-readahead.h"
 #include "wf-spectra.h"
+#include "wf-sub-track.h"
+#include "wf-trace.h"
+#include "wf-waveform.h"
+
+#define DEFAULT_POOL_SIZE      2
+#define MAX_POOL_SIZE          8
+#define DEFAULT_READAHEAD      3
+#define MAX_READAHEAD          16
+#define READAHEAD_HEAD_BYTES   (4 * 1024 * 1024)
+#define MAX_CROSSFADE          12000
+#define FADE_POINTS            32
+#define SEEK_PREFETCH          (1024 * 1024)
+#define SPECTRA_BANDS          20
+#define SPECTRA_QUEUE          32
+#define MAX_SPECTRA_LEAD       GST_SECOND
+
+/* Sink ring buffer sizes in µs and update intervals in ms. The normal ones
+ * are the GstAudioBaseSink and GstPlay defaults. */
+#define BUFFER_TIME            200000
+#define LATENCY_TIME           10000
+#define UPDATE_INTERVAL        100
+#define LOW_BUFFER_TIME        20000
+#define LOW_LATENCY_TIME       5000
+#define LOW_UPDATE_INTERVAL    16
+
+/* Audio thread scheduling: a low real-time priority, which is enough to
+ * preempt the UI and analysis, or failing that a raised nice value. */
+#define RT_PRIORITY            10
+#define ELEVATED_NICE          (-10)
+#define LATE_TOLERANCE         (5 * GST_MSECOND)
+#define DEFAULT_IDLE_TIMEOUT   300
+#define MAX_IDLE_TIMEOUT       86400
 
-struct _WfPlayer
+/*
+ * Every queue entry is played through its own GstPlay instance. The one
+ * feeding the sink is the active slot; a few more are kept prerolled in
+ * PAUSED on the neighbouring queue entries so that next and previous only
+ * have to swap which slot is active. Only the slots that play hold the
+ * audio device: the others preroll into a fakesink, and a slot that
+ * becomes active swaps its sink and prerolls again into the device. That
+ * costs a flushing seek, but keeps the file open, the decoders set up and
+ * the data in the page cache.
+ *
+ * A queue entry may also be a sub-track, a stretch of a longer file. The
+ * slots go by file, so the entries of one file share its pipeline, its
+ * analysis and its seek points. Playback is held to the stretch with a
+ * segment seek; when the next entry carries on in the same file, it is
+ * queued from segment-done without a flush, so there is no gap.
+ */
+
+typedef struct
 {
-    GObject parent;
+    gchar *uri;
+    gchar *file;
+    guint64 start;
+    guint64 end;
+} QueueEntry;
+
+enum
+{
+    SEEK_NONE,
+    SEEK_SENT,
+    SEEK_FLUSHED,
+};
+
+typedef struct
+{
+    WfPlayer *player;
 
     GstPlay *play;
     GstPlaySignalAdapter *signal_adaptor;
 
+    gchar *uri;
+    guint64 start;
+    WfPcmCache *pcm_cache;
+    WfEqualizer *equalizer;
+    GstElement *filter;
+    GstElement *fade;
+    guint output_config;
+
+    /* playbin's audio sink: a bin holding the audio device's sink, or a
+     * fakesink while the slot is only prerolled. */
+    GstElement *output;
+    GstElement *sink;
+    gboolean on_device;
+
+    /* Streaming thread only: whether the last buffer reached the sink late. */
+    gboolean late;
+
+    /* Atomic: SEEK_SENT once a timed seek is on its way, SEEK_FLUSHED once
+     * its flush went past the output. */
+    gint seek_state;
+
+    /* Whether the file could not be opened. */
+    gboolean failed;
+
+    /* Guarded by the player's priority_lock: the output threads running
+     * for this slot, and the lowest priority any of them got. */
+    guint output_threads;
+    WfAudioPriority audio_priority;
+
+    /* Guarded by the player's index_lock. */
+    GstElement *parser;
+} WfPlayerSlot;
+
+struct _WfPlayer
+{
+    GObject parent;
+
+    WfPlayerSlot *active;
+    GPtrArray *pool;
+    guint pool_size;
+    guint readahead;
+
+    GPtrArray *queue;
+    guint current;
+    gboolean playing;
+
+    WfPlayerSlot *fading;
+    guint crossfade;
+
+    /* After idle_timeout s without playing every pipeline is released.
+     * The active slot is left without a pipeline state, and what is
+     * needed to resume (uri, position, EQ, loop) stays in the player. */
+    guint idle_timeout;
+    guint idle_id;
+    gboolean idle;
+    guint64 idle_position;
+    guint64 idle_duration;
+    guint64 resume_position;
+    guint fade_id;
+
+    gint64 switch_time;
+    guint64 switch_latency;
+    gint64 seek_time;
+    guint64 seek_target;
+    guint64 seek_latency;
+
+    /* Seek points by uri, handed to parsers as they are plugged. */
+    GMutex index_lock;
+    GHashTable *seek_points;
+
+    /* Loop bounds are read from the GstPlay thread on segment-done. */
+    GMutex loop_lock;
+    guint64 loop_start;
+    guint64 loop_end;
+    guint64 pending_cue;
+    gboolean segment_armed;
+    GArray *cues;
+
+    /* The stretch of the active file the current entry covers, with an
+     * end of GST_CLOCK_TIME_NONE for the end of the file, and the stretch
+     * of the next entry if that follows on without a gap. Only changed on
+     * the main thread, with loop_lock held; the serial counts changes. */
+    guint64 window_start;
+    guint64 window_end;
+    guint64 follow_start;
+    guint64 follow_end;
+    guint window_serial;
+
+    WfEqBand eq_bands[WF_EQUALIZER_MAX_BANDS];
+    guint eq_n_bands;
+
+    /* Whether anything shows the spectra; the analysis is unlinked if not. */
+    gboolean analyze;
+
+    /* Output setup; slots built for an older one are not reused. */
+    gboolean low_latency;
+    gchar *audio_sink;
+    guint output_config;
+
+    /* Spectra are queued with their stream time on the GstPlay thread and
+     * handed out once the output position reaches them, so they show what
+     * is being heard rather than what just left the decoder. */
+    GMutex spectra_lock;
+    WfSpectra *spectra_queue[SPECTRA_QUEUE];
+    guint64 spectra_times[SPECTRA_QUEUE];
+    guint spectra_head;
+    guint spectra_len;
+    guint64 output_latency;
+
+    GMutex priority_lock;
+
+    /* Dropout counters, bumped from streaming threads. Their change is
+     * notified from the main context, one batch at a time. */
+    guint underruns;
+    guint late_buffers;
+    guint qos_events;
+    gint counters_queued;
+
     WfSpectra *spectra;
 };
 
@@ -40,6 +250,21 @@ enum
     PROP_ZERO,
     PROP_DURATION,
     PROP_POSITION,
+    PROP_URI,
+    PROP_PLAYING,
+    PROP_IDLE_TIMEOUT,
+    PROP_POOL_SIZE,
+    PROP_READAHEAD,
+    PROP_CROSSFADE,
+    PROP_SWITCH_LATENCY,
+    PROP_SEEK_LATENCY,
+    PROP_ANALYZE,
+    PROP_LOW_LATENCY,
+    PROP_AUDIO_SINK,
+    PROP_OUTPUT_LATENCY,
+    PROP_UNDERRUNS,
+    PROP_LATE_BUFFERS,
+    PROP_QOS_EVENTS,
     N_PROPS
 };
 
@@ -47,6 +272,9 @@ enum
 {
     DURATION_CHANGED,
     POSITION_CHNAGED,
+    CUES_CHANGED,
+    WINDOW_CHANGED,
+    LOOP_CHANGED,
     N_SIGNALS
 };
 
@@ -77,7 +305,7 @@ static void duration_changed_cb   (WfPlayer *self,
                                    gpointer  user_data);
 
 static void state_changed_cb      (WfPlayer     *self,
-                                   GstPlayState *state,
+                                   GstPlayState  state,
                                    gpointer      user_data);
 
 static void end_of_stream_cb      (WfPlayer *self,
@@ -96,6 +324,51 @@ static void element_cb            (GstBus     *bus,
                                    GstMessage *msg,
                                    gpointer    user_data);
 
+static void segment_done_cb       (GstBus     *bus,
+                                   GstMessage *msg,
+                                   gpointer    user_data);
+
+static void qos_cb                (GstBus     *bus,
+                                   GstMessage *msg,
+                                   gpointer    user_data);
+
+static void stream_status_cb      (GstBus     *bus,
+                                   GstMessage *msg,
+                                   gpointer    user_data);
+
+static GstPadProbeReturn seek_probe_cb (GstPad          *pad,
+                                        GstPadProbeInfo *info,
+                                        gpointer         user_data);
+
+static void element_added_cb      (GstBin     *bin,
+                                   GstBin     *sub_bin,
+                                   GstElement *element,
+                                   gpointer    user_data);
+
+static void element_removed_cb    (GstBin     *bin,
+                                   GstBin     *sub_bin,
+                                   GstElement *element,
+                                   gpointer    user_data);
+
+static void source_setup_cb       (GstElement *playbin,
+                                   GstElement *source,
+                                   gpointer    user_data);
+
+static void queue_entry_free (QueueEntry *entry);
+
+/* Slot handling */
+
+static WfPlayerSlot *slot_new           (WfPlayer     *self,
+                                         gboolean      on_device);
+static void          slot_free          (WfPlayerSlot *slot);
+static void          slot_set_pcm_cache (WfPlayerSlot *slot,
+                                         WfPcmCache   *cache);
+static gboolean      slot_seek          (WfPlayerSlot *slot,
+                                         guint64       start,
+                                         guint64       stop,
+                                         GstSeekFlags  flags);
+static void          refill_pool        (WfPlayer     *self);
+
 
 G_DEFINE_FINAL_TYPE (WfPlayer, wf_player, G_TYPE_OBJECT)
 
@@ -119,6 +392,99 @@ wf_player_class_init (WfPlayerClass *klass)
                              0, G_MAXUINT64, 0,
                              G_PARAM_READWRITE);
 
+    properties[PROP_URI] =
+        g_param_spec_string ("uri", NULL, NULL,
+                             NULL,
+                             G_PARAM_READABLE);
+
+    properties[PROP_PLAYING] =
+        g_param_spec_boolean ("playing", NULL, NULL,
+                              FALSE,
+                              G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY);
+
+    /* Seconds without playing before all pipelines are released, 0 keeps them. */
+    properties[PROP_IDLE_TIMEOUT] =
+        g_param_spec_uint ("idle-timeout", NULL, NULL,
+                           0, MAX_IDLE_TIMEOUT, DEFAULT_IDLE_TIMEOUT,
+                           G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+    /* Number of prerolled pipelines kept around the current queue entry. */
+    properties[PROP_POOL_SIZE] =
+        g_param_spec_uint ("pool-size", NULL, NULL,
+                           0, MAX_POOL_SIZE, DEFAULT_POOL_SIZE,
+                           G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+    /* Number of upcoming queue entries pulled into the page cache. */
+    properties[PROP_READAHEAD] =
+        g_param_spec_uint ("readahead", NULL, NULL,
+                           0, MAX_READAHEAD, DEFAULT_READAHEAD,
+                           G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+    /* Overlap between consecutive queue entries in ms, 0 for plain cuts. */
+    properties[PROP_CROSSFADE] =
+        g_param_spec_uint ("crossfade", NULL, NULL,
+                           0, MAX_CROSSFADE, 0,
+                           G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+    /* Time from the last track switch until the new slot reached PLAYING, in µs. */
+    properties[PROP_SWITCH_LATENCY] =
+        g_param_spec_uint64 ("switch-latency", NULL, NULL,
+                             0, G_MAXUINT64, 0,
+                             G_PARAM_READABLE);
+
+    /* Time from the last seek request until it completed, in µs. */
+    properties[PROP_SEEK_LATENCY] =
+        g_param_spec_uint64 ("seek-latency", NULL, NULL,
+                             0, G_MAXUINT64, 0,
+                             G_PARAM_READABLE);
+
+    /* Whether spectra are computed. Turn off while nothing displays them,
+     * e.g. when the window is hidden, to save the FFTs and wakeups. */
+    properties[PROP_ANALYZE] =
+        g_param_spec_boolean ("analyze", NULL, NULL,
+                              TRUE,
+                              G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+    /* Small sink buffers and frequent position updates, for snappier
+     * play, pause and seeks. Applies to tracks switched to afterwards. */
+    properties[PROP_LOW_LATENCY] =
+        g_param_spec_boolean ("low-latency", NULL, NULL,
+                              FALSE,
+                              G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+    /* Factory name of the audio sink, NULL or empty for the default one. */
+    properties[PROP_AUDIO_SINK] =
+        g_param_spec_string ("audio-sink", NULL, NULL,
+                             NULL,
+                             G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+    /* Measured lead of the decoded stream over the audible output in ns.
+     * Updated from the streaming thread without notification. */
+    properties[PROP_OUTPUT_LATENCY] =
+        g_param_spec_uint64 ("output-latency", NULL, NULL,
+                             0, G_MAXUINT64, 0,
+                             G_PARAM_READABLE);
+
+    /* Times the audio sink ran dry because data reached it too late. The
+     * counters are notified from the main context shortly after they
+     * change. */
+    properties[PROP_UNDERRUNS] =
+        g_param_spec_uint ("underruns", NULL, NULL,
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READABLE);
+
+    /* Buffers that reached the audio sink after their playback time. */
+    properties[PROP_LATE_BUFFERS] =
+        g_param_spec_uint ("late-buffers", NULL, NULL,
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READABLE);
+
+    /* QoS messages posted on the bus by any element. */
+    properties[PROP_QOS_EVENTS] =
+        g_param_spec_uint ("qos-events", NULL, NULL,
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READABLE);
+
     signals[DURATION_CHANGED] =
         g_signal_new ("duration-changed",
                       G_TYPE_FROM_CLASS (klass),
@@ -133,64 +499,71 @@ wf_player_class_init (WfPlayerClass *klass)
                       0, NULL, NULL, NULL,
                       G_TYPE_NONE, 1, G_TYPE_UINT64);
 
+    signals[CUES_CHANGED] =
+        g_signal_new ("cues-changed",
+                      G_TYPE_FROM_CLASS (klass),
+                      G_SIGNAL_RUN_LAST,
+                      0, NULL, NULL, NULL,
+                      G_TYPE_NONE, 0);
+
+    /* The stretch of the file the current queue entry covers changed. Both
+     * ends change at once, so they are read together with
+     * wf_player_get_window(). */
+    signals[WINDOW_CHANGED] =
+        g_signal_new ("window-changed",
+                      G_TYPE_FROM_CLASS (klass),
+                      G_SIGNAL_RUN_LAST,
+                      0, NULL, NULL, NULL,
+                      G_TYPE_NONE, 0);
+
+    /* The loop was set, cleared, or left for a cue. Read both ends with
+     * wf_player_get_loop(). */
+    signals[LOOP_CHANGED] =
+        g_signal_new ("loop-changed",
+                      G_TYPE_FROM_CLASS (klass),
+                      G_SIGNAL_RUN_LAST,
+                      0, NULL, NULL, NULL,
+                      G_TYPE_NONE, 0);
+
     g_object_class_install_properties (object_class, N_PROPS, properties);
 }
 
 static void
 wf_player_init (WfPlayer *self)
 {
-    GstElement *filter_pipeline;
-    GstElement *equalizer, *spectrum;
-    GstElement *play_pipeline;
-    GstPad *src_pad, *sink_pad;
-    GstPad *ghost_src_pad, *ghost_sink_pad;
-    GstBus *bus;
-
-    self->spectra = wf_spectra_new (20);
-
-    equalizer = gst_element_factory_make ("equalizer-10bands", "equalizer");
-    spectrum = gst_element_factory_make ("spectrum", "spectrum");
-
-    g_object_set (spectrum, "bands", self->spectra->n_bands, "threshold", -80,
-                  "post-messages", TRUE,"message-phase", TRUE, NULL);
-
-    sink_pad = gst_element_get_static_pad (equalizer, "sink");
-    src_pad = gst_element_get_static_pad (spectrum, "src");
-    gst_pad_set_active (sink_pad, TRUE);
-    gst_pad_set_active (src_pad, TRUE);
-
-    filter_pipeline = gst_pipeline_new (NULL);
-    gst_bin_add_many (GST_BIN (filter_pipeline), equalizer, spectrum, NULL);
-
-    gst_element_link (equalizer, spectrum);
-
-    ghost_sink_pad = gst_ghost_pad_new ("sink", sink_pad);
-    ghost_src_pad = gst_ghost_pad_new ("src", src_pad);
-
-    gst_element_add_pad (filter_pipeline, ghost_sink_pad);
-    gst_element_add_pad (filter_pipeline, ghost_src_pad);
-
-    self->play = gst_play_new (NULL);
-    play_pipeline = gst_play_get_pipeline (self->play);
-    g_object_set (play_pipeline, "audio-filter", filter_pipeline, NULL);
-    bus = gst_element_get_bus (play_pipeline);
-    g_signal_connect (bus, "message::element", G_CALLBACK (element_cb), self);
-    gst_object_unref (bus);
-
-    self->signal_adaptor = gst_play_signal_adapter_new (self->play);
-
-    g_signal_connect_swapped (self->signal_adaptor, "position-updated",
-                              G_CALLBACK (position_updated_cb), self);
-    g_signal_connect_swapped (self->signal_adaptor, "state-changed",
-                              G_CALLBACK (state_changed_cb), self);
-    g_signal_connect_swapped (self->signal_adaptor, "end-of-stream",
-                              G_CALLBACK (end_of_stream_cb), self);
-    g_signal_connect_swapped (self->signal_adaptor, "media-info-updated",
-                              G_CALLBACK (media_info_updated_cb), self);
-    g_signal_connect_swapped (self->signal_adaptor, "error",
-                              G_CALLBACK (error_cb), self);
-    g_signal_connect_swapped (self->signal_adaptor, "duration-changed",
-                              G_CALLBACK (duration_changed_cb), self);
+    self->analyze = TRUE;
+    self->spectra = wf_spectra_new (SPECTRA_BANDS);
+    g_mutex_init (&self->spectra_lock);
+    for (guint i = 0; i < SPECTRA_QUEUE; i++)
+        self->spectra_queue[i] = wf_spectra_new (SPECTRA_BANDS);
+    self->queue = g_ptr_array_new_with_free_func ((GDestroyNotify) queue_entry_free);
+    self->pool = g_ptr_array_new_with_free_func ((GDestroyNotify) slot_free);
+    self->pool_size = DEFAULT_POOL_SIZE;
+    self->readahead = DEFAULT_READAHEAD;
+    self->idle_timeout = DEFAULT_IDLE_TIMEOUT;
+    self->resume_position = GST_CLOCK_TIME_NONE;
+
+    g_mutex_init (&self->loop_lock);
+    g_mutex_init (&self->priority_lock);
+    self->pending_cue = GST_CLOCK_TIME_NONE;
+    self->window_end = GST_CLOCK_TIME_NONE;
+    self->follow_start = GST_CLOCK_TIME_NONE;
+    self->cues = g_array_new (FALSE, FALSE, sizeof (WfCuePoint));
+    g_array_set_clear_func (self->cues, (GDestroyNotify) wf_cue_point_clear);
+
+    memcpy (self->eq_bands, wf_equalizer_get_default_bands (&self->eq_n_bands),
+            sizeof (self->eq_bands[0]) * self->eq_n_bands);
+
+    g_mutex_init (&self->index_lock);
+    self->seek_points = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                               (GDestroyNotify) g_array_unref);
+
+    /* The first slot is only built once there is something to play, so
+     * creating a player does not wait for GStreamer to load its registry. */
+#ifdef ENABLE_BENCHMARKS
+    if (g_getenv ("WAVEFRONT_EAGER_GST"))
+        self->active = slot_new (self, TRUE);
+#endif
 }
 
 static void
@@ -198,11 +571,11 @@ dispose (GObject *object)
 {
     WfPlayer *player = WF_PLAYER (object);
 
-    // gst_bus_set_flushing (player->bus, TRUE);
-    // gst_object_unref (player->bus);
-
-    g_clear_object (&player->signal_adaptor);
-    g_clear_object (&player->play);
+    g_clear_handle_id (&player->fade_id, g_source_remove);
+    g_clear_handle_id (&player->idle_id, g_source_remove);
+    g_clear_pointer (&player->fading, slot_free);
+    g_clear_pointer (&player->active, slot_free);
+    g_clear_pointer (&player->pool, g_ptr_array_unref);
 
     G_OBJECT_CLASS (wf_player_parent_class)->dispose (object);
 }
@@ -212,7 +585,17 @@ finalize (GObject *object)
 {
     WfPlayer *player = WF_PLAYER (object);
 
+    g_clear_pointer (&player->queue, g_ptr_array_unref);
+    g_clear_pointer (&player->cues, g_array_unref);
     g_clear_pointer (&player->spectra, wf_spectra_free);
+    for (guint i = 0; i < SPECTRA_QUEUE; i++)
+        g_clear_pointer (&player->spectra_queue[i], wf_spectra_free);
+    g_mutex_clear (&player->spectra_lock);
+    g_free (player->audio_sink);
+    g_clear_pointer (&player->seek_points, g_hash_table_unref);
+    g_mutex_clear (&player->loop_lock);
+    g_mutex_clear (&player->index_lock);
+    g_mutex_clear (&player->priority_lock);
     G_OBJECT_CLASS (wf_player_parent_class)->finalize (object);
 }
 
@@ -231,6 +614,51 @@ get_property (GObject    *object,
     case PROP_DURATION:
         g_value_set_uint64 (value, wf_player_get_duration (player));
         break;
+    case PROP_URI:
+        g_value_set_string (value, wf_player_get_uri (player));
+        break;
+    case PROP_PLAYING:
+        g_value_set_boolean (value, player->playing);
+        break;
+    case PROP_IDLE_TIMEOUT:
+        g_value_set_uint (value, player->idle_timeout);
+        break;
+    case PROP_POOL_SIZE:
+        g_value_set_uint (value, player->pool_size);
+        break;
+    case PROP_READAHEAD:
+        g_value_set_uint (value, player->readahead);
+        break;
+    case PROP_CROSSFADE:
+        g_value_set_uint (value, player->crossfade);
+        break;
+    case PROP_SWITCH_LATENCY:
+        g_value_set_uint64 (value, player->switch_latency);
+        break;
+    case PROP_SEEK_LATENCY:
+        g_value_set_uint64 (value, player->seek_latency);
+        break;
+    case PROP_ANALYZE:
+        g_value_set_boolean (value, player->analyze);
+        break;
+    case PROP_LOW_LATENCY:
+        g_value_set_boolean (value, player->low_latency);
+        break;
+    case PROP_AUDIO_SINK:
+        g_value_set_string (value, player->audio_sink);
+        break;
+    case PROP_OUTPUT_LATENCY:
+        g_value_set_uint64 (value, wf_player_get_output_latency (player));
+        break;
+    case PROP_UNDERRUNS:
+        g_value_set_uint (value, wf_player_get_underruns (player));
+        break;
+    case PROP_LATE_BUFFERS:
+        g_value_set_uint (value, wf_player_get_late_buffers (player));
+        break;
+    case PROP_QOS_EVENTS:
+        g_value_set_uint (value, wf_player_get_qos_events (player));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
         break;
@@ -249,125 +677,2538 @@ set_property (GObject      *object,
     case PROP_POSITION:
         wf_player_set_position (player, g_value_get_uint64 (value));
         break;
+    case PROP_IDLE_TIMEOUT:
+        wf_player_set_idle_timeout (player, g_value_get_uint (value));
+        break;
+    case PROP_POOL_SIZE:
+        wf_player_set_pool_size (player, g_value_get_uint (value));
+        break;
+    case PROP_READAHEAD:
+        wf_player_set_readahead (player, g_value_get_uint (value));
+        break;
+    case PROP_CROSSFADE:
+        wf_player_set_crossfade (player, g_value_get_uint (value));
+        break;
+    case PROP_ANALYZE:
+        wf_player_set_analyze (player, g_value_get_boolean (value));
+        break;
+    case PROP_LOW_LATENCY:
+        wf_player_set_low_latency (player, g_value_get_boolean (value));
+        break;
+    case PROP_AUDIO_SINK:
+        wf_player_set_audio_sink (player, g_value_get_string (value));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
         break;
     }
 }
 
-static void
-element_cb (GstBus     *bus,
-            GstMessage *msg,
-            gpointer    user_data)
+/* The fade volume sits ahead of the equalizer and the analysis, so the
+ * spectra follow a crossfade as it is heard. */
+
+static GstElement *
+create_filter_bin (WfPlayer    *self,
+                   WfEqualizer *eq)
 {
-    WfPlayer *player = WF_PLAYER (user_data);
-    const GstStructure *structure;
-    const GValue *magnitude, *phase;
+    GstElement *filter_pipeline;
+    GstElement *equalizer, *audioconvert, *fade, *spectrum;
+    GstPad *src_pad, *sink_pad;
+    GstPad *ghost_src_pad, *ghost_sink_pad;
 
-    structure = gst_message_get_structure (msg);
-    if (gst_structure_has_name (structure, "spectrum")) {
-        magnitude = gst_structure_get_value (structure, "magnitude");
-        phase = gst_structure_get_value (structure, "phase");
-        wf_spectra_set_values (player->spectra, magnitude, phase);
-    }
+    /* The equalizer only takes F32; volume and spectrum are happy with it
+     * too. */
+    audioconvert = gst_element_factory_make ("audioconvert", NULL);
+    fade = gst_element_factory_make ("volume", "fade");
+    equalizer = GST_ELEMENT (eq);
+    spectrum = gst_element_factory_make ("spectrum", "spectrum");
+
+    g_object_set (spectrum, "bands", self->spectra->n_bands, "threshold", -80,
+                  "post-messages", TRUE,"message-phase", TRUE,
+                  "interval", (guint64) (self->low_latency ? LOW_UPDATE_INTERVAL : UPDATE_INTERVAL) * GST_MSECOND,
+                  NULL);
+
+    sink_pad = gst_element_get_static_pad (audioconvert, "sink");
+    src_pad = gst_element_get_static_pad (spectrum, "src");
+    gst_pad_set_active (sink_pad, TRUE);
+    gst_pad_set_active (src_pad, TRUE);
+
+    filter_pipeline = gst_pipeline_new (NULL);
+    gst_bin_add_many (GST_BIN (filter_pipeline), audioconvert, fade, equalizer, spectrum, NULL);
+
+    gst_element_link_many (audioconvert, fade, equalizer, spectrum, NULL);
+
+    ghost_sink_pad = gst_ghost_pad_new ("sink", sink_pad);
+    ghost_src_pad = gst_ghost_pad_new ("src", src_pad);
+
+    gst_element_add_pad (filter_pipeline, ghost_sink_pad);
+    gst_element_add_pad (filter_pipeline, ghost_src_pad);
+
+    gst_object_unref (sink_pad);
+    gst_object_unref (src_pad);
+
+    return filter_pipeline;
 }
 
-WfPlayer *
-wf_player_new (void)
+typedef struct
 {
-    return g_object_new (WF_TYPE_PLAYER, NULL);
-}
+    GstElement *filter;
+    gboolean analyze;
+} SpectrumSwitch;
 
 static void
-duration_changed_cb   (WfPlayer *self,
-                       guint64   duration,
-                       gpointer  user_data)
+spectrum_switch_free (SpectrumSwitch *data)
 {
-    g_signal_emit (self, signals[DURATION_CHANGED], 0, duration);
+    gst_object_unref (data->filter);
+    g_free (data);
 }
 
-static void
-position_updated_cb (WfPlayer *self,
-                     guint64   pos,
-                     gpointer  user_data)
+/* Runs once nothing flows out of the equalizer. Without analysis the
+ * spectrum element is unlinked and the equalizer feeds the bin's src pad
+ * directly, so no FFTs run and no messages are posted. Relinking makes
+ * the equalizer resend its sticky events to the spectrum element. */
+
+static GstPadProbeReturn
+switch_spectrum_cb (GstPad          *pad,
+                    GstPadProbeInfo *info,
+                    gpointer         user_data)
 {
-    g_signal_emit (self, signals[POSITION_CHNAGED], 0, pos);
+    SpectrumSwitch *data = user_data;
+    GstElement *spectrum;
+    GstPad *ghost, *spectrum_sink, *spectrum_src;
+
+    spectrum = gst_bin_get_by_name (GST_BIN (data->filter), "spectrum");
+    ghost = gst_element_get_static_pad (data->filter, "src");
+    spectrum_sink = gst_element_get_static_pad (spectrum, "sink");
+    spectrum_src = gst_element_get_static_pad (spectrum, "src");
+
+    if (data->analyze && !gst_pad_is_linked (spectrum_sink)) {
+        gst_ghost_pad_set_target (GST_GHOST_PAD (ghost), spectrum_src);
+        gst_pad_link (pad, spectrum_sink);
+    } else if (!data->analyze && gst_pad_is_linked (spectrum_sink)) {
+        gst_pad_unlink (pad, spectrum_sink);
+        gst_ghost_pad_set_target (GST_GHOST_PAD (ghost), pad);
+    }
+
+    gst_object_unref (spectrum_src);
+    gst_object_unref (spectrum_sink);
+    gst_object_unref (ghost);
+    gst_object_unref (spectrum);
+
+    return GST_PAD_PROBE_REMOVE;
 }
 
+/* Switches right away when the pad is idle, else after the buffer in
+ * flight. A prerolled slot switches once it starts playing or flushes. */
+
 static void
-state_changed_cb (WfPlayer     *self,
-                  GstPlayState *state,
-                  gpointer      user_data)
+slot_set_analyze (WfPlayerSlot *slot,
+                  gboolean      analyze)
 {
+    SpectrumSwitch *data;
+    GstPad *pad;
+
+    data = g_new0 (SpectrumSwitch, 1);
+    data->filter = gst_object_ref (slot->filter);
+    data->analyze = analyze;
+
+    pad = gst_element_get_static_pad (GST_ELEMENT (slot->equalizer), "src");
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_IDLE, switch_spectrum_cb,
+                       data, (GDestroyNotify) spectrum_switch_free);
+    gst_object_unref (pad);
 }
 
-static void
-end_of_stream_cb (WfPlayer *self,
-                  gpointer  user_data)
+static GstElement *
+create_output_bin (void)
 {
+    GstElement *output;
+
+    output = gst_bin_new ("output");
+    gst_element_add_pad (output, gst_ghost_pad_new_no_target ("sink", GST_PAD_SINK));
+
+    return output;
 }
 
-static void
-error_cb (WfPlayer     *self,
-          GError       *error,
-          GstStructure *details,
-          gpointer      user_data)
+/* Puts the audio device's sink or a fakesink in the slot's output bin.
+ * The old sink is shut down first, which fails the buffer it held and
+ * pauses the streaming threads; the caller seeks to preroll again into
+ * the new one. Returns whether the sink was swapped. */
+
+static gboolean
+slot_set_output (WfPlayerSlot *slot,
+                 gboolean      on_device)
 {
-    g_printerr ("%s\n", error->message);
+    WfPlayer *self = slot->player;
+    GstElement *sink = NULL;
+    GstPad *ghost, *pad;
+
+    if (slot->sink && slot->on_device == on_device)
+        return FALSE;
+
+    if (on_device && self->audio_sink) {
+        sink = gst_element_factory_make (self->audio_sink, NULL);
+        if (!sink)
+            g_warning ("Audio sink %s is not available", self->audio_sink);
+    }
+    if (on_device && !sink)
+        sink = gst_element_factory_make ("autoaudiosink", NULL);
+    if (!sink)
+        sink = gst_element_factory_make ("fakesink", NULL);
+
+    if (slot->sink) {
+        gst_element_set_state (slot->sink, GST_STATE_NULL);
+        gst_bin_remove (GST_BIN (slot->output), slot->sink);
+    }
+
+    gst_bin_add (GST_BIN (slot->output), sink);
+    pad = gst_element_get_static_pad (sink, "sink");
+    ghost = gst_element_get_static_pad (slot->output, "sink");
+    gst_ghost_pad_set_target (GST_GHOST_PAD (ghost), pad);
+    gst_object_unref (ghost);
+    gst_object_unref (pad);
+    gst_element_sync_state_with_parent (sink);
+
+    slot->sink = sink;
+    slot->on_device = on_device;
+
+    return TRUE;
+}
+
+static WfPlayerSlot *
+slot_new (WfPlayer *self,
+          gboolean  on_device)
+{
+    WfPlayerSlot *slot;
+    GstElement *play_pipeline;
+    GstStructure *config;
+    GstPad *pad;
+    GstBus *bus;
+
+    wf_gst_ensure ();
+
+    slot = g_new0 (WfPlayerSlot, 1);
+    slot->player = self;
+    slot->output_config = self->output_config;
+
+    slot->play = gst_play_new (NULL);
+
+    /* Seek points make accurate seeks cheap enough to always ask for. */
+    config = gst_play_get_config (slot->play);
+    gst_play_config_set_seek_accurate (config, TRUE);
+    gst_play_config_set_position_update_interval (config, self->low_latency ?
+                                                  LOW_UPDATE_INTERVAL : UPDATE_INTERVAL);
+    gst_play_set_config (slot->play, config);
+
+    slot->equalizer = gst_object_ref_sink (wf_equalizer_new ());
+    wf_equalizer_set_bands (slot->equalizer, self->eq_bands, self->eq_n_bands);
+
+    play_pipeline = gst_play_get_pipeline (slot->play);
+    slot->filter = gst_object_ref_sink (create_filter_bin (self, slot->equalizer));
+    slot->fade = gst_bin_get_by_name (GST_BIN (slot->filter), "fade");
+    g_object_set (play_pipeline, "audio-filter", slot->filter, NULL);
+    if (!self->analyze)
+        slot_set_analyze (slot, FALSE);
+    slot->output = gst_object_ref_sink (create_output_bin ());
+    slot_set_output (slot, on_device);
+    pad = gst_element_get_static_pad (slot->output, "sink");
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+                       seek_probe_cb, slot, NULL);
+    gst_object_unref (pad);
+    g_object_set (play_pipeline, "audio-sink", slot->output, NULL);
+    g_signal_connect (play_pipeline, "deep-element-added", G_CALLBACK (element_added_cb), slot);
+    g_signal_connect (play_pipeline, "deep-element-removed", G_CALLBACK (element_removed_cb), slot);
+    g_signal_connect (play_pipeline, "source-setup", G_CALLBACK (source_setup_cb), slot);
+    bus = gst_element_get_bus (play_pipeline);
+    g_signal_connect (bus, "message::element", G_CALLBACK (element_cb), slot);
+    g_signal_connect (bus, "message::segment-done", G_CALLBACK (segment_done_cb), slot);
+    g_signal_connect (bus, "message::qos", G_CALLBACK (qos_cb), slot);
+    gst_bus_enable_sync_message_emission (bus);
+    g_signal_connect (bus, "sync-message::stream-status", G_CALLBACK (stream_status_cb), slot);
+    gst_object_unref (bus);
+    gst_object_unref (play_pipeline);
+
+    slot->signal_adaptor = gst_play_signal_adapter_new (slot->play);
+
+    g_signal_connect_swapped (slot->signal_adaptor, "position-updated",
+                              G_CALLBACK (position_updated_cb), self);
+    g_signal_connect_swapped (slot->signal_adaptor, "state-changed",
+                              G_CALLBACK (state_changed_cb), self);
+    g_signal_connect_swapped (slot->signal_adaptor, "end-of-stream",
+                              G_CALLBACK (end_of_stream_cb), self);
+    g_signal_connect_swapped (slot->signal_adaptor, "media-info-updated",
+                              G_CALLBACK (media_info_updated_cb), self);
+    g_signal_connect_swapped (slot->signal_adaptor, "error",
+                              G_CALLBACK (error_cb), self);
+    g_signal_connect_swapped (slot->signal_adaptor, "duration-changed",
+                              G_CALLBACK (duration_changed_cb), self);
+
+    return slot;
 }
 
 static void
-media_info_updated_cb (WfPlayer         *self,
-                       GstPlayMediaInfo *media_info,
-                       gpointer          user_data)
+slot_free (WfPlayerSlot *slot)
 {
+    GstElement *play_pipeline;
+    GstBus *bus;
+
+    play_pipeline = gst_play_get_pipeline (slot->play);
+    bus = gst_element_get_bus (play_pipeline);
+    g_signal_handlers_disconnect_by_func (bus, element_cb, slot);
+    g_signal_handlers_disconnect_by_func (bus, segment_done_cb, slot);
+    g_signal_handlers_disconnect_by_func (bus, qos_cb, slot);
+    g_signal_handlers_disconnect_by_data (play_pipeline, slot);
+    gst_object_unref (play_pipeline);
+
+    g_signal_handlers_disconnect_by_data (slot->signal_adaptor, slot->player);
+    gst_play_stop (slot->play);
+
+    g_mutex_lock (&slot->player->index_lock);
+    g_clear_pointer (&slot->parser, gst_object_unref);
+    g_mutex_unlock (&slot->player->index_lock);
+
+    /* The pipeline is shut down with the GstPlay, and its output threads
+     * leave then; they get their old priority back on the way out. */
+    g_clear_object (&slot->signal_adaptor);
+    g_clear_object (&slot->play);
+    g_signal_handlers_disconnect_by_data (bus, slot);
+    gst_object_unref (bus);
+    gst_clear_object (&slot->equalizer);
+    gst_clear_object (&slot->fade);
+    gst_clear_object (&slot->filter);
+    gst_clear_object (&slot->output);
+    slot_set_pcm_cache (slot, NULL);
+    g_free (slot->uri);
+    g_free (slot);
 }
 
-void
-wf_player_set_file (WfPlayer    *self,
-                    const gchar *uri)
+/* A cache that is dropped half way leaves the slot playing from the file,
+ * from where the cache left off. */
+
+static void
+pcm_cache_state_cb (WfPcmCache   *cache,
+                    GParamSpec   *pspec,
+                    WfPlayerSlot *slot)
 {
-    g_return_if_fail (WF_IS_PLAYER (self));
+    WfPlayer *player = slot->player;
+    guint64 pos;
 
-    g_object_set (self->play, "uri", uri, NULL);
+    if (wf_pcm_cache_get_state (cache) != WF_PCM_CACHE_FAILED)
+        return;
+
+    pos = gst_play_get_position (slot->play);
+    slot_set_pcm_cache (slot, NULL);
+    gst_play_set_uri (slot->play, slot->uri);
+
+    if ((slot == player->active && player->playing) || slot == player->fading)
+        gst_play_play (slot->play);
+    else
+        gst_play_pause (slot->play);
+
+    if (GST_CLOCK_TIME_IS_VALID (pos) && pos > 0)
+        gst_play_seek (slot->play, pos);
 }
 
-void
-wf_player_play (WfPlayer *self)
+static void
+slot_set_pcm_cache (WfPlayerSlot *slot,
+                    WfPcmCache   *cache)
 {
-    g_return_if_fail (WF_IS_PLAYER (self));
+    if (slot->pcm_cache) {
+        g_signal_handlers_disconnect_by_data (slot->pcm_cache, slot);
+        g_clear_object (&slot->pcm_cache);
+    }
 
-    gst_play_play (self->play);
+    if (cache) {
+        slot->pcm_cache = cache;
+        g_signal_connect (cache, "notify::state", G_CALLBACK (pcm_cache_state_cb), slot);
+    }
 }
 
-guint64
-wf_player_get_duration (WfPlayer *self)
+static void
+source_setup_cb (GstElement *playbin,
+                 GstElement *source,
+                 gpointer    user_data)
 {
-    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+    WfPlayerSlot *slot = user_data;
 
-    return gst_play_get_duration (self->play);
+    if (GST_IS_APP_SRC (source) && slot->pcm_cache)
+        wf_pcm_cache_attach (slot->pcm_cache, GST_APP_SRC (source));
 }
 
-guint64
-wf_player_get_position (WfPlayer *self)
+/* Loads @uri into @slot and prerolls it at @start, so that playing it
+ * later only has to start the clock. If the file is being analysed, its
+ * decoded audio is played from the analysis instead of decoding it again. */
+
+static void
+slot_preroll (WfPlayerSlot *slot,
+              const gchar  *uri,
+              guint64       start)
 {
-    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+    slot->start = start;
+
+    if (g_strcmp0 (slot->uri, uri)) {
+        g_free (slot->uri);
+        slot->uri = g_strdup (uri);
+        slot->failed = FALSE;
+        slot_set_pcm_cache (slot, wf_pcm_cache_lookup (uri));
+        gst_play_set_uri (slot->play, slot->pcm_cache ? "appsrc://" : uri);
+        gst_play_pause (slot->play);
+        if (start > 0)
+            gst_play_seek (slot->play, start);
+        return;
+    }
 
-    return gst_play_get_position (self->play);
+    gst_play_seek (slot->play, start);
+    gst_play_pause (slot->play);
 }
 
-void
-wf_player_set_position (WfPlayer *self, guint64 pos)
+/* A pooled slot of the right file may have been prerolled for another
+ * of its entries. */
+
+static void
+slot_move_to (WfPlayerSlot *slot,
+              guint64       start)
 {
-    g_return_if_fail (WF_IS_PLAYER (self));
+    if (slot->start == start)
+        return;
 
-    gst_play_seek (self->play, pos);
+    slot->start = start;
+    gst_play_seek (slot->play, start);
 }
 
-const WfSpectra *
-wf_player_get_spectra (WfPlayer *self)
+/* Gives a pooled slot the audio device; if it had to swap its sink it is
+ * prerolled again, at @start. */
+
+static void
+slot_take_output (WfPlayerSlot *slot,
+                  guint64       start)
 {
+    if (!slot_set_output (slot, TRUE)) {
+        slot_move_to (slot, start);
+        return;
+    }
+
+    slot->start = start;
+    gst_play_seek (slot->play, start);
+}
+
+static void
+queue_entry_free (QueueEntry *entry)
+{
+    g_free (entry->uri);
+    g_free (entry->file);
+    g_free (entry);
+}
+
+static QueueEntry *
+queue_entry_new (const gchar *uri)
+{
+    QueueEntry *entry;
+
+    entry = g_new0 (QueueEntry, 1);
+    entry->uri = g_strdup (uri);
+    wf_sub_track_parse_uri (uri, &entry->file, &entry->start, &entry->end);
+
+    return entry;
+}
+
+static gboolean
+is_active (WfPlayer *self,
+           gpointer  signal_adaptor)
+{
+    return self->active && self->active->signal_adaptor == signal_adaptor;
+}
+
+static WfPlayerSlot *
+steal_pooled_slot (WfPlayer    *self,
+                   const gchar *uri)
+{
+    WfPlayerSlot *slot;
+
+    for (guint i = 0; i < self->pool->len; i++) {
+        slot = g_ptr_array_index (self->pool, i);
+        if (!g_strcmp0 (slot->uri, uri))
+            return g_ptr_array_steal_index (self->pool, i);
+    }
+
+    return NULL;
+}
+
+static QueueEntry *
+queue_entry (WfPlayer *self,
+             gint      index)
+{
+    if (index < 0 || index >= (gint) self->queue->len)
+        return NULL;
+
+    return g_ptr_array_index (self->queue, index);
+}
+
+/* Returns the file of a queue entry, which is what slots are kept for. */
+
+static const gchar *
+queue_uri (WfPlayer *self,
+           gint      index)
+{
+    QueueEntry *entry;
+
+    entry = queue_entry (self, index);
+
+    return entry ? entry->file : NULL;
+}
+
+static gboolean
+is_wanted (WfPlayer    *self,
+           const gchar *uri,
+           guint        n_wanted)
+{
+    gint offset;
+
+    /* Wanted entries alternate around the current one: +1, -1, +2, -2... */
+    for (guint i = 0; i < n_wanted; i++) {
+        offset = (i / 2 + 1) * (i % 2 ? -1 : 1);
+        if (!g_strcmp0 (queue_uri (self, (gint) self->current + offset), uri))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+static WfPlayerSlot *
+find_pooled_slot (WfPlayer    *self,
+                  const gchar *uri)
+{
+    WfPlayerSlot *slot;
+
+    for (guint i = 0; i < self->pool->len; i++) {
+        slot = g_ptr_array_index (self->pool, i);
+        if (!g_strcmp0 (slot->uri, uri))
+            return slot;
+    }
+
+    return NULL;
+}
+
+static void
+refill_pool (WfPlayer *self)
+{
+    WfPlayerSlot *slot;
+    QueueEntry *entry;
+    gint offset;
+    guint i;
+
+    if (self->idle)
+        return;
+
+    /* Drop slots that prerolled entries which are no longer next to the
+     * current one, then make sure the neighbours are warm. */
+    for (i = self->pool->len; i > 0; i--) {
+        slot = g_ptr_array_index (self->pool, i - 1);
+        if (!is_wanted (self, slot->uri, self->pool_size))
+            g_ptr_array_remove_index (self->pool, i - 1);
+    }
+
+    for (i = 0; i < self->pool_size; i++) {
+        offset = (i / 2 + 1) * (i % 2 ? -1 : 1);
+        entry = queue_entry (self, (gint) self->current + offset);
+        if (!entry || find_pooled_slot (self, entry->file))
+            continue;
+        if (self->active && !g_strcmp0 (self->active->uri, entry->file))
+            continue;
+        if (self->fading && !g_strcmp0 (self->fading->uri, entry->file))
+            continue;
+
+        slot = slot_new (self, FALSE);
+        slot_preroll (slot, entry->file, entry->start);
+        g_ptr_array_add (self->pool, slot);
+    }
+}
+
+static void
+queue_readahead (WfPlayer *self)
+{
+    WfReadahead *readahead = wf_readahead_get_default ();
+    const gchar *uri;
+
+    for (guint i = 1; i <= self->readahead; i++) {
+        uri = queue_uri (self, (gint) (self->current + i));
+        if (!uri)
+            break;
+        wf_readahead_queue_file (readahead, uri, READAHEAD_HEAD_BYTES);
+    }
+}
+
+static void
+park_slot (WfPlayer     *self,
+           WfPlayerSlot *slot)
+{
+    if (self->pool_size == 0 || !slot->uri || slot->failed ||
+        slot->output_config != self->output_config) {
+        slot_free (slot);
+        return;
+    }
+
+    /* It lets go of the device, and prerolls into the fakesink. */
+    slot_set_output (slot, FALSE);
+    slot_preroll (slot, slot->uri, slot->start);
+    g_ptr_array_add (self->pool, slot);
+}
+
+static void
+clear_spectra (WfPlayer *self)
+{
+    g_mutex_lock (&self->spectra_lock);
+    self->spectra_len = 0;
+    g_mutex_unlock (&self->spectra_lock);
+}
+
+static void
+active_changed (WfPlayer *self)
+{
+    guint64 duration;
+
+    /* Loops and cue points belong to the track they were set on. */
+    g_mutex_lock (&self->loop_lock);
+    self->loop_start = self->loop_end = 0;
+    self->pending_cue = GST_CLOCK_TIME_NONE;
+    g_mutex_unlock (&self->loop_lock);
+    self->segment_armed = FALSE;
+    g_signal_emit (self, signals[LOOP_CHANGED], 0);
+
+    if (self->cues->len) {
+        g_array_set_size (self->cues, 0);
+        g_signal_emit (self, signals[CUES_CHANGED], 0);
+    }
+
+    clear_spectra (self);
+    refill_pool (self);
+    queue_readahead (self);
+
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_URI]);
+
+    duration = gst_play_get_duration (self->active->play);
+    if (GST_CLOCK_TIME_IS_VALID (duration))
+        g_signal_emit (self, signals[DURATION_CHANGED], 0, duration);
+    g_signal_emit (self, signals[POSITION_CHNAGED], 0, self->window_start);
+}
+
+/* Takes the stretch of the current entry, and notes whether the next one
+ * can be joined to it from segment-done. */
+
+static gboolean
+follows (QueueEntry *entry,
+         QueueEntry *next)
+{
+    return next && GST_CLOCK_TIME_IS_VALID (entry->end) && next->start == entry->end &&
+           !g_strcmp0 (next->file, entry->file);
+}
+
+static void
+update_window (WfPlayer *self)
+{
+    QueueEntry *entry, *next;
+    gboolean changed;
+
+    entry = queue_entry (self, (gint) self->current);
+    next = queue_entry (self, (gint) self->current + 1);
+    changed = self->window_start != entry->start || self->window_end != entry->end;
+
+    g_mutex_lock (&self->loop_lock);
+    self->window_start = entry->start;
+    self->window_end = entry->end;
+    if (follows (entry, next)) {
+        self->follow_start = next->start;
+        self->follow_end = next->end;
+    } else {
+        self->follow_start = self->follow_end = GST_CLOCK_TIME_NONE;
+    }
+    self->window_serial++;
+    g_mutex_unlock (&self->loop_lock);
+
+    if (changed)
+        g_signal_emit (self, signals[WINDOW_CHANGED], 0);
+}
+
+/* Ramps the slot's fade volume over the crossfade, starting at stream
+ * time @start. The ramp is a control binding, so the volume element
+ * applies it sample by sample on the streaming thread rather than in
+ * steps from the main loop. Equal power: the summed energy of both
+ * tracks stays constant. */
+
+static void
+slot_fade (WfPlayerSlot *slot,
+           guint64       start,
+           guint64       duration,
+           gboolean      fade_in)
+{
+    GstControlSource *source;
+    GstTimedValueControlSource *values;
+    gdouble t;
+
+    source = gst_interpolation_control_source_new ();
+    g_object_set (source, "mode", GST_INTERPOLATION_MODE_LINEAR, NULL);
+    values = GST_TIMED_VALUE_CONTROL_SOURCE (source);
+    for (guint i = 0; i <= FADE_POINTS; i++) {
+        t = (gdouble) i / FADE_POINTS;
+        gst_timed_value_control_source_set (values, start + duration * i / FADE_POINTS,
+                                            fade_in ? sin (t * G_PI_2) : cos (t * G_PI_2));
+    }
+
+    gst_object_add_control_binding (GST_OBJECT (slot->fade),
+                                    gst_direct_control_binding_new_absolute (GST_OBJECT (slot->fade),
+                                                                             "volume", source));
+    gst_object_unref (source);
+}
+
+static void
+slot_clear_fade (WfPlayerSlot *slot)
+{
+    GstControlBinding *binding;
+
+    binding = gst_object_get_control_binding (GST_OBJECT (slot->fade), "volume");
+    if (binding) {
+        gst_object_remove_control_binding (GST_OBJECT (slot->fade), binding);
+        gst_object_unref (binding);
+    }
+
+    g_object_set (slot->fade, "volume", 1.0, NULL);
+}
+
+static void
+finish_crossfade (WfPlayer *self)
+{
+    g_clear_handle_id (&self->fade_id, g_source_remove);
+
+    if (self->fading) {
+        slot_clear_fade (self->fading);
+        park_slot (self, self->fading);
+        self->fading = NULL;
+    }
+
+    if (self->active)
+        slot_clear_fade (self->active);
+}
+
+static gboolean
+fade_done_cb (gpointer user_data)
+{
+    WfPlayer *self = WF_PLAYER (user_data);
+
+    self->fade_id = 0;
+    finish_crossfade (self);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+start_crossfade (WfPlayer *self,
+                 guint64   end)
+{
+    WfPlayerSlot *slot;
+    QueueEntry *entry;
+    guint64 pos, latency, start, duration;
+
+    entry = g_ptr_array_index (self->queue, self->current + 1);
+
+    /* Without a pool this is where the second decoder comes to life; it
+     * only lives for the overlap, as the outgoing one is parked after. */
+    slot = steal_pooled_slot (self, entry->file);
+    if (slot) {
+        slot_set_output (slot, TRUE);
+        slot->start = entry->start;
+    } else {
+        slot = slot_new (self, TRUE);
+        slot_preroll (slot, entry->file, entry->start);
+    }
+
+    /* The outgoing ramp ends with the entry. The slot has filtered ahead of
+     * what is heard by about the output latency, so the ramp can start no
+     * sooner than that and is shortened if the entry ends before a whole
+     * crossfade fits. The incoming one prerolled at full volume and is
+     * prerolled again with a ramp over the same window. */
+    pos = gst_play_get_position (self->active->play);
+    if (!GST_CLOCK_TIME_IS_VALID (pos))
+        pos = 0;
+    latency = wf_player_get_output_latency (self);
+    start = end > self->crossfade * GST_MSECOND ? end - self->crossfade * GST_MSECOND : 0;
+    start = MAX (start, pos + latency);
+    duration = end > start ? end - start : 0;
+    slot_fade (self->active, start, duration, FALSE);
+    slot_fade (slot, entry->start, duration, TRUE);
+    gst_play_seek (slot->play, entry->start);
+
+    self->fading = self->active;
+    self->active = slot;
+    self->current++;
+    update_window (self);
+
+    self->switch_time = g_get_monotonic_time ();
+    gst_play_play (slot->play);
+
+    /* Once both ramps have been heard out the outgoing slot is parked. */
+    self->fade_id = g_timeout_add ((duration + latency) / GST_MSECOND,
+                                   fade_done_cb, self);
+
+    active_changed (self);
+}
+
+/* Releases the decoders, the audio device and the prerolled neighbours.
+ * The active slot is rebuilt empty, so its equalizer is set up already
+ * when playback resumes. */
+
+static void
+enter_idle (WfPlayer *self)
+{
+    gchar *uri;
+
+    if (self->idle || self->playing || !self->active || !self->active->uri)
+        return;
+
+    self->idle_position = gst_play_get_position (self->active->play);
+    self->idle_duration = gst_play_get_duration (self->active->play);
+    if (!GST_CLOCK_TIME_IS_VALID (self->idle_position))
+        self->idle_position = 0;
+
+    finish_crossfade (self);
+    g_ptr_array_set_size (self->pool, 0);
+
+    uri = g_steal_pointer (&self->active->uri);
+    slot_free (self->active);
+    self->active = slot_new (self, TRUE);
+    self->active->uri = uri;
+
+    self->idle = TRUE;
+    self->segment_armed = FALSE;
+    clear_spectra (self);
+
+#ifdef HAVE_MALLOC_TRIM
+    /* Most of what was freed came from the heap; hand it back. */
+    malloc_trim (0);
+#endif
+
+    g_debug ("Idle, released pipelines at %" GST_TIME_FORMAT " of %s",
+             GST_TIME_ARGS (self->idle_position), uri);
+}
+
+/* Prerolls the dormant slot again at the sample it was left on. A loop or
+ * a sub-track resumes through arm_segment() instead, which needs a
+ * segment seek. */
+
+static void
+leave_idle (WfPlayer *self)
+{
+    gchar *uri;
+
+    if (!self->idle)
+        return;
+
+    self->idle = FALSE;
+    uri = g_steal_pointer (&self->active->uri);
+    slot_preroll (self->active, uri, 0);
+    g_free (uri);
+
+    if (self->loop_end > self->loop_start || GST_CLOCK_TIME_IS_VALID (self->window_end))
+        self->resume_position = self->idle_position;
+    else if (self->idle_position > 0)
+        gst_play_seek (self->active->play, self->idle_position);
+
+    refill_pool (self);
+}
+
+static gboolean
+idle_cb (gpointer user_data)
+{
+    WfPlayer *self = WF_PLAYER (user_data);
+
+    self->idle_id = 0;
+    enter_idle (self);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Every stop of playback restarts the idle countdown. */
+
+static void
+set_playing (WfPlayer *self,
+             gboolean  playing)
+{
+    g_clear_handle_id (&self->idle_id, g_source_remove);
+    if (!playing && self->idle_timeout > 0)
+        self->idle_id = g_timeout_add_seconds (self->idle_timeout, idle_cb, self);
+
+    if (self->playing == playing)
+        return;
+
+    self->playing = playing;
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PLAYING]);
+}
+
+static void
+switch_to (WfPlayer *self,
+           guint     index)
+{
+    WfPlayerSlot *previous, *slot;
+    QueueEntry *entry;
+
+    finish_crossfade (self);
+
+    /* The dormant slot is only a shell now, fit to be reused for any uri. */
+    if (self->idle) {
+        self->idle = FALSE;
+        g_clear_pointer (&self->active->uri, g_free);
+    }
+
+    entry = g_ptr_array_index (self->queue, index);
+    self->current = index;
+
+    /* Another stretch of the file that is playing is only a seek away. */
+    if (self->active && !g_strcmp0 (self->active->uri, entry->file) &&
+        !self->active->failed && self->active->output_config == self->output_config) {
+        update_window (self);
+        active_changed (self);
+        if (GST_CLOCK_TIME_IS_VALID (entry->end))
+            self->segment_armed = slot_seek (self->active, entry->start, entry->end,
+                                             GST_SEEK_FLAG_SEGMENT | GST_SEEK_FLAG_FLUSH);
+        else
+            gst_play_seek (self->active->play, entry->start);
+        return;
+    }
+
+    previous = self->active;
+    slot = steal_pooled_slot (self, entry->file);
+    if (slot && slot->failed)
+        g_clear_pointer (&slot, slot_free);
+    if (slot) {
+        slot_take_output (slot, entry->start);
+    } else {
+        /* Reuse the old pipeline when it is not worth keeping warm. */
+        if (previous && previous->output_config == self->output_config &&
+            !previous->failed && (!previous->uri || self->pool_size == 0)) {
+            slot = previous;
+            previous = NULL;
+        } else {
+            slot = slot_new (self, TRUE);
+        }
+        slot_preroll (slot, entry->file, entry->start);
+    }
+
+    self->active = slot;
+    update_window (self);
+
+    if (previous)
+        park_slot (self, previous);
+
+    self->switch_time = self->playing ? g_get_monotonic_time () : 0;
+    if (self->playing)
+        gst_play_play (slot->play);
+
+    active_changed (self);
+}
+
+/* The spectrum element sits before the sink's ring buffer, so by the time
+ * its message arrives the sink's position trails the analysed audio by
+ * the output latency. That difference is measured here too. */
+
+static void
+queue_spectra (WfPlayerSlot *slot,
+               GstClockTime  time,
+               const GValue *magnitude,
+               const GValue *phase)
+{
+    WfPlayer *self = slot->player;
+    GstElement *pipeline;
+    gint64 pos = -1;
+    guint64 latency;
+    guint index;
+
+    pipeline = gst_play_get_pipeline (slot->play);
+    if (!gst_element_query_position (pipeline, GST_FORMAT_TIME, &pos))
+        pos = -1;
+    gst_object_unref (pipeline);
+
+    g_mutex_lock (&self->spectra_lock);
+    if (pos >= 0) {
+        latency = time > (guint64) pos ? time - pos : 0;
+        self->output_latency = self->output_latency ?
+            (self->output_latency * 7 + latency) / 8 : latency;
+    }
+
+    index = (self->spectra_head + self->spectra_len) % SPECTRA_QUEUE;
+    if (self->spectra_len == SPECTRA_QUEUE)
+        self->spectra_head = (self->spectra_head + 1) % SPECTRA_QUEUE;
+    else
+        self->spectra_len++;
+
+    wf_spectra_set_values (self->spectra_queue[index], magnitude, phase);
+    self->spectra_times[index] = time;
+    g_mutex_unlock (&self->spectra_lock);
+}
+
+/* Smaller ring buffers cut how long a pause, resume or flushing seek takes
+ * to be heard, at the cost of more wakeups and less slack for underruns. */
+
+static void
+configure_sink (WfPlayer   *self,
+                GstElement *sink)
+{
+    gboolean low_latency;
+
+    low_latency = g_atomic_int_get (&self->low_latency);
+    g_object_set (sink,
+                  "buffer-time", (gint64) (low_latency ? LOW_BUFFER_TIME : BUFFER_TIME),
+                  "latency-time", (gint64) (low_latency ? LOW_LATENCY_TIME : LATENCY_TIME),
+                  NULL);
+}
+
+static gboolean
+notify_counters_cb (gpointer user_data)
+{
+    WfPlayer *self = WF_PLAYER (user_data);
+
+    g_atomic_int_set (&self->counters_queued, FALSE);
+
+    g_object_freeze_notify (G_OBJECT (self));
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_UNDERRUNS]);
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LATE_BUFFERS]);
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_QOS_EVENTS]);
+    g_object_thaw_notify (G_OBJECT (self));
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Called from streaming threads after a counter went up. A run of late
+ * buffers is one notification, not one per buffer. */
+
+static void
+queue_counters_notify (WfPlayer *self)
+{
+    if (g_atomic_int_compare_and_exchange (&self->counters_queued, FALSE, TRUE))
+        g_main_context_invoke_full (NULL, G_PRIORITY_DEFAULT_IDLE, notify_counters_cb,
+                                    g_object_ref (self), g_object_unref);
+}
+
+/* A buffer that reaches a playing sink after its running time means the
+ * ring buffer ran out before it and silence was played; a run of them is
+ * one audible dropout. */
+
+static GstPadProbeReturn
+sink_buffer_probe_cb (GstPad          *pad,
+                      GstPadProbeInfo *info,
+                      gpointer         user_data)
+{
+    WfPlayerSlot *slot = user_data;
+    WfPlayer *player = slot->player;
+    GstElement *sink;
+    GstBuffer *buffer;
+    GstClockTime running_time, now;
+    gboolean late;
+
+    sink = GST_ELEMENT (GST_OBJECT_PARENT (pad));
+    buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+    if (GST_STATE (sink) != GST_STATE_PLAYING || !GST_BUFFER_PTS_IS_VALID (buffer))
+        return GST_PAD_PROBE_OK;
+
+    GST_OBJECT_LOCK (sink);
+    running_time = gst_segment_to_running_time (&GST_BASE_SINK (sink)->segment,
+                                                GST_FORMAT_TIME, GST_BUFFER_PTS (buffer));
+    GST_OBJECT_UNLOCK (sink);
+    now = gst_element_get_current_running_time (sink);
+    if (!GST_CLOCK_TIME_IS_VALID (running_time) || !GST_CLOCK_TIME_IS_VALID (now))
+        return GST_PAD_PROBE_OK;
+
+    late = now > running_time + LATE_TOLERANCE;
+    if (late) {
+        g_atomic_int_inc ((gint *) &player->late_buffers);
+        if (!slot->late) {
+            g_atomic_int_inc ((gint *) &player->underruns);
+            g_debug ("Audio underrun, buffer %" GST_TIME_FORMAT " late",
+                     GST_TIME_ARGS (now - running_time));
+        }
+        queue_counters_notify (player);
+    }
+    slot->late = late;
+
+    return GST_PAD_PROBE_OK;
+}
+
+static void
+watch_sink (WfPlayerSlot *slot,
+            GstElement   *sink)
+{
+    GstPad *pad;
+
+    pad = gst_element_get_static_pad (sink, "sink");
+    if (!pad)
+        return;
+
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, sink_buffer_probe_cb, slot, NULL);
+    gst_object_unref (pad);
+}
+
+/* Only the threads that feed the audio device are raised: the sink's own
+ * ring buffer thread and the queue thread playsink puts in front of it.
+ * Decoding stays at normal priority, playsink's queue absorbs its jitter. */
+
+static gboolean
+is_output_thread_owner (GstElement *owner)
+{
+    GstObject *parent;
+
+    if (GST_IS_AUDIO_BASE_SINK (owner))
+        return TRUE;
+
+    /* playbin creates playsink directly, so it has no factory to check. */
+    for (parent = GST_OBJECT_PARENT (owner); parent; parent = GST_OBJECT_PARENT (parent)) {
+        if (!g_strcmp0 (G_OBJECT_TYPE_NAME (parent), "GstPlaySink"))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* What a raised thread ran at before, put back when it leaves its task:
+ * GstTaskPool hands the same thread on to decoders and sources later. */
+typedef struct
+{
+    WfAudioPriority priority;
+#ifdef HAVE_PTHREAD_SETSCHEDPARAM
+    gint policy;
+    struct sched_param param;
+#endif
+#if defined(HAVE_SETPRIORITY) && defined(__linux__)
+    gint nice;
+#endif
+} SavedPriority;
+
+static GPrivate saved_priority = G_PRIVATE_INIT (g_free);
+
+static WfAudioPriority
+raise_thread_priority (void)
+{
+    SavedPriority *saved;
+#ifdef HAVE_PTHREAD_SETSCHEDPARAM
+    struct sched_param param = {0};
+#endif
+
+    saved = g_private_get (&saved_priority);
+    if (saved)
+        return saved->priority;
+
+    saved = g_new0 (SavedPriority, 1);
+    saved->priority = WF_AUDIO_PRIORITY_NORMAL;
+    g_private_set (&saved_priority, saved);
+
+#ifdef HAVE_PTHREAD_SETSCHEDPARAM
+    param.sched_priority = MAX (sched_get_priority_min (SCHED_RR), RT_PRIORITY);
+    if (pthread_getschedparam (pthread_self (), &saved->policy, &saved->param) == 0 &&
+        pthread_setschedparam (pthread_self (), SCHED_RR, &param) == 0) {
+        saved->priority = WF_AUDIO_PRIORITY_REALTIME;
+        return saved->priority;
+    }
+#endif
+
+#if defined(HAVE_SETPRIORITY) && defined(__linux__)
+    /* On Linux nice values apply to the calling thread only. -1 is a valid
+     * nice value, so only errno tells a failure apart. */
+    errno = 0;
+    saved->nice = getpriority (PRIO_PROCESS, (id_t) syscall (SYS_gettid));
+    if (errno == 0 &&
+        setpriority (PRIO_PROCESS, (id_t) syscall (SYS_gettid), ELEVATED_NICE) == 0)
+        saved->priority = WF_AUDIO_PRIORITY_ELEVATED;
+#endif
+
+    return saved->priority;
+}
+
+static void
+restore_thread_priority (void)
+{
+    SavedPriority *saved;
+
+    saved = g_private_get (&saved_priority);
+    if (!saved)
+        return;
+
+#ifdef HAVE_PTHREAD_SETSCHEDPARAM
+    if (saved->priority == WF_AUDIO_PRIORITY_REALTIME)
+        pthread_setschedparam (pthread_self (), saved->policy, &saved->param);
+#endif
+#if defined(HAVE_SETPRIORITY) && defined(__linux__)
+    if (saved->priority == WF_AUDIO_PRIORITY_ELEVATED)
+        setpriority (PRIO_PROCESS, (id_t) syscall (SYS_gettid), saved->nice);
+#endif
+
+    g_private_replace (&saved_priority, NULL);
+}
+
+static gboolean
+slot_seek (WfPlayerSlot *slot,
+           guint64       start,
+           guint64       stop,
+           GstSeekFlags  flags)
+{
+    GstElement *pipeline;
+    gboolean ret;
+
+    /* An invalid @stop is set too, so the stop of an earlier segment
+     * does not carry over. */
+    pipeline = gst_play_get_pipeline (slot->play);
+    ret = gst_element_seek (pipeline, 1.0, GST_FORMAT_TIME,
+                            flags | GST_SEEK_FLAG_ACCURATE,
+                            GST_SEEK_TYPE_SET, start,
+                            GST_SEEK_TYPE_SET,
+                            GST_CLOCK_TIME_IS_VALID (stop) ? (gint64) stop : -1);
+    gst_object_unref (pipeline);
+
+    return ret;
+}
+
+/* Starts the segment playback is held to: the loop, or else the stretch
+ * of the current entry if it ends before the file does. From then on each
+ * pass ends with segment-done instead of EOS, and what follows is queued
+ * without a flush. */
+
+static void
+arm_segment (WfPlayer *self)
+{
+    guint64 pos, start, end;
+
+    if (!self->active)
+        return;
+
+    if (self->loop_end > self->loop_start) {
+        start = self->loop_start;
+        end = self->loop_end;
+    } else if (GST_CLOCK_TIME_IS_VALID (self->window_end)) {
+        start = self->window_start;
+        end = self->window_end;
+    } else {
+        return;
+    }
+
+    /* After an idle teardown playback resumes where it was left. */
+    pos = GST_CLOCK_TIME_IS_VALID (self->resume_position) ?
+          self->resume_position : gst_play_get_position (self->active->play);
+    self->resume_position = GST_CLOCK_TIME_NONE;
+    if (!GST_CLOCK_TIME_IS_VALID (pos) || pos < start || pos >= end)
+        pos = start;
+
+    self->segment_armed = slot_seek (self->active, pos, end,
+                                     GST_SEEK_FLAG_SEGMENT | GST_SEEK_FLAG_FLUSH);
+}
+
+static gboolean
+notify_loop_cb (gpointer user_data)
+{
+    WfPlayer *self = WF_PLAYER (user_data);
+
+    self->segment_armed = GST_CLOCK_TIME_IS_VALID (self->window_end);
+    g_signal_emit (self, signals[LOOP_CHANGED], 0);
+
+    return G_SOURCE_REMOVE;
+}
+
+typedef struct
+{
+    WfPlayer *player;
+    guint window_serial;
+    gboolean followed;
+} WindowEnd;
+
+static void
+window_end_free (WindowEnd *data)
+{
+    g_object_unref (data->player);
+    g_free (data);
+}
+
+/* The current entry has played to its end. If segment-done went on into
+ * the next one, that only has to be made current; otherwise playback
+ * moves on as it would at the end of a file. */
+
+static gboolean
+window_end_cb (gpointer user_data)
+{
+    WindowEnd *data = user_data;
+    WfPlayer *self = data->player;
+
+    if (data->window_serial != self->window_serial || !self->active)
+        return G_SOURCE_REMOVE;
+
+    if (data->followed) {
+        self->current++;
+        update_window (self);
+        active_changed (self);
+        self->segment_armed = GST_CLOCK_TIME_IS_VALID (self->window_end);
+    } else if (self->current + 1 < self->queue->len) {
+        switch_to (self, self->current + 1);
+    } else {
+        set_playing (self, FALSE);
+        gst_play_pause (self->active->play);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+segment_done_cb (GstBus     *bus,
+                 GstMessage *msg,
+                 gpointer    user_data)
+{
+    WfPlayerSlot *slot = user_data;
+    WfPlayer *player = slot->player;
+    WindowEnd *data;
+    GstFormat format;
+    gint64 position;
+    guint64 start, end, cue, window_end, follow_start, follow_end;
+    guint window_serial;
+
+    if (g_atomic_pointer_get (&player->active) != slot)
+        return;
+
+    gst_message_parse_segment_done (msg, &format, &position);
+
+    g_mutex_lock (&player->loop_lock);
+    start = player->loop_start;
+    end = player->loop_end;
+    cue = player->pending_cue;
+    player->pending_cue = GST_CLOCK_TIME_NONE;
+    if (GST_CLOCK_TIME_IS_VALID (cue))
+        player->loop_start = player->loop_end = 0;
+    window_end = player->window_end;
+    follow_start = player->follow_start;
+    follow_end = player->follow_end;
+    window_serial = player->window_serial;
+    g_mutex_unlock (&player->loop_lock);
+
+    /* None of these flush, so the next pass joins the previous one without
+     * a gap. A pending cue jump or a cleared loop leaves at the boundary,
+     * and playback stays within the current entry. */
+    if (GST_CLOCK_TIME_IS_VALID (cue)) {
+        slot_seek (slot, cue, window_end, GST_CLOCK_TIME_IS_VALID (window_end) ?
+                   GST_SEEK_FLAG_SEGMENT : GST_SEEK_FLAG_NONE);
+        g_main_context_invoke_full (NULL, G_PRIORITY_DEFAULT, notify_loop_cb,
+                                    g_object_ref (player), g_object_unref);
+    } else if (end > start) {
+        slot_seek (slot, start, end, GST_SEEK_FLAG_SEGMENT);
+    } else if (GST_CLOCK_TIME_IS_VALID (window_end) && (guint64) position >= window_end) {
+        data = g_new0 (WindowEnd, 1);
+        data->player = g_object_ref (player);
+        data->window_serial = window_serial;
+        data->followed = GST_CLOCK_TIME_IS_VALID (follow_start);
+        if (data->followed)
+            slot_seek (slot, follow_start, follow_end, GST_CLOCK_TIME_IS_VALID (follow_end) ?
+                       GST_SEEK_FLAG_SEGMENT : GST_SEEK_FLAG_NONE);
+        g_main_context_invoke_full (NULL, G_PRIORITY_DEFAULT, window_end_cb,
+                                    data, (GDestroyNotify) window_end_free);
+    } else {
+        slot_seek (slot, position, window_end, GST_CLOCK_TIME_IS_VALID (window_end) ?
+                   GST_SEEK_FLAG_SEGMENT : GST_SEEK_FLAG_NONE);
+    }
+}
+
+static void
+element_cb (GstBus     *bus,
+            GstMessage *msg,
+            gpointer    user_data)
+{
+    WfPlayerSlot *slot = user_data;
+    WfPlayer *player = slot->player;
+    const GstStructure *structure;
+    const GValue *magnitude, *phase;
+    GstClockTime time;
+
+    /* Runs on the GstPlay thread; prerolled slots must not touch the spectra. */
+    if (g_atomic_pointer_get (&player->active) != slot)
+        return;
+
+    structure = gst_message_get_structure (msg);
+    if (gst_structure_has_name (structure, "spectrum") &&
+        gst_structure_get_clock_time (structure, "stream-time", &time)) {
+        magnitude = gst_structure_get_value (structure, "magnitude");
+        phase = gst_structure_get_value (structure, "phase");
+        queue_spectra (slot, time, magnitude, phase);
+    }
+}
+
+static void
+qos_cb (GstBus     *bus,
+        GstMessage *msg,
+        gpointer    user_data)
+{
+    WfPlayerSlot *slot = user_data;
+
+    g_atomic_int_inc ((gint *) &slot->player->qos_events);
+    queue_counters_notify (slot->player);
+}
+
+/* Sync handler, so it runs on the thread that is starting up or leaving
+ * and can change its own scheduling. Failing to raise it is not an error. */
+
+static void
+stream_status_cb (GstBus     *bus,
+                  GstMessage *msg,
+                  gpointer    user_data)
+{
+    WfPlayerSlot *slot = user_data;
+    WfPlayer *player = slot->player;
+    GstStreamStatusType type;
+    GstElement *owner;
+    WfAudioPriority priority;
+
+    gst_message_parse_stream_status (msg, &type, &owner);
+    if (!is_output_thread_owner (owner))
+        return;
+
+    if (type == GST_STREAM_STATUS_TYPE_ENTER) {
+        priority = raise_thread_priority ();
+
+        g_mutex_lock (&player->priority_lock);
+        if (slot->output_threads++ == 0)
+            slot->audio_priority = priority;
+        else
+            slot->audio_priority = MIN (slot->audio_priority, priority);
+        g_mutex_unlock (&player->priority_lock);
+
+        g_debug ("Audio thread of %s runs at %s priority", GST_ELEMENT_NAME (owner),
+                 priority == WF_AUDIO_PRIORITY_REALTIME ? "real-time" :
+                 priority == WF_AUDIO_PRIORITY_ELEVATED ? "elevated" : "normal");
+    } else if (type == GST_STREAM_STATUS_TYPE_LEAVE) {
+        restore_thread_priority ();
+
+        g_mutex_lock (&player->priority_lock);
+        if (slot->output_threads > 0 && --slot->output_threads == 0)
+            slot->audio_priority = WF_AUDIO_PRIORITY_NORMAL;
+        g_mutex_unlock (&player->priority_lock);
+    }
+}
+
+/* Feeds @points to the parser's index, which it consults before falling
+ * back to bisecting or scanning the stream. Called with index_lock held. */
+
+static void
+slot_apply_seek_points (WfPlayerSlot *slot,
+                        GArray       *points)
+{
+    WfSeekPoint *point;
+
+    if (!slot->parser || !points)
+        return;
+
+    for (guint i = 0; i < points->len; i++) {
+        point = &g_array_index (points, WfSeekPoint, i);
+        gst_base_parse_add_index_entry (GST_BASE_PARSE (slot->parser),
+                                        point->offset, point->time, TRUE, TRUE);
+    }
+}
+
+static void
+element_added_cb (GstBin     *bin,
+                  GstBin     *sub_bin,
+                  GstElement *element,
+                  gpointer    user_data)
+{
+    WfPlayerSlot *slot = user_data;
+    WfPlayer *player = slot->player;
+    gchar *uri = NULL;
+
+    if (GST_IS_AUDIO_BASE_SINK (element)) {
+        configure_sink (player, element);
+        watch_sink (slot, element);
+        return;
+    }
+
+    if (!GST_IS_BASE_PARSE (element))
+        return;
+
+    /* Runs on a streaming thread, where slot->uri may be changing. */
+    g_object_get (bin, "current-uri", &uri, NULL);
+
+    g_mutex_lock (&player->index_lock);
+    gst_object_replace ((GstObject **) &slot->parser, GST_OBJECT (element));
+    if (uri)
+        slot_apply_seek_points (slot, g_hash_table_lookup (player->seek_points, uri));
+    g_mutex_unlock (&player->index_lock);
+
+    g_free (uri);
+}
+
+static void
+element_removed_cb (GstBin     *bin,
+                    GstBin     *sub_bin,
+                    GstElement *element,
+                    gpointer    user_data)
+{
+    WfPlayerSlot *slot = user_data;
+
+    g_mutex_lock (&slot->player->index_lock);
+    if (slot->parser == element)
+        g_clear_pointer (&slot->parser, gst_object_unref);
+    g_mutex_unlock (&slot->player->index_lock);
+}
+
+/* Returns the byte offset of the last seek point at or before @pos. */
+
+static gboolean
+find_seek_offset (WfPlayer    *self,
+                  const gchar *uri,
+                  guint64      pos,
+                  guint64     *offset)
+{
+    GArray *points;
+    guint lo = 0, hi, mid;
+    gboolean found = FALSE;
+
+    g_mutex_lock (&self->index_lock);
+    points = g_hash_table_lookup (self->seek_points, uri);
+    if (points && points->len > 0) {
+        hi = points->len;
+        while (hi - lo > 1) {
+            mid = lo + (hi - lo) / 2;
+            if (g_array_index (points, WfSeekPoint, mid).time <= pos)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        *offset = g_array_index (points, WfSeekPoint, lo).offset;
+        found = TRUE;
+    }
+    g_mutex_unlock (&self->index_lock);
+
+    return found;
+}
+
+WfPlayer *
+wf_player_new (void)
+{
+    return g_object_new (WF_TYPE_PLAYER, NULL);
+}
+
+static void
+duration_changed_cb   (WfPlayer *self,
+                       guint64   duration,
+                       gpointer  user_data)
+{
+    if (!is_active (self, user_data))
+        return;
+
+    g_signal_emit (self, signals[DURATION_CHANGED], 0, duration);
+}
+
+static void
+position_updated_cb (WfPlayer *self,
+                     guint64   pos,
+                     gpointer  user_data)
+{
+    guint64 end, latency;
+
+    if (!is_active (self, user_data))
+        return;
+
+    /* An entry that the next one carries on from is not faded out. The
+     * fade starts one output latency ahead so that a whole crossfade is
+     * heard before the entry ends. */
+    if (self->crossfade && !self->fading && self->loop_end <= self->loop_start &&
+        self->current + 1 < self->queue->len && !GST_CLOCK_TIME_IS_VALID (self->follow_start)) {
+        end = GST_CLOCK_TIME_IS_VALID (self->window_end) ?
+              self->window_end : gst_play_get_duration (self->active->play);
+        latency = wf_player_get_output_latency (self);
+        if (GST_CLOCK_TIME_IS_VALID (end) &&
+            pos + latency + self->crossfade * GST_MSECOND >= end) {
+            start_crossfade (self, end);
+            return;
+        }
+    }
+
+    g_signal_emit (self, signals[POSITION_CHNAGED], 0, pos);
+}
+
+static void
+state_changed_cb (WfPlayer     *self,
+                  GstPlayState  state,
+                  gpointer      user_data)
+{
+    if (!is_active (self, user_data))
+        return;
+
+    if (state >= GST_PLAY_STATE_PAUSED && !self->segment_armed)
+        arm_segment (self);
+
+    if (state == GST_PLAY_STATE_PLAYING && self->switch_time) {
+        WF_TRACE_MARK (self->switch_time, "First audio", "%s", self->active->uri);
+        self->switch_latency = g_get_monotonic_time () - self->switch_time;
+        self->switch_time = 0;
+        g_debug ("Time to first audio for %s: %" G_GUINT64_FORMAT " us",
+                 self->active->uri, self->switch_latency);
+        g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_SWITCH_LATENCY]);
+    }
+}
+
+typedef struct
+{
+    WfPlayer *player;
+    WfPlayerSlot *slot;
+    GstClockTime pts;
+    gint64 time;
+} SeekReached;
+
+static void
+seek_reached_free (SeekReached *reached)
+{
+    g_object_unref (reached->player);
+    g_free (reached);
+}
+
+static gboolean
+seek_reached_cb (gpointer user_data)
+{
+    SeekReached *reached = user_data;
+    WfPlayer *self = reached->player;
+
+    if (reached->slot != self->active || !self->seek_time)
+        return G_SOURCE_REMOVE;
+
+    WF_TRACE_MARK (self->seek_time, "Seek", "%s to %" GST_TIME_FORMAT,
+                   self->active->uri, GST_TIME_ARGS (self->seek_target));
+    self->seek_latency = reached->time - self->seek_time;
+    self->seek_time = 0;
+    g_debug ("Seek to %" GST_TIME_FORMAT " in %s took %" G_GUINT64_FORMAT
+             " us, landed at %" GST_TIME_FORMAT,
+             GST_TIME_ARGS (self->seek_target), self->active->uri,
+             self->seek_latency, GST_TIME_ARGS (reached->pts));
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_SEEK_LATENCY]);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* A seek is done once the first buffer after its flush reaches the
+ * output. Segment seeks, which loops and sub-tracks use, get no
+ * seek-done from GstPlay, so this is watched for on the pad instead. */
+
+static GstPadProbeReturn
+seek_probe_cb (GstPad          *pad,
+               GstPadProbeInfo *info,
+               gpointer         user_data)
+{
+    WfPlayerSlot *slot = user_data;
+    SeekReached *reached;
+    GstBuffer *buffer;
+
+    if (info->type & GST_PAD_PROBE_TYPE_EVENT_FLUSH) {
+        if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) == GST_EVENT_FLUSH_STOP)
+            g_atomic_int_compare_and_exchange (&slot->seek_state, SEEK_SENT, SEEK_FLUSHED);
+        return GST_PAD_PROBE_OK;
+    }
+
+    if (!g_atomic_int_compare_and_exchange (&slot->seek_state, SEEK_FLUSHED, SEEK_NONE))
+        return GST_PAD_PROBE_OK;
+
+    buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+    reached = g_new0 (SeekReached, 1);
+    reached->player = g_object_ref (slot->player);
+    reached->slot = slot;
+    reached->pts = GST_BUFFER_PTS (buffer);
+    reached->time = g_get_monotonic_time ();
+    g_main_context_invoke_full (NULL, G_PRIORITY_DEFAULT, seek_reached_cb,
+                                reached, (GDestroyNotify) seek_reached_free);
+
+    return GST_PAD_PROBE_OK;
+}
+
+static void
+end_of_stream_cb (WfPlayer *self,
+                  gpointer  user_data)
+{
+    if (!is_active (self, user_data))
+        return;
+
+    if (self->current + 1 < self->queue->len)
+        switch_to (self, self->current + 1);
+    else
+        set_playing (self, FALSE);
+}
+
+/* Errors that mean the file is missing or is not something we can play. */
+static gboolean
+is_unplayable (GError *error)
+{
+    return g_error_matches (error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_NOT_FOUND) ||
+           g_error_matches (error, GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_OPEN_READ) ||
+           g_error_matches (error, GST_STREAM_ERROR, GST_STREAM_ERROR_TYPE_NOT_FOUND) ||
+           g_error_matches (error, GST_STREAM_ERROR, GST_STREAM_ERROR_CODEC_NOT_FOUND) ||
+           g_error_matches (error, GST_STREAM_ERROR, GST_STREAM_ERROR_WRONG_TYPE);
+}
+
+/* Queue entries are not checked up front, as a playlist may hold tens of
+ * thousands, so one that cannot be played is skipped once it comes up. A
+ * prerolled slot that failed is opened again when it is needed, in case
+ * the file has turned up since; the active one is freed rather than
+ * parked, or the pool would preroll the missing file again. */
+static void
+error_cb (WfPlayer     *self,
+          GError       *error,
+          GstStructure *details,
+          gpointer      user_data)
+{
+    WfPlayerSlot *slot;
+
+    g_printerr ("%s\n", error->message);
+
+    if (!is_unplayable (error))
+        return;
+
+    if (!is_active (self, user_data)) {
+        for (guint i = 0; i < self->pool->len; i++) {
+            slot = g_ptr_array_index (self->pool, i);
+            if (slot->signal_adaptor == user_data)
+                slot->failed = TRUE;
+        }
+        return;
+    }
+
+    self->active->failed = TRUE;
+    if (self->current + 1 < self->queue->len)
+        switch_to (self, self->current + 1);
+    else
+        set_playing (self, FALSE);
+}
+
+static void
+media_info_updated_cb (WfPlayer         *self,
+                       GstPlayMediaInfo *media_info,
+                       gpointer          user_data)
+{
+}
+
+void
+wf_player_set_file (WfPlayer    *self,
+                    const gchar *uri)
+{
+    const gchar *uris[] = {uri, NULL};
+
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    wf_player_set_queue (self, uris);
+}
+
+/* Sub-track uris, as WfSubTrack makes them, play just their stretch of
+ * the file. */
+
+void
+wf_player_set_queue (WfPlayer           *self,
+                     const gchar * const *uris)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+    g_return_if_fail (uris != NULL);
+
+    g_ptr_array_set_size (self->queue, 0);
+    g_mutex_lock (&self->index_lock);
+    g_hash_table_remove_all (self->seek_points);
+    g_mutex_unlock (&self->index_lock);
+    for (guint i = 0; uris[i]; i++)
+        g_ptr_array_add (self->queue, queue_entry_new (uris[i]));
+
+    if (self->queue->len == 0)
+        return;
+
+    set_playing (self, FALSE);
+    switch_to (self, 0);
+
+    /* The first audio is timed from the file being opened, however long
+     * it waits for play. */
+    self->switch_time = g_get_monotonic_time ();
+}
+
+/* Adds entries after the last one, as a playlist is read in. The current
+ * entry stays as it is, but its neighbours may just have arrived. */
+void
+wf_player_append_queue (WfPlayer           *self,
+                        const gchar * const *uris)
+{
+    QueueEntry *entry, *next;
+    guint n_queued;
+
+    g_return_if_fail (WF_IS_PLAYER (self));
+    g_return_if_fail (uris != NULL);
+
+    n_queued = self->queue->len;
+    for (guint i = 0; uris[i]; i++)
+        g_ptr_array_add (self->queue, queue_entry_new (uris[i]));
+
+    if (n_queued == 0) {
+        if (self->queue->len > 0) {
+            set_playing (self, FALSE);
+            switch_to (self, 0);
+        }
+        return;
+    }
+
+    /* Only the follow-on changes, so a segment-done already on its way
+     * still counts for the current window. */
+    if (self->current + 1 == n_queued) {
+        entry = queue_entry (self, (gint) self->current);
+        next = queue_entry (self, (gint) self->current + 1);
+        if (follows (entry, next)) {
+            g_mutex_lock (&self->loop_lock);
+            self->follow_start = next->start;
+            self->follow_end = next->end;
+            g_mutex_unlock (&self->loop_lock);
+        }
+    }
+
+    if (self->current + MAX (self->pool_size, self->readahead) >= n_queued) {
+        refill_pool (self);
+        queue_readahead (self);
+    }
+}
+
+void
+wf_player_next (WfPlayer *self)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    if (self->current + 1 < self->queue->len)
+        switch_to (self, self->current + 1);
+}
+
+void
+wf_player_prev (WfPlayer *self)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    if (self->current > 0)
+        switch_to (self, self->current - 1);
+}
+
+/* Returns the file being played, which for a sub-track is its whole file. */
+
+const gchar *
+wf_player_get_uri (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), NULL);
+
+    return self->active ? self->active->uri : NULL;
+}
+
+/* The index in the queue of the entry playing, which is what "uri" is
+ * notified for. */
+
+guint
+wf_player_get_queue_position (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    return self->current;
+}
+
+/* Gets the stretch of the file the current entry covers, and returns
+ * whether that is less than all of it. An @end of G_MAXUINT64 is the end
+ * of the file. */
+
+gboolean
+wf_player_get_window (WfPlayer *self,
+                      guint64  *start,
+                      guint64  *end)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), FALSE);
+
+    if (start)
+        *start = self->window_start;
+    if (end)
+        *end = self->window_end;
+
+    return self->window_start > 0 || GST_CLOCK_TIME_IS_VALID (self->window_end);
+}
+
+void
+wf_player_set_idle_timeout (WfPlayer *self,
+                            guint     idle_timeout)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    idle_timeout = MIN (idle_timeout, MAX_IDLE_TIMEOUT);
+    if (self->idle_timeout == idle_timeout)
+        return;
+
+    self->idle_timeout = idle_timeout;
+    set_playing (self, self->playing);
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_IDLE_TIMEOUT]);
+}
+
+guint
+wf_player_get_idle_timeout (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    return self->idle_timeout;
+}
+
+void
+wf_player_set_pool_size (WfPlayer *self,
+                         guint     pool_size)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    pool_size = MIN (pool_size, MAX_POOL_SIZE);
+    if (self->pool_size == pool_size)
+        return;
+
+    self->pool_size = pool_size;
+    refill_pool (self);
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_POOL_SIZE]);
+}
+
+guint
+wf_player_get_pool_size (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    return self->pool_size;
+}
+
+void
+wf_player_set_readahead (WfPlayer *self,
+                         guint     readahead)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    readahead = MIN (readahead, MAX_READAHEAD);
+    if (self->readahead == readahead)
+        return;
+
+    self->readahead = readahead;
+    queue_readahead (self);
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_READAHEAD]);
+}
+
+guint
+wf_player_get_readahead (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    return self->readahead;
+}
+
+void
+wf_player_set_crossfade (WfPlayer *self,
+                         guint     crossfade)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    crossfade = MIN (crossfade, MAX_CROSSFADE);
+    if (self->crossfade == crossfade)
+        return;
+
+    self->crossfade = crossfade;
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_CROSSFADE]);
+}
+
+guint
+wf_player_get_crossfade (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    return self->crossfade;
+}
+
+guint64
+wf_player_get_switch_latency (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    return self->switch_latency;
+}
+
+guint64
+wf_player_get_seek_latency (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    return self->seek_latency;
+}
+
+/* Prerolled slots are rebuilt for the new output setup right away; the
+ * active one keeps its sink until the next track switch, as swapping it
+ * would mean prerolling again under the listener. */
+
+static void
+output_config_changed (WfPlayer *self)
+{
+    self->output_config++;
+    g_ptr_array_set_size (self->pool, 0);
+    refill_pool (self);
+}
+
+void
+wf_player_set_low_latency (WfPlayer *self,
+                           gboolean  low_latency)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    low_latency = !!low_latency;
+    if (self->low_latency == low_latency)
+        return;
+
+    g_atomic_int_set (&self->low_latency, low_latency);
+    output_config_changed (self);
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LOW_LATENCY]);
+}
+
+gboolean
+wf_player_get_low_latency (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), FALSE);
+
+    return self->low_latency;
+}
+
+void
+wf_player_set_audio_sink (WfPlayer    *self,
+                          const gchar *audio_sink)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    if (audio_sink && !*audio_sink)
+        audio_sink = NULL;
+    if (!g_strcmp0 (self->audio_sink, audio_sink))
+        return;
+
+    g_free (self->audio_sink);
+    self->audio_sink = g_strdup (audio_sink);
+
+    output_config_changed (self);
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_AUDIO_SINK]);
+}
+
+const gchar *
+wf_player_get_audio_sink (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), NULL);
+
+    return self->audio_sink;
+}
+
+void
+wf_player_set_analyze (WfPlayer *self,
+                       gboolean  analyze)
+{
+    WfPlayerSlot *slot;
+
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    analyze = !!analyze;
+    if (self->analyze == analyze)
+        return;
+
+    self->analyze = analyze;
+    if (self->active)
+        slot_set_analyze (self->active, analyze);
+    if (self->fading)
+        slot_set_analyze (self->fading, analyze);
+    for (guint i = 0; i < self->pool->len; i++) {
+        slot = g_ptr_array_index (self->pool, i);
+        slot_set_analyze (slot, analyze);
+    }
+
+    /* Spectra queued before the pause would be stale when it ends. */
+    clear_spectra (self);
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_ANALYZE]);
+}
+
+gboolean
+wf_player_get_analyze (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), FALSE);
+
+    return self->analyze;
+}
+
+/* Returns the priority the output threads of the current track got. */
+
+WfAudioPriority
+wf_player_get_audio_priority (WfPlayer *self)
+{
+    WfAudioPriority priority = WF_AUDIO_PRIORITY_NORMAL;
+
+    g_return_val_if_fail (WF_IS_PLAYER (self), WF_AUDIO_PRIORITY_NORMAL);
+
+    g_mutex_lock (&self->priority_lock);
+    if (self->active)
+        priority = self->active->audio_priority;
+    g_mutex_unlock (&self->priority_lock);
+
+    return priority;
+}
+
+guint
+wf_player_get_underruns (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    return g_atomic_int_get ((gint *) &self->underruns);
+}
+
+guint
+wf_player_get_late_buffers (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    return g_atomic_int_get ((gint *) &self->late_buffers);
+}
+
+guint
+wf_player_get_qos_events (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    return g_atomic_int_get ((gint *) &self->qos_events);
+}
+
+guint64
+wf_player_get_output_latency (WfPlayer *self)
+{
+    guint64 latency;
+
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    g_mutex_lock (&self->spectra_lock);
+    latency = self->output_latency;
+    g_mutex_unlock (&self->spectra_lock);
+
+    return latency;
+}
+
+/* Sets the seek points of @uri, as recorded by WfWaveform. Slots that
+ * already have a parser for @uri get them right away, later ones when
+ * their parser is plugged. */
+
+void
+wf_player_set_seek_points (WfPlayer    *self,
+                           const gchar *uri,
+                           GArray      *points)
+{
+    WfPlayerSlot *slot;
+
+    g_return_if_fail (WF_IS_PLAYER (self));
+    g_return_if_fail (uri != NULL);
+
+    g_mutex_lock (&self->index_lock);
+    if (points)
+        g_hash_table_replace (self->seek_points, g_strdup (uri), g_array_ref (points));
+    else
+        g_hash_table_remove (self->seek_points, uri);
+
+    if (self->active && !g_strcmp0 (self->active->uri, uri))
+        slot_apply_seek_points (self->active, points);
+    if (self->fading && !g_strcmp0 (self->fading->uri, uri))
+        slot_apply_seek_points (self->fading, points);
+    for (guint i = 0; i < self->pool->len; i++) {
+        slot = g_ptr_array_index (self->pool, i);
+        if (!g_strcmp0 (slot->uri, uri))
+            slot_apply_seek_points (slot, points);
+    }
+    g_mutex_unlock (&self->index_lock);
+}
+
+void
+wf_player_play (WfPlayer *self)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    if (!self->active)
+        return;
+
+    /* Resuming is timed too, unless the open is still waiting for it. */
+    if (!self->playing && !self->switch_time)
+        self->switch_time = g_get_monotonic_time ();
+
+    leave_idle (self);
+    set_playing (self, TRUE);
+    gst_play_play (self->active->play);
+}
+
+void
+wf_player_pause (WfPlayer *self)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    finish_crossfade (self);
+    set_playing (self, FALSE);
+    if (self->active && !self->idle)
+        gst_play_pause (self->active->play);
+}
+
+gboolean
+wf_player_get_playing (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), FALSE);
+
+    return self->playing;
+}
+
+guint64
+wf_player_get_duration (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    if (!self->active)
+        return GST_CLOCK_TIME_NONE;
+    if (self->idle)
+        return self->idle_duration;
+
+    return gst_play_get_duration (self->active->play);
+}
+
+guint64
+wf_player_get_position (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    if (!self->active)
+        return GST_CLOCK_TIME_NONE;
+    if (self->idle)
+        return self->idle_position;
+
+    return gst_play_get_position (self->active->play);
+}
+
+/* Returns the entry next to the current one, playing the same file, that
+ * covers @pos, or -1 if there is none. */
+
+static gint
+find_entry_at (WfPlayer *self,
+               guint64   pos)
+{
+    QueueEntry *entry, *current;
+    gint index;
+
+    current = queue_entry (self, (gint) self->current);
+    for (guint i = 0; i < self->queue->len; i++) {
+        /* Nearest first: +1, -1, +2, -2... */
+        index = (gint) self->current + (gint) (i / 2 + 1) * (i % 2 ? -1 : 1);
+        entry = queue_entry (self, index);
+        if (entry && !g_strcmp0 (entry->file, current->file) &&
+            pos >= entry->start && pos < entry->end)
+            return index;
+    }
+
+    return -1;
+}
+
+/* Positions are within the file. One outside the current entry moves
+ * playback to the entry of that file which covers it, if the queue has
+ * one; otherwise it is kept within the current entry. */
+
+void
+wf_player_set_position (WfPlayer *self, guint64 pos)
+{
+    guint64 duration, offset;
+    gint index;
+
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    if (!self->active)
+        return;
+
+    if (pos < self->window_start || pos >= self->window_end) {
+        index = find_entry_at (self, pos);
+        if (index >= 0) {
+            self->current = index;
+            update_window (self);
+            active_changed (self);
+        } else {
+            pos = CLAMP (pos, self->window_start, self->window_end - 1);
+        }
+    }
+
+    if (self->idle) {
+        self->idle_position = pos;
+        return;
+    }
+
+    /* Timed the same whichever of the seeks below is made. */
+    self->seek_time = g_get_monotonic_time ();
+    self->seek_target = pos;
+    g_atomic_int_set (&self->active->seek_state, SEEK_SENT);
+
+    /* With seek points the bytes the seek lands on are known exactly. */
+    duration = gst_play_get_duration (self->active->play);
+    if (self->active->uri && find_seek_offset (self, self->active->uri, pos, &offset))
+        wf_readahead_queue_range (wf_readahead_get_default (), self->active->uri,
+                                  offset, SEEK_PREFETCH);
+    else if (self->active->uri && GST_CLOCK_TIME_IS_VALID (duration) && duration > 0)
+        wf_readahead_queue_position (wf_readahead_get_default (), self->active->uri,
+                                     pos / (gdouble) duration);
+
+    if (self->loop_end > self->loop_start) {
+        if (pos >= self->loop_start && pos < self->loop_end) {
+            self->segment_armed = slot_seek (self->active, pos, self->loop_end,
+                                             GST_SEEK_FLAG_SEGMENT | GST_SEEK_FLAG_FLUSH);
+            return;
+        }
+        wf_player_set_loop (self, 0, 0);
+    }
+
+    if (GST_CLOCK_TIME_IS_VALID (self->window_end)) {
+        clear_spectra (self);
+        self->segment_armed = slot_seek (self->active, pos, self->window_end,
+                                         GST_SEEK_FLAG_SEGMENT | GST_SEEK_FLAG_FLUSH);
+        return;
+    }
+
+    clear_spectra (self);
+    gst_play_seek (self->active->play, pos);
+}
+
+/* Loops between @start and @end of the current track; @end <= @start
+ * clears the loop, which then plays on past its end without a gap. */
+
+void
+wf_player_set_loop (WfPlayer *self,
+                    guint64   start,
+                    guint64   end)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+
+    if (end <= start)
+        start = end = 0;
+
+    if (self->loop_start == start && self->loop_end == end)
+        return;
+
+    g_mutex_lock (&self->loop_lock);
+    self->loop_start = start;
+    self->loop_end = end;
+    g_mutex_unlock (&self->loop_lock);
+
+    if (end > start)
+        arm_segment (self);
+    else if (!GST_CLOCK_TIME_IS_VALID (self->window_end))
+        self->segment_armed = FALSE;
+
+    g_signal_emit (self, signals[LOOP_CHANGED], 0);
+}
+
+gboolean
+wf_player_get_loop (WfPlayer *self,
+                    guint64  *start,
+                    guint64  *end)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), FALSE);
+
+    if (start)
+        *start = self->loop_start;
+    if (end)
+        *end = self->loop_end;
+
+    return self->loop_end > self->loop_start;
+}
+
+static gint
+find_cue (WfPlayer    *self,
+          const gchar *name)
+{
+    for (guint i = 0; i < self->cues->len; i++) {
+        if (!g_strcmp0 (g_array_index (self->cues, WfCuePoint, i).name, name))
+            return i;
+    }
+
+    return -1;
+}
+
+void
+wf_player_add_cue (WfPlayer    *self,
+                   const gchar *name,
+                   guint64      position)
+{
+    WfCuePoint cue;
+    gint index;
+
+    g_return_if_fail (WF_IS_PLAYER (self));
+    g_return_if_fail (name != NULL);
+
+    index = find_cue (self, name);
+    if (index >= 0) {
+        g_array_index (self->cues, WfCuePoint, index).position = position;
+    } else {
+        cue.name = g_strdup (name);
+        cue.position = position;
+        g_array_append_val (self->cues, cue);
+    }
+
+    g_signal_emit (self, signals[CUES_CHANGED], 0);
+}
+
+gboolean
+wf_player_remove_cue (WfPlayer    *self,
+                      const gchar *name)
+{
+    gint index;
+
+    g_return_val_if_fail (WF_IS_PLAYER (self), FALSE);
+
+    index = find_cue (self, name);
+    if (index < 0)
+        return FALSE;
+
+    g_array_remove_index (self->cues, index);
+    g_signal_emit (self, signals[CUES_CHANGED], 0);
+
+    return TRUE;
+}
+
+/* Returns the cue points of the current track as an array of WfCuePoint. */
+
+GArray *
+wf_player_get_cues (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), NULL);
+
+    return self->cues;
+}
+
+/* Inside a loop the jump is taken at the end of the current pass, so it is
+ * as seamless as the loop itself; otherwise it is an ordinary seek. */
+
+gboolean
+wf_player_jump_to_cue (WfPlayer    *self,
+                       const gchar *name)
+{
+    guint64 position;
+    gboolean looping;
+    gint index;
+
+    g_return_val_if_fail (WF_IS_PLAYER (self), FALSE);
+
+    index = find_cue (self, name);
+    if (index < 0)
+        return FALSE;
+
+    position = g_array_index (self->cues, WfCuePoint, index).position;
+
+    g_mutex_lock (&self->loop_lock);
+    looping = self->segment_armed && self->loop_end > self->loop_start;
+    if (looping)
+        self->pending_cue = position;
+    g_mutex_unlock (&self->loop_lock);
+
+    if (!looping)
+        wf_player_set_position (self, position);
+
+    return TRUE;
+}
+
+/* Every slot has its own equalizer, so prerolled and fading tracks sound
+ * the same once they become audible. */
+
+static void
+publish_eq (WfPlayer *self)
+{
+    WfPlayerSlot *slot;
+
+    if (self->active)
+        wf_equalizer_set_bands (self->active->equalizer, self->eq_bands, self->eq_n_bands);
+    if (self->fading)
+        wf_equalizer_set_bands (self->fading->equalizer, self->eq_bands, self->eq_n_bands);
+    for (guint i = 0; i < self->pool->len; i++) {
+        slot = g_ptr_array_index (self->pool, i);
+        wf_equalizer_set_bands (slot->equalizer, self->eq_bands, self->eq_n_bands);
+    }
+}
+
+guint
+wf_player_get_eq_n_bands (WfPlayer *self)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), 0);
+
+    return self->eq_n_bands;
+}
+
+gboolean
+wf_player_get_eq_band (WfPlayer *self,
+                       guint     index,
+                       WfEqBand *band)
+{
+    g_return_val_if_fail (WF_IS_PLAYER (self), FALSE);
+    g_return_val_if_fail (band != NULL, FALSE);
+
+    if (index >= self->eq_n_bands)
+        return FALSE;
+
+    *band = self->eq_bands[index];
+    return TRUE;
+}
+
+void
+wf_player_set_eq_band (WfPlayer       *self,
+                       guint           index,
+                       const WfEqBand *band)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+    g_return_if_fail (band != NULL);
+    g_return_if_fail (index < self->eq_n_bands);
+
+    self->eq_bands[index] = *band;
+    publish_eq (self);
+}
+
+/* Replaces the whole curve, e.g. with a preset. The equalizers pick it up
+ * in one piece at their next buffer. */
+
+void
+wf_player_set_eq_bands (WfPlayer       *self,
+                        const WfEqBand *bands,
+                        guint           n_bands)
+{
+    g_return_if_fail (WF_IS_PLAYER (self));
+    g_return_if_fail (bands != NULL || n_bands == 0);
+    g_return_if_fail (n_bands <= WF_EQUALIZER_MAX_BANDS);
+
+    if (n_bands)
+        memcpy (self->eq_bands, bands, n_bands * sizeof (WfEqBand));
+    self->eq_n_bands = n_bands;
+    publish_eq (self);
+}
+
+void
+wf_cue_point_clear (WfCuePoint *self)
+{
+    g_clear_pointer (&self->name, g_free);
+}
+
+/* Returns the spectrum of what is audible now. Queued spectra the output
+ * position has reached are swapped in; ones too far ahead of it are left
+ * over from before a loop wrapped and are dropped. */
+
+const WfSpectra *
+wf_player_get_spectra (WfPlayer *self)
+{
+    WfSpectra *spectra;
+    guint64 pos, time;
+
     g_return_val_if_fail (WF_IS_PLAYER (self), NULL);
 
+    if (!self->active)
+        return self->spectra;
+
+    pos = gst_play_get_position (self->active->play);
+    if (!GST_CLOCK_TIME_IS_VALID (pos))
+        return self->spectra;
+
+    g_mutex_lock (&self->spectra_lock);
+    while (self->spectra_len > 0) {
+        time = self->spectra_times[self->spectra_head];
+        if (time > pos && time <= pos + MAX_SPECTRA_LEAD)
+            break;
+
+        if (time <= pos) {
+            spectra = self->spectra;
+            self->spectra = self->spectra_queue[self->spectra_head];
+            self->spectra_queue[self->spectra_head] = spectra;
+        }
+        self->spectra_head = (self->spectra_head + 1) % SPECTRA_QUEUE;
+        self->spectra_len--;
+    }
+    g_mutex_unlock (&self->spectra_lock);
+
     return self->spectra;
 }
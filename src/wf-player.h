@@ -22,6 +22,8 @@
 #pragma once
 
 #include <glib-object.h>
+
+#include "wf-equalizer.h"
 #include "wf-spectra.h"
 
 G_BEGIN_DECLS
@@ -29,16 +31,107 @@ G_BEGIN_DECLS
 #define WF_TYPE_PLAYER (wf_player_get_type ())
 G_DECLARE_FINAL_TYPE (WfPlayer, wf_player, WF, PLAYER, GObject)
 
+typedef struct
+{
+    gchar *name;
+    guint64 position;
+} WfCuePoint;
+
+void wf_cue_point_clear (WfCuePoint *self);
+
+typedef enum
+{
+    WF_AUDIO_PRIORITY_NORMAL,
+    WF_AUDIO_PRIORITY_ELEVATED,
+    WF_AUDIO_PRIORITY_REALTIME,
+} WfAudioPriority;
+
 WfPlayer *wf_player_new (void);
 
 void wf_player_set_file        (WfPlayer    *self,
                                 const gchar *uri);
-guint64 wf_player_get_duration (WfPlayer *self);
-guint64 wf_player_get_position (WfPlayer *self);
-void    wf_player_set_position (WfPlayer *self,
-                                guint64   pos);
-void    wf_player_play         (WfPlayer *self);
+void wf_player_set_queue       (WfPlayer           *self,
+                                const gchar * const *uris);
+void wf_player_append_queue    (WfPlayer           *self,
+                                const gchar * const *uris);
+void wf_player_next            (WfPlayer *self);
+void wf_player_prev            (WfPlayer *self);
+
+const gchar *wf_player_get_uri            (WfPlayer *self);
+guint        wf_player_get_queue_position (WfPlayer *self);
+gboolean     wf_player_get_window         (WfPlayer *self,
+                                           guint64  *start,
+                                           guint64  *end);
+
+guint64  wf_player_get_duration (WfPlayer *self);
+guint64  wf_player_get_position (WfPlayer *self);
+void     wf_player_set_position (WfPlayer *self,
+                                 guint64   pos);
+void     wf_player_play         (WfPlayer *self);
+void     wf_player_pause        (WfPlayer *self);
+gboolean wf_player_get_playing  (WfPlayer *self);
+
+void     wf_player_set_loop    (WfPlayer *self,
+                                guint64   start,
+                                guint64   end);
+gboolean wf_player_get_loop    (WfPlayer *self,
+                                guint64  *start,
+                                guint64  *end);
+void     wf_player_add_cue     (WfPlayer    *self,
+                                const gchar *name,
+                                guint64      position);
+gboolean wf_player_remove_cue  (WfPlayer    *self,
+                                const gchar *name);
+gboolean wf_player_jump_to_cue (WfPlayer    *self,
+                                const gchar *name);
+GArray  *wf_player_get_cues    (WfPlayer *self);
+
+void    wf_player_set_idle_timeout   (WfPlayer *self,
+                                      guint     idle_timeout);
+guint   wf_player_get_idle_timeout   (WfPlayer *self);
+void    wf_player_set_pool_size      (WfPlayer *self,
+                                      guint     pool_size);
+guint   wf_player_get_pool_size      (WfPlayer *self);
+void    wf_player_set_readahead      (WfPlayer *self,
+                                      guint     readahead);
+guint   wf_player_get_readahead      (WfPlayer *self);
+void    wf_player_set_crossfade      (WfPlayer *self,
+                                      guint     crossfade);
+guint   wf_player_get_crossfade      (WfPlayer *self);
+guint64 wf_player_get_switch_latency (WfPlayer *self);
+guint64 wf_player_get_seek_latency   (WfPlayer *self);
+
+void         wf_player_set_analyze        (WfPlayer    *self,
+                                           gboolean     analyze);
+gboolean     wf_player_get_analyze        (WfPlayer    *self);
+void         wf_player_set_low_latency    (WfPlayer    *self,
+                                           gboolean     low_latency);
+gboolean     wf_player_get_low_latency    (WfPlayer    *self);
+void         wf_player_set_audio_sink     (WfPlayer    *self,
+                                           const gchar *audio_sink);
+const gchar *wf_player_get_audio_sink     (WfPlayer    *self);
+guint64      wf_player_get_output_latency (WfPlayer    *self);
+
+WfAudioPriority wf_player_get_audio_priority (WfPlayer *self);
+guint           wf_player_get_underruns      (WfPlayer *self);
+guint           wf_player_get_late_buffers   (WfPlayer *self);
+guint           wf_player_get_qos_events     (WfPlayer *self);
+
+void    wf_player_set_seek_points    (WfPlayer    *self,
+                                      const gchar *uri,
+                                      GArray      *points);
+
+guint    wf_player_get_eq_n_bands (WfPlayer *self);
+gboolean wf_player_get_eq_band    (WfPlayer *self,
+                                   guint     index,
+                                   WfEqBand *band);
+void     wf_player_set_eq_band    (WfPlayer       *self,
+                                   guint           index,
+                                   const WfEqBand *band);
+void     wf_player_set_eq_bands   (WfPlayer       *self,
+                                   const WfEqBand *bands,
+                                   guint           n_bands);
 
-const WfSpectra *wf_player_get_specta (WfPlayer *self);
+const WfSpectra *wf_player_get_spectra (WfPlayer *self);
 
 G_END_DECLS
@@ -0,0 +1,520 @@
+/*
+ * wf-playlist.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "wf-playlist.h"
+
+/*
+ * Reads M3U, PLS and XSPF playlists on a worker thread, a chunk at a time,
+ * and hands their entries to the main thread in batches as they are
+ * parsed: a small first batch, so that playback can start at once, then
+ * larger ones. Entries are only turned into uris here, which needs no
+ * I/O; whether the files are there is found out by whoever opens them.
+ * Files that are not playlists are passed through in their place.
+ */
+
+#define CHUNK_SIZE   (64 * 1024)
+#define FIRST_BATCH  64
+#define BATCH_SIZE   4096
+
+typedef enum
+{
+    FORMAT_NONE,
+    FORMAT_M3U,
+    FORMAT_PLS,
+    FORMAT_XSPF,
+} Format;
+
+struct _WfPlaylist
+{
+    GObject parent;
+};
+
+typedef struct
+{
+    GFile **files;
+    guint n_files;
+    guint n_entries;
+
+    /* Worker thread only. */
+    GTask *task;
+    GPtrArray *batch;
+    guint n_batches;
+
+    /* The playlist being read. */
+    gchar *base_uri;
+    gchar *base_dir;
+    GString *line;
+    gboolean in_track;
+    gboolean in_location;
+    gboolean have_location;
+} LoadData;
+
+typedef struct
+{
+    WfPlaylist *self;
+    GCancellable *cancellable;
+    GPtrArray *uris;
+} Batch;
+
+enum
+{
+    ENTRIES_ADDED,
+    N_SIGNAL
+};
+
+static guint signals[N_SIGNAL] = {0};
+
+G_DEFINE_FINAL_TYPE (WfPlaylist, wf_playlist, G_TYPE_OBJECT)
+
+static void
+wf_playlist_class_init (WfPlaylistClass *klass)
+{
+    /* Emitted on the thread that started a load, with the uris of the
+     * entries that follow the ones before, in playlist order. */
+    signals[ENTRIES_ADDED] =
+        g_signal_new ("entries-added",
+                      G_TYPE_FROM_CLASS (klass),
+                      G_SIGNAL_RUN_LAST,
+                      0,
+                      NULL, NULL, NULL,
+                      G_TYPE_NONE,
+                      1,
+                      G_TYPE_STRV | G_SIGNAL_TYPE_STATIC_SCOPE);
+}
+
+static void
+wf_playlist_init (WfPlaylist *self)
+{
+}
+
+static void
+load_data_free (LoadData *data)
+{
+    for (guint i = 0; i < data->n_files; i++)
+        g_object_unref (data->files[i]);
+    g_free (data->files);
+    g_ptr_array_unref (data->batch);
+    g_string_free (data->line, TRUE);
+    g_free (data->base_uri);
+    g_free (data->base_dir);
+    g_free (data);
+}
+
+static void
+batch_free (Batch *batch)
+{
+    g_object_unref (batch->self);
+    g_clear_object (&batch->cancellable);
+    g_ptr_array_unref (batch->uris);
+    g_free (batch);
+}
+
+static Format
+get_format (const gchar *name)
+{
+    const gchar *dot;
+
+    dot = strrchr (name, '.');
+    if (!dot || strchr (dot, '/'))
+        return FORMAT_NONE;
+
+    if (!g_ascii_strcasecmp (dot, ".m3u") || !g_ascii_strcasecmp (dot, ".m3u8"))
+        return FORMAT_M3U;
+    if (!g_ascii_strcasecmp (dot, ".pls"))
+        return FORMAT_PLS;
+    if (!g_ascii_strcasecmp (dot, ".xspf"))
+        return FORMAT_XSPF;
+
+    return FORMAT_NONE;
+}
+
+static gboolean
+emit_batch_cb (gpointer user_data)
+{
+    Batch *batch = user_data;
+
+    /* A load that was given up on adds nothing more. */
+    if (!g_cancellable_is_cancelled (batch->cancellable))
+        g_signal_emit (batch->self, signals[ENTRIES_ADDED], 0, batch->uris->pdata);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Batches are idle sources of one priority on one context, so they are
+ * dispatched in order, and before the load completes. */
+static void
+flush_batch (LoadData *data)
+{
+    GCancellable *cancellable;
+    GSource *source;
+    Batch *batch;
+
+    if (data->batch->len == 0)
+        return;
+
+    g_ptr_array_add (data->batch, NULL);
+    cancellable = g_task_get_cancellable (data->task);
+
+    batch = g_new0 (Batch, 1);
+    batch->self = g_object_ref (g_task_get_source_object (data->task));
+    batch->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+    batch->uris = g_steal_pointer (&data->batch);
+    data->batch = g_ptr_array_new_with_free_func (g_free);
+    data->n_batches++;
+
+    source = g_idle_source_new ();
+    g_source_set_priority (source, G_PRIORITY_DEFAULT);
+    g_source_set_callback (source, emit_batch_cb, batch, (GDestroyNotify) batch_free);
+    g_source_attach (source, g_task_get_context (data->task));
+    g_source_unref (source);
+}
+
+static void
+add_entry (LoadData *data,
+           gchar    *uri)
+{
+    g_ptr_array_add (data->batch, uri);
+    data->n_entries++;
+    if (data->batch->len >= (data->n_batches == 0 ? FIRST_BATCH : BATCH_SIZE))
+        flush_batch (data);
+}
+
+/* Turns a location as a playlist gives it into a uri. Uris are kept as
+ * they are and paths are taken relative to the playlist; nothing is
+ * looked up on disk. XSPF locations are relative uri references rather
+ * than paths. */
+static gchar *
+resolve_location (LoadData *data,
+                  gchar    *location,
+                  gboolean  is_uri)
+{
+    const gchar *scheme;
+    gchar *path, *escaped, *uri;
+
+    /* A one letter scheme is a Windows drive. */
+    scheme = g_uri_peek_scheme (location);
+    if (scheme && strlen (scheme) > 1)
+        return g_strdup (location);
+
+    if (is_uri)
+        return g_uri_resolve_relative (data->base_uri, location, G_URI_FLAGS_ENCODED, NULL);
+
+    g_strdelimit (location, "\\", '/');
+    if (data->base_dir || g_path_is_absolute (location)) {
+        path = g_canonicalize_filename (location, data->base_dir);
+        uri = g_filename_to_uri (path, NULL, NULL);
+        g_free (path);
+        return uri;
+    }
+
+    escaped = g_uri_escape_string (location, G_URI_RESERVED_CHARS_ALLOWED_IN_PATH, FALSE);
+    uri = g_uri_resolve_relative (data->base_uri, escaped, G_URI_FLAGS_ENCODED, NULL);
+    g_free (escaped);
+
+    return uri;
+}
+
+/* M3U lines are locations, or comments and extended info after a '#'.
+ * PLS lines of interest are FileN=location. Lines that are not UTF-8 are
+ * taken to be Windows-1252, as in plain .m3u files from older players. */
+static void
+parse_line (LoadData *data,
+            Format    format,
+            gchar    *line)
+{
+    gchar *converted = NULL, *location, *p;
+    gchar *uri;
+
+    if (!g_utf8_validate (line, -1, NULL)) {
+        converted = g_convert (line, -1, "UTF-8", "WINDOWS-1252", NULL, NULL, NULL);
+        if (!converted)
+            return;
+        line = converted;
+    }
+
+    location = g_strstrip (line);
+    if (format == FORMAT_M3U) {
+        if (*location == '#')
+            location = NULL;
+    } else if (!g_ascii_strncasecmp (location, "File", 4)) {
+        p = location + 4;
+        while (g_ascii_isdigit (*p))
+            p++;
+        location = p > location + 4 && *p == '=' ? g_strstrip (p + 1) : NULL;
+    } else {
+        location = NULL;
+    }
+
+    if (location && *location) {
+        uri = resolve_location (data, location, FALSE);
+        if (uri)
+            add_entry (data, uri);
+    }
+
+    g_free (converted);
+}
+
+static void
+parse_lines (LoadData    *data,
+             Format       format,
+             const gchar *chunk,
+             gsize        length)
+{
+    const gchar *end = chunk + length;
+    const gchar *newline;
+
+    while (chunk < end) {
+        newline = memchr (chunk, '\n', end - chunk);
+        if (!newline) {
+            g_string_append_len (data->line, chunk, end - chunk);
+            break;
+        }
+
+        g_string_append_len (data->line, chunk, newline - chunk);
+        parse_line (data, format, data->line->str);
+        g_string_truncate (data->line, 0);
+        chunk = newline + 1;
+    }
+}
+
+/* XSPF: the first location of each track. */
+
+static void
+start_element (GMarkupParseContext  *context,
+               const gchar          *element_name,
+               const gchar         **attribute_names,
+               const gchar         **attribute_values,
+               gpointer              user_data,
+               GError              **error)
+{
+    LoadData *data = user_data;
+
+    if (!strcmp (element_name, "track")) {
+        data->in_track = TRUE;
+        data->have_location = FALSE;
+    } else if (!strcmp (element_name, "location") && data->in_track && !data->have_location) {
+        data->in_location = TRUE;
+        g_string_truncate (data->line, 0);
+    }
+}
+
+static void
+end_element (GMarkupParseContext  *context,
+             const gchar          *element_name,
+             gpointer              user_data,
+             GError              **error)
+{
+    LoadData *data = user_data;
+    gchar *location, *uri;
+
+    if (!strcmp (element_name, "location") && data->in_location) {
+        data->in_location = FALSE;
+        data->have_location = TRUE;
+        location = g_strstrip (data->line->str);
+        uri = *location ? resolve_location (data, location, TRUE) : NULL;
+        if (uri)
+            add_entry (data, uri);
+    } else if (!strcmp (element_name, "track")) {
+        data->in_track = FALSE;
+    }
+}
+
+static void
+element_text (GMarkupParseContext  *context,
+              const gchar          *text,
+              gsize                 text_len,
+              gpointer              user_data,
+              GError              **error)
+{
+    LoadData *data = user_data;
+
+    if (data->in_location)
+        g_string_append_len (data->line, text, text_len);
+}
+
+static const GMarkupParser xspf_parser = {start_element, end_element, element_text, NULL, NULL};
+
+static gboolean
+read_playlist (LoadData      *data,
+               GFile         *file,
+               Format         format,
+               GCancellable  *cancellable,
+               GError       **error)
+{
+    GMarkupParseContext *markup = NULL;
+    GFileInputStream *stream;
+    GFile *parent;
+    gchar *buffer;
+    gssize n_read;
+    gsize skip;
+    gboolean first = TRUE;
+    gboolean ok = TRUE;
+
+    stream = g_file_read (file, cancellable, error);
+    if (!stream)
+        return FALSE;
+
+    data->base_uri = g_file_get_uri (file);
+    parent = g_file_get_parent (file);
+    data->base_dir = parent ? g_file_get_path (parent) : NULL;
+    g_clear_object (&parent);
+    g_string_truncate (data->line, 0);
+    data->in_track = data->in_location = FALSE;
+    if (format == FORMAT_XSPF)
+        markup = g_markup_parse_context_new (&xspf_parser, 0, data, NULL);
+
+    buffer = g_malloc (CHUNK_SIZE);
+    for (;;) {
+        n_read = g_input_stream_read (G_INPUT_STREAM (stream), buffer, CHUNK_SIZE,
+                                      cancellable, error);
+        if (n_read <= 0) {
+            ok = n_read == 0;
+            break;
+        }
+
+        skip = first && n_read >= 3 && memcmp (buffer, "\xef\xbb\xbf", 3) == 0 ? 3 : 0;
+        first = FALSE;
+        if (markup) {
+            ok = g_markup_parse_context_parse (markup, buffer + skip, n_read - skip, error);
+            if (!ok)
+                break;
+        } else {
+            parse_lines (data, format, buffer + skip, n_read - skip);
+        }
+    }
+
+    if (ok && markup)
+        ok = g_markup_parse_context_end_parse (markup, error);
+    else if (ok && data->line->len > 0)
+        parse_line (data, format, data->line->str);
+
+    g_free (buffer);
+    g_clear_pointer (&markup, g_markup_parse_context_free);
+    g_clear_pointer (&data->base_uri, g_free);
+    g_clear_pointer (&data->base_dir, g_free);
+    g_object_unref (stream);
+
+    return ok;
+}
+
+static void
+load_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+    LoadData *data = task_data;
+    GError *error = NULL;
+    Format format;
+    gchar *name;
+
+    data->task = task;
+    for (guint i = 0; i < data->n_files && !g_cancellable_is_cancelled (cancellable); i++) {
+        name = g_file_get_basename (data->files[i]);
+        format = name ? get_format (name) : FORMAT_NONE;
+        g_free (name);
+
+        if (format == FORMAT_NONE) {
+            add_entry (data, g_file_get_uri (data->files[i]));
+            continue;
+        }
+
+        /* The rest still loads if one playlist cannot be read. */
+        read_playlist (data, data->files[i], format, cancellable, error ? NULL : &error);
+    }
+    flush_batch (data);
+    data->task = NULL;
+
+    if (!error)
+        g_cancellable_set_error_if_cancelled (cancellable, &error);
+    if (error)
+        g_task_return_error (task, error);
+    else
+        g_task_return_boolean (task, TRUE);
+}
+
+WfPlaylist *
+wf_playlist_new (void)
+{
+    return g_object_new (WF_TYPE_PLAYLIST, NULL);
+}
+
+/* Loads @files in order, expanding the playlists among them; the entries
+ * come with WfPlaylist::entries-added as they are read. */
+void
+wf_playlist_load_async (WfPlaylist           *self,
+                        GFile               **files,
+                        guint                 n_files,
+                        GCancellable         *cancellable,
+                        GAsyncReadyCallback   callback,
+                        gpointer              user_data)
+{
+    LoadData *data;
+    GTask *task;
+
+    g_return_if_fail (WF_IS_PLAYLIST (self));
+    g_return_if_fail (files != NULL || n_files == 0);
+
+    data = g_new0 (LoadData, 1);
+    data->files = g_new (GFile *, n_files);
+    for (guint i = 0; i < n_files; i++)
+        data->files[i] = g_object_ref (files[i]);
+    data->n_files = n_files;
+    data->batch = g_ptr_array_new_with_free_func (g_free);
+    data->line = g_string_new (NULL);
+
+    task = g_task_new (self, cancellable, callback, user_data);
+    g_task_set_source_tag (task, wf_playlist_load_async);
+    g_task_set_task_data (task, data, (GDestroyNotify) load_data_free);
+    g_task_run_in_thread (task, load_thread);
+    g_object_unref (task);
+}
+
+/* Returns the number of entries the load added. @error is set if it was
+ * cancelled or a playlist could not be read, though the entries that
+ * could be read are added all the same. */
+guint
+wf_playlist_load_finish (WfPlaylist    *self,
+                         GAsyncResult  *result,
+                         GError       **error)
+{
+    LoadData *data;
+
+    g_return_val_if_fail (g_task_is_valid (result, self), 0);
+
+    data = g_task_get_task_data (G_TASK (result));
+    g_task_propagate_boolean (G_TASK (result), error);
+
+    return data->n_entries;
+}
+
+/* Whether @name, a file name, path or uri, is that of a playlist. */
+gboolean
+wf_playlist_is_playlist (const gchar *name)
+{
+    g_return_val_if_fail (name != NULL, FALSE);
+
+    return get_format (name) != FORMAT_NONE;
+}
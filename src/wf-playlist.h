@@ -0,0 +1,44 @@
+/*
+ * wf-playlist.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define WF_TYPE_PLAYLIST (wf_playlist_get_type ())
+G_DECLARE_FINAL_TYPE (WfPlaylist, wf_playlist, WF, PLAYLIST, GObject)
+
+WfPlaylist *wf_playlist_new         (void);
+void        wf_playlist_load_async  (WfPlaylist           *self,
+                                     GFile               **files,
+                                     guint                 n_files,
+                                     GCancellable         *cancellable,
+                                     GAsyncReadyCallback   callback,
+                                     gpointer              user_data);
+guint       wf_playlist_load_finish (WfPlaylist    *self,
+                                     GAsyncResult  *result,
+                                     GError       **error);
+
+gboolean    wf_playlist_is_playlist (const gchar *name);
+
+G_END_DECLS
@@ -0,0 +1,285 @@
+/*
+ * wf-readahead.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#define _GNU_SOURCE
+
+#include "config.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+#include "wf-readahead.h"
+
+/*
+ * Pulls upcoming files into the page cache from a small thread pool, so
+ * that the pipelines reading them later do not stall on disk or network
+ * I/O. Only local paths (including network mounts) are handled.
+ *
+ * A request that is already waiting in the queue is not queued twice.
+ * Requests are told apart by uri and range, so a seek window never stands
+ * in for the whole file or the other way round.
+ */
+
+#define MAX_JOBS       2
+#define SEEK_WINDOW    (2 * 1024 * 1024)
+#define PRIORITY_SEEK  0
+#define PRIORITY_FILE  1
+
+struct _WfReadahead
+{
+    GObject parent;
+
+    GThreadPool *pool;
+
+    /* Keys of the jobs waiting in the pool. */
+    GMutex lock;
+    GHashTable *pending;
+};
+
+typedef struct
+{
+    gchar *key;
+    gchar *uri;
+    guint64 offset;
+    guint64 length;
+    gdouble fraction;
+    gint priority;
+} WfReadaheadJob;
+
+static void dispose  (GObject *object);
+static void finalize (GObject *object);
+
+static void run_job  (gpointer data,
+                      gpointer user_data);
+static void job_free (WfReadaheadJob *job);
+
+G_DEFINE_FINAL_TYPE (WfReadahead, wf_readahead, G_TYPE_OBJECT)
+
+static void
+wf_readahead_class_init (WfReadaheadClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->dispose = dispose;
+    object_class->finalize = finalize;
+}
+
+static void
+job_free (WfReadaheadJob *job)
+{
+    g_free (job->key);
+    g_free (job->uri);
+    g_free (job);
+}
+
+static gint
+compare_jobs (gconstpointer a,
+              gconstpointer b,
+              gpointer      user_data)
+{
+    const WfReadaheadJob *job_a = a;
+    const WfReadaheadJob *job_b = b;
+
+    return job_a->priority - job_b->priority;
+}
+
+static void
+wf_readahead_init (WfReadahead *self)
+{
+    g_mutex_init (&self->lock);
+    self->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    self->pool = g_thread_pool_new_full (run_job, self, (GDestroyNotify) job_free,
+                                         MAX_JOBS, FALSE, NULL);
+    g_thread_pool_set_sort_function (self->pool, compare_jobs, NULL);
+}
+
+static void
+dispose (GObject *object)
+{
+    WfReadahead *readahead = WF_READAHEAD (object);
+
+    if (readahead->pool) {
+        g_thread_pool_free (readahead->pool, TRUE, TRUE);
+        readahead->pool = NULL;
+    }
+
+    G_OBJECT_CLASS (wf_readahead_parent_class)->dispose (object);
+}
+
+static void
+finalize (GObject *object)
+{
+    WfReadahead *readahead = WF_READAHEAD (object);
+
+    g_hash_table_unref (readahead->pending);
+    g_mutex_clear (&readahead->lock);
+    G_OBJECT_CLASS (wf_readahead_parent_class)->finalize (object);
+}
+
+static void
+run_job (gpointer data,
+         gpointer user_data)
+{
+    WfReadahead *self = user_data;
+    WfReadaheadJob *job = data;
+    gchar *path;
+    GStatBuf st;
+    guint64 offset, length;
+    gint fd;
+
+    g_mutex_lock (&self->lock);
+    g_hash_table_remove (self->pending, job->key);
+    g_mutex_unlock (&self->lock);
+
+    path = g_filename_from_uri (job->uri, NULL, NULL);
+    if (!path)
+        goto out;
+
+    fd = g_open (path, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0)
+        goto out;
+
+    if (fstat (fd, &st) < 0 || !S_ISREG (st.st_mode) || st.st_size == 0) {
+        g_close (fd, NULL);
+        goto out;
+    }
+
+    if (job->fraction >= 0.0) {
+        offset = CLAMP (job->fraction, 0.0, 1.0) * st.st_size;
+        offset = offset > SEEK_WINDOW / 4 ? offset - SEEK_WINDOW / 4 : 0;
+    } else {
+        offset = job->offset;
+    }
+
+    if (offset >= (guint64) st.st_size) {
+        g_close (fd, NULL);
+        goto out;
+    }
+
+    length = job->length ? job->length : (guint64) st.st_size;
+    length = MIN (length, (guint64) st.st_size - offset);
+
+#if defined(HAVE_READAHEAD)
+    /* Blocks until the range is cached, which keeps MAX_JOBS meaningful. */
+    if (readahead (fd, offset, length) < 0)
+        g_debug ("readahead failed for %s", path);
+#elif defined(HAVE_POSIX_FADVISE)
+    posix_fadvise (fd, offset, length, POSIX_FADV_WILLNEED);
+#endif
+
+    g_close (fd, NULL);
+
+out:
+    g_free (path);
+    job_free (job);
+}
+
+static void
+push_job (WfReadahead *self,
+          const gchar *uri,
+          guint64      offset,
+          guint64      length,
+          gdouble      fraction,
+          gint         priority)
+{
+    WfReadaheadJob *job;
+    gchar *key;
+    gboolean queued;
+
+    if (!g_str_has_prefix (uri, "file:"))
+        return;
+
+    /* A position is a range too, but one known only once the file is
+     * opened. */
+    if (fraction >= 0.0)
+        key = g_strdup_printf ("%s @%g", uri, fraction);
+    else
+        key = g_strdup_printf ("%s %" G_GUINT64_FORMAT "+%" G_GUINT64_FORMAT, uri, offset, length);
+
+    g_mutex_lock (&self->lock);
+    queued = !g_hash_table_add (self->pending, g_strdup (key));
+    g_mutex_unlock (&self->lock);
+
+    if (queued) {
+        g_free (key);
+        return;
+    }
+
+    job = g_new0 (WfReadaheadJob, 1);
+    job->key = key;
+    job->uri = g_strdup (uri);
+    job->offset = offset;
+    job->length = length;
+    job->fraction = fraction;
+    job->priority = priority;
+
+    g_thread_pool_push (self->pool, job, NULL);
+}
+
+WfReadahead *
+wf_readahead_get_default (void)
+{
+    static WfReadahead *readahead = NULL;
+
+    if (g_once_init_enter (&readahead))
+        g_once_init_leave (&readahead, g_object_new (WF_TYPE_READAHEAD, NULL));
+
+    return readahead;
+}
+
+/* Queues the first @length bytes of @uri, or all of it for 0. */
+void
+wf_readahead_queue_file (WfReadahead *self,
+                         const gchar *uri,
+                         guint64      length)
+{
+    g_return_if_fail (WF_IS_READAHEAD (self));
+    g_return_if_fail (uri != NULL);
+
+    push_job (self, uri, 0, length, -1.0, PRIORITY_FILE);
+}
+
+void
+wf_readahead_queue_range (WfReadahead *self,
+                          const gchar *uri,
+                          guint64      offset,
+                          guint64      length)
+{
+    g_return_if_fail (WF_IS_READAHEAD (self));
+    g_return_if_fail (uri != NULL);
+
+    push_job (self, uri, offset, length, -1.0, PRIORITY_SEEK);
+}
+
+/* Queues a window around the byte offset @fraction of the duration maps to,
+ * assuming a roughly constant bitrate. Seeks jump ahead of queued files. */
+void
+wf_readahead_queue_position (WfReadahead *self,
+                             const gchar *uri,
+                             gdouble      fraction)
+{
+    g_return_if_fail (WF_IS_READAHEAD (self));
+    g_return_if_fail (uri != NULL);
+
+    push_job (self, uri, 0, SEEK_WINDOW, MAX (fraction, 0.0), PRIORITY_SEEK);
+}
@@ -0,0 +1,44 @@
+/*
+ * wf-readahead.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define WF_TYPE_READAHEAD (wf_readahead_get_type ())
+G_DECLARE_FINAL_TYPE (WfReadahead, wf_readahead, WF, READAHEAD, GObject)
+
+WfReadahead *wf_readahead_get_default   (void);
+
+void         wf_readahead_queue_file     (WfReadahead *self,
+                                          const gchar *uri,
+                                          guint64      length);
+void         wf_readahead_queue_range    (WfReadahead *self,
+                                          const gchar *uri,
+                                          guint64      offset,
+                                          guint64      length);
+void         wf_readahead_queue_position (WfReadahead *self,
+                                          const gchar *uri,
+                                          gdouble      fraction);
+
+G_END_DECLS
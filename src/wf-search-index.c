@@ -0,0 +1,590 @@
+/*
+ * wf-search-index.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "wf-search-index.h"
+
+/*
+ * For every three-byte sequence of the case-folded text, the tracks that
+ * contain it, as delta-coded varints. The lists hold the order tracks
+ * were added in rather than their index in the store, so they only ever
+ * grow by appending. A track whose tags change keeps its old entries and
+ * is marked stale: stale tracks are candidates for every query, and every
+ * candidate is matched against the text itself.
+ *
+ * Removing tracks from the store leaves their entries in place with a
+ * tombstone, and renumbers the rest in the table from added order to
+ * index. The store keeps the order of the tracks it retains, so indices
+ * stay sorted in added order.
+ *
+ * The directories of a path mostly repeat the artist and album, so only
+ * the file name is indexed.
+ */
+
+#define MAX_STALE     4096
+#define MAX_INTERSECT 3
+
+/* In the table from added order to index, for a removed track. */
+#define TOMBSTONE G_MAXUINT32
+
+#define TRIGRAM(p) (((guint32) (guint8) (p)[0] << 16) | \
+                    ((guint32) (guint8) (p)[1] << 8) | \
+                    (guint32) (guint8) (p)[2])
+
+typedef struct
+{
+    guint8 *data;
+    guint32 size;
+    guint32 alloc;
+    guint32 count;
+    guint32 last;
+} Posting;
+
+typedef struct
+{
+    const guint8 *p;
+    const guint8 *end;
+    guint32 value;
+    gboolean started;
+} Cursor;
+
+struct _WfSearchIndex
+{
+    gint ref_count;
+    guint n_added;
+    guint n_removed;
+
+    /* Added order by index in the store, index by added order or
+     * TOMBSTONE, and the uri hash by added order. */
+    GArray *added;
+    GArray *indices;
+    GArray *hashes;
+
+    GHashTable *postings;
+    GArray *stale;
+    GArray *scratch;
+};
+
+static void
+posting_free (Posting *posting)
+{
+    g_free (posting->data);
+    g_free (posting);
+}
+
+static void
+posting_append (Posting *posting,
+                guint32  index)
+{
+    guint32 delta = posting->count ? index - posting->last : index;
+
+    if (posting->size + 5 > posting->alloc) {
+        posting->alloc = MAX (8, posting->alloc * 2);
+        posting->data = g_realloc (posting->data, posting->alloc);
+    }
+
+    while (delta >= 0x80) {
+        posting->data[posting->size++] = (delta & 0x7f) | 0x80;
+        delta >>= 7;
+    }
+    posting->data[posting->size++] = delta;
+
+    posting->last = index;
+    posting->count++;
+}
+
+static void
+cursor_init (Cursor        *cursor,
+             const Posting *posting)
+{
+    cursor->p = posting->data;
+    cursor->end = posting->data + posting->size;
+    cursor->value = 0;
+    cursor->started = FALSE;
+}
+
+static gboolean
+cursor_next (Cursor  *cursor,
+             guint32 *index)
+{
+    guint32 delta = 0;
+    guint shift = 0;
+
+    if (cursor->p >= cursor->end)
+        return FALSE;
+
+    do {
+        delta |= (guint32) (*cursor->p & 0x7f) << shift;
+        shift += 7;
+    } while (*cursor->p++ & 0x80);
+
+    cursor->value = cursor->started ? cursor->value + delta : delta;
+    cursor->started = TRUE;
+    *index = cursor->value;
+
+    return TRUE;
+}
+
+static gint
+compare_uint32 (gconstpointer a,
+                gconstpointer b)
+{
+    guint32 value_a = *(const guint32 *) a;
+    guint32 value_b = *(const guint32 *) b;
+
+    return (value_a > value_b) - (value_a < value_b);
+}
+
+static gint
+compare_count (gconstpointer a,
+               gconstpointer b)
+{
+    const Posting *posting_a = *(Posting * const *) a;
+    const Posting *posting_b = *(Posting * const *) b;
+
+    return (posting_a->count > posting_b->count) - (posting_a->count < posting_b->count);
+}
+
+/* Sorts the trigrams and drops repeats. */
+static void
+sort_unique (GArray *trigrams)
+{
+    guint32 *values = (guint32 *) trigrams->data;
+    guint n = 0;
+
+    if (trigrams->len == 0)
+        return;
+
+    qsort (values, trigrams->len, sizeof (guint32), compare_uint32);
+    for (guint i = 0; i < trigrams->len; i++) {
+        if (n == 0 || values[i] != values[n - 1])
+            values[n++] = values[i];
+    }
+    g_array_set_size (trigrams, n);
+}
+
+static void
+collect_trigrams (GArray      *trigrams,
+                  const gchar *text)
+{
+    gchar *folded;
+    guint32 trigram;
+    gsize len;
+
+    if (!text || *text == '\0')
+        return;
+
+    folded = g_utf8_casefold (text, -1);
+    len = strlen (folded);
+    for (gsize i = 0; i + 3 <= len; i++) {
+        trigram = TRIGRAM (folded + i);
+        g_array_append_val (trigrams, trigram);
+    }
+    g_free (folded);
+}
+
+static gchar *
+file_name (const gchar *uri)
+{
+    const gchar *name;
+    gchar *unescaped;
+
+    name = strrchr (uri, '/');
+    name = name ? name + 1 : uri;
+    unescaped = g_uri_unescape_string (name, NULL);
+
+    return unescaped ? unescaped : g_strdup (name);
+}
+
+WfSearchIndex *
+wf_search_index_new (void)
+{
+    WfSearchIndex *self;
+
+    self = g_new0 (WfSearchIndex, 1);
+    self->ref_count = 1;
+    self->postings = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) posting_free);
+    self->added = g_array_new (FALSE, FALSE, sizeof (guint32));
+    self->indices = g_array_new (FALSE, FALSE, sizeof (guint32));
+    self->hashes = g_array_new (FALSE, FALSE, sizeof (guint32));
+    self->stale = g_array_new (FALSE, FALSE, sizeof (guint32));
+    self->scratch = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+    return self;
+}
+
+/* Indexes all of @snapshot; slow for a large library, so meant for a
+ * worker thread. */
+WfSearchIndex *
+wf_search_index_new_from_snapshot (WfTrackSnapshot *snapshot)
+{
+    WfSearchIndex *self;
+    GHashTableIter iter;
+    Posting *posting;
+    WfTrack track;
+    guint n_tracks;
+
+    g_return_val_if_fail (snapshot != NULL, NULL);
+
+    self = wf_search_index_new ();
+    n_tracks = wf_track_snapshot_get_n_tracks (snapshot);
+    for (guint i = 0; i < n_tracks; i++) {
+        wf_track_snapshot_get_track (snapshot, i, &track);
+        wf_search_index_add (self, &track);
+    }
+
+    /* Lists of common trigrams were doubled well past their size. */
+    g_hash_table_iter_init (&iter, self->postings);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &posting)) {
+        posting->alloc = posting->size;
+        posting->data = g_realloc (posting->data, posting->alloc);
+    }
+
+    return self;
+}
+
+WfSearchIndex *
+wf_search_index_ref (WfSearchIndex *self)
+{
+    g_return_val_if_fail (self != NULL, NULL);
+
+    g_atomic_int_inc (&self->ref_count);
+
+    return self;
+}
+
+void
+wf_search_index_unref (WfSearchIndex *self)
+{
+    g_return_if_fail (self != NULL);
+
+    if (!g_atomic_int_dec_and_test (&self->ref_count))
+        return;
+
+    g_hash_table_unref (self->postings);
+    g_array_unref (self->added);
+    g_array_unref (self->indices);
+    g_array_unref (self->hashes);
+    g_array_unref (self->stale);
+    g_array_unref (self->scratch);
+    g_free (self);
+}
+
+guint
+wf_search_index_get_n_tracks (WfSearchIndex *self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return self->added->len;
+}
+
+/* Adds @track as the next index of the store. */
+void
+wf_search_index_add (WfSearchIndex *self,
+                     const WfTrack *track)
+{
+    const guint32 *trigrams;
+    Posting *posting;
+    guint32 index, position, hash;
+    gchar *name;
+
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (track != NULL);
+
+    index = self->n_added++;
+    position = self->added->len;
+    hash = g_str_hash (track->uri);
+    g_array_append_val (self->added, index);
+    g_array_append_val (self->indices, position);
+    g_array_append_val (self->hashes, hash);
+
+    g_array_set_size (self->scratch, 0);
+    collect_trigrams (self->scratch, track->title);
+    collect_trigrams (self->scratch, track->artist);
+    collect_trigrams (self->scratch, track->album);
+    name = file_name (track->uri);
+    collect_trigrams (self->scratch, name);
+    g_free (name);
+    sort_unique (self->scratch);
+
+    trigrams = (const guint32 *) self->scratch->data;
+    for (guint i = 0; i < self->scratch->len; i++) {
+        posting = g_hash_table_lookup (self->postings, GUINT_TO_POINTER (trigrams[i]));
+        if (!posting) {
+            posting = g_new0 (Posting, 1);
+            g_hash_table_insert (self->postings, GUINT_TO_POINTER (trigrams[i]), posting);
+        }
+        posting_append (posting, index);
+    }
+}
+
+/* Marks the track at @index as changed since it was added. Returns FALSE
+ * once so many are that the index is better built again. */
+gboolean
+wf_search_index_invalidate (WfSearchIndex *self,
+                            guint          index)
+{
+    guint32 value;
+    guint lo = 0, hi;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+
+    if (index >= self->added->len)
+        return TRUE;
+
+    value = g_array_index (self->added, guint32, index);
+
+    hi = self->stale->len;
+    while (lo < hi) {
+        guint mid = (lo + hi) / 2;
+
+        if (g_array_index (self->stale, guint32, mid) < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == self->stale->len || g_array_index (self->stale, guint32, lo) != value)
+        g_array_insert_val (self->stale, lo, value);
+
+    return self->stale->len <= MAX_STALE;
+}
+
+/* Follows a change to @store that replaced the @removed tracks from
+ * @position with the @added now there, which must be the ones it kept of
+ * them in the same order, as wf_track_store_retain() leaves them. They
+ * are told apart by the hash of their uri. Tracks past those the index
+ * has seen are left for wf_search_index_add().
+ *
+ * Returns FALSE if the tracks now there are not the ones kept, or once so
+ * many tracks are gone that the index is better built again. */
+gboolean
+wf_search_index_remove (WfSearchIndex *self,
+                        WfTrackStore  *store,
+                        guint          position,
+                        guint          removed,
+                        guint          added)
+{
+    guint32 *order, *indices;
+    guint n_tracks, covered, kept = 0;
+    guint32 hash;
+
+    g_return_val_if_fail (self != NULL, FALSE);
+    g_return_val_if_fail (WF_IS_TRACK_STORE (store), FALSE);
+
+    n_tracks = self->added->len;
+    if (position >= n_tracks)
+        return TRUE;
+    if (added > removed)
+        return FALSE;
+
+    order = (guint32 *) self->added->data;
+    indices = (guint32 *) self->indices->data;
+    covered = MIN (position + removed, n_tracks) - position;
+
+    /* Moves each kept track down to the next place among the new ones. */
+    hash = added > 0 ? g_str_hash (wf_track_store_get_uri (store, position)) : 0;
+    for (guint i = 0; i < covered; i++) {
+        if (kept < added && hash == g_array_index (self->hashes, guint32, order[position + i])) {
+            order[position + kept++] = order[position + i];
+            if (kept < added)
+                hash = g_str_hash (wf_track_store_get_uri (store, position + kept));
+        } else {
+            indices[order[position + i]] = TOMBSTONE;
+            self->n_removed++;
+        }
+    }
+
+    /* The new tracks past the kept ones were never seen, or were not
+     * kept at all. */
+    if (position + removed <= n_tracks && kept < added)
+        return FALSE;
+
+    if (position + removed <= n_tracks)
+        g_array_remove_range (self->added, position + kept, removed - added);
+    else
+        g_array_set_size (self->added, position + kept);
+
+    order = (guint32 *) self->added->data;
+    for (guint i = position; i < self->added->len; i++)
+        indices[order[i]] = i;
+
+    return self->n_removed <= MAX (self->added->len, MAX_STALE);
+}
+
+static void
+intersect (GArray        *result,
+           const Posting *posting)
+{
+    guint32 *values = (guint32 *) result->data;
+    guint32 index;
+    guint i = 0, n = 0;
+    Cursor cursor;
+
+    cursor_init (&cursor, posting);
+    while (i < result->len && cursor_next (&cursor, &index)) {
+        while (i < result->len && values[i] < index)
+            i++;
+        if (i < result->len && values[i] == index)
+            values[n++] = values[i++];
+    }
+    g_array_set_size (result, n);
+}
+
+static GArray *
+merge (GArray *a,
+       GArray *b)
+{
+    const guint32 *values_a = (const guint32 *) a->data;
+    const guint32 *values_b = (const guint32 *) b->data;
+    GArray *result;
+    guint i = 0, j = 0;
+    guint32 value;
+
+    result = g_array_sized_new (FALSE, FALSE, sizeof (guint32), a->len + b->len);
+    while (i < a->len || j < b->len) {
+        if (j == b->len || (i < a->len && values_a[i] < values_b[j])) {
+            value = values_a[i++];
+        } else if (i == a->len || values_b[j] < values_a[i]) {
+            value = values_b[j++];
+        } else {
+            value = values_a[i++];
+            j++;
+        }
+        g_array_append_val (result, value);
+    }
+
+    return result;
+}
+
+/* Returns the sorted indices of the tracks that may contain @query, a
+ * case-folded string, or NULL if it is too short to narrow them down.
+ * Tracks added to the store after the index are not among them. */
+GArray *
+wf_search_index_query (WfSearchIndex *self,
+                       const gchar   *query)
+{
+    GArray *trigrams, *result, *merged;
+    Posting **lists;
+    Posting *posting;
+    guint32 index;
+    guint n_lists = 0, n = 0;
+    Cursor cursor;
+
+    g_return_val_if_fail (self != NULL, NULL);
+    g_return_val_if_fail (query != NULL, NULL);
+
+    if (strlen (query) < 3)
+        return NULL;
+
+    trigrams = g_array_new (FALSE, FALSE, sizeof (guint32));
+    collect_trigrams (trigrams, query);
+    sort_unique (trigrams);
+
+    lists = g_new (Posting *, trigrams->len);
+    for (guint i = 0; i < trigrams->len; i++) {
+        posting = g_hash_table_lookup (self->postings,
+                                       GUINT_TO_POINTER (g_array_index (trigrams, guint32, i)));
+        if (!posting) {
+            n_lists = 0;
+            break;
+        }
+        lists[n_lists++] = posting;
+    }
+
+    /* Starting from the rarest trigram, a few lists narrow it down about
+     * as far as all of them would. */
+    if (n_lists > 0) {
+        qsort (lists, n_lists, sizeof (Posting *), compare_count);
+        result = g_array_sized_new (FALSE, FALSE, sizeof (guint32), lists[0]->count);
+        cursor_init (&cursor, lists[0]);
+        while (cursor_next (&cursor, &index))
+            g_array_append_val (result, index);
+
+        for (guint i = 1; i < MIN (n_lists, MAX_INTERSECT) && result->len > 0; i++)
+            intersect (result, lists[i]);
+    } else {
+        result = g_array_new (FALSE, FALSE, sizeof (guint32));
+    }
+
+    if (self->stale->len > 0) {
+        merged = merge (result, self->stale);
+        g_array_unref (result);
+        result = merged;
+    }
+
+    /* From added order to index, in place, leaving removed tracks out. */
+    for (guint i = 0; i < result->len; i++) {
+        index = g_array_index (self->indices, guint32, g_array_index (result, guint32, i));
+        if (index != TOMBSTONE)
+            g_array_index (result, guint32, n++) = index;
+    }
+    g_array_set_size (result, n);
+
+    g_free (lists);
+    g_array_unref (trigrams);
+
+    return result;
+}
+
+static gboolean
+contains (const gchar *str,
+          const gchar *query)
+{
+    gchar *folded;
+    gboolean found;
+
+    if (*str == '\0')
+        return FALSE;
+
+    folded = g_utf8_casefold (str, -1);
+    found = strstr (folded, query) != NULL;
+    g_free (folded);
+
+    return found;
+}
+
+/* Whether @track matches the case-folded @query, as the candidates of
+ * wf_search_index_query() are checked. */
+gboolean
+wf_search_index_match (const WfTrack *track,
+                       const gchar   *query)
+{
+    gboolean found;
+    gchar *name;
+
+    g_return_val_if_fail (track != NULL, FALSE);
+    g_return_val_if_fail (query != NULL, FALSE);
+
+    if (contains (track->title, query) ||
+        contains (track->artist, query) ||
+        contains (track->album, query))
+        return TRUE;
+
+    name = file_name (track->uri);
+    found = contains (name, query);
+    g_free (name);
+
+    return found;
+}
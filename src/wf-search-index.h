@@ -0,0 +1,55 @@
+/*
+ * wf-search-index.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+#include "wf-track-store.h"
+
+G_BEGIN_DECLS
+
+/* A trigram index over the title, artist, album and file name of each
+ * track, for finding candidates for a substring search. */
+typedef struct _WfSearchIndex WfSearchIndex;
+
+WfSearchIndex *wf_search_index_new               (void);
+WfSearchIndex *wf_search_index_new_from_snapshot (WfTrackSnapshot *snapshot);
+WfSearchIndex *wf_search_index_ref               (WfSearchIndex *self);
+void           wf_search_index_unref             (WfSearchIndex *self);
+
+guint          wf_search_index_get_n_tracks      (WfSearchIndex *self);
+void           wf_search_index_add               (WfSearchIndex *self,
+                                                  const WfTrack *track);
+gboolean       wf_search_index_invalidate        (WfSearchIndex *self,
+                                                  guint          index);
+gboolean       wf_search_index_remove            (WfSearchIndex *self,
+                                                  WfTrackStore  *store,
+                                                  guint          position,
+                                                  guint          removed,
+                                                  guint          added);
+GArray        *wf_search_index_query             (WfSearchIndex *self,
+                                                  const gchar   *query);
+
+gboolean       wf_search_index_match             (const WfTrack *track,
+                                                  const gchar   *query);
+
+G_END_DECLS
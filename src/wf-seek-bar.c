@@ -19,15 +19,36 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include "config.h"
+
+#include <math.h>
+
 #include "wf-seek-bar.h"
+#include "wf-trace.h"
 #include "wf-waveform.h"
 
+#define MARKER_WIDTH 2.0
+#define MARKER_GRAB  6.0
+
+typedef enum
+{
+    DRAG_SEEK,
+    DRAG_LOOP_START,
+    DRAG_LOOP_END,
+    DRAG_LOOP_NEW,
+} DragMode;
+
 struct _WfSeekBar
 {
     GtkWidget parent;
 
     guint64 duration;
     guint64 position;
+    guint64 loop_start;
+    guint64 loop_end;
+    guint64 window_start;
+    guint64 window_end;
+    gboolean show_window;
 
     GArray *peaks;
     GArray *bars;
@@ -36,6 +57,8 @@ struct _WfSeekBar
     gdouble bar_spacing;
     gdouble cursor_x;
     gdouble drag_x;
+    gdouble drag_origin;
+    DragMode drag_mode;
 
     AdwStyleManager *style_manager;
     GdkRGBA *hover_color;
@@ -47,12 +70,18 @@ enum
     PROP_PEAKS,
     PROP_POSITION,
     PROP_DURATION,
+    PROP_LOOP_START,
+    PROP_LOOP_END,
+    PROP_WINDOW_START,
+    PROP_WINDOW_END,
+    PROP_SHOW_WINDOW,
     N_PROPS
 };
 
 enum
 {
     SEEKED,
+    LOOP_CHANGED,
     N_SIGNAL
 };
 
@@ -140,8 +169,6 @@ static void accent_color_notify_cb (WfSeekBar  *self,
                                     GParamSpec *pspec,
                                     gpointer    user_data);
 
-gdouble     interpolate   (GArray *peaks,
-                           guint index);
 static void generate_bars (WfSeekBar *self);
 
 G_DEFINE_FINAL_TYPE (WfSeekBar, wf_seek_bar, GTK_TYPE_WIDGET)
@@ -181,6 +208,43 @@ wf_seek_bar_class_init (WfSeekBarClass *klass)
                              0, G_MAXUINT64, 0,
                              G_PARAM_READWRITE);
 
+    /* Read-only for the same reason as the window below;
+     * wf_seek_bar_set_loop() sets both ends. */
+    properties[PROP_LOOP_START] =
+        g_param_spec_uint64 ("loop-start",
+                             NULL, NULL,
+                             0, G_MAXUINT64, 0,
+                             G_PARAM_READABLE);
+
+    properties[PROP_LOOP_END] =
+        g_param_spec_uint64 ("loop-end",
+                             NULL, NULL,
+                             0, G_MAXUINT64, 0,
+                             G_PARAM_READABLE);
+
+    /* The part of the file the current track covers; the end is
+     * G_MAXUINT64 when it runs to the end of the file. Read-only, as one
+     * end set on its own may cross the other; wf_seek_bar_set_window()
+     * sets both. */
+    properties[PROP_WINDOW_START] =
+        g_param_spec_uint64 ("window-start",
+                             NULL, NULL,
+                             0, G_MAXUINT64, 0,
+                             G_PARAM_READABLE);
+
+    properties[PROP_WINDOW_END] =
+        g_param_spec_uint64 ("window-end",
+                             NULL, NULL,
+                             0, G_MAXUINT64, G_MAXUINT64,
+                             G_PARAM_READABLE);
+
+    /* Whether the bar spans just the window rather than the whole file. */
+    properties[PROP_SHOW_WINDOW] =
+        g_param_spec_boolean ("show-window",
+                              NULL, NULL,
+                              FALSE,
+                              G_PARAM_READWRITE);
+
     signals[SEEKED] =
         g_signal_new ("seeked",
                       G_TYPE_FROM_CLASS (klass),
@@ -191,6 +255,17 @@ wf_seek_bar_class_init (WfSeekBarClass *klass)
                       1,
                       G_TYPE_UINT64);
 
+    /* Emitted when the user has dragged or drawn (with shift) a loop. */
+    signals[LOOP_CHANGED] =
+        g_signal_new ("loop-changed",
+                      G_TYPE_FROM_CLASS (klass),
+                      G_SIGNAL_RUN_FIRST | G_SIGNAL_NO_RECURSE,
+                      0,
+                      NULL, NULL, NULL,
+                      G_TYPE_NONE,
+                      2,
+                      G_TYPE_UINT64, G_TYPE_UINT64);
+
     g_object_class_install_properties (object_class, N_PROPS, properties);
 }
 
@@ -222,6 +297,7 @@ wf_seek_bar_init (WfSeekBar *self)
 
     self->bar_width = 4.0;
     self->bar_spacing = 2.2;
+    self->window_end = G_MAXUINT64;
 
     self->style_manager = adw_style_manager_get_default ();
     g_signal_connect_swapped (self->style_manager, "notify::accent-color",
@@ -247,6 +323,21 @@ get_property (GObject    *object,
     case PROP_POSITION:
         g_value_set_uint (value, seek_bar->position);
         break;
+    case PROP_LOOP_START:
+        g_value_set_uint64 (value, seek_bar->loop_start);
+        break;
+    case PROP_LOOP_END:
+        g_value_set_uint64 (value, seek_bar->loop_end);
+        break;
+    case PROP_WINDOW_START:
+        g_value_set_uint64 (value, seek_bar->window_start);
+        break;
+    case PROP_WINDOW_END:
+        g_value_set_uint64 (value, seek_bar->window_end);
+        break;
+    case PROP_SHOW_WINDOW:
+        g_value_set_boolean (value, seek_bar->show_window);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
         break;
@@ -271,6 +362,9 @@ set_property (GObject      *object,
     case PROP_POSITION:
         wf_seek_bar_set_position (seek_bar, g_value_get_uint (value));
         break;
+    case PROP_SHOW_WINDOW:
+        wf_seek_bar_set_show_window (seek_bar, g_value_get_boolean (value));
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
         break;
@@ -370,17 +464,107 @@ leave_cb (WfSeekBar *self,
     gtk_widget_queue_draw (GTK_WIDGET (self));
 }
 
+static gboolean
+has_window (WfSeekBar *self)
+{
+    return self->window_start > 0 || self->window_end < self->duration;
+}
+
+/* The part of the file the bar spans. */
+static void
+get_view (WfSeekBar *self,
+          guint64   *start,
+          guint64   *end)
+{
+    *start = 0;
+    *end = self->duration;
+    if (self->show_window && has_window (self)) {
+        *start = MIN (self->window_start, self->duration);
+        *end = MIN (self->window_end, self->duration);
+    }
+}
+
+static gdouble
+time_to_x (WfSeekBar *self,
+           guint64    pos)
+{
+    gint width = gtk_widget_get_width (GTK_WIDGET (self));
+    guint64 start, end;
+
+    get_view (self, &start, &end);
+    if (end <= start)
+        return 0.0;
+
+    return ((gdouble) pos - start) / (end - start) * width;
+}
+
+static guint64
+x_to_time (WfSeekBar *self,
+           gdouble    x)
+{
+    gint width = gtk_widget_get_width (GTK_WIDGET (self));
+    guint64 start, end;
+
+    if (width <= 0)
+        return 0;
+
+    get_view (self, &start, &end);
+    return start + CLAMP (x / (gdouble) width, 0.0, 1.0) * (end - start);
+}
+
+static void
+update_loop_drag (WfSeekBar *self)
+{
+    guint64 pos = x_to_time (self, self->drag_x);
+
+    switch (self->drag_mode) {
+    case DRAG_LOOP_START:
+        self->loop_start = MIN (pos, self->loop_end);
+        break;
+    case DRAG_LOOP_END:
+        self->loop_end = MAX (pos, self->loop_start);
+        break;
+    case DRAG_LOOP_NEW:
+        self->loop_start = x_to_time (self, MIN (self->drag_origin, self->drag_x));
+        self->loop_end = x_to_time (self, MAX (self->drag_origin, self->drag_x));
+        break;
+    case DRAG_SEEK:
+    default:
+        return;
+    }
+
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
 static void
 drag_begin_cb (WfSeekBar *self,
                gdouble    start_x,
                gdouble    start_y,
                gpointer   user_data)
 {
-    gint width = gtk_widget_get_width (GTK_WIDGET (self));
+    GdkModifierType state;
     guint64 pos;
 
     self->drag_x = start_x;
-    pos = (self->drag_x / (gdouble) width) * self->duration;
+    self->drag_origin = start_x;
+    self->drag_mode = DRAG_SEEK;
+
+    state = gtk_event_controller_get_current_event_state (GTK_EVENT_CONTROLLER (user_data));
+    if (state & GDK_SHIFT_MASK)
+        self->drag_mode = DRAG_LOOP_NEW;
+    else if (self->loop_end > self->loop_start &&
+             fabs (start_x - time_to_x (self, self->loop_start)) <= MARKER_GRAB)
+        self->drag_mode = DRAG_LOOP_START;
+    else if (self->loop_end > self->loop_start &&
+             fabs (start_x - time_to_x (self, self->loop_end)) <= MARKER_GRAB)
+        self->drag_mode = DRAG_LOOP_END;
+
+    if (self->drag_mode != DRAG_SEEK) {
+        update_loop_drag (self);
+        return;
+    }
+
+    pos = x_to_time (self, self->drag_x);
     g_signal_emit (self, signals[SEEKED], 0, pos);
 }
 
@@ -390,11 +574,16 @@ drag_update_cb (WfSeekBar *self,
                 gdouble    offset_y,
                 gpointer   user_data)
 {
-    gint width = gtk_widget_get_width (GTK_WIDGET (self));
     guint64 pos;
 
-    self->drag_x += offset_x;
-    pos = (self->drag_x / (gdouble) width) * self->duration;
+    /* Offsets are relative to the start of the drag. */
+    self->drag_x = self->drag_origin + offset_x;
+    if (self->drag_mode != DRAG_SEEK) {
+        update_loop_drag (self);
+        return;
+    }
+
+    pos = x_to_time (self, self->drag_x);
     g_signal_emit (self, signals[SEEKED], 0, pos);
 }
 
@@ -404,11 +593,19 @@ drag_end_cb (WfSeekBar *self,
              gdouble    offset_y,
              gpointer   user_data)
 {
-    gint width = gtk_widget_get_width (GTK_WIDGET (self));
     guint64 pos;
 
-    self->drag_x += offset_x;
-    pos = (self->drag_x / (gdouble) width) * self->duration;
+    self->drag_x = self->drag_origin + offset_x;
+    if (self->drag_mode != DRAG_SEEK) {
+        update_loop_drag (self);
+        g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LOOP_START]);
+        g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LOOP_END]);
+        g_signal_emit (self, signals[LOOP_CHANGED], 0, self->loop_start, self->loop_end);
+        self->drag_mode = DRAG_SEEK;
+        return;
+    }
+
+    pos = x_to_time (self, self->drag_x);
     g_signal_emit (self, signals[SEEKED], 0, pos);
 }
 
@@ -419,21 +616,25 @@ snapshot (GtkWidget   *widget,
     WfSeekBar *seek_bar = WF_SEEK_BAR (widget);
     graphene_rect_t bar_rect;
     GdkRGBA white = {1.0, 1.0, 1.0, 1.0};
-    GdkRGBA color;
+    GdkRGBA color, loop_color;
     gint width, height;
     gdouble delta;
     gdouble offset = 0.0;
     gdouble bar_height;
     gdouble pos;
+    gdouble loop_x, loop_w;
+    gint64 trace_start;
 
     if (!seek_bar->bars)
         return;
 
+    trace_start = WF_TRACE_NOW ();
+
     width = gtk_widget_get_width (widget);
     height = gtk_widget_get_height (widget);
     gtk_widget_get_color (widget, &color);
 
-    pos = seek_bar->duration ? seek_bar->position / (gdouble) seek_bar->duration * width : 0.0;
+    pos = CLAMP (time_to_x (seek_bar, seek_bar->position), 0.0, width);
     delta = seek_bar->bar_width + seek_bar->bar_spacing;
     gtk_snapshot_push_mask (snapshot, GSK_MASK_MODE_ALPHA);
     for (int i = 0; i < seek_bar->bars->len; i++) {
@@ -453,6 +654,38 @@ snapshot (GtkWidget   *widget,
     gtk_snapshot_append_color (snapshot, &color,
                                &GRAPHENE_RECT_INIT (pos, 0, width - pos, height));
     gtk_snapshot_pop (snapshot);
+
+    if (seek_bar->loop_end > seek_bar->loop_start && seek_bar->duration) {
+        loop_x = CLAMP (time_to_x (seek_bar, seek_bar->loop_start), 0.0, width);
+        loop_w = CLAMP (time_to_x (seek_bar, seek_bar->loop_end), 0.0, width) - loop_x;
+        loop_color = *seek_bar->hover_color;
+        loop_color.alpha = 0.25;
+        gtk_snapshot_append_color (snapshot, &loop_color,
+                                   &GRAPHENE_RECT_INIT (loop_x, 0, loop_w, height));
+        gtk_snapshot_append_color (snapshot, seek_bar->hover_color,
+                                   &GRAPHENE_RECT_INIT (loop_x - MARKER_WIDTH / 2, 0,
+                                                        MARKER_WIDTH, height));
+        gtk_snapshot_append_color (snapshot, seek_bar->hover_color,
+                                   &GRAPHENE_RECT_INIT (loop_x + loop_w - MARKER_WIDTH / 2, 0,
+                                                        MARKER_WIDTH, height));
+    }
+
+    /* Over the whole file, mark where the current track lies. */
+    if (!seek_bar->show_window && seek_bar->duration && has_window (seek_bar)) {
+        color.alpha = 0.6;
+        if (seek_bar->window_start > 0)
+            gtk_snapshot_append_color (snapshot, &color,
+                                       &GRAPHENE_RECT_INIT (time_to_x (seek_bar, seek_bar->window_start)
+                                                            - MARKER_WIDTH / 2, 0,
+                                                            MARKER_WIDTH, height));
+        if (seek_bar->window_end < seek_bar->duration)
+            gtk_snapshot_append_color (snapshot, &color,
+                                       &GRAPHENE_RECT_INIT (time_to_x (seek_bar, seek_bar->window_end)
+                                                            - MARKER_WIDTH / 2, 0,
+                                                            MARKER_WIDTH, height));
+    }
+
+    WF_TRACE_MARK (trace_start, "Seek bar snapshot", "%u bars", seek_bar->bars->len);
 }
 
 static void
@@ -470,55 +703,43 @@ wf_seek_bar_new (void)
     return g_object_new (WF_TYPE_SEEK_BAR, NULL);
 }
 
-/* TODO: This is too naive. I should come up a better interpolation function. */
-
-gdouble
-interpolate (GArray *peaks, guint index)
-{
-    WfPeakData *current, *prev, *next;
-
-    if (index == 0) {
-        current = &g_array_index (peaks, WfPeakData, index);
-        next = &g_array_index (peaks, WfPeakData, index + 1);
-        return (current->left + next->left) / 2;
-    } else if (index + 1 == peaks->len) {
-        current = &g_array_index (peaks, WfPeakData, index);
-        prev = &g_array_index (peaks, WfPeakData, index - 1);
-        return (current->left + prev->left) / 2;
-    }
-
-    prev = &g_array_index (peaks, WfPeakData, index - 1);
-    current = &g_array_index (peaks, WfPeakData, index);
-    next = &g_array_index (peaks, WfPeakData, index + 1);
-
-    return (prev->left + current->left + next->left) / 3;
-}
-
 /* TODO: Is this the best way? I may need to rewrite this. */
 
 static void
 generate_bars (WfSeekBar *self)
 {
     gint width;
+    guint first = 0;
     guint n_peaks;
     guint n_bars;
-    gdouble p;
-    gdouble val;
+    guint64 start, end;
+    gint64 trace_start;
+
+    if (!self->peaks || self->peaks->len < 2)
+        return;
 
+    trace_start = WF_TRACE_NOW ();
     width = gtk_widget_get_width (GTK_WIDGET (self));
 
+    /* The peaks always cover the whole file, so a window is just a slice
+     * of them. */
     n_peaks = self->peaks->len;
-    n_bars = (width - self->bar_spacing) / (self->bar_width + self->bar_spacing);
-    p = n_bars / (gdouble) n_peaks;
+    get_view (self, &start, &end);
+    if (self->duration && end > start) {
+        first = MIN (start / (gdouble) self->duration * n_peaks, n_peaks - 1);
+        n_peaks = MAX (end / (gdouble) self->duration * n_peaks, first + 1) - first;
+        n_peaks = MIN (n_peaks, self->peaks->len - first);
+    }
+
+    n_bars = 0;
+    if (width > self->bar_spacing)
+        n_bars = (width - self->bar_spacing) / (self->bar_width + self->bar_spacing);
 
     if (self->bars)
         g_array_unref (self->bars);
 
-    self->bars = g_array_new (FALSE, FALSE, sizeof (gdouble));
-    for (int i = 0; i < n_bars; i++) {
-        val = interpolate (self->peaks, (guint) (i / p));
-        g_array_append_val (self->bars, val);
-    }
+    self->bars = wf_peak_data_to_bars (self->peaks, first, n_peaks, n_bars);
+    WF_TRACE_MARK (trace_start, "Seek bar bars", "%u peaks to %u bars", n_peaks, n_bars);
 }
 
 void
@@ -543,6 +764,7 @@ wf_seek_bar_set_duration (WfSeekBar *self,
     g_return_if_fail (WF_IS_SEEK_BAR (self));
 
     self->duration = duration;
+    generate_bars (self);
     g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_DURATION]);
     gtk_widget_queue_draw (GTK_WIDGET (self));
 }
@@ -558,3 +780,61 @@ wf_seek_bar_set_position (WfSeekBar *self,
     gtk_widget_queue_draw (GTK_WIDGET (self));
 }
 
+void
+wf_seek_bar_set_loop (WfSeekBar *self,
+                      guint64    start,
+                      guint64    end)
+{
+    g_return_if_fail (WF_IS_SEEK_BAR (self));
+
+    if (self->drag_mode != DRAG_SEEK)
+        return;
+
+    if (end <= start)
+        start = end = 0;
+
+    self->loop_start = start;
+    self->loop_end = end;
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LOOP_START]);
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LOOP_END]);
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+void
+wf_seek_bar_set_window (WfSeekBar *self,
+                        guint64    start,
+                        guint64    end)
+{
+    g_return_if_fail (WF_IS_SEEK_BAR (self));
+
+    if (end <= start) {
+        start = 0;
+        end = G_MAXUINT64;
+    }
+
+    if (start == self->window_start && end == self->window_end)
+        return;
+
+    self->window_start = start;
+    self->window_end = end;
+    generate_bars (self);
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_WINDOW_START]);
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_WINDOW_END]);
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+void
+wf_seek_bar_set_show_window (WfSeekBar *self,
+                             gboolean   show_window)
+{
+    g_return_if_fail (WF_IS_SEEK_BAR (self));
+
+    show_window = !!show_window;
+    if (show_window == self->show_window)
+        return;
+
+    self->show_window = show_window;
+    generate_bars (self);
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_SHOW_WINDOW]);
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
@@ -28,13 +28,21 @@ G_BEGIN_DECLS
 #define WF_TYPE_SEEK_BAR (wf_seek_bar_get_type ())
 G_DECLARE_FINAL_TYPE (WfSeekBar, wf_seek_bar, WF, SEEK_BAR, GtkWidget)
 
-WfSeekBar *wf_seek_bar_new          (void);
-void       wf_seek_bar_set_peaks    (WfSeekBar *self,
-                                     GArray     *peaks);
-void       wf_seek_bar_set_duration (WfSeekBar *self,
-                                     guint64    duration);
-void       wf_seek_bar_set_position (WfSeekBar *self,
-                                     guint64    position);
+WfSeekBar *wf_seek_bar_new             (void);
+void       wf_seek_bar_set_peaks       (WfSeekBar *self,
+                                        GArray     *peaks);
+void       wf_seek_bar_set_duration    (WfSeekBar *self,
+                                        guint64    duration);
+void       wf_seek_bar_set_position    (WfSeekBar *self,
+                                        guint64    position);
+void       wf_seek_bar_set_loop        (WfSeekBar *self,
+                                        guint64    start,
+                                        guint64    end);
+void       wf_seek_bar_set_window      (WfSeekBar *self,
+                                        guint64    start,
+                                        guint64    end);
+void       wf_seek_bar_set_show_window (WfSeekBar *self,
+                                        gboolean   show_window);
 
 G_END_DECLS
 
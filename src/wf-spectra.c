@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <math.h>
+#include <string.h>
 #include <gst/gst.h>
 
 #include "wf-spectra.h"
@@ -32,8 +33,8 @@ wf_spectra_copy (WfSpectra *self)
     WfSpectra *copy;
 
     copy = wf_spectra_new (self->n_bands);
-    copy->magnitude = g_memdup2 (self->magnitude, self->n_bands * sizeof (float));
-    copy->phase = g_memdup2 (self->magnitude, self->n_bands * sizeof (float));
+    memcpy (copy->magnitude, self->magnitude, self->n_bands * sizeof (float));
+    memcpy (copy->phase, self->phase, self->n_bands * sizeof (float));
     return copy;
 }
 
@@ -42,9 +43,7 @@ wf_spectra_free (WfSpectra *self)
 {
     g_free (self->magnitude);
     g_free (self->phase);
-
-    self->magnitude = NULL;
-    self->phase = NULL;
+    g_free (self);
 }
 
 G_DEFINE_BOXED_TYPE (WfSpectra, wf_spectra, wf_spectra_copy, wf_spectra_free)
@@ -0,0 +1,161 @@
+/*
+ * wf-sub-track.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "wf-sub-track.h"
+
+/*
+ * A sub-track is addressed by the uri of its file with a media fragment,
+ * file:///mix.flac#t=312.5,624.04 for instance. A '#' in a file name is
+ * escaped in its uri, so whatever follows one is always the fragment.
+ * Times are written in seconds with up to nine decimals, which keeps
+ * them exact to the nanosecond.
+ */
+
+#define SECOND G_GUINT64_CONSTANT (1000000000)
+
+void
+wf_sub_track_free (WfSubTrack *self)
+{
+    if (!self)
+        return;
+
+    g_free (self->title);
+    g_free (self->performer);
+    g_free (self);
+}
+
+static void
+append_time (GString *str,
+             guint64  time)
+{
+    gchar digits[10];
+    gint length;
+
+    g_string_append_printf (str, "%" G_GUINT64_FORMAT, time / SECOND);
+    if (time % SECOND == 0)
+        return;
+
+    length = g_snprintf (digits, sizeof (digits), "%09" G_GUINT64_FORMAT, time % SECOND);
+    while (length > 1 && digits[length - 1] == '0')
+        digits[--length] = '\0';
+    g_string_append_printf (str, ".%s", digits);
+}
+
+/* Returns the uri of the part of @file_uri between @start and @end. */
+gchar *
+wf_sub_track_make_uri (const gchar *file_uri,
+                       guint64      start,
+                       guint64      end)
+{
+    GString *uri;
+    const gchar *hash;
+
+    g_return_val_if_fail (file_uri != NULL, NULL);
+
+    hash = strchr (file_uri, '#');
+    uri = g_string_new_len (file_uri, hash ? hash - file_uri : -1);
+    g_string_append (uri, "#t=");
+    append_time (uri, start);
+    if (end != G_MAXUINT64) {
+        g_string_append_c (uri, ',');
+        append_time (uri, end);
+    }
+
+    return g_string_free (uri, FALSE);
+}
+
+static gboolean
+parse_time (const gchar **p,
+            guint64      *time)
+{
+    const gchar *s = *p;
+    guint64 seconds = 0, fraction = 0, scale = SECOND;
+
+    if (!g_ascii_isdigit (*s))
+        return FALSE;
+
+    while (g_ascii_isdigit (*s))
+        seconds = seconds * 10 + (*s++ - '0');
+
+    if (*s == '.') {
+        s++;
+        while (g_ascii_isdigit (*s)) {
+            if (scale > 1) {
+                scale /= 10;
+                fraction += (*s - '0') * scale;
+            }
+            s++;
+        }
+    }
+
+    *time = seconds * SECOND + fraction;
+    *p = s;
+
+    return TRUE;
+}
+
+/* Splits @uri into the uri of its file and the stretch it covers, and
+ * returns whether it is a sub-track at all. For any other uri the file
+ * is @uri itself and the stretch is all of it. */
+gboolean
+wf_sub_track_parse_uri (const gchar  *uri,
+                        gchar       **file_uri,
+                        guint64      *start,
+                        guint64      *end)
+{
+    const gchar *hash, *p;
+    guint64 from = 0, to = G_MAXUINT64;
+    gboolean valid;
+
+    g_return_val_if_fail (uri != NULL, FALSE);
+
+    hash = strchr (uri, '#');
+    valid = hash && g_str_has_prefix (hash, "#t=");
+    if (valid) {
+        p = hash + 3;
+        if (g_str_has_prefix (p, "npt:"))
+            p += 4;
+        valid = parse_time (&p, &from);
+        if (valid && *p == ',') {
+            p++;
+            valid = parse_time (&p, &to) && to > from;
+        }
+        valid = valid && *p == '\0';
+    }
+
+    if (!valid) {
+        from = 0;
+        to = G_MAXUINT64;
+    }
+
+    if (file_uri)
+        *file_uri = valid ? g_strndup (uri, hash - uri) : g_strdup (uri);
+    if (start)
+        *start = from;
+    if (end)
+        *end = to;
+
+    return valid;
+}
@@ -0,0 +1,49 @@
+/*
+ * wf-sub-track.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* A stretch of a longer file, such as a CUE sheet entry or a chapter.
+ * Times are in nanoseconds from the start of the file; an end of
+ * G_MAXUINT64 runs to the end of the file. */
+typedef struct
+{
+    gchar *title;
+    gchar *performer;
+    guint64 start;
+    guint64 end;
+} WfSubTrack;
+
+void      wf_sub_track_free      (WfSubTrack *self);
+
+gchar    *wf_sub_track_make_uri  (const gchar *file_uri,
+                                  guint64      start,
+                                  guint64      end);
+gboolean  wf_sub_track_parse_uri (const gchar  *uri,
+                                  gchar       **file_uri,
+                                  guint64      *start,
+                                  guint64      *end);
+
+G_END_DECLS
@@ -0,0 +1,172 @@
+/*
+ * wf-thumbnail.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "wf-thumbnail.h"
+
+/* Shows the thumbnail of a track at half its size in the atlas, so it is
+ * sharp on scaled displays. */
+
+struct _WfThumbnail
+{
+    GtkWidget parent;
+
+    WfThumbnailer *thumbnailer;
+    gchar *uri;
+};
+
+static void dispose  (GObject *object);
+static void finalize (GObject *object);
+static void measure  (GtkWidget      *widget,
+                      GtkOrientation  orientation,
+                      gint            for_size,
+                      gint           *minimum,
+                      gint           *natural,
+                      gint           *minimum_baseline,
+                      gint           *natural_baseline);
+static void snapshot (GtkWidget   *widget,
+                      GtkSnapshot *snapshot);
+
+G_DEFINE_FINAL_TYPE (WfThumbnail, wf_thumbnail, GTK_TYPE_WIDGET)
+
+static void
+wf_thumbnail_class_init (WfThumbnailClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+    GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+    object_class->dispose = dispose;
+    object_class->finalize = finalize;
+
+    widget_class->measure = measure;
+    widget_class->snapshot = snapshot;
+
+    gtk_widget_class_set_css_name (widget_class, "wfthumbnail");
+}
+
+static void
+wf_thumbnail_init (WfThumbnail *self)
+{
+}
+
+static void
+dispose (GObject *object)
+{
+    WfThumbnail *thumbnail = WF_THUMBNAIL (object);
+
+    if (thumbnail->thumbnailer && thumbnail->uri)
+        wf_thumbnailer_release (thumbnail->thumbnailer, thumbnail->uri);
+    g_clear_object (&thumbnail->thumbnailer);
+
+    G_OBJECT_CLASS (wf_thumbnail_parent_class)->dispose (object);
+}
+
+static void
+finalize (GObject *object)
+{
+    WfThumbnail *thumbnail = WF_THUMBNAIL (object);
+
+    g_free (thumbnail->uri);
+
+    G_OBJECT_CLASS (wf_thumbnail_parent_class)->finalize (object);
+}
+
+static void
+measure (GtkWidget      *widget,
+         GtkOrientation  orientation,
+         gint            for_size,
+         gint           *minimum,
+         gint           *natural,
+         gint           *minimum_baseline,
+         gint           *natural_baseline)
+{
+    if (orientation == GTK_ORIENTATION_HORIZONTAL)
+        *minimum = *natural = WF_THUMBNAIL_WIDTH / 2;
+    else
+        *minimum = *natural = WF_THUMBNAIL_HEIGHT / 2;
+}
+
+static void
+snapshot (GtkWidget   *widget,
+          GtkSnapshot *snapshot)
+{
+    WfThumbnail *thumbnail = WF_THUMBNAIL (widget);
+    graphene_rect_t area;
+    GdkTexture *atlas;
+    GdkRGBA color;
+    gdouble scale_x, scale_y;
+    gint width, height;
+
+    if (!thumbnail->uri || !thumbnail->thumbnailer ||
+        !wf_thumbnailer_lookup (thumbnail->thumbnailer, thumbnail->uri, &atlas, &area))
+        return;
+
+    width = gtk_widget_get_width (widget);
+    height = gtk_widget_get_height (widget);
+    scale_x = width / area.size.width;
+    scale_y = height / area.size.height;
+    gtk_widget_get_color (widget, &color);
+    color.alpha *= 0.6;
+
+    gtk_snapshot_push_clip (snapshot, &GRAPHENE_RECT_INIT (0, 0, width, height));
+    gtk_snapshot_push_mask (snapshot, GSK_MASK_MODE_ALPHA);
+    gtk_snapshot_append_texture (snapshot, atlas,
+                                 &GRAPHENE_RECT_INIT (-area.origin.x * scale_x,
+                                                      -area.origin.y * scale_y,
+                                                      gdk_texture_get_width (atlas) * scale_x,
+                                                      gdk_texture_get_height (atlas) * scale_y));
+    gtk_snapshot_pop (snapshot);
+    gtk_snapshot_append_color (snapshot, &color, &GRAPHENE_RECT_INIT (0, 0, width, height));
+    gtk_snapshot_pop (snapshot);
+    gtk_snapshot_pop (snapshot);
+}
+
+GtkWidget *
+wf_thumbnail_new (WfThumbnailer *thumbnailer)
+{
+    WfThumbnail *self;
+
+    g_return_val_if_fail (WF_IS_THUMBNAILER (thumbnailer), NULL);
+
+    self = g_object_new (WF_TYPE_THUMBNAIL, NULL);
+    self->thumbnailer = g_object_ref (thumbnailer);
+    g_signal_connect_object (thumbnailer, "updated",
+                             G_CALLBACK (gtk_widget_queue_draw), self, G_CONNECT_SWAPPED);
+
+    return GTK_WIDGET (self);
+}
+
+void
+wf_thumbnail_set_uri (WfThumbnail *self,
+                      const gchar *uri)
+{
+    g_return_if_fail (WF_IS_THUMBNAIL (self));
+
+    if (g_strcmp0 (self->uri, uri) == 0)
+        return;
+
+    if (self->uri)
+        wf_thumbnailer_release (self->thumbnailer, self->uri);
+    g_free (self->uri);
+    self->uri = g_strdup (uri);
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
@@ -0,0 +1,37 @@
+/*
+ * wf-thumbnail.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+#include "wf-thumbnailer.h"
+
+G_BEGIN_DECLS
+
+#define WF_TYPE_THUMBNAIL (wf_thumbnail_get_type ())
+G_DECLARE_FINAL_TYPE (WfThumbnail, wf_thumbnail, WF, THUMBNAIL, GtkWidget)
+
+GtkWidget *wf_thumbnail_new     (WfThumbnailer *thumbnailer);
+void       wf_thumbnail_set_uri (WfThumbnail *self,
+                                 const gchar *uri);
+
+G_END_DECLS
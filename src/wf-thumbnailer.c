@@ -0,0 +1,598 @@
+/*
+ * wf-thumbnailer.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "wf-thumbnailer.h"
+#include "wf-peak-cache.h"
+#include "wf-sub-track.h"
+#include "wf-waveform.h"
+
+/*
+ * Small waveforms for list rows, drawn from the peak cache: a file that
+ * was never analyzed has no thumbnail, and nothing here decodes.
+ *
+ * Rows ask for the thumbnails they draw. What was asked for over one main
+ * loop iteration goes to a worker as a batch; it reads the cached peaks
+ * and rasterizes each into an alpha mask. The masks are copied into atlas
+ * textures holding many thumbnails each, so a screenful of rows draws
+ * from one or two textures, uploaded once per batch. Atlases are added
+ * as needed up to the memory budget; after that the thumbnails drawn
+ * least recently give up their cells.
+ *
+ * A sub-track is drawn from the peaks of its whole file, cut to its
+ * stretch; the worker maps the cached peaks and reads only that stretch.
+ *
+ * Files without cached peaks are remembered so rows do not ask again,
+ * but only the MAX_MISSING seen most recently. A row that moves on to
+ * another track releases what it asked for and did not get yet, so the
+ * worker does not spend a batch on rows scrolled out of view.
+ */
+
+#define ATLAS_SIZE      512
+#define CELL_WIDTH      (WF_THUMBNAIL_WIDTH + 2)
+#define CELL_HEIGHT     (WF_THUMBNAIL_HEIGHT + 2)
+#define ATLAS_COLUMNS   (ATLAS_SIZE / CELL_WIDTH)
+#define CELLS_PER_ATLAS (ATLAS_COLUMNS * (ATLAS_SIZE / CELL_HEIGHT))
+#define BATCH_SIZE      64
+#define MAX_MISSING     4096
+
+typedef enum
+{
+    THUMB_PENDING,
+    THUMB_READY,
+    THUMB_MISSING,
+} ThumbState;
+
+typedef struct _Raster Raster;
+
+typedef struct
+{
+    gchar *uri;
+    ThumbState state;
+    guint cell;
+    /* In lru while ready, in missing while missing. */
+    GList link;
+    /* Set while with the worker; dirty if its peaks changed meanwhile. */
+    Raster *raster;
+    gboolean dirty;
+} Thumb;
+
+typedef struct
+{
+    guint8 *pixels;
+    GdkTexture *texture;
+} Atlas;
+
+struct _Raster
+{
+    gchar *uri;
+    guint8 *mask;
+    gint cancelled;
+};
+
+struct _WfThumbnailer
+{
+    GObject parent;
+
+    gsize budget;
+    GHashTable *thumbs;
+    GQueue lru;
+    GQueue missing;
+
+    GPtrArray *atlases;
+    GArray *free_cells;
+    guint n_cells;
+
+    /* Uris asked for and not yet sent to the worker, newest last. */
+    GPtrArray *pending;
+    guint flush_id;
+    gboolean running;
+    GCancellable *cancellable;
+};
+
+enum
+{
+    UPDATED,
+    N_SIGNALS
+};
+
+static guint signals[N_SIGNALS] = {0, };
+
+static void dispose  (GObject *object);
+static void finalize (GObject *object);
+
+G_DEFINE_FINAL_TYPE (WfThumbnailer, wf_thumbnailer, G_TYPE_OBJECT)
+
+static void
+wf_thumbnailer_class_init (WfThumbnailerClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->dispose = dispose;
+    object_class->finalize = finalize;
+
+    /* Emitted when thumbnails were added or dropped. */
+    signals[UPDATED] =
+        g_signal_new ("updated",
+                      G_TYPE_FROM_CLASS (object_class),
+                      G_SIGNAL_RUN_LAST,
+                      0, NULL, NULL, NULL,
+                      G_TYPE_NONE, 0);
+}
+
+static void
+thumb_free (Thumb *thumb)
+{
+    g_free (thumb->uri);
+    g_free (thumb);
+}
+
+static void
+atlas_free (Atlas *atlas)
+{
+    g_clear_object (&atlas->texture);
+    g_free (atlas->pixels);
+    g_free (atlas);
+}
+
+static void
+raster_free (Raster *raster)
+{
+    g_free (raster->uri);
+    g_free (raster->mask);
+    g_free (raster);
+}
+
+static void
+wf_thumbnailer_init (WfThumbnailer *self)
+{
+    self->thumbs = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) thumb_free);
+    g_queue_init (&self->lru);
+    g_queue_init (&self->missing);
+    self->atlases = g_ptr_array_new_with_free_func ((GDestroyNotify) atlas_free);
+    self->free_cells = g_array_new (FALSE, FALSE, sizeof (guint));
+    self->pending = g_ptr_array_new_with_free_func (g_free);
+    self->cancellable = g_cancellable_new ();
+}
+
+static void
+dispose (GObject *object)
+{
+    WfThumbnailer *thumbnailer = WF_THUMBNAILER (object);
+
+    g_cancellable_cancel (thumbnailer->cancellable);
+    g_clear_handle_id (&thumbnailer->flush_id, g_source_remove);
+
+    G_OBJECT_CLASS (wf_thumbnailer_parent_class)->dispose (object);
+}
+
+static void
+finalize (GObject *object)
+{
+    WfThumbnailer *thumbnailer = WF_THUMBNAILER (object);
+
+    g_hash_table_unref (thumbnailer->thumbs);
+    g_ptr_array_unref (thumbnailer->atlases);
+    g_array_unref (thumbnailer->free_cells);
+    g_ptr_array_unref (thumbnailer->pending);
+    g_object_unref (thumbnailer->cancellable);
+
+    G_OBJECT_CLASS (wf_thumbnailer_parent_class)->finalize (object);
+}
+
+/* Draws the loudest peak of each column of peaks @first to @last as a bar
+ * centred on the middle, scaled to the loudest column, with soft ends. */
+static guint8 *
+rasterize (const WfPeakData *peaks,
+           guint             n_peaks,
+           guint             first,
+           guint             last)
+{
+    gdouble columns[WF_THUMBNAIL_WIDTH];
+    gdouble top = 0.0, half, y0, y1, coverage;
+    const WfPeakData *peak;
+    guint start, end, length;
+    guint8 *mask;
+
+    mask = g_malloc0 (WF_THUMBNAIL_WIDTH * WF_THUMBNAIL_HEIGHT);
+    last = MIN (last, n_peaks);
+    if (first >= last)
+        return mask;
+
+    length = last - first;
+    for (guint x = 0; x < WF_THUMBNAIL_WIDTH; x++) {
+        start = first + (guint) ((guint64) x * length / WF_THUMBNAIL_WIDTH);
+        end = MAX (start + 1, first + (guint) ((guint64) (x + 1) * length / WF_THUMBNAIL_WIDTH));
+        columns[x] = 0.0;
+        for (guint i = start; i < end && i < last; i++) {
+            peak = &peaks[i];
+            columns[x] = MAX (columns[x], MAX (fabs (peak->left), fabs (peak->right)));
+        }
+        top = MAX (top, columns[x]);
+    }
+
+    for (guint x = 0; x < WF_THUMBNAIL_WIDTH; x++) {
+        half = MAX (0.5, top > 0.0 ? columns[x] / top * WF_THUMBNAIL_HEIGHT / 2 : 0.0);
+        y0 = WF_THUMBNAIL_HEIGHT / 2.0 - half;
+        y1 = WF_THUMBNAIL_HEIGHT / 2.0 + half;
+        for (guint y = 0; y < WF_THUMBNAIL_HEIGHT; y++) {
+            coverage = CLAMP (MIN (y + 1.0, y1) - MAX ((gdouble) y, y0), 0.0, 1.0);
+            mask[y * WF_THUMBNAIL_WIDTH + x] = (guint8) (coverage * 255 + 0.5);
+        }
+    }
+
+    return mask;
+}
+
+static void
+rasterize_thread (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+    GPtrArray *rasters = task_data;
+    const WfPeakData *peaks = NULL;
+    GMappedFile *map = NULL;
+    gchar *file_uri, *mapped_uri = NULL;
+    Raster *raster;
+    guint64 start, end;
+    guint n_peaks = 0;
+
+    for (guint i = 0; i < rasters->len; i++) {
+        if (g_cancellable_is_cancelled (cancellable))
+            break;
+
+        raster = g_ptr_array_index (rasters, i);
+        if (g_atomic_int_get (&raster->cancelled))
+            continue;
+
+        /* Sub-tracks of one file tend to come together: keep its
+         * mapping for the next. */
+        wf_sub_track_parse_uri (raster->uri, &file_uri, &start, &end);
+        if (g_strcmp0 (file_uri, mapped_uri) != 0) {
+            g_clear_pointer (&map, g_mapped_file_unref);
+            map = wf_peak_cache_map (file_uri, &peaks, &n_peaks);
+            g_free (mapped_uri);
+            mapped_uri = g_steal_pointer (&file_uri);
+        }
+        g_free (file_uri);
+        if (!map)
+            continue;
+
+        raster->mask = rasterize (peaks, n_peaks,
+                                  (guint) MIN (start / WF_PEAK_INTERVAL, G_MAXUINT),
+                                  (guint) MIN (end / WF_PEAK_INTERVAL, G_MAXUINT));
+    }
+
+    g_clear_pointer (&map, g_mapped_file_unref);
+    g_free (mapped_uri);
+
+    if (!g_task_return_error_if_cancelled (task))
+        g_task_return_boolean (task, TRUE);
+}
+
+static void
+drop_thumb (WfThumbnailer *self,
+            Thumb         *thumb)
+{
+    if (thumb->state == THUMB_READY) {
+        g_queue_unlink (&self->lru, &thumb->link);
+        g_array_append_val (self->free_cells, thumb->cell);
+    } else if (thumb->state == THUMB_MISSING) {
+        g_queue_unlink (&self->missing, &thumb->link);
+    } else if (thumb->raster) {
+        g_atomic_int_set (&thumb->raster->cancelled, TRUE);
+    } else {
+        for (guint i = self->pending->len; i > 0; i--) {
+            if (strcmp (g_ptr_array_index (self->pending, i - 1), thumb->uri) == 0) {
+                g_ptr_array_remove_index (self->pending, i - 1);
+                break;
+            }
+        }
+    }
+    g_hash_table_remove (self->thumbs, thumb->uri);
+}
+
+static void
+mark_missing (WfThumbnailer *self,
+              Thumb         *thumb)
+{
+    thumb->state = THUMB_MISSING;
+    g_queue_push_head_link (&self->missing, &thumb->link);
+    if (self->missing.length > MAX_MISSING)
+        drop_thumb (self, g_queue_peek_tail (&self->missing));
+}
+
+/* Returns a free cell, adding an atlas or evicting the thumbnail drawn
+ * least recently if there is none, or G_MAXUINT. */
+static guint
+take_cell (WfThumbnailer *self)
+{
+    guint max_cells, cell;
+    Atlas *atlas;
+    GList *oldest;
+
+    max_cells = MAX (1, self->budget / (ATLAS_SIZE * ATLAS_SIZE)) * CELLS_PER_ATLAS;
+
+    if (self->free_cells->len == 0 && self->n_cells < max_cells) {
+        if (self->n_cells % CELLS_PER_ATLAS == 0) {
+            atlas = g_new0 (Atlas, 1);
+            atlas->pixels = g_malloc0 (ATLAS_SIZE * ATLAS_SIZE);
+            g_ptr_array_add (self->atlases, atlas);
+        }
+        return self->n_cells++;
+    }
+
+    if (self->free_cells->len == 0) {
+        oldest = g_queue_peek_tail_link (&self->lru);
+        if (!oldest)
+            return G_MAXUINT;
+        drop_thumb (self, oldest->data);
+    }
+
+    cell = g_array_index (self->free_cells, guint, self->free_cells->len - 1);
+    g_array_set_size (self->free_cells, self->free_cells->len - 1);
+
+    return cell;
+}
+
+static void
+cell_origin (guint  cell,
+             guint *x,
+             guint *y)
+{
+    cell %= CELLS_PER_ATLAS;
+    *x = (cell % ATLAS_COLUMNS) * CELL_WIDTH + 1;
+    *y = (cell / ATLAS_COLUMNS) * CELL_HEIGHT + 1;
+}
+
+/* Copies @mask into @cell; the atlas texture is made again when next
+ * drawn. */
+static void
+write_cell (WfThumbnailer *self,
+            guint          cell,
+            const guint8  *mask)
+{
+    Atlas *atlas;
+    guint x, y;
+
+    atlas = g_ptr_array_index (self->atlases, cell / CELLS_PER_ATLAS);
+    cell_origin (cell, &x, &y);
+    for (guint row = 0; row < WF_THUMBNAIL_HEIGHT; row++)
+        memcpy (atlas->pixels + (y + row) * ATLAS_SIZE + x,
+                mask + row * WF_THUMBNAIL_WIDTH, WF_THUMBNAIL_WIDTH);
+
+    g_clear_object (&atlas->texture);
+}
+
+static void flush (WfThumbnailer *self);
+
+static void
+rasterized_cb (GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+    WfThumbnailer *self = WF_THUMBNAILER (source);
+    GPtrArray *rasters = g_task_get_task_data (G_TASK (result));
+    Raster *raster;
+    Thumb *thumb;
+    guint cell;
+
+    if (!g_task_propagate_boolean (G_TASK (result), NULL))
+        return;
+
+    self->running = FALSE;
+
+    for (guint i = 0; i < rasters->len; i++) {
+        raster = g_ptr_array_index (rasters, i);
+        thumb = g_hash_table_lookup (self->thumbs, raster->uri);
+        if (!thumb || thumb->raster != raster)
+            continue;
+
+        thumb->raster = NULL;
+        if (thumb->dirty) {
+            /* Its peaks were cached while the worker had it. */
+            thumb->dirty = FALSE;
+            g_ptr_array_add (self->pending, g_strdup (thumb->uri));
+            continue;
+        }
+
+        cell = raster->mask ? take_cell (self) : G_MAXUINT;
+        if (cell == G_MAXUINT) {
+            mark_missing (self, thumb);
+            continue;
+        }
+
+        write_cell (self, cell, raster->mask);
+        thumb->cell = cell;
+        thumb->state = THUMB_READY;
+        g_queue_push_head_link (&self->lru, &thumb->link);
+    }
+
+    g_signal_emit (self, signals[UPDATED], 0);
+
+    if (self->pending->len > 0)
+        flush (self);
+}
+
+/* Sends the newest requests to the worker: while scrolling, the rows in
+ * view now matter more than those that went past. */
+static void
+flush (WfThumbnailer *self)
+{
+    GPtrArray *rasters;
+    Raster *raster;
+    Thumb *thumb;
+    GTask *task;
+    guint n;
+
+    n = MIN (self->pending->len, BATCH_SIZE);
+    rasters = g_ptr_array_new_full (n, (GDestroyNotify) raster_free);
+    for (guint i = 0; i < n; i++) {
+        raster = g_new0 (Raster, 1);
+        raster->uri = g_ptr_array_steal_index (self->pending, self->pending->len - 1);
+        thumb = g_hash_table_lookup (self->thumbs, raster->uri);
+        thumb->raster = raster;
+        g_ptr_array_add (rasters, raster);
+    }
+
+    task = g_task_new (self, self->cancellable, rasterized_cb, NULL);
+    g_task_set_task_data (task, rasters, (GDestroyNotify) g_ptr_array_unref);
+    g_task_run_in_thread (task, rasterize_thread);
+    g_object_unref (task);
+
+    self->running = TRUE;
+}
+
+static gboolean
+flush_cb (gpointer user_data)
+{
+    WfThumbnailer *self = WF_THUMBNAILER (user_data);
+
+    self->flush_id = 0;
+    if (!self->running)
+        flush (self);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* @budget is the most memory the atlases may take, in bytes. */
+WfThumbnailer *
+wf_thumbnailer_new (gsize budget)
+{
+    WfThumbnailer *self;
+
+    self = g_object_new (WF_TYPE_THUMBNAILER, NULL);
+    self->budget = budget;
+
+    return self;
+}
+
+/* Returns the atlas holding the thumbnail for @uri and where in it, or
+ * FALSE if there is none yet; it is then made in the background, and
+ * ::updated is emitted once it is there. */
+gboolean
+wf_thumbnailer_lookup (WfThumbnailer    *self,
+                       const gchar      *uri,
+                       GdkTexture      **atlas,
+                       graphene_rect_t  *area)
+{
+    Atlas *cell_atlas;
+    GBytes *bytes;
+    Thumb *thumb;
+    guint x, y;
+
+    g_return_val_if_fail (WF_IS_THUMBNAILER (self), FALSE);
+    g_return_val_if_fail (uri != NULL, FALSE);
+
+    thumb = g_hash_table_lookup (self->thumbs, uri);
+    if (!thumb) {
+        thumb = g_new0 (Thumb, 1);
+        thumb->uri = g_strdup (uri);
+        thumb->state = THUMB_PENDING;
+        thumb->link.data = thumb;
+        g_hash_table_insert (self->thumbs, thumb->uri, thumb);
+
+        g_ptr_array_add (self->pending, g_strdup (uri));
+        if (!self->flush_id && !self->running)
+            self->flush_id = g_idle_add (flush_cb, self);
+        return FALSE;
+    }
+
+    if (thumb->state == THUMB_MISSING) {
+        g_queue_unlink (&self->missing, &thumb->link);
+        g_queue_push_head_link (&self->missing, &thumb->link);
+    }
+    if (thumb->state != THUMB_READY)
+        return FALSE;
+
+    g_queue_unlink (&self->lru, &thumb->link);
+    g_queue_push_head_link (&self->lru, &thumb->link);
+
+    cell_atlas = g_ptr_array_index (self->atlases, thumb->cell / CELLS_PER_ATLAS);
+    if (!cell_atlas->texture) {
+        bytes = g_bytes_new (cell_atlas->pixels, ATLAS_SIZE * ATLAS_SIZE);
+        cell_atlas->texture = gdk_memory_texture_new (ATLAS_SIZE, ATLAS_SIZE, GDK_MEMORY_A8,
+                                                      bytes, ATLAS_SIZE);
+        g_bytes_unref (bytes);
+    }
+
+    cell_origin (thumb->cell, &x, &y);
+    *atlas = cell_atlas->texture;
+    *area = GRAPHENE_RECT_INIT (x, y, WF_THUMBNAIL_WIDTH, WF_THUMBNAIL_HEIGHT);
+
+    return TRUE;
+}
+
+/* Gives up on the thumbnail for @uri if it was asked for and is not made
+ * yet, for when the row that wanted it shows another track. */
+void
+wf_thumbnailer_release (WfThumbnailer *self,
+                        const gchar   *uri)
+{
+    Thumb *thumb;
+
+    g_return_if_fail (WF_IS_THUMBNAILER (self));
+    g_return_if_fail (uri != NULL);
+
+    thumb = g_hash_table_lookup (self->thumbs, uri);
+    if (thumb && thumb->state == THUMB_PENDING)
+        drop_thumb (self, thumb);
+}
+
+/* Forgets the thumbnails for @uri and its sub-tracks, for when its peaks
+ * were just cached. Those with the worker are made again once back. */
+void
+wf_thumbnailer_invalidate (WfThumbnailer *self,
+                           const gchar   *uri)
+{
+    GHashTableIter iter;
+    GPtrArray *dropped;
+    Thumb *thumb;
+    gsize length;
+
+    g_return_if_fail (WF_IS_THUMBNAILER (self));
+    g_return_if_fail (uri != NULL);
+
+    length = strlen (uri);
+    dropped = g_ptr_array_new ();
+    g_hash_table_iter_init (&iter, self->thumbs);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &thumb)) {
+        if (strncmp (thumb->uri, uri, length) != 0 ||
+            (thumb->uri[length] != '\0' && thumb->uri[length] != '#'))
+            continue;
+
+        if (thumb->state != THUMB_PENDING)
+            g_ptr_array_add (dropped, thumb);
+        else if (thumb->raster)
+            thumb->dirty = TRUE;
+    }
+
+    for (guint i = 0; i < dropped->len; i++)
+        drop_thumb (self, g_ptr_array_index (dropped, i));
+    if (dropped->len > 0)
+        g_signal_emit (self, signals[UPDATED], 0);
+    g_ptr_array_unref (dropped);
+}
@@ -0,0 +1,46 @@
+/*
+ * wf-thumbnailer.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+/* Size of a thumbnail in the atlas, in pixels. */
+#define WF_THUMBNAIL_WIDTH  96
+#define WF_THUMBNAIL_HEIGHT 24
+
+#define WF_TYPE_THUMBNAILER (wf_thumbnailer_get_type ())
+G_DECLARE_FINAL_TYPE (WfThumbnailer, wf_thumbnailer, WF, THUMBNAILER, GObject)
+
+WfThumbnailer *wf_thumbnailer_new        (gsize budget);
+
+gboolean       wf_thumbnailer_lookup     (WfThumbnailer    *self,
+                                          const gchar      *uri,
+                                          GdkTexture      **atlas,
+                                          graphene_rect_t  *area);
+void           wf_thumbnailer_release    (WfThumbnailer *self,
+                                          const gchar   *uri);
+void           wf_thumbnailer_invalidate (WfThumbnailer *self,
+                                          const gchar   *uri);
+
+G_END_DECLS
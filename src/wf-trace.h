@@ -0,0 +1,53 @@
+/*
+ * wf-trace.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+#ifdef HAVE_SYSPROF
+#include <sysprof-capture.h>
+#endif
+
+/*
+ * Sysprof marks around the spans that matter when playback or analysis is
+ * slow, built in with -Dsysprof=enabled. A span starts at a time taken
+ * with WF_TRACE_NOW(), which reads the same monotonic clock as Sysprof,
+ * and WF_TRACE_MARK() records it when it ends. In other builds the start is
+ * a constant 0, WF_TRACE_MARK() only looks at it to keep the variable used,
+ * and the rest of its arguments are never evaluated.
+ */
+
+#ifdef HAVE_SYSPROF
+
+#define WF_TRACE_NOW() g_get_monotonic_time ()
+
+#define WF_TRACE_MARK(start, name, ...)                                         \
+    sysprof_collector_mark_printf ((start) * 1000,                              \
+                                   (g_get_monotonic_time () - (start)) * 1000,  \
+                                   "Wavefront", name, __VA_ARGS__)
+
+#else
+
+#define WF_TRACE_NOW() G_GINT64_CONSTANT (0)
+
+#define WF_TRACE_MARK(start, name, ...) G_STMT_START { (void) (start); } G_STMT_END
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * wf-track-item.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include "wf-track-item.h"
+
+/*
+ * A row of a WfTrackList. Made when a row is asked for and dropped when
+ * it scrolls out of view, so only the visible rows exist as objects.
+ */
+
+struct _WfTrackItem
+{
+    GObject parent;
+
+    gchar *uri;
+    gchar *title;
+    gchar *artist;
+    gchar *album;
+    gchar *cover;
+    guint64 duration;
+};
+
+static void finalize (GObject *object);
+
+G_DEFINE_FINAL_TYPE (WfTrackItem, wf_track_item, G_TYPE_OBJECT)
+
+static void
+wf_track_item_class_init (WfTrackItemClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->finalize = finalize;
+}
+
+static void
+wf_track_item_init (WfTrackItem *self)
+{
+}
+
+static void
+finalize (GObject *object)
+{
+    WfTrackItem *item = WF_TRACK_ITEM (object);
+
+    g_free (item->uri);
+    g_free (item->title);
+    g_free (item->artist);
+    g_free (item->album);
+    g_free (item->cover);
+
+    G_OBJECT_CLASS (wf_track_item_parent_class)->finalize (object);
+}
+
+WfTrackItem *
+wf_track_item_new (const WfTrack *track)
+{
+    WfTrackItem *self;
+
+    g_return_val_if_fail (track != NULL, NULL);
+
+    self = g_object_new (WF_TYPE_TRACK_ITEM, NULL);
+    self->uri = g_strdup (track->uri);
+    self->title = g_strdup (track->title);
+    self->artist = g_strdup (track->artist);
+    self->album = g_strdup (track->album);
+    self->cover = g_strdup (track->cover);
+    self->duration = track->duration;
+
+    return self;
+}
+
+const gchar *
+wf_track_item_get_uri (WfTrackItem *self)
+{
+    g_return_val_if_fail (WF_IS_TRACK_ITEM (self), NULL);
+
+    return self->uri;
+}
+
+const gchar *
+wf_track_item_get_title (WfTrackItem *self)
+{
+    g_return_val_if_fail (WF_IS_TRACK_ITEM (self), NULL);
+
+    return self->title;
+}
+
+const gchar *
+wf_track_item_get_artist (WfTrackItem *self)
+{
+    g_return_val_if_fail (WF_IS_TRACK_ITEM (self), NULL);
+
+    return self->artist;
+}
+
+const gchar *
+wf_track_item_get_album (WfTrackItem *self)
+{
+    g_return_val_if_fail (WF_IS_TRACK_ITEM (self), NULL);
+
+    return self->album;
+}
+
+/* The hash of the cover image, or an empty string. */
+const gchar *
+wf_track_item_get_cover (WfTrackItem *self)
+{
+    g_return_val_if_fail (WF_IS_TRACK_ITEM (self), NULL);
+
+    return self->cover;
+}
+
+guint64
+wf_track_item_get_duration (WfTrackItem *self)
+{
+    g_return_val_if_fail (WF_IS_TRACK_ITEM (self), 0);
+
+    return self->duration;
+}
@@ -0,0 +1,42 @@
+/*
+ * wf-track-item.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include "wf-track-store.h"
+
+G_BEGIN_DECLS
+
+#define WF_TYPE_TRACK_ITEM (wf_track_item_get_type ())
+G_DECLARE_FINAL_TYPE (WfTrackItem, wf_track_item, WF, TRACK_ITEM, GObject)
+
+WfTrackItem *wf_track_item_new          (const WfTrack *track);
+
+const gchar *wf_track_item_get_uri      (WfTrackItem *self);
+const gchar *wf_track_item_get_title    (WfTrackItem *self);
+const gchar *wf_track_item_get_artist   (WfTrackItem *self);
+const gchar *wf_track_item_get_album    (WfTrackItem *self);
+const gchar *wf_track_item_get_cover    (WfTrackItem *self);
+guint64      wf_track_item_get_duration (WfTrackItem *self);
+
+G_END_DECLS
@@ -0,0 +1,829 @@
+/*
+ * wf-track-list.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "wf-track-list.h"
+#include "wf-track-item.h"
+#include "wf-search-index.h"
+
+/*
+ * A GListModel over a WfTrackStore. Rows are WfTrackItems made on demand,
+ * so a list view only ever holds objects for the rows it shows; the model
+ * itself is two arrays of indices, and none at all while it is neither
+ * sorted nor filtered.
+ *
+ * Sorting and filtering run on a worker thread over a snapshot of the
+ * store. Changes to the store are applied in place where that is cheap;
+ * new tracks show up with the next refresh, which is held back a little
+ * so that a scan adding thousands of tracks refreshes only now and then.
+ *
+ * Filtering looks candidates up in a trigram index, built on the worker
+ * the first time and brought up to date before each refresh after that.
+ * A filter that only adds to the one the rows were made for narrows
+ * those rows down rather than starting over, which keeps their order and
+ * spares the sort.
+ */
+
+#define REFRESH_DELAY 250  /* milliseconds */
+#define CANCEL_CHECK  4096
+
+#define BIT_IS_SET(bits, i) ((bits)[(i) / 8] & (1 << ((i) % 8)))
+#define BIT_SET(bits, i)    ((bits)[(i) / 8] |= 1 << ((i) % 8))
+
+struct _WfTrackList
+{
+    GObject parent;
+
+    WfTrackStore *store;
+    WfTrackSort sort;
+    gchar *filter;
+
+    /* Store index by position, and position by store index or
+     * G_MAXUINT32; both NULL while the list is the store as it is. */
+    GArray *rows;
+    GArray *positions;
+
+    /* Bumped on every store change, and on those that renumber it. */
+    guint generation;
+    guint layout;
+
+    /* What the rows were made for. */
+    gchar *rows_filter;
+    WfTrackSort rows_sort;
+    guint rows_generation;
+
+    /* Workers read the index while index_users is non-zero, and changed
+     * tracks wait in reindex until they are done. */
+    WfSearchIndex *index;
+    guint index_users;
+    gboolean building;
+    GArray *reindex;
+
+    GCancellable *cancellable;
+    gboolean running;
+    guint refresh_id;
+    gboolean busy;
+};
+
+typedef struct
+{
+    WfTrackSnapshot *snapshot;
+    WfTrackSort sort;
+    gchar *filter;
+    guint generation;
+    guint layout;
+
+    /* The rows to narrow down, if any. */
+    GArray *within;
+
+    /* The index to use, or whether to build one. */
+    WfSearchIndex *index;
+    gboolean build;
+    WfSearchIndex *built;
+} RefreshData;
+
+typedef struct
+{
+    guint32 index;
+    gchar *key;
+    guint64 value;
+} SortKey;
+
+enum
+{
+    PROP_ZERO,
+    PROP_BUSY,
+    N_PROPS
+};
+
+static GParamSpec *properties[N_PROPS] = {NULL, };
+
+static void get_property (GObject    *object,
+                          guint       property_id,
+                          GValue     *value,
+                          GParamSpec *pspec);
+static void dispose      (GObject *object);
+static void finalize     (GObject *object);
+
+static void list_model_iface_init (GListModelInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (WfTrackList, wf_track_list, G_TYPE_OBJECT,
+                               G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, list_model_iface_init))
+
+static void
+wf_track_list_class_init (WfTrackListClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->get_property = get_property;
+    object_class->dispose = dispose;
+    object_class->finalize = finalize;
+
+    /* Set while a sort or filter is pending or running. */
+    properties[PROP_BUSY] =
+        g_param_spec_boolean ("busy",
+                              NULL, NULL,
+                              FALSE, G_PARAM_READABLE);
+
+    g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+wf_track_list_init (WfTrackList *self)
+{
+    self->cancellable = g_cancellable_new ();
+    self->reindex = g_array_new (FALSE, FALSE, sizeof (guint32));
+}
+
+static void
+dispose (GObject *object)
+{
+    WfTrackList *list = WF_TRACK_LIST (object);
+
+    g_cancellable_cancel (list->cancellable);
+    g_clear_handle_id (&list->refresh_id, g_source_remove);
+    if (list->store)
+        g_signal_handlers_disconnect_by_data (list->store, list);
+    g_clear_object (&list->store);
+
+    G_OBJECT_CLASS (wf_track_list_parent_class)->dispose (object);
+}
+
+static void
+finalize (GObject *object)
+{
+    WfTrackList *list = WF_TRACK_LIST (object);
+
+    g_clear_pointer (&list->rows, g_array_unref);
+    g_clear_pointer (&list->positions, g_array_unref);
+    g_clear_pointer (&list->index, wf_search_index_unref);
+    g_array_unref (list->reindex);
+    g_object_unref (list->cancellable);
+    g_free (list->rows_filter);
+    g_free (list->filter);
+
+    G_OBJECT_CLASS (wf_track_list_parent_class)->finalize (object);
+}
+
+static void
+get_property (GObject    *object,
+              guint       property_id,
+              GValue     *value,
+              GParamSpec *pspec)
+{
+    WfTrackList *list = WF_TRACK_LIST (object);
+
+    switch (property_id) {
+    case PROP_BUSY:
+        g_value_set_boolean (value, list->busy);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static GType
+get_item_type (GListModel *model)
+{
+    return WF_TYPE_TRACK_ITEM;
+}
+
+static guint
+get_n_items (GListModel *model)
+{
+    WfTrackList *self = WF_TRACK_LIST (model);
+
+    if (self->rows)
+        return self->rows->len;
+
+    return self->store ? wf_track_store_get_n_tracks (self->store) : 0;
+}
+
+static gpointer
+get_item (GListModel *model,
+          guint       position)
+{
+    WfTrackList *self = WF_TRACK_LIST (model);
+    WfTrack track;
+    gint index;
+
+    index = wf_track_list_get_index (self, position);
+    if (index < 0)
+        return NULL;
+
+    wf_track_store_get_track (self->store, index, &track);
+    return wf_track_item_new (&track);
+}
+
+static void
+list_model_iface_init (GListModelInterface *iface)
+{
+    iface->get_item_type = get_item_type;
+    iface->get_n_items = get_n_items;
+    iface->get_item = get_item;
+}
+
+static void
+set_busy (WfTrackList *self,
+          gboolean     busy)
+{
+    if (self->busy == busy)
+        return;
+
+    self->busy = busy;
+    g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_BUSY]);
+}
+
+static void
+refresh_data_free (RefreshData *data)
+{
+    wf_track_snapshot_free (data->snapshot);
+    g_clear_pointer (&data->within, g_array_unref);
+    g_clear_pointer (&data->index, wf_search_index_unref);
+    g_clear_pointer (&data->built, wf_search_index_unref);
+    g_free (data->filter);
+    g_free (data);
+}
+
+static gint
+compare_keys (gconstpointer a,
+              gconstpointer b)
+{
+    const SortKey *key_a = a;
+    const SortKey *key_b = b;
+    gint ret;
+
+    if (key_a->key && key_b->key) {
+        /* Tracks without the tag go last. */
+        if (*key_a->key == '\0' || *key_b->key == '\0')
+            ret = (*key_a->key == '\0') - (*key_b->key == '\0');
+        else
+            ret = strcmp (key_a->key, key_b->key);
+    } else {
+        ret = (key_a->value > key_b->value) - (key_a->value < key_b->value);
+    }
+
+    if (ret == 0)
+        ret = (key_a->index > key_b->index) - (key_a->index < key_b->index);
+
+    return ret;
+}
+
+static const gchar *
+sort_string (const WfTrack *track,
+             WfTrackSort    sort)
+{
+    switch (sort) {
+    case WF_TRACK_SORT_TITLE:
+        return track->title;
+    case WF_TRACK_SORT_ARTIST:
+        return track->artist;
+    case WF_TRACK_SORT_ALBUM:
+        return track->album;
+    case WF_TRACK_SORT_NONE:
+    case WF_TRACK_SORT_DURATION:
+    default:
+        return NULL;
+    }
+}
+
+/* Marks the tracks that match in @found, looking at the candidates from
+ * the index, or failing that the rows being narrowed down or all of them. */
+static void
+find_matches (RefreshData   *data,
+              WfSearchIndex *index,
+              guint8        *found,
+              GCancellable  *cancellable)
+{
+    const guint32 *indices = NULL;
+    GArray *candidates = NULL;
+    guint8 *in_within = NULL;
+    guint n_tracks, n;
+    guint32 track_index;
+    WfTrack track;
+
+    n = n_tracks = wf_track_snapshot_get_n_tracks (data->snapshot);
+    if (index)
+        candidates = wf_search_index_query (index, data->filter);
+
+    if (candidates) {
+        indices = (const guint32 *) candidates->data;
+        n = candidates->len;
+        if (data->within) {
+            in_within = g_new0 (guint8, n_tracks / 8 + 1);
+            for (guint i = 0; i < data->within->len; i++)
+                BIT_SET (in_within, g_array_index (data->within, guint32, i));
+        }
+    } else if (data->within) {
+        indices = (const guint32 *) data->within->data;
+        n = data->within->len;
+    }
+
+    for (guint i = 0; i < n; i++) {
+        if (i % CANCEL_CHECK == 0 && g_cancellable_is_cancelled (cancellable))
+            break;
+
+        track_index = indices ? indices[i] : i;
+        if (track_index >= n_tracks || (in_within && !BIT_IS_SET (in_within, track_index)))
+            continue;
+
+        wf_track_snapshot_get_track (data->snapshot, track_index, &track);
+        if (wf_search_index_match (&track, data->filter))
+            BIT_SET (found, track_index);
+    }
+
+    g_free (in_within);
+    if (candidates)
+        g_array_unref (candidates);
+}
+
+static void
+refresh_thread (GTask        *task,
+                gpointer      source_object,
+                gpointer      task_data,
+                GCancellable *cancellable)
+{
+    RefreshData *data = task_data;
+    guint8 *found = NULL;
+    SortKey *keys = NULL;
+    const gchar *str;
+    GArray *rows;
+    WfTrack track;
+    guint n_tracks, n_keys = 0;
+    guint32 index;
+
+    n_tracks = wf_track_snapshot_get_n_tracks (data->snapshot);
+    rows = g_array_sized_new (FALSE, FALSE, sizeof (guint32), n_tracks);
+
+    /* Not cancelled halfway: the next filter needs the index as well. */
+    if (data->build)
+        data->built = wf_search_index_new_from_snapshot (data->snapshot);
+
+    if (data->filter) {
+        found = g_new0 (guint8, n_tracks / 8 + 1);
+        find_matches (data, data->index ? data->index : data->built, found, cancellable);
+    }
+
+    if (data->within) {
+        for (guint i = 0; i < data->within->len; i++) {
+            index = g_array_index (data->within, guint32, i);
+            if (index < n_tracks && BIT_IS_SET (found, index))
+                g_array_append_val (rows, index);
+        }
+        goto out;
+    }
+
+    if (data->sort != WF_TRACK_SORT_NONE)
+        keys = g_new (SortKey, n_tracks);
+
+    for (index = 0; index < n_tracks; index++) {
+        if (index % CANCEL_CHECK == 0 && g_cancellable_is_cancelled (cancellable))
+            break;
+
+        if (found && !BIT_IS_SET (found, index))
+            continue;
+
+        if (!keys) {
+            g_array_append_val (rows, index);
+            continue;
+        }
+
+        wf_track_snapshot_get_track (data->snapshot, index, &track);
+        str = sort_string (&track, data->sort);
+        keys[n_keys].index = index;
+        keys[n_keys].key = str ? g_utf8_collate_key (str, -1) : NULL;
+        keys[n_keys].value = track.duration;
+        n_keys++;
+    }
+
+    if (keys) {
+        if (!g_cancellable_is_cancelled (cancellable))
+            qsort (keys, n_keys, sizeof (SortKey), compare_keys);
+        for (guint i = 0; i < n_keys; i++) {
+            g_array_append_val (rows, keys[i].index);
+            g_free (keys[i].key);
+        }
+        g_free (keys);
+    }
+
+out:
+    g_free (found);
+
+    if (g_task_return_error_if_cancelled (task))
+        g_array_unref (rows);
+    else
+        g_task_return_pointer (task, rows, (GDestroyNotify) g_array_unref);
+}
+
+#define ROW_AT(rows, i) ((rows) ? g_array_index ((rows), guint32, (i)) : (i))
+
+/* Only the rows between what the old and new ones have in common at
+ * either end are reported changed, so a view keeps its place when a
+ * filter narrows the list down or a refresh adds a few tracks. */
+static void
+set_rows (WfTrackList *self,
+          GArray      *rows)
+{
+    guint old_len, new_len, n_tracks, prefix = 0, suffix = 0;
+    guint32 none = G_MAXUINT32;
+    GArray *old_rows;
+
+    n_tracks = wf_track_store_get_n_tracks (self->store);
+    old_rows = self->rows;
+    old_len = get_n_items (G_LIST_MODEL (self));
+    new_len = rows ? rows->len : n_tracks;
+
+    while (prefix < old_len && prefix < new_len &&
+           ROW_AT (old_rows, prefix) == ROW_AT (rows, prefix))
+        prefix++;
+    while (suffix < old_len - prefix && suffix < new_len - prefix &&
+           ROW_AT (old_rows, old_len - 1 - suffix) == ROW_AT (rows, new_len - 1 - suffix))
+        suffix++;
+
+    g_clear_pointer (&self->rows, g_array_unref);
+    g_clear_pointer (&self->positions, g_array_unref);
+
+    if (rows) {
+        self->rows = rows;
+        self->positions = g_array_sized_new (FALSE, FALSE, sizeof (guint32), n_tracks);
+        for (guint i = 0; i < n_tracks; i++)
+            g_array_append_val (self->positions, none);
+        for (guint p = 0; p < rows->len; p++)
+            g_array_index (self->positions, guint32, g_array_index (rows, guint32, p)) = p;
+    }
+
+    if (old_len - prefix - suffix > 0 || new_len - prefix - suffix > 0)
+        g_list_model_items_changed (G_LIST_MODEL (self), prefix,
+                                    old_len - prefix - suffix, new_len - prefix - suffix);
+    if (old_rows)
+        g_array_unref (old_rows);
+}
+
+static void
+drop_index (WfTrackList *self)
+{
+    g_clear_pointer (&self->index, wf_search_index_unref);
+    self->index_users = 0;
+    g_array_set_size (self->reindex, 0);
+}
+
+/* Marks the tracks changed while the index was being read or built. */
+static void
+flush_reindex (WfTrackList *self)
+{
+    gboolean valid = TRUE;
+
+    for (guint i = 0; i < self->reindex->len; i++)
+        valid &= wf_search_index_invalidate (self->index, g_array_index (self->reindex, guint32, i));
+    g_array_set_size (self->reindex, 0);
+
+    if (!valid)
+        drop_index (self);
+}
+
+static void
+reindex (WfTrackList *self,
+         guint        index)
+{
+    if (self->index && self->index_users == 0) {
+        if (!wf_search_index_invalidate (self->index, index))
+            drop_index (self);
+    } else if (self->index || self->building) {
+        g_array_append_val (self->reindex, index);
+    }
+}
+
+/* Adds the tracks the store gained since the index last saw it. */
+static void
+catch_up (WfTrackList *self)
+{
+    WfTrack track;
+    guint n_tracks;
+
+    flush_reindex (self);
+    if (!self->index)
+        return;
+
+    n_tracks = wf_track_store_get_n_tracks (self->store);
+    for (guint i = wf_search_index_get_n_tracks (self->index); i < n_tracks; i++) {
+        wf_track_store_get_track (self->store, i, &track);
+        wf_search_index_add (self->index, &track);
+    }
+}
+
+static void schedule_refresh (WfTrackList *self);
+
+/* A result computed before tracks were added still has valid indices and
+ * is shown while the next refresh picks the new tracks up. One from
+ * before tracks were removed is not. */
+static void
+refresh_done_cb (GObject      *source,
+                 GAsyncResult *result,
+                 gpointer      user_data)
+{
+    WfTrackList *self = WF_TRACK_LIST (source);
+    RefreshData *data = g_task_get_task_data (G_TASK (result));
+    GArray *rows;
+
+    if (data->index && data->index == self->index && --self->index_users == 0)
+        flush_reindex (self);
+
+    if (data->build) {
+        self->building = FALSE;
+        if (data->built && data->layout == self->layout && !self->index) {
+            self->index = g_steal_pointer (&data->built);
+            flush_reindex (self);
+        } else {
+            g_array_set_size (self->reindex, 0);
+        }
+    }
+
+    rows = g_task_propagate_pointer (G_TASK (result), NULL);
+    if (!rows)
+        return;
+
+    self->running = FALSE;
+    if (data->layout == self->layout && self->store) {
+        set_rows (self, rows);
+        g_free (self->rows_filter);
+        self->rows_filter = g_strdup (data->filter);
+        self->rows_sort = data->sort;
+        self->rows_generation = data->generation;
+    } else {
+        g_array_unref (rows);
+    }
+
+    if (data->generation != self->generation || data->layout != self->layout)
+        schedule_refresh (self);
+    else
+        set_busy (self, self->refresh_id != 0);
+}
+
+/* Starts a refresh, narrowing @within down if given. */
+static void
+start_refresh (WfTrackList *self,
+               GArray      *within)
+{
+    RefreshData *data;
+    GTask *task;
+
+    g_cancellable_cancel (self->cancellable);
+    g_object_unref (self->cancellable);
+    self->cancellable = g_cancellable_new ();
+
+    data = g_new0 (RefreshData, 1);
+    data->snapshot = wf_track_store_snapshot (self->store);
+    data->sort = self->sort;
+    data->filter = g_strdup (self->filter);
+    data->generation = self->generation;
+    data->layout = self->layout;
+    data->within = within;
+
+    /* While a cancelled refresh still reads the index it cannot be
+     * brought up to date, and this one goes without. */
+    if (self->filter) {
+        if (self->index && self->index_users == 0)
+            catch_up (self);
+
+        if (self->index && self->reindex->len == 0 &&
+            wf_search_index_get_n_tracks (self->index) == wf_track_snapshot_get_n_tracks (data->snapshot)) {
+            data->index = wf_search_index_ref (self->index);
+            self->index_users++;
+        } else if (!self->index && !self->building) {
+            data->build = TRUE;
+            self->building = TRUE;
+        }
+    }
+
+    task = g_task_new (self, self->cancellable, refresh_done_cb, NULL);
+    g_task_set_task_data (task, data, (GDestroyNotify) refresh_data_free);
+    g_task_run_in_thread (task, refresh_thread);
+    g_object_unref (task);
+
+    self->running = TRUE;
+    set_busy (self, TRUE);
+}
+
+static gboolean
+refresh_cb (gpointer user_data)
+{
+    WfTrackList *self = WF_TRACK_LIST (user_data);
+
+    self->refresh_id = 0;
+    if (!self->running)
+        start_refresh (self, NULL);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* A refresh that is already running is left to finish; its result says
+ * whether another one is needed. */
+static void
+schedule_refresh (WfTrackList *self)
+{
+    if ((self->sort == WF_TRACK_SORT_NONE && !self->filter) ||
+        self->running || self->refresh_id)
+        return;
+
+    self->refresh_id = g_timeout_add (REFRESH_DELAY, refresh_cb, self);
+    set_busy (self, TRUE);
+}
+
+/* Sort or filter changed: whatever is running is out of date. A filter
+ * that contains the one the rows were made for, with the store as it was
+ * then, only needs those rows narrowed down. */
+static void
+restart (WfTrackList *self)
+{
+    GArray *within = NULL;
+
+    g_clear_handle_id (&self->refresh_id, g_source_remove);
+
+    if (self->sort == WF_TRACK_SORT_NONE && !self->filter) {
+        g_cancellable_cancel (self->cancellable);
+        self->running = FALSE;
+        g_clear_pointer (&self->rows_filter, g_free);
+        if (self->rows)
+            set_rows (self, NULL);
+        set_busy (self, FALSE);
+        return;
+    }
+
+    if (self->rows && self->filter && self->rows_filter &&
+        self->rows_sort == self->sort &&
+        self->rows_generation == self->generation &&
+        strstr (self->filter, self->rows_filter))
+        within = g_array_copy (self->rows);
+
+    start_refresh (self, within);
+}
+
+/* Drops the rows of removed tracks and renumbers the rest. */
+static void
+renumber (WfTrackList *self,
+          guint        position,
+          guint        removed,
+          guint        added)
+{
+    GArray *rows;
+    guint32 index;
+
+    rows = g_array_sized_new (FALSE, FALSE, sizeof (guint32), self->rows->len);
+    for (guint p = 0; p < self->rows->len; p++) {
+        index = g_array_index (self->rows, guint32, p);
+        if (index >= position && index < position + removed)
+            continue;
+        if (index >= position + removed)
+            index = index - removed + added;
+        g_array_append_val (rows, index);
+    }
+
+    set_rows (self, rows);
+}
+
+static void
+store_changed_cb (WfTrackList  *self,
+                  guint         position,
+                  guint         removed,
+                  guint         added,
+                  WfTrackStore *store)
+{
+    guint32 none = G_MAXUINT32;
+    gboolean update, append;
+    guint32 p;
+
+    update = removed == 1 && added == 1;
+    append = removed == 0 && position + added == wf_track_store_get_n_tracks (store);
+
+    /* Removals renumber the tracks after them. The index follows them
+     * unless a refresh is reading it; a store loaded anew replaces all
+     * of them, and the index goes. */
+    self->generation++;
+    if (update) {
+        reindex (self, position);
+    } else if (!append) {
+        self->layout++;
+        if (!self->index || self->index_users > 0 ||
+            !wf_search_index_remove (self->index, store, position, removed, added))
+            drop_index (self);
+    }
+
+    if (!self->rows) {
+        g_list_model_items_changed (G_LIST_MODEL (self), position, removed, added);
+        return;
+    }
+
+    if (update) {
+        p = g_array_index (self->positions, guint32, position);
+        if (p != none)
+            g_list_model_items_changed (G_LIST_MODEL (self), p, 1, 1);
+    } else if (append) {
+        for (guint i = 0; i < added; i++)
+            g_array_append_val (self->positions, none);
+    } else {
+        renumber (self, position, removed, added);
+    }
+
+    schedule_refresh (self);
+}
+
+WfTrackList *
+wf_track_list_new (WfTrackStore *store)
+{
+    WfTrackList *self;
+
+    g_return_val_if_fail (WF_IS_TRACK_STORE (store), NULL);
+
+    self = g_object_new (WF_TYPE_TRACK_LIST, NULL);
+    self->store = g_object_ref (store);
+    g_signal_connect_swapped (store, "items-changed", G_CALLBACK (store_changed_cb), self);
+
+    return self;
+}
+
+void
+wf_track_list_set_sort (WfTrackList *self,
+                        WfTrackSort  sort)
+{
+    g_return_if_fail (WF_IS_TRACK_LIST (self));
+
+    if (self->sort == sort)
+        return;
+
+    self->sort = sort;
+    restart (self);
+}
+
+WfTrackSort
+wf_track_list_get_sort (WfTrackList *self)
+{
+    g_return_val_if_fail (WF_IS_TRACK_LIST (self), WF_TRACK_SORT_NONE);
+
+    return self->sort;
+}
+
+/* Keeps the tracks whose title, artist, album or file name contain
+ * @filter, ignoring case. NULL or empty shows all of them. */
+void
+wf_track_list_set_filter (WfTrackList *self,
+                          const gchar *filter)
+{
+    gchar *folded = NULL;
+
+    g_return_if_fail (WF_IS_TRACK_LIST (self));
+
+    if (filter && *filter)
+        folded = g_utf8_casefold (filter, -1);
+
+    if (g_strcmp0 (self->filter, folded) == 0) {
+        g_free (folded);
+        return;
+    }
+
+    g_free (self->filter);
+    self->filter = folded;
+    restart (self);
+}
+
+gboolean
+wf_track_list_get_busy (WfTrackList *self)
+{
+    g_return_val_if_fail (WF_IS_TRACK_LIST (self), FALSE);
+
+    return self->busy;
+}
+
+/* Returns the store index of the track at @position, or -1. */
+gint
+wf_track_list_get_index (WfTrackList *self,
+                         guint        position)
+{
+    g_return_val_if_fail (WF_IS_TRACK_LIST (self), -1);
+
+    if (self->rows)
+        return position < self->rows->len ? (gint) g_array_index (self->rows, guint32, position) : -1;
+
+    return position < get_n_items (G_LIST_MODEL (self)) ? (gint) position : -1;
+}
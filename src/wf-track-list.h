@@ -0,0 +1,53 @@
+/*
+ * wf-track-list.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "wf-track-store.h"
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+    WF_TRACK_SORT_NONE,
+    WF_TRACK_SORT_TITLE,
+    WF_TRACK_SORT_ARTIST,
+    WF_TRACK_SORT_ALBUM,
+    WF_TRACK_SORT_DURATION,
+} WfTrackSort;
+
+#define WF_TYPE_TRACK_LIST (wf_track_list_get_type ())
+G_DECLARE_FINAL_TYPE (WfTrackList, wf_track_list, WF, TRACK_LIST, GObject)
+
+WfTrackList *wf_track_list_new        (WfTrackStore *store);
+
+void         wf_track_list_set_sort   (WfTrackList *self,
+                                       WfTrackSort  sort);
+WfTrackSort  wf_track_list_get_sort   (WfTrackList *self);
+void         wf_track_list_set_filter (WfTrackList *self,
+                                       const gchar *filter);
+gboolean     wf_track_list_get_busy   (WfTrackList *self);
+gint         wf_track_list_get_index  (WfTrackList *self,
+                                       guint        position);
+
+G_END_DECLS
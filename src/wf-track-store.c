@@ -0,0 +1,914 @@
+/*
+ * wf-track-store.c
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "wf-track-store.h"
+
+/*
+ * Track metadata kept column by column, with all strings in one pool and
+ * referred to by offset. A library of 100k tracks is a handful of flat
+ * allocations rather than hundreds of thousands of small ones.
+ *
+ * The columns come in refcounted chunks of CHUNK_TRACKS rows, and the
+ * pool in pages that are only ever appended to. A snapshot for the track
+ * list takes references to the chunks and the pool blocks instead of
+ * copying them, and the store copies a chunk only before changing rows a
+ * snapshot may still see. Appending writes past the rows of every
+ * snapshot, so a scan that adds tracks copies nothing.
+ *
+ * The on-disk index is the same layout behind a header, in host byte
+ * order, so loading it is a mapping: the chunks and pages point straight
+ * into the file until a change copies the chunk it touches. Only used from
+ * the main thread.
+ */
+
+#define INDEX_MAGIC   0x42494657 /* "WFIB" */
+#define INDEX_VERSION 2
+
+#define CHUNK_SHIFT  12
+#define CHUNK_TRACKS (1u << CHUNK_SHIFT)
+#define CHUNK_MASK   (CHUNK_TRACKS - 1)
+
+#define POOL_PAGE_SHIFT 16
+#define POOL_PAGE       ((gsize) 1 << POOL_PAGE_SHIFT)
+#define POOL_PAGE_MASK  (POOL_PAGE - 1)
+#define POOL_BLOCK      (4 * POOL_PAGE)
+
+/* Below this the pool is left to grow until the next save. */
+#define POOL_COMPACT_MIN (1024 * 1024)
+
+typedef enum
+{
+    COLUMN_URI,
+    COLUMN_TITLE,
+    COLUMN_ARTIST,
+    COLUMN_ALBUM,
+    COLUMN_COVER,
+    COLUMN_DURATION,
+    COLUMN_MTIME,
+    COLUMN_SIZE,
+    N_COLUMNS
+} Column;
+
+#define N_STRING_COLUMNS (COLUMN_COVER + 1)
+
+/* String columns first, so the 8 byte columns stay aligned in the file. */
+static const gsize column_size[N_COLUMNS] = {4, 4, 4, 4, 4, 8, 8, 8};
+#define ROW_SIZE (N_STRING_COLUMNS * 4 + (N_COLUMNS - N_STRING_COLUMNS) * 8)
+
+typedef struct
+{
+    guint32 magic;
+    guint32 version;
+    guint32 n_tracks;
+    guint32 pool_size;
+    guint32 reserved[4];
+} IndexHeader;
+
+/* CHUNK_TRACKS rows of every column, in one allocation after the struct
+ * or in the mapped index. */
+typedef struct
+{
+    gatomicrefcount ref_count;
+    GMappedFile *map;
+    gpointer columns[N_COLUMNS];
+} Chunk;
+
+/* Consecutive pool pages, allocated at once or in the mapped index. */
+typedef struct
+{
+    gatomicrefcount ref_count;
+    GMappedFile *map;
+    gchar *data;
+} PoolBlock;
+
+struct _WfTrackStore
+{
+    GObject parent;
+
+    guint n_tracks;
+
+    /* Chunk i holds rows i * CHUNK_TRACKS on. The rows of the last chunk
+     * past n_tracks are never seen by a snapshot, so it is appended to
+     * in place. */
+    GPtrArray *chunks;
+
+    /* Offset o is at pages[o >> POOL_PAGE_SHIFT] + (o & POOL_PAGE_MASK);
+     * a string never crosses from one block into the next. */
+    GPtrArray *pages;
+    GPtrArray *blocks;
+    gsize pool_size;
+    gsize pool_end;
+
+    /* Pool size when it was last compacted or loaded. */
+    gsize pool_compacted;
+
+    /* Open addressing table of index + 1 by uri, built on first lookup. */
+    guint32 *slots;
+    guint n_slots;
+};
+
+/* Holds references to the chunks and pool blocks the store had when it
+ * was taken. */
+struct _WfTrackSnapshot
+{
+    guint n_tracks;
+    Chunk **chunks;
+    guint n_chunks;
+    const gchar **pages;
+    PoolBlock **blocks;
+    guint n_blocks;
+};
+
+enum
+{
+    ITEMS_CHANGED,
+    N_SIGNALS
+};
+
+static guint signals[N_SIGNALS] = {0, };
+
+static inline gpointer
+cell_at (Chunk * const *chunks,
+         Column         column,
+         guint          index)
+{
+    return (guint8 *) chunks[index >> CHUNK_SHIFT]->columns[column] +
+           (gsize) (index & CHUNK_MASK) * column_size[column];
+}
+
+static inline const gchar *
+string_at (Chunk * const       *chunks,
+           const gchar * const *pages,
+           Column               column,
+           guint                index)
+{
+    guint32 offset = *(const guint32 *) cell_at (chunks, column, index);
+
+    return pages[offset >> POOL_PAGE_SHIFT] + (offset & POOL_PAGE_MASK);
+}
+
+#define STRING_AT(self, column, index) \
+    string_at ((Chunk * const *) (self)->chunks->pdata, \
+               (const gchar * const *) (self)->pages->pdata, column, index)
+#define UINT64_AT(self, column, index) \
+    (*(const guint64 *) cell_at ((Chunk * const *) (self)->chunks->pdata, column, index))
+#define SNAPSHOT_STRING_AT(self, column, index) \
+    string_at ((self)->chunks, (self)->pages, column, index)
+#define SNAPSHOT_UINT64_AT(self, column, index) \
+    (*(const guint64 *) cell_at ((self)->chunks, column, index))
+
+static void finalize (GObject *object);
+
+G_DEFINE_FINAL_TYPE (WfTrackStore, wf_track_store, G_TYPE_OBJECT)
+
+static void
+wf_track_store_class_init (WfTrackStoreClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->finalize = finalize;
+
+    /* Same arguments as GListModel::items-changed. */
+    signals[ITEMS_CHANGED] =
+        g_signal_new ("items-changed",
+                      G_TYPE_FROM_CLASS (object_class),
+                      G_SIGNAL_RUN_LAST,
+                      0, NULL, NULL, NULL,
+                      G_TYPE_NONE, 3, G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT);
+}
+
+static Chunk *
+chunk_new (void)
+{
+    Chunk *chunk;
+    guint8 *data;
+
+    chunk = g_malloc (sizeof (Chunk) + (gsize) CHUNK_TRACKS * ROW_SIZE);
+    g_atomic_ref_count_init (&chunk->ref_count);
+    chunk->map = NULL;
+
+    data = (guint8 *) (chunk + 1);
+    for (guint c = 0; c < N_COLUMNS; c++) {
+        chunk->columns[c] = data;
+        data += (gsize) CHUNK_TRACKS * column_size[c];
+    }
+
+    return chunk;
+}
+
+static Chunk *
+chunk_new_mapped (GMappedFile         *map,
+                  const gconstpointer *columns,
+                  guint                first)
+{
+    Chunk *chunk;
+
+    chunk = g_new (Chunk, 1);
+    g_atomic_ref_count_init (&chunk->ref_count);
+    chunk->map = g_mapped_file_ref (map);
+    for (guint c = 0; c < N_COLUMNS; c++)
+        chunk->columns[c] = (guint8 *) columns[c] + (gsize) first * column_size[c];
+
+    return chunk;
+}
+
+static Chunk *
+chunk_ref (Chunk *chunk)
+{
+    g_atomic_ref_count_inc (&chunk->ref_count);
+    return chunk;
+}
+
+static void
+chunk_unref (gpointer data)
+{
+    Chunk *chunk = data;
+
+    if (!g_atomic_ref_count_dec (&chunk->ref_count))
+        return;
+
+    g_clear_pointer (&chunk->map, g_mapped_file_unref);
+    g_free (chunk);
+}
+
+static PoolBlock *
+pool_block_new (gchar       *data,
+                GMappedFile *map)
+{
+    PoolBlock *block;
+
+    block = g_new (PoolBlock, 1);
+    g_atomic_ref_count_init (&block->ref_count);
+    block->map = map ? g_mapped_file_ref (map) : NULL;
+    block->data = data;
+
+    return block;
+}
+
+static PoolBlock *
+pool_block_ref (PoolBlock *block)
+{
+    g_atomic_ref_count_inc (&block->ref_count);
+    return block;
+}
+
+static void
+pool_block_unref (gpointer data)
+{
+    PoolBlock *block = data;
+
+    if (!g_atomic_ref_count_dec (&block->ref_count))
+        return;
+
+    if (block->map)
+        g_mapped_file_unref (block->map);
+    else
+        g_free (block->data);
+    g_free (block);
+}
+
+/* Adds pages for at least @length bytes, after the last page. */
+static void
+add_pool_block (WfTrackStore *self,
+                gsize         length)
+{
+    gsize n_pages;
+    gchar *data;
+
+    n_pages = (MAX (length, POOL_BLOCK) + POOL_PAGE - 1) >> POOL_PAGE_SHIFT;
+    data = g_malloc (n_pages << POOL_PAGE_SHIFT);
+    g_ptr_array_add (self->blocks, pool_block_new (data, NULL));
+    for (gsize p = 0; p < n_pages; p++)
+        g_ptr_array_add (self->pages, data + (p << POOL_PAGE_SHIFT));
+
+    self->pool_size = self->pool_end;
+    self->pool_end += n_pages << POOL_PAGE_SHIFT;
+}
+
+static void
+clear_storage (WfTrackStore *self)
+{
+    g_ptr_array_set_size (self->chunks, 0);
+    g_ptr_array_set_size (self->pages, 0);
+    g_ptr_array_set_size (self->blocks, 0);
+    self->pool_size = self->pool_end = 0;
+    g_clear_pointer (&self->slots, g_free);
+}
+
+/* Offset 0 is the empty string. */
+static void
+reset_pool (WfTrackStore *self)
+{
+    add_pool_block (self, 1);
+    *(gchar *) self->pages->pdata[0] = '\0';
+    self->pool_size = 1;
+    self->pool_compacted = POOL_COMPACT_MIN;
+}
+
+/* Returns the chunk of row @index, copied first if a snapshot or the
+ * mapped index shares it. */
+static Chunk *
+writable_chunk (WfTrackStore *self,
+                guint         index)
+{
+    guint k = index >> CHUNK_SHIFT;
+    Chunk *chunk = g_ptr_array_index (self->chunks, k), *copy;
+    gsize n_rows;
+
+    if (!chunk->map && g_atomic_ref_count_compare (&chunk->ref_count, 1))
+        return chunk;
+
+    copy = chunk_new ();
+    n_rows = MIN (CHUNK_TRACKS, self->n_tracks - (k << CHUNK_SHIFT));
+    for (guint c = 0; c < N_COLUMNS; c++)
+        memcpy (copy->columns[c], chunk->columns[c], n_rows * column_size[c]);
+
+    self->chunks->pdata[k] = copy;
+    chunk_unref (chunk);
+
+    return copy;
+}
+
+/* Drops the chunks past the last row after removals, and makes sure the
+ * last one can be appended to in place. */
+static void
+truncate_chunks (WfTrackStore *self,
+                 guint         n_tracks)
+{
+    self->n_tracks = n_tracks;
+    g_ptr_array_set_size (self->chunks, (n_tracks + CHUNK_MASK) >> CHUNK_SHIFT);
+    if (n_tracks & CHUNK_MASK)
+        writable_chunk (self, n_tracks - 1);
+}
+
+static void
+wf_track_store_init (WfTrackStore *self)
+{
+    self->chunks = g_ptr_array_new_with_free_func (chunk_unref);
+    self->pages = g_ptr_array_new ();
+    self->blocks = g_ptr_array_new_with_free_func (pool_block_unref);
+    reset_pool (self);
+}
+
+static void
+finalize (GObject *object)
+{
+    WfTrackStore *self = WF_TRACK_STORE (object);
+
+    g_ptr_array_unref (self->chunks);
+    g_ptr_array_unref (self->pages);
+    g_ptr_array_unref (self->blocks);
+    g_free (self->slots);
+
+    G_OBJECT_CLASS (wf_track_store_parent_class)->finalize (object);
+}
+
+WfTrackStore *
+wf_track_store_new (void)
+{
+    return g_object_new (WF_TYPE_TRACK_STORE, NULL);
+}
+
+gboolean
+wf_track_store_load (WfTrackStore  *self,
+                     const gchar   *path,
+                     GError       **error)
+{
+    gconstpointer columns[N_COLUMNS];
+    GMappedFile *map;
+    IndexHeader header;
+    const gchar *data, *pool;
+    gsize length, offset, n_pages;
+    guint old_n_tracks;
+
+    g_return_val_if_fail (WF_IS_TRACK_STORE (self), FALSE);
+    g_return_val_if_fail (path != NULL, FALSE);
+
+    map = g_mapped_file_new (path, FALSE, error);
+    if (!map)
+        return FALSE;
+
+    data = g_mapped_file_get_contents (map);
+    length = g_mapped_file_get_length (map);
+    if (length < sizeof (header))
+        goto invalid;
+
+    memcpy (&header, data, sizeof (header));
+    offset = sizeof (header);
+    for (guint c = 0; c < N_COLUMNS; c++) {
+        columns[c] = data + offset;
+        offset += (gsize) header.n_tracks * column_size[c];
+    }
+    pool = data + offset;
+
+    if (header.magic != INDEX_MAGIC || header.version != INDEX_VERSION ||
+        header.pool_size == 0 || length != offset + header.pool_size ||
+        pool[header.pool_size - 1] != '\0')
+        goto invalid;
+
+    for (guint c = 0; c < N_STRING_COLUMNS; c++)
+        for (guint i = 0; i < header.n_tracks; i++)
+            if (((const guint32 *) columns[c])[i] >= header.pool_size)
+                goto invalid;
+
+    old_n_tracks = self->n_tracks;
+    clear_storage (self);
+
+    for (guint i = 0; i < header.n_tracks; i += CHUNK_TRACKS)
+        g_ptr_array_add (self->chunks, chunk_new_mapped (map, columns, i));
+
+    /* The pages of the mapped pool end where the file does; new strings
+     * go to a block of their own after them. */
+    n_pages = (header.pool_size + POOL_PAGE - 1) >> POOL_PAGE_SHIFT;
+    g_ptr_array_add (self->blocks, pool_block_new ((gchar *) pool, map));
+    for (gsize p = 0; p < n_pages; p++)
+        g_ptr_array_add (self->pages, (gchar *) pool + (p << POOL_PAGE_SHIFT));
+    self->pool_size = self->pool_end = n_pages << POOL_PAGE_SHIFT;
+    self->pool_compacted = MAX (self->pool_size, POOL_COMPACT_MIN);
+
+    self->n_tracks = header.n_tracks;
+    g_mapped_file_unref (map);
+
+    g_signal_emit (self, signals[ITEMS_CHANGED], 0, 0, old_n_tracks, self->n_tracks);
+
+    return TRUE;
+
+invalid:
+    g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s is not a track index", path);
+    g_mapped_file_unref (map);
+    return FALSE;
+}
+
+/* Interns every string the rows refer to into @pool: strings of removed
+ * or updated tracks are dropped and repeated ones, such as an album
+ * shared by its tracks, are stored once. Fills @offsets column by
+ * column. */
+static void
+intern_strings (WfTrackStore *self,
+                GByteArray   *pool,
+                guint32      *offsets)
+{
+    GHashTable *interned;
+    gpointer value;
+    const gchar *str;
+
+    interned = g_hash_table_new (g_str_hash, g_str_equal);
+    g_byte_array_append (pool, (const guint8 *) "", 1);
+
+    for (guint c = 0; c < N_STRING_COLUMNS; c++) {
+        for (guint i = 0; i < self->n_tracks; i++) {
+            str = STRING_AT (self, c, i);
+            if (*str == '\0') {
+                offsets[c * self->n_tracks + i] = 0;
+            } else if (g_hash_table_lookup_extended (interned, str, NULL, &value)) {
+                offsets[c * self->n_tracks + i] = GPOINTER_TO_UINT (value);
+            } else {
+                offsets[c * self->n_tracks + i] = pool->len;
+                g_hash_table_insert (interned, (gpointer) str, GUINT_TO_POINTER (pool->len));
+                g_byte_array_append (pool, (const guint8 *) str, strlen (str) + 1);
+            }
+        }
+    }
+
+    g_hash_table_unref (interned);
+}
+
+/* Writes the index with the string pool compacted. */
+
+gboolean
+wf_track_store_save (WfTrackStore  *self,
+                     const gchar   *path,
+                     GError       **error)
+{
+    IndexHeader header = {0, };
+    GByteArray *bytes, *pool;
+    guint32 *offsets;
+    gchar *dir;
+    gboolean ret;
+
+    g_return_val_if_fail (WF_IS_TRACK_STORE (self), FALSE);
+    g_return_val_if_fail (path != NULL, FALSE);
+
+    pool = g_byte_array_new ();
+    offsets = g_new (guint32, (gsize) self->n_tracks * N_STRING_COLUMNS);
+    intern_strings (self, pool, offsets);
+
+    header.magic = INDEX_MAGIC;
+    header.version = INDEX_VERSION;
+    header.n_tracks = self->n_tracks;
+    header.pool_size = pool->len;
+
+    bytes = g_byte_array_new ();
+    g_byte_array_append (bytes, (const guint8 *) &header, sizeof (header));
+    g_byte_array_append (bytes, (const guint8 *) offsets,
+                         (gsize) self->n_tracks * N_STRING_COLUMNS * sizeof (guint32));
+    for (guint c = N_STRING_COLUMNS; c < N_COLUMNS; c++) {
+        for (guint i = 0; i < self->n_tracks; i += CHUNK_TRACKS)
+            g_byte_array_append (bytes, cell_at ((Chunk * const *) self->chunks->pdata, c, i),
+                                 MIN (CHUNK_TRACKS, self->n_tracks - i) * column_size[c]);
+    }
+    g_byte_array_append (bytes, pool->data, pool->len);
+
+    dir = g_path_get_dirname (path);
+    g_mkdir_with_parents (dir, 0700);
+    g_free (dir);
+
+    /* Replaces the file rather than writing into it, so a mapping of the
+     * old index stays intact. */
+    ret = g_file_set_contents (path, (const gchar *) bytes->data, bytes->len, error);
+
+    g_byte_array_unref (bytes);
+    g_byte_array_unref (pool);
+    g_free (offsets);
+
+    return ret;
+}
+
+/* Replaces the pool with one holding only the strings still referred to,
+ * once updates and removals have left it twice the size it had after the
+ * last compaction. Every chunk is rewritten, so this is amortized over at
+ * least as many bytes of new strings; snapshots keep the old pool. */
+static void
+compact_pool (WfTrackStore *self)
+{
+    GByteArray *pool;
+    guint32 *offsets;
+    Chunk *chunk;
+    gsize length;
+
+    if (self->pool_size < self->pool_compacted * 2)
+        return;
+
+    pool = g_byte_array_new ();
+    offsets = g_new (guint32, (gsize) self->n_tracks * N_STRING_COLUMNS);
+    intern_strings (self, pool, offsets);
+
+    for (guint i = 0; i < self->n_tracks; i += CHUNK_TRACKS) {
+        chunk = writable_chunk (self, i);
+        for (guint c = 0; c < N_STRING_COLUMNS; c++)
+            memcpy (chunk->columns[c], offsets + (gsize) c * self->n_tracks + i,
+                    MIN (CHUNK_TRACKS, self->n_tracks - i) * sizeof (guint32));
+    }
+
+    /* One block for the lot, with room to grow into. */
+    length = pool->len;
+    g_ptr_array_set_size (self->pages, 0);
+    g_ptr_array_set_size (self->blocks, 0);
+    self->pool_end = 0;
+    add_pool_block (self, length + length / 2);
+    memcpy (self->pages->pdata[0], pool->data, length);
+    self->pool_size = length;
+    self->pool_compacted = MAX (length, POOL_COMPACT_MIN);
+
+    g_byte_array_unref (pool);
+    g_free (offsets);
+}
+
+guint
+wf_track_store_get_n_tracks (WfTrackStore *self)
+{
+    g_return_val_if_fail (WF_IS_TRACK_STORE (self), 0);
+
+    return self->n_tracks;
+}
+
+void
+wf_track_store_get_track (WfTrackStore *self,
+                          guint         index,
+                          WfTrack      *track)
+{
+    g_return_if_fail (WF_IS_TRACK_STORE (self));
+    g_return_if_fail (index < self->n_tracks);
+    g_return_if_fail (track != NULL);
+
+    track->uri = STRING_AT (self, COLUMN_URI, index);
+    track->title = STRING_AT (self, COLUMN_TITLE, index);
+    track->artist = STRING_AT (self, COLUMN_ARTIST, index);
+    track->album = STRING_AT (self, COLUMN_ALBUM, index);
+    track->cover = STRING_AT (self, COLUMN_COVER, index);
+    track->duration = UINT64_AT (self, COLUMN_DURATION, index);
+    track->mtime = (gint64) UINT64_AT (self, COLUMN_MTIME, index);
+    track->size = UINT64_AT (self, COLUMN_SIZE, index);
+}
+
+const gchar *
+wf_track_store_get_uri (WfTrackStore *self,
+                        guint         index)
+{
+    g_return_val_if_fail (WF_IS_TRACK_STORE (self), NULL);
+    g_return_val_if_fail (index < self->n_tracks, NULL);
+
+    return STRING_AT (self, COLUMN_URI, index);
+}
+
+static void
+insert_slot (WfTrackStore *self,
+             guint         index)
+{
+    guint mask = self->n_slots - 1;
+    guint slot;
+
+    slot = g_str_hash (STRING_AT (self, COLUMN_URI, index)) & mask;
+    while (self->slots[slot])
+        slot = (slot + 1) & mask;
+    self->slots[slot] = index + 1;
+}
+
+static void
+build_slots (WfTrackStore *self)
+{
+    self->n_slots = 16;
+    while (self->n_slots < self->n_tracks * 2)
+        self->n_slots <<= 1;
+
+    self->slots = g_new0 (guint32, self->n_slots);
+    for (guint i = 0; i < self->n_tracks; i++)
+        insert_slot (self, i);
+}
+
+gint
+wf_track_store_lookup (WfTrackStore *self,
+                       const gchar  *uri)
+{
+    guint mask, slot, index;
+
+    g_return_val_if_fail (WF_IS_TRACK_STORE (self), -1);
+    g_return_val_if_fail (uri != NULL, -1);
+
+    if (!self->slots)
+        build_slots (self);
+
+    mask = self->n_slots - 1;
+    for (slot = g_str_hash (uri) & mask; self->slots[slot]; slot = (slot + 1) & mask) {
+        index = self->slots[slot] - 1;
+        if (strcmp (STRING_AT (self, COLUMN_URI, index), uri) == 0)
+            return index;
+    }
+
+    return -1;
+}
+
+static guint32
+add_string (WfTrackStore *self,
+            const gchar  *str)
+{
+    gsize length, offset;
+
+    if (!str || *str == '\0')
+        return 0;
+
+    length = strlen (str) + 1;
+    if (self->pool_size + length > self->pool_end)
+        add_pool_block (self, length);
+
+    offset = self->pool_size;
+    memcpy ((gchar *) self->pages->pdata[offset >> POOL_PAGE_SHIFT] + (offset & POOL_PAGE_MASK),
+            str, length);
+    self->pool_size += length;
+
+    return offset;
+}
+
+/* Adds @track, or updates the track with the same uri. The strings must
+ * not point into the store itself. */
+
+void
+wf_track_store_set_track (WfTrackStore  *self,
+                          const WfTrack *track)
+{
+    guint32 strings[N_STRING_COLUMNS];
+    guint64 values[N_COLUMNS - N_STRING_COLUMNS];
+    Chunk *chunk;
+    gint index;
+
+    g_return_if_fail (WF_IS_TRACK_STORE (self));
+    g_return_if_fail (track != NULL && track->uri != NULL);
+
+    compact_pool (self);
+    index = wf_track_store_lookup (self, track->uri);
+
+    strings[COLUMN_TITLE] = add_string (self, track->title);
+    strings[COLUMN_ARTIST] = add_string (self, track->artist);
+    strings[COLUMN_ALBUM] = add_string (self, track->album);
+    strings[COLUMN_COVER] = add_string (self, track->cover);
+    values[COLUMN_DURATION - N_STRING_COLUMNS] = track->duration;
+    values[COLUMN_MTIME - N_STRING_COLUMNS] = (guint64) track->mtime;
+    values[COLUMN_SIZE - N_STRING_COLUMNS] = track->size;
+
+    if (index >= 0) {
+        chunk = writable_chunk (self, index);
+        for (guint c = COLUMN_TITLE; c < N_STRING_COLUMNS; c++)
+            ((guint32 *) chunk->columns[c])[index & CHUNK_MASK] = strings[c];
+        for (guint c = N_STRING_COLUMNS; c < N_COLUMNS; c++)
+            ((guint64 *) chunk->columns[c])[index & CHUNK_MASK] = values[c - N_STRING_COLUMNS];
+
+        g_signal_emit (self, signals[ITEMS_CHANGED], 0, index, 1, 1);
+        return;
+    }
+
+    strings[COLUMN_URI] = add_string (self, track->uri);
+    index = self->n_tracks;
+    if ((index & CHUNK_MASK) == 0)
+        g_ptr_array_add (self->chunks, chunk_new ());
+    chunk = g_ptr_array_index (self->chunks, index >> CHUNK_SHIFT);
+    if (chunk->map)
+        chunk = writable_chunk (self, index);
+    for (guint c = 0; c < N_STRING_COLUMNS; c++)
+        ((guint32 *) chunk->columns[c])[index & CHUNK_MASK] = strings[c];
+    for (guint c = N_STRING_COLUMNS; c < N_COLUMNS; c++)
+        ((guint64 *) chunk->columns[c])[index & CHUNK_MASK] = values[c - N_STRING_COLUMNS];
+    self->n_tracks++;
+
+    if (self->slots && self->n_tracks * 2 > self->n_slots)
+        g_clear_pointer (&self->slots, g_free);
+    else if (self->slots)
+        insert_slot (self, index);
+
+    g_signal_emit (self, signals[ITEMS_CHANGED], 0, index, 0, 1);
+}
+
+/* Moves row @from down to @to, copying the chunk of @to out of any
+ * snapshot first. */
+static void
+move_row (WfTrackStore *self,
+          guint         to,
+          guint         from)
+{
+    Chunk *chunk = writable_chunk (self, to);
+
+    for (guint c = 0; c < N_COLUMNS; c++)
+        memcpy ((guint8 *) chunk->columns[c] + (gsize) (to & CHUNK_MASK) * column_size[c],
+                cell_at ((Chunk * const *) self->chunks->pdata, c, from), column_size[c]);
+}
+
+void
+wf_track_store_remove (WfTrackStore *self,
+                       guint         index)
+{
+    g_return_if_fail (WF_IS_TRACK_STORE (self));
+    g_return_if_fail (index < self->n_tracks);
+
+    for (guint i = index + 1; i < self->n_tracks; i++)
+        move_row (self, i - 1, i);
+    truncate_chunks (self, self->n_tracks - 1);
+    g_clear_pointer (&self->slots, g_free);
+
+    g_signal_emit (self, signals[ITEMS_CHANGED], 0, index, 1, 0);
+}
+
+/* Removes every track @keep returns FALSE for in one pass over the
+ * columns, however scattered they are. A single items-changed spans the
+ * first to the last removed track; the tracks kept in between count as
+ * removed and added again. */
+
+void
+wf_track_store_retain (WfTrackStore      *self,
+                       WfTrackFilterFunc  keep,
+                       gpointer           user_data)
+{
+    guint first, last, out, n_removed;
+
+    g_return_if_fail (WF_IS_TRACK_STORE (self));
+    g_return_if_fail (keep != NULL);
+
+    for (first = 0; first < self->n_tracks; first++)
+        if (!keep (STRING_AT (self, COLUMN_URI, first), user_data))
+            break;
+    if (first == self->n_tracks)
+        return;
+
+    /* Moving rows keeps their offsets into the pool, so the uris stay
+     * readable while the columns are compacted under them. */
+    out = first;
+    last = first + 1;
+    for (guint i = first + 1; i < self->n_tracks; i++) {
+        if (!keep (STRING_AT (self, COLUMN_URI, i), user_data)) {
+            last = i + 1;
+            continue;
+        }
+
+        move_row (self, out++, i);
+    }
+
+    n_removed = self->n_tracks - out;
+    truncate_chunks (self, out);
+    g_clear_pointer (&self->slots, g_free);
+
+    g_signal_emit (self, signals[ITEMS_CHANGED], 0, first, last - first,
+                   last - first - n_removed);
+}
+
+static gboolean
+not_under (const gchar *uri,
+           gpointer     user_data)
+{
+    const gchar *dir = user_data;
+    gsize length = strlen (dir);
+
+    return !(strncmp (uri, dir, length) == 0 &&
+             (uri[length] == '/' || uri[length] == '#' || uri[length] == '\0'));
+}
+
+/* Removes @uri with its sub-tracks and, for a directory, everything
+ * below it. */
+void
+wf_track_store_remove_under (WfTrackStore *self,
+                             const gchar  *uri)
+{
+    g_return_if_fail (WF_IS_TRACK_STORE (self));
+    g_return_if_fail (uri != NULL);
+
+    wf_track_store_retain (self, not_under, (gpointer) uri);
+}
+
+/* Costs a reference per chunk of rows and per pool block, and a copy of
+ * the page table, whatever the size of the library. */
+WfTrackSnapshot *
+wf_track_store_snapshot (WfTrackStore *self)
+{
+    WfTrackSnapshot *snapshot;
+
+    g_return_val_if_fail (WF_IS_TRACK_STORE (self), NULL);
+
+    snapshot = g_new0 (WfTrackSnapshot, 1);
+    snapshot->n_tracks = self->n_tracks;
+
+    snapshot->n_chunks = self->chunks->len;
+    snapshot->chunks = g_new (Chunk *, self->chunks->len);
+    for (guint k = 0; k < self->chunks->len; k++)
+        snapshot->chunks[k] = chunk_ref (g_ptr_array_index (self->chunks, k));
+
+    snapshot->n_blocks = self->blocks->len;
+    snapshot->blocks = g_new (PoolBlock *, self->blocks->len);
+    for (guint b = 0; b < self->blocks->len; b++)
+        snapshot->blocks[b] = pool_block_ref (g_ptr_array_index (self->blocks, b));
+
+    snapshot->pages = g_memdup2 (self->pages->pdata, self->pages->len * sizeof (gpointer));
+
+    return snapshot;
+}
+
+guint
+wf_track_snapshot_get_n_tracks (WfTrackSnapshot *self)
+{
+    g_return_val_if_fail (self != NULL, 0);
+
+    return self->n_tracks;
+}
+
+void
+wf_track_snapshot_get_track (WfTrackSnapshot *self,
+                             guint            index,
+                             WfTrack         *track)
+{
+    g_return_if_fail (self != NULL);
+    g_return_if_fail (index < self->n_tracks);
+    g_return_if_fail (track != NULL);
+
+    track->uri = SNAPSHOT_STRING_AT (self, COLUMN_URI, index);
+    track->title = SNAPSHOT_STRING_AT (self, COLUMN_TITLE, index);
+    track->artist = SNAPSHOT_STRING_AT (self, COLUMN_ARTIST, index);
+    track->album = SNAPSHOT_STRING_AT (self, COLUMN_ALBUM, index);
+    track->cover = SNAPSHOT_STRING_AT (self, COLUMN_COVER, index);
+    track->duration = SNAPSHOT_UINT64_AT (self, COLUMN_DURATION, index);
+    track->mtime = (gint64) SNAPSHOT_UINT64_AT (self, COLUMN_MTIME, index);
+    track->size = SNAPSHOT_UINT64_AT (self, COLUMN_SIZE, index);
+}
+
+void
+wf_track_snapshot_free (WfTrackSnapshot *self)
+{
+    g_return_if_fail (self != NULL);
+
+    for (guint k = 0; k < self->n_chunks; k++)
+        chunk_unref (self->chunks[k]);
+    for (guint b = 0; b < self->n_blocks; b++)
+        pool_block_unref (self->blocks[b]);
+    g_free (self->chunks);
+    g_free (self->blocks);
+    g_free (self->pages);
+    g_free (self);
+}
@@ -0,0 +1,86 @@
+/*
+ * wf-track-store.h
+ *
+ * Copyright 2025 Dilnavas Roshan <dilnavasroshan@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/* A view of one track. The strings belong to the store and stay valid
+ * until the store is next changed. */
+typedef struct
+{
+    const gchar *uri;
+    const gchar *title;
+    const gchar *artist;
+    const gchar *album;
+    const gchar *cover;
+    guint64 duration;
+    gint64 mtime;
+    guint64 size;
+} WfTrack;
+
+/* A read-only view of the store that other threads may use. It shares
+ * the storage of the store, which copies what it changes. */
+typedef struct _WfTrackSnapshot WfTrackSnapshot;
+
+typedef gboolean (*WfTrackFilterFunc) (const gchar *uri,
+                                       gpointer     user_data);
+
+#define WF_TYPE_TRACK_STORE (wf_track_store_get_type ())
+G_DECLARE_FINAL_TYPE (WfTrackStore, wf_track_store, WF, TRACK_STORE, GObject)
+
+WfTrackStore *wf_track_store_new          (void);
+gboolean      wf_track_store_load         (WfTrackStore  *self,
+                                           const gchar   *path,
+                                           GError       **error);
+gboolean      wf_track_store_save         (WfTrackStore  *self,
+                                           const gchar   *path,
+                                           GError       **error);
+
+guint         wf_track_store_get_n_tracks (WfTrackStore *self);
+void          wf_track_store_get_track    (WfTrackStore *self,
+                                           guint         index,
+                                           WfTrack      *track);
+const gchar  *wf_track_store_get_uri      (WfTrackStore *self,
+                                           guint         index);
+gint          wf_track_store_lookup       (WfTrackStore *self,
+                                           const gchar  *uri);
+
+void          wf_track_store_set_track    (WfTrackStore  *self,
+                                           const WfTrack *track);
+void          wf_track_store_remove       (WfTrackStore *self,
+                                           guint         index);
+void          wf_track_store_remove_under (WfTrackStore *self,
+                                           const gchar  *uri);
+void          wf_track_store_retain       (WfTrackStore      *self,
+                                           WfTrackFilterFunc  keep,
+                                           gpointer           user_data);
+
+WfTrackSnapshot *wf_track_store_snapshot        (WfTrackStore *self);
+guint            wf_track_snapshot_get_n_tracks (WfTrackSnapshot *self);
+void             wf_track_snapshot_get_track    (WfTrackSnapshot *self,
+                                                 guint            index,
+                                                 WfTrack         *track);
+void             wf_track_snapshot_free         (WfTrackSnapshot *self);
+
+G_END_DECLS
@@ -23,8 +23,24 @@
 
 #include <math.h>
 #include <gst/gst.h>
+#include <gst/base/gstbaseparse.h>
+#include <gst/app/gstappsink.h>
 
 #include "wf-waveform.h"
+#include "wf-gst.h"
+#include "wf-peak-cache.h"
+#include "wf-pcm-cache.h"
+#include "wf-readahead.h"
+#include "wf-trace.h"
+
+/* Spacing of the seek points recorded while the file is analysed. */
+#define SEEK_POINT_INTERVAL (GST_SECOND / 2)
+/* Decoders hand out 10 MiB a minute of S16 stereo at 44.1 kHz and up to
+ * 22 MiB of F32 at 48 kHz, so 128 MiB holds a long song either way;
+ * albums and mixes are decoded again for playback. The pcm-cache case
+ * of bench-analysis measures the rate. */
+#define DEFAULT_CACHE_BUDGET 128
+#define MAX_CACHE_BUDGET     4096
 
 struct _WfWaveform
 {
@@ -34,15 +50,24 @@ struct _WfWaveform
     GstBus *bus;
     gint watch_id;
 
+    gchar *uri;
+    WfPcmCache *pcm_cache;
+    guint cache_budget;
+    gboolean cache_sized;
     GArray *peaks;
+    GArray *seek_points;
+    GstClockTime last_seek_point;
     gdouble max_right;
     gdouble max_left;
+
+    gint64 trace_start;
 };
 
 enum
 {
     PROP_ZERO,
     PROP_PEAKS,
+    PROP_CACHE_BUDGET,
     N_PROPS
 };
 
@@ -87,6 +112,13 @@ wf_waveform_class_init (WfWaveformClass *klass)
                             NULL, NULL,
                             G_TYPE_ARRAY, G_PARAM_READABLE);
 
+    /* MiB of decoded audio kept for playback while analysing, 0 for none. */
+    properties[PROP_CACHE_BUDGET] =
+        g_param_spec_uint ("cache-budget",
+                           NULL, NULL,
+                           0, MAX_CACHE_BUDGET, DEFAULT_CACHE_BUDGET,
+                           G_PARAM_READWRITE);
+
     signals[READY] =
         g_signal_new ("ready",
                       G_TYPE_FROM_CLASS (object_class),
@@ -113,8 +145,14 @@ dispose (GObject *object)
         waveform->pipeline = NULL;
     }
 
+    if (waveform->pcm_cache) {
+        wf_pcm_cache_fail (waveform->pcm_cache);
+        g_clear_object (&waveform->pcm_cache);
+    }
+
     g_clear_pointer (&waveform->bus, gst_object_unref);
     g_clear_pointer (&waveform->peaks, g_array_unref);
+    g_clear_pointer (&waveform->seek_points, g_array_unref);
 
     G_OBJECT_CLASS (wf_waveform_parent_class)->dispose (object);
 }
@@ -122,6 +160,9 @@ dispose (GObject *object)
 static void
 finalize (GObject *object)
 {
+    WfWaveform *waveform = WF_WAVEFORM (object);
+
+    g_free (waveform->uri);
     G_OBJECT_CLASS (wf_waveform_parent_class)->finalize (object);
 }
 
@@ -137,6 +178,9 @@ get_property (GObject    *object,
     case PROP_PEAKS:
         g_value_set_boxed (value, waveform->peaks);
         break;
+    case PROP_CACHE_BUDGET:
+        g_value_set_uint (value, waveform->cache_budget);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
@@ -148,7 +192,12 @@ set_property (GObject      *object,
               const GValue *value,
               GParamSpec   *pspec)
 {
+    WfWaveform *waveform = WF_WAVEFORM (object);
+
     switch (property_id) {
+    case PROP_CACHE_BUDGET:
+        waveform->cache_budget = g_value_get_uint (value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
@@ -157,28 +206,120 @@ set_property (GObject      *object,
 static void
 wf_waveform_init (WfWaveform *self)
 {
+    self->cache_budget = DEFAULT_CACHE_BUDGET;
+}
+
+/* Parsers put the byte offset of each frame on the buffers they push, so
+ * a probe after the parser sees the whole file's timestamp to offset map
+ * go by while the peaks are computed. */
+
+static GstPadProbeReturn
+parser_probe_cb (GstPad          *pad,
+                 GstPadProbeInfo *info,
+                 gpointer         user_data)
+{
+    WfWaveform *self = WF_WAVEFORM (user_data);
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+    WfSeekPoint point;
+
+    if (!GST_BUFFER_PTS_IS_VALID (buffer) ||
+        GST_BUFFER_OFFSET (buffer) == GST_BUFFER_OFFSET_NONE ||
+        GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+        return GST_PAD_PROBE_OK;
+
+    if (GST_CLOCK_TIME_IS_VALID (self->last_seek_point) &&
+        GST_BUFFER_PTS (buffer) < self->last_seek_point + SEEK_POINT_INTERVAL)
+        return GST_PAD_PROBE_OK;
+
+    point.time = GST_BUFFER_PTS (buffer);
+    point.offset = GST_BUFFER_OFFSET (buffer);
+    g_array_append_val (self->seek_points, point);
+    self->last_seek_point = point.time;
+
+    return GST_PAD_PROBE_OK;
+}
+
+static void
+element_added_cb (GstBin     *bin,
+                  GstBin     *sub_bin,
+                  GstElement *element,
+                  gpointer    user_data)
+{
+    GstPad *pad;
+
+    if (!GST_IS_BASE_PARSE (element))
+        return;
+
+    pad = gst_element_get_static_pad (element, "src");
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, parser_probe_cb, user_data, NULL);
+    gst_object_unref (pad);
+}
+
+static GstFlowReturn
+new_sample_cb (GstAppSink *sink,
+               gpointer    user_data)
+{
+    WfWaveform *self = WF_WAVEFORM (user_data);
+    GstSample *sample;
+    gint64 duration;
+
+    sample = gst_app_sink_pull_sample (sink);
+    if (!sample)
+        return GST_FLOW_EOS;
+
+    wf_pcm_cache_append (self->pcm_cache, sample);
+    gst_sample_unref (sample);
+
+    /* Known by the first buffer; lets the cache bail out before playback
+     * starts reading from it. */
+    if (!self->cache_sized &&
+        gst_element_query_duration (self->pipeline, GST_FORMAT_TIME, &duration)) {
+        wf_pcm_cache_set_duration (self->pcm_cache, duration);
+        self->cache_sized = TRUE;
+    }
+
+    return GST_FLOW_OK;
 }
 
 static void
 create_pipeline (WfWaveform *self)
 {
-    GstElement *fakesink, *level;
-
-    self->pipeline = gst_parse_launch ("uridecodebin name=uridecodebin "
-                                       "! audioconvert ! audio/x-raw,channels=2 "
-                                       "! level name=level interval=250000000 "
-                                       "! fakesink name=fakesink", NULL);
+    GstAppSinkCallbacks callbacks = {.new_sample = new_sample_cb};
+    GstElement *fakesink, *level, *pcmsink;
+
+    /* With a cache the decoded stream is split: one branch is analysed,
+     * the other is kept for the player as the decoder produced it. */
+    if (self->pcm_cache)
+        self->pipeline = gst_parse_launch ("uridecodebin name=uridecodebin ! tee name=tee "
+                                           "tee. ! queue ! audioconvert ! audio/x-raw,channels=2 "
+                                           "! level name=level "
+                                           "! fakesink name=fakesink "
+                                           "tee. ! queue ! appsink name=pcmsink sync=false", NULL);
+    else
+        self->pipeline = gst_parse_launch ("uridecodebin name=uridecodebin "
+                                           "! audioconvert ! audio/x-raw,channels=2 "
+                                           "! level name=level "
+                                           "! fakesink name=fakesink", NULL);
     if (!self->pipeline) {
         g_printerr ("Error: failed building pipeline\n");
         return;
     }
 
+    if (self->pcm_cache) {
+        pcmsink = gst_bin_get_by_name (GST_BIN (self->pipeline), "pcmsink");
+        gst_app_sink_set_callbacks (GST_APP_SINK (pcmsink), &callbacks, self, NULL);
+        gst_object_unref (pcmsink);
+    }
+
     fakesink = gst_bin_get_by_name (GST_BIN (self->pipeline), "fakesink");
     level = gst_bin_get_by_name (GST_BIN (self->pipeline), "level");
 
-    g_object_set (level, "post-messages", TRUE, NULL);
+    g_object_set (level, "post-messages", TRUE, "interval", WF_PEAK_INTERVAL, NULL);
     g_object_set (fakesink, "qos", FALSE, "sync", FALSE, NULL);
 
+    g_signal_connect (self->pipeline, "deep-element-added",
+                      G_CALLBACK (element_added_cb), self);
+
     self->bus = gst_pipeline_get_bus (GST_PIPELINE (self->pipeline));
     self->watch_id = gst_bus_add_watch (self->bus, message_handler, self);
 }
@@ -187,6 +328,13 @@ static void
 destroy_pipeline (WfWaveform *self)
 {
     gst_element_set_state (self->pipeline, GST_STATE_NULL);
+
+    /* Unfinished, so whoever plays from it has to go back to the file. */
+    if (self->pcm_cache) {
+        wf_pcm_cache_fail (self->pcm_cache);
+        g_clear_object (&self->pcm_cache);
+    }
+
     g_source_remove (self->watch_id);
     gst_object_unref (self->bus);
     gst_object_unref (self->pipeline);
@@ -251,9 +399,13 @@ message_handler (GstBus     *bus,
         }
         break;
     case GST_MESSAGE_EOS:
+        if (waveform->pcm_cache)
+            wf_pcm_cache_finish (waveform->pcm_cache);
         destroy_pipeline (waveform);
         noarmalize_peaks (waveform);
+        wf_peak_cache_store (waveform->uri, waveform->peaks, waveform->seek_points);
         g_object_notify_by_pspec (G_OBJECT (waveform), properties[PROP_PEAKS]);
+        WF_TRACE_MARK (waveform->trace_start, "Analysis", "%s", waveform->uri);
         g_signal_emit (waveform, signals[READY], 0);
         break;
     case GST_MESSAGE_ERROR:
@@ -261,6 +413,8 @@ message_handler (GstBus     *bus,
         g_printerr ("Error: %s\n", error->message);
         g_error_free (error);
         g_free (debug_msg);
+        if (waveform->pcm_cache)
+            wf_pcm_cache_fail (waveform->pcm_cache);
         break;
     default:
         break;
@@ -276,14 +430,37 @@ generate_peaks (WfWaveform  *self,
     GstElement *uridecode;
     gint status;
 
+    if (self->pipeline)
+        destroy_pipeline (self);
+
+    g_free (self->uri);
+    self->uri = g_strdup (uri);
+    g_clear_pointer (&self->peaks, g_array_unref);
+    g_clear_pointer (&self->seek_points, g_array_unref);
+    self->trace_start = WF_TRACE_NOW ();
+
+    if (wf_peak_cache_lookup (uri, &self->peaks, &self->seek_points)) {
+        g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_PEAKS]);
+        WF_TRACE_MARK (self->trace_start, "Analysis", "%s (cached)", uri);
+        g_signal_emit (self, signals[READY], 0);
+        return;
+    }
+
+    /* The analysis reads the whole file, so ask for all of it up front. */
+    wf_readahead_queue_file (wf_readahead_get_default (), uri, 0);
+
+    if (self->cache_budget)
+        self->pcm_cache = wf_pcm_cache_new (uri, (guint64) self->cache_budget * 1024 * 1024);
+    self->cache_sized = FALSE;
+
     create_pipeline (self);
     uridecode = gst_bin_get_by_name (GST_BIN (self->pipeline), "uridecodebin");
     g_object_set (uridecode, "uri", uri, NULL);
-
-    if (self->peaks)
-        g_array_unref (self->peaks);
+    gst_object_unref (uridecode);
 
     self->peaks = g_array_new (FALSE, FALSE, sizeof (WfPeakData));
+    self->seek_points = g_array_new (FALSE, FALSE, sizeof (WfSeekPoint));
+    self->last_seek_point = GST_CLOCK_TIME_NONE;
 
     self->max_left = G_MINDOUBLE;
     self->max_right = G_MINDOUBLE;
@@ -305,9 +482,21 @@ wf_waveform_set_file (WfWaveform *self, const gchar *uri)
 {
     g_return_if_fail (WF_IS_WAVEFORM (self));
 
+    if (!g_strcmp0 (self->uri, uri))
+        return;
+
+    wf_gst_ensure ();
     generate_peaks (self, uri);
 }
 
+const gchar *
+wf_waveform_get_uri (WfWaveform *self)
+{
+    g_return_val_if_fail (WF_IS_WAVEFORM (self), NULL);
+
+    return self->uri;
+}
+
 GArray *
 wf_waveform_get_peaks (WfWaveform *self)
 {
@@ -316,6 +505,66 @@ wf_waveform_get_peaks (WfWaveform *self)
     return self->peaks;
 }
 
+/* Returns the seek points of the current file as an array of WfSeekPoint
+ * in increasing time. It is only complete once ready has been emitted. */
+
+GArray *
+wf_waveform_get_seek_points (WfWaveform *self)
+{
+    g_return_val_if_fail (WF_IS_WAVEFORM (self), NULL);
+
+    return self->seek_points;
+}
+
+/* TODO: This is too naive. I should come up a better interpolation function. */
+
+static gdouble
+interpolate (GArray *peaks, guint index)
+{
+    WfPeakData *current, *prev, *next;
+
+    if (index == 0) {
+        current = &g_array_index (peaks, WfPeakData, index);
+        next = &g_array_index (peaks, WfPeakData, index + 1);
+        return (current->left + next->left) / 2;
+    } else if (index + 1 == peaks->len) {
+        current = &g_array_index (peaks, WfPeakData, index);
+        prev = &g_array_index (peaks, WfPeakData, index - 1);
+        return (current->left + prev->left) / 2;
+    }
+
+    prev = &g_array_index (peaks, WfPeakData, index - 1);
+    current = &g_array_index (peaks, WfPeakData, index);
+    next = &g_array_index (peaks, WfPeakData, index + 1);
+
+    return (prev->left + current->left + next->left) / 3;
+}
+
+/* Spreads @n_peaks peaks of @peaks, from @first on, over @n_bars bars and
+ * returns their heights. @peaks needs at least two peaks. */
+GArray *
+wf_peak_data_to_bars (GArray *peaks,
+                      guint   first,
+                      guint   n_peaks,
+                      guint   n_bars)
+{
+    GArray *bars;
+    gdouble p;
+    gdouble val;
+
+    g_return_val_if_fail (peaks != NULL && peaks->len >= 2, NULL);
+    g_return_val_if_fail (n_peaks > 0 && first + n_peaks <= peaks->len, NULL);
+
+    p = n_bars / (gdouble) n_peaks;
+    bars = g_array_sized_new (FALSE, FALSE, sizeof (gdouble), n_bars);
+    for (guint i = 0; i < n_bars; i++) {
+        val = interpolate (peaks, first + (guint) (i / p));
+        g_array_append_val (bars, val);
+    }
+
+    return bars;
+}
+
 G_DEFINE_BOXED_TYPE (WfPeakData, wf_peak_data, wf_peak_data_copy, wf_peak_data_free)
 
 WfPeakData *
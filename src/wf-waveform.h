@@ -29,10 +29,15 @@ G_BEGIN_DECLS
 G_DECLARE_FINAL_TYPE (WfWaveform, wf_waveform, WF, WAVEFORM, GObject)
 
 
-WfWaveform *wf_waveform_new       (void);
-void        wf_waveform_set_file  (WfWaveform *self,
-                                     const gchar *uri);
-GArray     *wf_waveform_get_peaks (WfWaveform *self);
+WfWaveform  *wf_waveform_new             (void);
+void         wf_waveform_set_file        (WfWaveform *self,
+                                          const gchar *uri);
+const gchar *wf_waveform_get_uri         (WfWaveform *self);
+GArray      *wf_waveform_get_peaks       (WfWaveform *self);
+GArray      *wf_waveform_get_seek_points (WfWaveform *self);
+
+/* Each peak covers this much of the stream, in ns. */
+#define WF_PEAK_INTERVAL G_GUINT64_CONSTANT (250000000)
 
 #define WF_TYPE_PEAK_DATA (wf_peak_data_get_type ())
 
@@ -44,8 +49,19 @@ typedef struct
 
 GType wf_peak_data_get_type (void);
 
-WfPeakData *wf_peak_data_copy (WfPeakData *self);
-void        wf_peak_data_free (WfPeakData *self);
+WfPeakData *wf_peak_data_copy    (WfPeakData *self);
+void        wf_peak_data_free    (WfPeakData *self);
+GArray     *wf_peak_data_to_bars (GArray *peaks,
+                                  guint   first,
+                                  guint   n_peaks,
+                                  guint   n_bars);
+
+/* A timestamp and the byte offset of the frame that starts there. */
+typedef struct
+{
+    guint64 time;
+    guint64 offset;
+} WfSeekPoint;
 
 
 G_END_DECLS
@@ -20,42 +20,142 @@
 
 #include "config.h"
 
+#include "wf-application.h"
 #include "wf-window.h"
 #include "wf-player.h"
 #include "wf-waveform.h"
 #include "wf-seek-bar.h"
+#include "wf-eq-panel.h"
+#include "wf-debug-window.h"
+#include "wf-track-item.h"
+#include "wf-track-list.h"
+#include "wf-thumbnail.h"
+#include "wf-cover.h"
+
+/* Tracks queued at a time from the track list. The next lot follows once
+ * playback is halfway through them. */
+#define QUEUE_AHEAD 50
+
+/* Memory for the waveform thumbnails and covers of the track list. */
+#define THUMBNAIL_BUDGET (4 * 1024 * 1024)
+#define COVER_BUDGET     (16 * 1024 * 1024)
+#define COVER_SIZE       32
+
+/* How long the equalizer sliders rest before their curve is stored, in
+ * milliseconds. A drag is heard at once but written once. */
+#define EQ_SAVE_DELAY 500
 
 struct _WfWindow
 {
     AdwApplicationWindow parent_instance;
 
+    GSettings *settings;
     WfPlayer *player;
     WfWaveform *waveform;
+    WfTrackList *tracks;
+    WfThumbnailer *thumbnailer;
+    WfCoverCache *covers;
+
+    /* Open while shown, there is at most one per window. */
+    WfDebugWindow *debug_window;
 
     /* Template widgets */
     GtkWidget *play_button;
+    GtkWidget *prev_button;
+    GtkWidget *next_button;
     WfSeekBar *seek_bar;
+    WfEqPanel *eq_panel;
+    GtkDropDown *eq_preset_dropdown;
+    GtkSearchEntry *search_entry;
+    GtkDropDown *sort_dropdown;
+    GtkListView *track_view;
+
+    GtkStringList *eq_presets;
+    gboolean eq_updating;
+    guint eq_save_id;
+
+    /* The rows the player's queue covers, from its first entry on, and
+     * whether more are queued once it is halfway through the last lot. */
+    guint queue_start;
+    guint queue_end;
+    gboolean queue_refill;
+
+    /* Set while minimized or otherwise not shown. */
+    gboolean hidden;
+    guint64 hidden_position;
+
+    /* Not a reference, the application outlives its windows. Set while
+     * the window is counted among the visible ones. */
+    WfApplication *application;
+    gboolean counted_visible;
 };
 
 static void dispose             (GObject *object);
 static void action_open_cb      (GSimpleAction *action,
                                  GVariant      *parameters,
                                  gpointer       user_data);
+static void action_debug_cb     (GSimpleAction *action,
+                                 GVariant      *parameters,
+                                 gpointer       user_data);
 static void play_button_cb      (GtkButton *button,
                                  gpointer   user_data);
+static void prev_button_cb      (GtkButton *button,
+                                 gpointer   user_data);
+static void next_button_cb      (GtkButton *button,
+                                 gpointer   user_data);
+static void playing_changed_cb  (WfWindow   *self,
+                                 GParamSpec *pspec,
+                                 gpointer    user_data);
 static void position_changed_cb (WfWindow *self,
                                  guint64 pos,
                                  gpointer user_data);
 static void duration_changed_cb (WfWindow *self,
                                  guint64 duration,
                                  gpointer user_data);
+static void window_changed_cb   (WfWindow *self,
+                                 gpointer  user_data);
+static void player_loop_changed_cb (WfWindow *self,
+                                    gpointer  user_data);
 static void seeked_cb           (WfWindow *self,
                                  guint64 pos,
                                  gpointer user_data);
+static void eq_gain_changed_cb  (WfWindow *self,
+                                 guint     index,
+                                 gdouble   gain,
+                                 gpointer  user_data);
+static void eq_preset_cb        (WfWindow   *self,
+                                 GParamSpec *pspec,
+                                 gpointer    user_data);
+#ifdef ENABLE_BENCHMARKS
+static void realize_cb          (WfWindow *self,
+                                 gpointer  user_data);
+#endif
+static void visibility_cb       (WfWindow   *self,
+                                 GParamSpec *pspec,
+                                 gpointer    user_data);
+static void update_visible      (WfWindow *self);
+static void loop_changed_cb     (WfWindow *self,
+                                 guint64   start,
+                                 guint64   end,
+                                 gpointer  user_data);
+static void search_changed_cb   (WfWindow       *self,
+                                 GtkSearchEntry *entry);
+static void sort_changed_cb     (WfWindow   *self,
+                                 GParamSpec *pspec,
+                                 gpointer    user_data);
+static void track_activated_cb  (WfWindow *self,
+                                 guint     position,
+                                 gpointer  user_data);
+static void queue_uri_cb        (WfWindow   *self,
+                                 GParamSpec *pspec,
+                                 gpointer    user_data);
+static void waveform_ready_cb   (WfWindow   *self,
+                                 WfWaveform *waveform);
 
 static GActionEntry window_actions[] =
 {
-    {"open", action_open_cb}
+    {"open", action_open_cb},
+    {"debug", action_debug_cb},
 };
 
 G_DEFINE_FINAL_TYPE (WfWindow, wf_window, ADW_TYPE_APPLICATION_WINDOW)
@@ -72,38 +172,312 @@ wf_window_class_init (WfWindowClass *klass)
                                                  "/cc/placid/Wavefront/ui/wf-window.ui");
 
     gtk_widget_class_bind_template_child (widget_class, WfWindow, play_button);
+    gtk_widget_class_bind_template_child (widget_class, WfWindow, prev_button);
+    gtk_widget_class_bind_template_child (widget_class, WfWindow, next_button);
     gtk_widget_class_bind_template_child (widget_class, WfWindow, seek_bar);
+    gtk_widget_class_bind_template_child (widget_class, WfWindow, eq_panel);
+    gtk_widget_class_bind_template_child (widget_class, WfWindow, eq_preset_dropdown);
+    gtk_widget_class_bind_template_child (widget_class, WfWindow, search_entry);
+    gtk_widget_class_bind_template_child (widget_class, WfWindow, sort_dropdown);
+    gtk_widget_class_bind_template_child (widget_class, WfWindow, track_view);
+}
+
+static void
+apply_eq_bands (WfWindow *self,
+                GVariant *variant)
+{
+    WfEqBand bands[WF_EQUALIZER_MAX_BANDS];
+    guint n_bands;
+
+    n_bands = wf_eq_bands_from_variant (variant, bands);
+    if (n_bands > 0)
+        wf_eq_panel_set_bands (self->eq_panel, bands, n_bands);
+}
+
+static void
+setup_eq_presets (WfWindow *self)
+{
+    GVariant *presets, *bands;
+    GVariantIter iter;
+    const gchar *name;
+    gchar *current;
+    guint selected = GTK_INVALID_LIST_POSITION;
+
+    bands = g_settings_get_value (self->settings, "eq-bands");
+    apply_eq_bands (self, bands);
+    g_variant_unref (bands);
+
+    current = g_settings_get_string (self->settings, "eq-preset");
+    self->eq_presets = gtk_string_list_new (NULL);
+    presets = g_settings_get_value (self->settings, "eq-presets");
+    g_variant_iter_init (&iter, presets);
+    while (g_variant_iter_next (&iter, "{&s@a(iddd)}", &name, NULL)) {
+        if (g_strcmp0 (name, current) == 0)
+            selected = g_list_model_get_n_items (G_LIST_MODEL (self->eq_presets));
+        gtk_string_list_append (self->eq_presets, name);
+    }
+    g_variant_unref (presets);
+    g_free (current);
+
+    self->eq_updating = TRUE;
+    gtk_drop_down_set_model (self->eq_preset_dropdown, G_LIST_MODEL (self->eq_presets));
+    gtk_drop_down_set_selected (self->eq_preset_dropdown, selected);
+    self->eq_updating = FALSE;
+
+    g_signal_connect_swapped (self->eq_preset_dropdown, "notify::selected",
+                              G_CALLBACK (eq_preset_cb), self);
+    g_signal_connect_swapped (self->eq_panel, "gain-changed", G_CALLBACK (eq_gain_changed_cb), self);
+}
+
+static void
+setup_track_cb (GtkSignalListItemFactory *factory,
+                GtkListItem              *item,
+                WfWindow                 *self)
+{
+    GtkWidget *row, *cover, *thumbnail, *box, *title, *subtitle;
+
+    row = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 8);
+    cover = wf_cover_new (self->covers, COVER_SIZE);
+    gtk_widget_set_valign (cover, GTK_ALIGN_CENTER);
+    thumbnail = wf_thumbnail_new (self->thumbnailer);
+    gtk_widget_set_valign (thumbnail, GTK_ALIGN_CENTER);
+
+    box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 2);
+    gtk_widget_set_hexpand (box, TRUE);
+    title = gtk_label_new (NULL);
+    gtk_label_set_xalign (GTK_LABEL (title), 0);
+    gtk_label_set_ellipsize (GTK_LABEL (title), PANGO_ELLIPSIZE_END);
+    subtitle = gtk_label_new (NULL);
+    gtk_label_set_xalign (GTK_LABEL (subtitle), 0);
+    gtk_label_set_ellipsize (GTK_LABEL (subtitle), PANGO_ELLIPSIZE_END);
+    gtk_widget_add_css_class (subtitle, "dim-label");
+    gtk_widget_add_css_class (subtitle, "caption");
+
+    gtk_box_append (GTK_BOX (box), title);
+    gtk_box_append (GTK_BOX (box), subtitle);
+    gtk_box_append (GTK_BOX (row), cover);
+    gtk_box_append (GTK_BOX (row), box);
+    gtk_box_append (GTK_BOX (row), thumbnail);
+    gtk_list_item_set_child (item, row);
+}
+
+static void
+bind_track_cb (GtkSignalListItemFactory *factory,
+               GtkListItem              *item,
+               gpointer                  user_data)
+{
+    WfTrackItem *track = gtk_list_item_get_item (item);
+    GtkWidget *cover, *box, *thumbnail, *title, *subtitle;
+    const gchar *artist, *album;
+    gchar *text;
+
+    cover = gtk_widget_get_first_child (gtk_list_item_get_child (item));
+    box = gtk_widget_get_next_sibling (cover);
+    thumbnail = gtk_widget_get_next_sibling (box);
+    title = gtk_widget_get_first_child (box);
+    subtitle = gtk_widget_get_next_sibling (title);
+
+    wf_cover_set_hash (WF_COVER (cover), wf_track_item_get_cover (track));
+    wf_thumbnail_set_uri (WF_THUMBNAIL (thumbnail), wf_track_item_get_uri (track));
+
+    /* Untagged files go by their file name. */
+    if (*wf_track_item_get_title (track)) {
+        gtk_label_set_label (GTK_LABEL (title), wf_track_item_get_title (track));
+    } else {
+        text = g_path_get_basename (wf_track_item_get_uri (track));
+        gtk_label_set_label (GTK_LABEL (title), text);
+        g_free (text);
+    }
+
+    artist = wf_track_item_get_artist (track);
+    album = wf_track_item_get_album (track);
+    if (*artist && *album)
+        text = g_strdup_printf ("%s \u2014 %s", artist, album);
+    else
+        text = g_strdup (*artist ? artist : album);
+    gtk_label_set_label (GTK_LABEL (subtitle), text);
+    gtk_widget_set_visible (subtitle, *text != '\0');
+    g_free (text);
+}
+
+/* Rows are made as they scroll into view, so the view costs the same
+ * for a hundred tracks as for half a million. Their thumbnails come from
+ * cached peaks only, and covers are decoded and scaled off the main
+ * thread. */
+static void
+setup_track_view (WfWindow *self)
+{
+    GtkListItemFactory *factory;
+
+    self->thumbnailer = wf_thumbnailer_new (THUMBNAIL_BUDGET);
+    self->covers = wf_cover_cache_new (COVER_BUDGET);
+
+    factory = gtk_signal_list_item_factory_new ();
+    g_signal_connect (factory, "setup", G_CALLBACK (setup_track_cb), self);
+    g_signal_connect (factory, "bind", G_CALLBACK (bind_track_cb), NULL);
+    gtk_list_view_set_factory (self->track_view, factory);
+    g_object_unref (factory);
+
+    g_signal_connect_swapped (self->track_view, "activate", G_CALLBACK (track_activated_cb), self);
+    g_signal_connect_swapped (self->search_entry, "search-changed", G_CALLBACK (search_changed_cb), self);
+    g_signal_connect_swapped (self->sort_dropdown, "notify::selected", G_CALLBACK (sort_changed_cb), self);
 }
 
 static void
 wf_window_init (WfWindow *self)
 {
     g_type_ensure (WF_TYPE_SEEK_BAR);
+    g_type_ensure (WF_TYPE_EQ_PANEL);
 
     gtk_widget_init_template (GTK_WIDGET (self));
 
     g_action_map_add_action_entries (G_ACTION_MAP (self), window_actions,
                                      G_N_ELEMENTS (window_actions), self);
 
-    self->player = wf_player_new ();
-    g_signal_connect_swapped (self->player, "position-changed",
-                              G_CALLBACK (position_changed_cb), self);
-    g_signal_connect_swapped (self->player, "duration-changed",
-                              G_CALLBACK (duration_changed_cb), self);
-    g_signal_connect (self->play_button, "clicked", G_CALLBACK (play_button_cb), self);
+    self->settings = g_settings_new (FW_APP_ID);
 
-    self->waveform = wf_waveform_new ();
-    g_object_bind_property (self->waveform, "peaks", self->seek_bar, "peaks", G_BINDING_DEFAULT);
+    g_signal_connect (self->play_button, "clicked", G_CALLBACK (play_button_cb), self);
+    g_signal_connect (self->prev_button, "clicked", G_CALLBACK (prev_button_cb), self);
+    g_signal_connect (self->next_button, "clicked", G_CALLBACK (next_button_cb), self);
     g_signal_connect_swapped (self->seek_bar, "seeked", G_CALLBACK (seeked_cb), self);
+    g_signal_connect_swapped (self->seek_bar, "loop-changed", G_CALLBACK (loop_changed_cb), self);
+    g_settings_bind (self->settings, "seek-bar-track-view",
+                     self->seek_bar, "show-window", G_SETTINGS_BIND_GET);
+
+    setup_eq_presets (self);
+    setup_track_view (self);
+
+    g_signal_connect (self, "notify::suspended", G_CALLBACK (visibility_cb), NULL);
+    g_signal_connect (self, "notify::visible", G_CALLBACK (visibility_cb), NULL);
+
+#ifdef ENABLE_BENCHMARKS
+    if (g_getenv ("WAVEFRONT_BENCHMARK_STARTUP"))
+        g_signal_connect (self, "realize", G_CALLBACK (realize_cb), NULL);
+#endif
+}
+
+/* Attaches to the player and analysis the application owns, which may
+ * have been running for a while: the peaks computed so far, the position
+ * and the loop are shown at once. The player outlives the window, so its
+ * handlers go away with the window. */
+
+static void
+attach (WfWindow      *self,
+        WfApplication *application)
+{
+    GtkSingleSelection *selection;
+    guint64 duration;
+
+    self->player = g_object_ref (wf_application_get_player (application));
+    self->waveform = g_object_ref (wf_application_get_waveform (application));
+
+    self->tracks = wf_track_list_new (wf_library_get_store (wf_application_get_library (application)));
+    selection = gtk_single_selection_new (G_LIST_MODEL (g_object_ref (self->tracks)));
+    gtk_single_selection_set_autoselect (selection, FALSE);
+    gtk_single_selection_set_can_unselect (selection, TRUE);
+    gtk_list_view_set_model (self->track_view, GTK_SELECTION_MODEL (selection));
+    g_object_unref (selection);
+
+    g_signal_connect_object (self->player, "position-changed",
+                             G_CALLBACK (position_changed_cb), self, G_CONNECT_SWAPPED);
+    g_signal_connect_object (self->player, "duration-changed",
+                             G_CALLBACK (duration_changed_cb), self, G_CONNECT_SWAPPED);
+    g_signal_connect_object (self->player, "notify::playing",
+                             G_CALLBACK (playing_changed_cb), self, G_CONNECT_SWAPPED);
+    g_signal_connect_object (self->player, "window-changed",
+                             G_CALLBACK (window_changed_cb), self, G_CONNECT_SWAPPED);
+    g_signal_connect_object (self->player, "loop-changed",
+                             G_CALLBACK (player_loop_changed_cb), self, G_CONNECT_SWAPPED);
+    g_signal_connect_object (self->player, "notify::uri",
+                             G_CALLBACK (queue_uri_cb), self, G_CONNECT_SWAPPED);
+    g_signal_connect_object (self->waveform, "ready",
+                             G_CALLBACK (waveform_ready_cb), self, G_CONNECT_SWAPPED);
+
+    g_object_bind_property (self->waveform, "peaks", self->seek_bar, "peaks", G_BINDING_SYNC_CREATE);
+
+    duration = wf_player_get_duration (self->player);
+    if (GST_CLOCK_TIME_IS_VALID (duration)) {
+        wf_seek_bar_set_duration (self->seek_bar, duration);
+        wf_seek_bar_set_position (self->seek_bar, wf_player_get_position (self->player));
+    }
+    window_changed_cb (self, NULL);
+    player_loop_changed_cb (self, NULL);
+    playing_changed_cb (self, NULL, NULL);
+
+    self->application = application;
+    update_visible (self);
+}
+
+WfWindow *
+wf_window_new (WfApplication *application)
+{
+    WfWindow *self;
+
+    g_return_val_if_fail (WF_IS_APPLICATION (application), NULL);
+
+    self = g_object_new (WF_TYPE_WINDOW,
+                         "application", application,
+                         NULL);
+    attach (self, application);
+
+    return self;
+}
+
+#ifdef ENABLE_BENCHMARKS
+
+/* For the startup benchmark: reports the time from application creation
+ * to the end of the first paint, then quits. */
+
+static void
+first_paint_cb (GdkFrameClock *clock,
+                WfWindow      *self)
+{
+    GtkApplication *app;
+    gint64 start_time;
+
+    g_signal_handlers_disconnect_by_func (clock, first_paint_cb, self);
+
+    app = gtk_window_get_application (GTK_WINDOW (self));
+    start_time = wf_application_get_start_time (WF_APPLICATION (app));
+    g_debug ("first-frame %.1f ms", (g_get_monotonic_time () - start_time) / 1000.0);
+    g_application_quit (G_APPLICATION (app));
 }
 
+static void
+realize_cb (WfWindow *self,
+            gpointer  user_data)
+{
+    g_signal_connect (gtk_widget_get_frame_clock (GTK_WIDGET (self)), "after-paint",
+                      G_CALLBACK (first_paint_cb), self);
+}
+
+#endif
+
+static void save_eq_bands (WfWindow *self);
+
 static void
 dispose (GObject *object)
 {
     WfWindow *window = WF_WINDOW (object);
 
+    if (window->eq_save_id)
+        save_eq_bands (window);
+
+    /* Playback goes on without the window, the analysis for it only
+     * while another window shows it. */
+    if (window->counted_visible) {
+        window->counted_visible = FALSE;
+        wf_application_window_hidden (window->application);
+    }
+
+    g_clear_weak_pointer (&window->debug_window);
     g_clear_object (&window->player);
     g_clear_object (&window->waveform);
+    g_clear_object (&window->tracks);
+    g_clear_object (&window->thumbnailer);
+    g_clear_object (&window->covers);
+    g_clear_object (&window->eq_presets);
+    g_clear_object (&window->settings);
     G_OBJECT_CLASS (wf_window_parent_class)->dispose (object);
 }
 
@@ -114,19 +488,32 @@ file_opened_async_cb (GObject      *source,
 {
     GError *error = NULL;
     WfWindow *window = user_data;
-    GFile *file;
-    gchar *uri;
+    GListModel *files;
+    GPtrArray *array;
+    guint n_files;
 
-    file = gtk_file_dialog_open_finish (GTK_FILE_DIALOG (source), result, &error);
-    if (!file) {
+    files = gtk_file_dialog_open_multiple_finish (GTK_FILE_DIALOG (source), result, &error);
+    if (!files) {
         g_printerr ("Error: %s\n", error->message);
-        g_free (error);
+        g_error_free (error);
         return;
     }
 
-    uri = g_file_get_uri (file);
-    wf_waveform_set_file (window->waveform, uri);
-    wf_player_set_file (window->player, uri);
+    /* Opened through the application, as files from the command line are. */
+    n_files = g_list_model_get_n_items (files);
+    array = g_ptr_array_new_full (n_files, g_object_unref);
+    for (guint i = 0; i < n_files; i++)
+        g_ptr_array_add (array, g_list_model_get_item (files, i));
+
+    /* The queue is the files now, not the track list. */
+    if (n_files > 0) {
+        window->queue_refill = FALSE;
+        g_application_open (G_APPLICATION (gtk_window_get_application (GTK_WINDOW (window))),
+                            (GFile **) array->pdata, n_files, "");
+    }
+
+    g_ptr_array_unref (array);
+    g_object_unref (files);
 }
 
 static void
@@ -137,35 +524,331 @@ action_open_cb (GSimpleAction *action,
     GtkFileDialog *file_dialog;
 
     file_dialog = gtk_file_dialog_new ();
-    gtk_file_dialog_open (file_dialog, GTK_WINDOW (user_data), NULL,
-                          file_opened_async_cb, user_data);
+    gtk_file_dialog_open_multiple (file_dialog, GTK_WINDOW (user_data), NULL,
+                                   file_opened_async_cb, user_data);
     g_object_unref (file_dialog);
 }
 
+static void
+action_debug_cb (GSimpleAction *action,
+                 GVariant      *parameters,
+                 gpointer       user_data)
+{
+    WfWindow *window = WF_WINDOW (user_data);
+
+    if (!window->debug_window) {
+        window->debug_window = wf_debug_window_new (GTK_WINDOW (window), window->player);
+        g_object_add_weak_pointer (G_OBJECT (window->debug_window),
+                                   (gpointer *) &window->debug_window);
+    }
+
+    gtk_window_present (GTK_WINDOW (window->debug_window));
+}
+
 static void
 play_button_cb (GtkButton *button,
                 gpointer   user_data)
 {
     WfWindow *window = WF_WINDOW (user_data);
 
-    wf_player_play (window->player);
+    if (wf_player_get_playing (window->player))
+        wf_player_pause (window->player);
+    else
+        wf_player_play (window->player);
+}
+
+static void
+prev_button_cb (GtkButton *button,
+                gpointer   user_data)
+{
+    WfWindow *window = WF_WINDOW (user_data);
+
+    wf_player_prev (window->player);
+}
+
+static void
+next_button_cb (GtkButton *button,
+                gpointer   user_data)
+{
+    WfWindow *window = WF_WINDOW (user_data);
+
+    wf_player_next (window->player);
+}
+
+static void
+playing_changed_cb (WfWindow   *self,
+                    GParamSpec *pspec,
+                    gpointer    user_data)
+{
+    gtk_button_set_icon_name (GTK_BUTTON (self->play_button),
+                              wf_player_get_playing (self->player) ?
+                              "media-playback-pause-symbolic" : "play-symbolic");
 }
 
 static void
 position_changed_cb (WfWindow *self, guint64 pos, gpointer user_data)
 {
+    if (self->hidden) {
+        self->hidden_position = pos;
+        return;
+    }
+
     wf_seek_bar_set_position (self->seek_bar, pos);
 }
 
+/* The analysis is shared by all windows, the application runs it while
+ * any of them is shown. */
+
+static void
+update_visible (WfWindow *self)
+{
+    if (self->counted_visible == !self->hidden)
+        return;
+
+    self->counted_visible = !self->hidden;
+    if (self->counted_visible)
+        wf_application_window_shown (self->application);
+    else
+        wf_application_window_hidden (self->application);
+}
+
+/* A minimized window, or one on another workspace, is suspended. Nothing
+ * shows the spectra or the playhead then, so neither is updated until the
+ * window is back. */
+
+static void
+visibility_cb (WfWindow   *self,
+               GParamSpec *pspec,
+               gpointer    user_data)
+{
+    gboolean hidden;
+
+    hidden = !gtk_widget_get_visible (GTK_WIDGET (self)) ||
+             gtk_window_is_suspended (GTK_WINDOW (self));
+    if (self->hidden == hidden || !self->player)
+        return;
+
+    self->hidden = hidden;
+    if (hidden)
+        g_object_get (self->seek_bar, "position", &self->hidden_position, NULL);
+    update_visible (self);
+    if (!hidden)
+        wf_seek_bar_set_position (self->seek_bar, self->hidden_position);
+}
+
 static void
 duration_changed_cb (WfWindow *self, guint64 duration, gpointer user_data)
 {
     wf_seek_bar_set_duration (self->seek_bar, duration);
 }
 
+/* Moving on to the next sub-track moves both ends, the new start to where
+ * the old end was, so they are handed over together. */
+static void
+window_changed_cb (WfWindow *self,
+                   gpointer  user_data)
+{
+    guint64 start, end;
+
+    wf_player_get_window (self->player, &start, &end);
+    wf_seek_bar_set_window (self->seek_bar, start, end);
+}
+
+/* A loop dragged past its old start moves both ends, so they are handed
+ * over together as well. */
+static void
+player_loop_changed_cb (WfWindow *self,
+                        gpointer  user_data)
+{
+    guint64 start, end;
+
+    wf_player_get_loop (self->player, &start, &end);
+    wf_seek_bar_set_loop (self->seek_bar, start, end);
+}
+
 static void
 seeked_cb (WfWindow *self, guint64 pos, gpointer user_data)
 {
     wf_player_set_position (self->player, pos);
 }
 
+/* Stores the player's curve. The application hands it back to the player
+ * when it changes, which is then a no-op. A hand-edited curve no longer
+ * matches any preset. */
+static void
+save_eq_bands (WfWindow *self)
+{
+    WfEqBand bands[WF_EQUALIZER_MAX_BANDS];
+    guint n_bands;
+
+    g_clear_handle_id (&self->eq_save_id, g_source_remove);
+
+    n_bands = wf_player_get_eq_n_bands (self->player);
+    for (guint i = 0; i < n_bands; i++)
+        wf_player_get_eq_band (self->player, i, &bands[i]);
+
+    g_settings_set_value (self->settings, "eq-bands", wf_eq_bands_to_variant (bands, n_bands));
+    g_settings_set_string (self->settings, "eq-preset", "");
+}
+
+static gboolean
+save_eq_bands_cb (gpointer user_data)
+{
+    WfWindow *self = WF_WINDOW (user_data);
+
+    self->eq_save_id = 0;
+    save_eq_bands (self);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* The player takes the new gain at once; the settings only once the
+ * sliders rest, rather than on every step of a drag. */
+static void
+eq_gain_changed_cb (WfWindow *self,
+                    guint     index,
+                    gdouble   gain,
+                    gpointer  user_data)
+{
+    WfEqBand band;
+
+    if (!wf_player_get_eq_band (self->player, index, &band))
+        return;
+
+    band.gain = gain;
+    wf_player_set_eq_band (self->player, index, &band);
+
+    g_clear_handle_id (&self->eq_save_id, g_source_remove);
+    self->eq_save_id = g_timeout_add (EQ_SAVE_DELAY, save_eq_bands_cb, self);
+
+    self->eq_updating = TRUE;
+    gtk_drop_down_set_selected (self->eq_preset_dropdown, GTK_INVALID_LIST_POSITION);
+    self->eq_updating = FALSE;
+}
+
+static void
+eq_preset_cb (WfWindow   *self,
+              GParamSpec *pspec,
+              gpointer    user_data)
+{
+    GVariant *presets, *bands;
+    const gchar *name;
+    guint selected;
+
+    selected = gtk_drop_down_get_selected (self->eq_preset_dropdown);
+    if (self->eq_updating || selected == GTK_INVALID_LIST_POSITION)
+        return;
+
+    name = gtk_string_list_get_string (self->eq_presets, selected);
+    presets = g_settings_get_value (self->settings, "eq-presets");
+    bands = g_variant_lookup_value (presets, name, G_VARIANT_TYPE ("a(iddd)"));
+    g_variant_unref (presets);
+    if (!bands)
+        return;
+
+    /* A hand-edited curve waiting to be stored is replaced. */
+    g_clear_handle_id (&self->eq_save_id, g_source_remove);
+    apply_eq_bands (self, bands);
+    g_settings_set_value (self->settings, "eq-bands", bands);
+    g_settings_set_string (self->settings, "eq-preset", name);
+    g_variant_unref (bands);
+}
+
+static void
+loop_changed_cb (WfWindow *self,
+                 guint64   start,
+                 guint64   end,
+                 gpointer  user_data)
+{
+    wf_player_set_loop (self->player, start, end);
+}
+
+static void
+search_changed_cb (WfWindow       *self,
+                   GtkSearchEntry *entry)
+{
+    if (self->tracks)
+        wf_track_list_set_filter (self->tracks, gtk_editable_get_text (GTK_EDITABLE (entry)));
+}
+
+static void
+sort_changed_cb (WfWindow   *self,
+                 GParamSpec *pspec,
+                 gpointer    user_data)
+{
+    guint selected;
+
+    /* The dropdown lists the sorts in the order of WfTrackSort. */
+    selected = gtk_drop_down_get_selected (self->sort_dropdown);
+    if (self->tracks)
+        wf_track_list_set_sort (self->tracks, selected <= WF_TRACK_SORT_DURATION ? selected : WF_TRACK_SORT_NONE);
+}
+
+/* Queues up to QUEUE_AHEAD tracks from @position on, in the order shown,
+ * in place of the queue or after it. */
+static void
+queue_tracks (WfWindow *self,
+              guint     position,
+              gboolean  replace)
+{
+    GtkApplication *app;
+    WfTrackStore *store;
+    GPtrArray *uris;
+    gint index;
+
+    app = gtk_window_get_application (GTK_WINDOW (self));
+    store = wf_library_get_store (wf_application_get_library (WF_APPLICATION (app)));
+
+    uris = g_ptr_array_new ();
+    for (guint p = position; p < position + QUEUE_AHEAD; p++) {
+        index = wf_track_list_get_index (self->tracks, p);
+        if (index < 0)
+            break;
+        g_ptr_array_add (uris, (gpointer) wf_track_store_get_uri (store, index));
+    }
+
+    if (replace)
+        self->queue_start = position;
+    self->queue_end = position + uris->len;
+    self->queue_refill = uris->len == QUEUE_AHEAD;
+    g_ptr_array_add (uris, NULL);
+
+    if (uris->len > 1 && replace) {
+        wf_application_set_queue (WF_APPLICATION (app), (const gchar * const *) uris->pdata);
+        wf_player_play (self->player);
+    } else if (uris->len > 1) {
+        wf_player_append_queue (self->player, (const gchar * const *) uris->pdata);
+    }
+    g_ptr_array_unref (uris);
+}
+
+/* Plays from the activated row on. */
+static void
+track_activated_cb (WfWindow *self,
+                    guint     position,
+                    gpointer  user_data)
+{
+    queue_tracks (self, position, TRUE);
+}
+
+static void
+queue_uri_cb (WfWindow   *self,
+              GParamSpec *pspec,
+              gpointer    user_data)
+{
+    guint position;
+
+    /* Every entry notifies, sub-tracks of the same file too, so this goes
+     * by the place in the queue rather than the uri. */
+    position = self->queue_start + wf_player_get_queue_position (self->player);
+    if (self->queue_refill && position + QUEUE_AHEAD / 2 >= self->queue_end)
+        queue_tracks (self, self->queue_end, FALSE);
+}
+
+/* The peaks of the track just analyzed are in the cache now. */
+static void
+waveform_ready_cb (WfWindow   *self,
+                   WfWaveform *waveform)
+{
+    wf_thumbnailer_invalidate (self->thumbnailer, wf_waveform_get_uri (waveform));
+}